@@ -164,6 +164,13 @@ namespace PeterDB {
                     code = error("I expect <tableName>");
             }
 
+                ////////////////////////////////////////////
+                // analyze <tableName>
+                ////////////////////////////////////////////
+            else if (expect(tokenizer, "analyze")) {
+                code = analyzeTable();
+            }
+
                 ///////////////////////////////////////////////////////////////
                 // insert into <tableName> tuple(attr1=val1, attr2=value2, ...)
                 ///////////////////////////////////////////////////////////////
@@ -1437,6 +1444,46 @@ namespace PeterDB {
         return this->printOutputBuffer(outputBuffer, 2);
     }
 
+// print page usage of given tableName
+    RC CLI::analyzeTable() {
+        char *tokenizer = next();
+        if (tokenizer == NULL)
+            return error("I expect tableName to analyze");
+
+        std::string tableName = std::string(tokenizer);
+        HeapStats stats;
+        if (rm.analyzeTable(tableName, stats) != 0)
+            return error("table: " + tableName + " cannot be analyzed");
+
+        std::vector <std::string> outputBuffer;
+        outputBuffer.emplace_back("statistic");
+        outputBuffer.emplace_back("value");
+        auto add = [&outputBuffer](const std::string &name, unsigned long value) {
+            outputBuffer.push_back(name);
+            outputBuffer.push_back(std::to_string(value));
+        };
+
+        add("pages", stats.pages);
+        for (unsigned i = 0; i < stats.fillHistogram.size(); i++)
+            add("pages " + std::to_string(i * 100 / HEAP_FILL_BUCKETS) + "-" +
+                std::to_string((i + 1) * 100 / HEAP_FILL_BUCKETS) + "% full", stats.fillHistogram[i]);
+        add("records", stats.records);
+        add("free bytes", stats.freeBytes);
+        add("fragmented bytes", stats.fragmentedBytes);
+        add("reclaimable bytes", stats.reclaimableBytes);
+        add("empty slots", stats.emptySlots);
+        add("tombstones", stats.chains.tombstones);
+        add("forwarding chains", stats.chains.chains);
+        for (unsigned length = 1; length < stats.chains.chainLengths.size(); length++)
+            if (stats.chains.chainLengths[length] != 0)
+                add("chains of " + std::to_string(length) + " tombstones", stats.chains.chainLengths[length]);
+        for (unsigned version = 0; version < stats.versions.size(); version++)
+            if (stats.versions[version] != 0)
+                add("records of version " + std::to_string(version), stats.versions[version]);
+
+        return this->printOutputBuffer(outputBuffer, 2);
+    }
+
 // print every tuples in given tableName
     RC CLI::printTable(const std::string& tableName) {
         std::vector <Attribute> attributes;
@@ -1503,6 +1550,9 @@ namespace PeterDB {
             std::cout << "\tprint <tableName>: print every record in tableName" << std::endl;
             std::cout << "\tprint attributes <tableName>: print columns of given tableName" << std::endl;
             std::cout << "\tprint index <attributeName> on <tableName>: print columns of given tableName" << std::endl;
+        } else if (input == "analyze") {
+            std::cout << "\tanalyze <tableName>: print page fill, free space, tombstones and record versions of tableName"
+                 << std::endl;
         } else if (input == "load") {
             std::cout << "\tload <tableName> \"fileName\"";
             std::cout << ": loads given filName to given table" << std::endl;
@@ -1536,6 +1586,7 @@ namespace PeterDB {
             help("create");
             help("drop");
             help("print");
+            help("analyze");
             help("insert");
             help("load");
             help("help");
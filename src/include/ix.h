@@ -3,15 +3,33 @@
 
 #include <vector>
 #include <string>
+#include <cstdio>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 #include "pfm.h"
 #include "rbfm.h" // for some type declarations only, e.g., RID and Attribute
 
 # define IX_EOF (-1)  // end of the index scan
+# define BULK_LOAD_MEMORY (1024 * PAGE_SIZE)  // bytes of entries a bulk load sorts in memory before spilling a run
+# define DEFAULT_INDEX_FILL_FACTOR 90  // bulk-loaded B+ tree nodes keep room for the inserts that follow
+# define LEAF_LATCH_STRIPES 64  // leaves share latches and version counters by page number modulo this
 
 namespace PeterDB {
+    // Recorded in the hidden page of an index file, the way record files keep their page layout
+    typedef enum {
+        IndexBTree = 0,     // B+ tree, scanned in key order
+        IndexHash,          // extendible hash, answers an equality scan from one bucket
+        IndexPrefixBTree,   // B+ tree whose varchar nodes store their keys after the prefix they share, and whose
+                            // separators keep only the bytes that tell two neighbouring leaves apart
+        IndexPostingBTree   // IndexPrefixBTree whose leaves store each key once, followed by the list of its RIDs
+    } IndexKind;
+
     class IX_ScanIterator;
 
+    class IX_BulkLoader;
+
     class IXFileHandle;
 
     template <typename T>
@@ -38,16 +56,20 @@ namespace PeterDB {
 
     class IndexManager {
         friend class IX_ScanIterator;
+        friend class IX_BulkLoader;
 
     public:
         static IndexManager &instance();
 
         // Create an index file.
-        RC createFile(const std::string &fileName);
+        RC createFile(const std::string &fileName, IndexKind kind = IndexBTree);
 
         // Delete an index file.
         RC destroyFile(const std::string &fileName);
 
+        // Rename an index file, replacing any index at newFileName.
+        RC renameFile(const std::string &fileName, const std::string &newFileName);
+
         // Open an index and return an ixFileHandle.
         RC openFile(const std::string &fileName, IXFileHandle &ixFileHandle);
 
@@ -60,18 +82,37 @@ namespace PeterDB {
         // Delete an entry from the given index that is indicated by the given ixFileHandle.
         RC deleteEntry(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid);
 
-        // Initialize and IX_ScanIterator to support a range search
+        // Initialize and IX_ScanIterator to support a range search. A hash index returns its entries in no particular
+        // order, and reads only the key's bucket when both bounds are the same inclusive key. A descending scan returns
+        // the entries from the high key down, which a hash index cannot do.
         RC scan(IXFileHandle &ixFileHandle,
                 const Attribute &attribute,
                 const void *lowKey,
                 const void *highKey,
                 bool lowKeyInclusive,
                 bool highKeyInclusive,
-                IX_ScanIterator &ix_ScanIterator);
+                IX_ScanIterator &ix_ScanIterator,
+                bool descending = false);
 
-        // Print the B+ tree in pre-order (in a JSON record format)
+        // Print the B+ tree in pre-order (in a JSON record format). Hash indexes cannot be printed.
         RC printBTree(IXFileHandle &ixFileHandle, const Attribute &attribute, std::ostream &out) const;
 
+        // A composite key over several attributes is encoded into one varchar key whose bytes order like the attribute
+        // values compared one after the other, nulls first. A composite index is then an ordinary index on the varchar
+        // attribute returned by compositeAttribute, and the keys sharing values of the leading attributes form one range.
+        Attribute compositeAttribute(const std::vector<Attribute> &keyAttrs) const;
+
+        // "data" is a tuple of keyAttrs in the insertRecord() format, "key" receives its varchar key
+        void encodeCompositeKey(const std::vector<Attribute> &keyAttrs, const void *data, void *key) const;
+
+        // Reverse of encodeCompositeKey
+        void decodeCompositeKey(const std::vector<Attribute> &keyAttrs, const void *key, void *data) const;
+
+        // Inclusive bounds of the keys whose first prefixCount attributes hold the values in "data", a tuple of those
+        // attributes in the insertRecord() format
+        void compositePrefixRange(const std::vector<Attribute> &keyAttrs, const void *data, unsigned prefixCount,
+                                  void *lowKey, void *highKey) const;
+
     protected:
         IndexManager() = default;                                                   // Prevent construction
         ~IndexManager() = default;                                                  // Prevent unwanted destruction
@@ -80,17 +121,55 @@ namespace PeterDB {
 
         SizeType nodeEntrySize(const Attribute & attr, const void *key, bool isLeafPage) const;
         RC insertEntryIntoEmptyIndex(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid);
-        char * putEntryOnPage(char *pagePtr, const Attribute &attr, const void *key, const RID &rid, unsigned childPage = 0);
-        char * determinePos(char *pagePtr, const Attribute &attr, const void *key, const RID &rid, char *endPtr, bool isLeaf, int typeOfSearch);
+        // prefixLength leading key bytes are left out of the entry, those of a prefix-compressed node
+        char * putEntryOnPage(char *pagePtr, const Attribute &attr, const void *key, const RID &rid, unsigned childPage = 0, SizeType prefixLength = 0);
+        char * determinePos(char *pagePtr, const Attribute &attr, const void *key, const RID &rid, char *endPtr, bool isLeaf, int typeOfSearch,
+                            const char *prefix = nullptr, SizeType prefixLength = 0);
         void shiftEntriesRight(char *oldLoc, char *newLoc, SizeType bytesToShift);
         void shiftEntriesLeft(char *oldLoc, char *newLoc, SizeType bytesToShift);
-        void splitLeaf(IXFileHandle &fh, char *leftPage, char *rightPage, const Attribute &attr, const void *key, const RID &rid, char *insertPos);
-        void splitNode(IXFileHandle &fh, char *leftPage, char *rightPage, const Attribute &attr, const void *key, const RID &rid, unsigned pageNum, char *insertPos, void *pushUpKey);
-        RC getLeafPage(IXFileHandle &fh, char *pageData, unsigned &pageNum, const Attribute &attr, const void *key, const RID &rid);
+        void splitLeaf(unsigned rightPageNum, char *leftPage, char *rightPage, const Attribute &attr, const void *key, const RID &rid, char *insertPos, SizeType prefixLength = 0);
+        // A posting leaf is changed as the whole entries it holds, with the entry added or removed, then stored again
+        RC editPostings(char *page, const Attribute &attr, bool compressed, const void *key, const RID &rid, bool isInsertion, std::vector<char> &entries);
+        void splitPostingLeaf(unsigned rightPageNum, char *leftPage, char *rightPage, const Attribute &attr, const void *key, const RID &rid,
+                              const char *prefix, SizeType prefixLength);
+        void splitNode(IXFileHandle &fh, char *leftPage, char *rightPage, const Attribute &attr, const void *key, const RID &rid, unsigned pageNum, char *insertPos, void *pushUpKey,
+                       const char *prefix = nullptr, SizeType prefixLength = 0);
+        RC getLeafPage(IXFileHandle &fh, char *pageData, unsigned &pageNum, const Attribute &attr, const void *key, const RID &rid, unsigned *leafVersion = nullptr, bool *isRoot = nullptr);
         RC printSubtree(unsigned pageNum, int indents, IXFileHandle &fh, const Attribute &attr, std::ostream &out) const;
-        void printPageKeys(char * const pagePtr, bool isLeafPage, char * const endPos, const Attribute &attr, std::ostream &out) const;
-        RC visitInsertNode(IXFileHandle &fh, char *pageData, unsigned pageNum, const Attribute &attr, const void *key, const RID &rid, bool & needSplit, void *pushUpKey, RID &pushUpRID, unsigned &childPage);
+        void printPageKeys(char * const pagePtr, bool isLeafPage, char * const endPos, const Attribute &attr, std::ostream &out,
+                           const char *prefix = nullptr, SizeType prefixLength = 0) const;
+        RC insertWithSplits(IXFileHandle &fh, const Attribute &attr, const void *key, const RID &rid);
+        RC deleteWithMerges(IXFileHandle &fh, const Attribute &attr, const void *key, const RID &rid);
+        // Insert or delete in the key's leaf under its latch, when that needs no split or merge. done tells whether it did.
+        RC updateLeaf(IXFileHandle &fh, const Attribute &attr, const void *key, const RID &rid, bool isInsertion, bool &done);
+        // lowFence and highFence are the keys of the separators around the node in its parent, null at the ends of the tree
+        RC visitInsertNode(IXFileHandle &fh, char *rootPtr, char *pageData, unsigned pageNum, const Attribute &attr, const void *key, const RID &rid, bool & needSplit, void *pushUpKey, RID &pushUpRID, unsigned &childPage,
+                           const char *lowFence, const char *highFence);
         RC createNewRoot(IXFileHandle &fh, char *rootPage, char *rootPtr, const Attribute &attr, const void *rootKey, const RID &rootRID, unsigned childPage);
+        RC visitDeleteNode(IXFileHandle &fh, char *rootPtr, char *pageData, unsigned pageNum, const Attribute &attr, const void *key, const RID &rid, bool &underflow);
+        RC rebalanceLeaves(IXFileHandle &fh, char *rootPtr, char *parent, const Attribute &attr, char *sepPos, char *leftPage, unsigned leftNum, char *rightPage, unsigned rightNum);
+        RC rebalanceNodes(IXFileHandle &fh, char *rootPtr, char *parent, const Attribute &attr, char *sepPos, char *leftPage, unsigned leftNum, char *rightPage, unsigned rightNum);
+
+        // Pages freed by merges are chained from page 0 and handed out again before the file grows. A page numbered
+        // pageCount is not in the file yet, and placePage appends it.
+        RC allocatePage(IXFileHandle &fh, char *rootPtr, unsigned &pageNum);
+        RC placePage(IXFileHandle &fh, unsigned pageNum, const char *pageData);
+        RC freePage(IXFileHandle &fh, char *rootPtr, unsigned pageNum);
+
+        // A hash index keeps its global depth, free list and the pages of its directory on page 0. Directory entries
+        // point at buckets, each chaining overflow pages for entries that splitting the bucket cannot separate. New
+        // entries go on a bucket's first page, whose entries move to a new overflow page when it is full.
+        RC hashInsert(IXFileHandle &fh, const Attribute &attr, const void *key, const RID &rid);
+        RC hashDelete(IXFileHandle &fh, const Attribute &attr, const void *key, const RID &rid);
+        RC hashBucket(IXFileHandle &fh, const char *header, unsigned hash, unsigned &bucketPage);
+        RC doubleDirectory(IXFileHandle &fh, char *header);
+        RC splitBucket(IXFileHandle &fh, char *header, const Attribute &attr, unsigned hash, SizeType entrySize, unsigned bucketPage,
+                       const char *bucketHead, bool &split);
+        size_t inseparableBytes(const Attribute &attr, const char *page, unsigned hash) const;
+        RC writeBucketChain(IXFileHandle &fh, char *header, const Attribute &attr, unsigned pageNum, unsigned char localDepth,
+                            const std::vector<const char *> &entries, std::vector<unsigned> &spare);
+        RC hashEntries(IXFileHandle &fh, const Attribute &attr, const void *lowKey, const void *highKey, bool lowKeyInclusive,
+                       bool highKeyInclusive, std::vector<char> &entries);
     };
 
     class IX_ScanIterator {
@@ -105,6 +184,37 @@ namespace PeterDB {
         char *endPos;
         unsigned nextPageNum;
         bool firstScan;
+        char lastEntry[PAGE_SIZE];      // last returned entry, to find the scan's place again after the index changed
+        unsigned writesSeen;
+        bool lastEntryKept;
+        std::vector<char> hashMatches;  // entries of a hash index in range, gathered by the first getNextEntry
+        size_t hashPos;
+        std::vector<char> leafEntries;  // whole entries of the current leaf, when it holds posting lists or the scan descends
+        bool descending;
+        // Leaves are linked forward only, so a descending scan keeps the children of each node above its leaf, and
+        // which of them it is under, to step back a leaf
+        std::vector<std::vector<unsigned>> pathChildren;
+        std::vector<unsigned> pathIndex;
+
+        // sets currPos and endPos to the entries of the leaf in currPage, and nextPageNum to the leaf after it. A
+        // descending scan gets the entries in reverse order.
+        void startLeaf();
+
+        // reads into currPage the leaf under pageNum where the entry would go, the last leaf without a key, and keeps
+        // the path to it
+        RC descendTo(unsigned pageNum, const void *key, const RID &rid);
+
+        // reads the leaf before the current one, IX_EOF at the first leaf
+        RC previousLeaf();
+
+        // whether currPage still is a leaf whose first entry in scan order comes after the last entry returned. Other
+        // handles may have merged leaves since the link or path to it was read, freeing it or reusing it elsewhere.
+        bool leafFollows(bool compressed);
+
+        // find the scan's place again from the root: after the last entry returned, or at the low key (high key when
+        // descending) before any was
+        RC resumeAscending(bool compressed);
+        RC resumeDescending();
 
         // 0 for accepted key, 1 for rejected key, 2 for no more possible acceptable keys (IX_EOF)
         int acceptKey(RID &rid, void *key);
@@ -118,7 +228,8 @@ namespace PeterDB {
         ~IX_ScanIterator();
 
         // initialize all data members after IndexManager::scan() is called on this iterator
-        void init(IXFileHandle &fh, const Attribute &attr, const void *lowKey, const void *highKey, bool lowKeyInclusive, bool highKeyInclusive);
+        void init(IXFileHandle &fh, const Attribute &attr, const void *lowKey, const void *highKey, bool lowKeyInclusive, bool highKeyInclusive,
+                  bool descending = false);
 
         // Get next matching entry
         RC getNextEntry(RID &rid, void *key);
@@ -127,13 +238,87 @@ namespace PeterDB {
         RC close();
     };
 
+    // Builds an index bottom-up from entries added in any order: they are sorted, in runs spilled to temporary files once
+    // more than memoryBytes of them are held, then packed into leaves and internal nodes filled up to fillFactor
+    // percent of a page. The index must be empty.
+    class IX_BulkLoader {
+        IXFileHandle *fh;
+        Attribute attr;
+        unsigned fillFactor;
+        size_t memoryBytes;
+        std::vector<char> entries;              // leaf entries added since the last run was spilled, back to back
+        std::vector<size_t> entryOffsets;
+        std::vector<FILE *> runs;               // sorted runs, removed once closed
+
+        std::vector<char> leafEntries;          // entries of the leaf being filled, with whole keys
+        size_t lastLeafEntry;
+        unsigned leafEntryCount;
+        size_t leafBytes;                       // bytes its entries take in the leaf, before any prefix is left out
+        unsigned leafKeys;                      // keys stored in those bytes, fewer than the entries in posting lists
+        std::vector<char> lowFence;             // key of the separator before that leaf, empty for the first leaf
+        std::vector<char> separators;           // separator and page of every leaf after the first, as node entries
+
+        RC spillRun();
+        RC addSorted(const char *entry);
+        // writes the leaf up to "end", "next" is the entry after it, or null for the last leaf
+        RC writeLeaf(size_t end, const char *next);
+        RC buildNodes(unsigned &rootPage);
+
+    public:
+        IX_BulkLoader();
+        ~IX_BulkLoader();
+
+        void init(IXFileHandle &fh, const Attribute &attr, unsigned fillFactor = DEFAULT_INDEX_FILL_FACTOR, size_t memoryBytes = BULK_LOAD_MEMORY);
+
+        // "key" follows the same format as in IndexManager::insertEntry(). A hash index takes it right away.
+        RC addEntry(const void *key, const RID &rid);
+
+        // Sort what was added and write the tree
+        RC finish();
+    };
+
+    // A reader-writer latch whose writers go ahead of readers arriving after them
+    class TreeLatch {
+        std::mutex mutex;
+        std::condition_variable released;
+        unsigned readers = 0;
+        unsigned writersWaiting = 0;
+        bool writer = false;
+
+    public:
+        void lock();
+        void unlock();
+        void lockShared();
+        void unlockShared();
+    };
+
+    // Threads sharing one handle may insert, delete and scan concurrently. Operations that keep the shape of a B+ tree
+    // hold treeLatch shared and change a leaf under its latch, while splits and merges hold treeLatch alone. A leaf's
+    // version counter moves on with every such change, so a leaf read before it was latched is read again only when
+    // it changed meanwhile. Hash index updates hold treeLatch alone.
     class IXFileHandle : public FileHandle {
+        std::mutex ioLatch;                                     // the file stream serves one page at a time
+
     public:
+        TreeLatch treeLatch;
+        std::mutex leafLatches[LEAF_LATCH_STRIPES];
+        std::atomic<unsigned> leafVersions[LEAF_LATCH_STRIPES];
+        std::mutex headerLatch;
+        std::vector<char> hashHeader;                           // page 0 of a hash index as scans last read it
+
         // Constructor
         IXFileHandle();
 
         // Destructor
         ~IXFileHandle();
+
+        // FileHandle's page I/O, under ioLatch
+        RC readPage(PageNum pageNum, void *data);
+        RC writePage(PageNum pageNum, const void *data);
+        RC appendPage(const void *data);
+
+        // Pages written and appended so far
+        unsigned pageWrites();
     };
 
 }// namespace PeterDB
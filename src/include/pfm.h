@@ -2,6 +2,7 @@
 #define _pfm_h_
 
 #define PAGE_SIZE 4096
+#define FULL_FILL_FACTOR 100
 
 #include <string>
 #include <fstream>
@@ -12,6 +13,7 @@ namespace PeterDB {
     typedef int RC;
 
     class FileHandle;
+    struct RecordLayout;
 
     class PagedFileManager {
     public:
@@ -19,6 +21,7 @@ namespace PeterDB {
 
         RC createFile(const std::string &fileName);                         // Create a new file
         RC destroyFile(const std::string &fileName);                        // Destroy a file
+        RC renameFile(const std::string &fileName, const std::string &newFileName);  // Rename a file, replacing any at newFileName
         RC openFile(const std::string &fileName, FileHandle &fileHandle);   // Open a file
         RC closeFile(FileHandle &fileHandle);                               // Close a file
 
@@ -40,11 +43,16 @@ namespace PeterDB {
         unsigned writePageCounter;
         unsigned appendPageCounter;
         unsigned pageCount;
+        unsigned pageLayout;                                                // Record layout of the data pages, set at creation
+        FileHandle *zoneMap;                                                // Companion file of per-page value ranges, if any
+        unsigned fillFactor;                                                // Percent of a data page inserts may fill, set on open
+        unsigned insertHint;                                                // Row group columnar inserts try first, kept in the hidden page
+        const RecordLayout *recordLayout;                                   // Value offsets of the descriptor written with, if known
 
         FileHandle();                                                       // Default constructor
         FileHandle(const FileHandle & fh);
         ~FileHandle();                                              // Destructor
-        FileHandle & operator = (const FileHandle & other);                 // Assigns counters, not open file
+        FileHandle & operator = (const FileHandle & other);                 // Assigns counters and zone map, not open file
 
         RC initFileHandle(const std::string &fileName);             // Pull info from file's first page
         RC readPage(PageNum pageNum, void *data);                           // Get a specific page
@@ -4,6 +4,7 @@
 #include <vector>
 #include <string>
 #include <limits>
+#include <cstring>
 
 #include "rm.h"
 #include "ix.h"
@@ -11,6 +12,7 @@
 namespace PeterDB {
 
 #define QE_EOF (-1)  // end of the index scan
+#define INDEX_SCAN_BATCH 32  // index entries whose tuples IndexScan fetches together
     enum AggregateOp {
         MIN = 0, MAX, COUNT, SUM, AVG
     };
@@ -110,35 +112,62 @@ namespace PeterDB {
         std::vector<Attribute> attrs;
         char key[PAGE_SIZE];
         RID rid;
+        // tuples of the next index entries, fetched in page order and returned in key order
+        std::vector<RID> batchRids;
+        std::vector<unsigned> batchOffsets;
+        std::vector<char> batchData;
+        unsigned batchPos = 0;
+        bool entriesDone = false;
+        bool indexOnly;         // tuples hold the indexed attribute alone, read from the index leaves
+        bool descending;        // tuples come from the highest key down
+
+        RC fetchBatch() {
+            batchRids.clear();
+            batchPos = 0;
+            while (!entriesDone && batchRids.size() < INDEX_SCAN_BATCH) {
+                if (iter.getNextEntry(rid, key) != 0) entriesDone = true;
+                else batchRids.push_back(rid);
+            }
+            if (batchRids.empty()) return QE_EOF;
+            batchData.resize(batchRids.size() * PAGE_SIZE);
+            return rm.readTuples(tableName, batchRids, batchData.data(), batchOffsets);
+        }
+
     public:
+        // indexOnly suits queries that need no attribute besides the indexed one, e.g. counting the tuples in a key
+        // range, and skips reading the table altogether. A descending scan gives the largest keys first, so a MAX or
+        // top-N query reads only the last leaves.
         IndexScan(RelationManager &rm, const std::string &tableName, const std::string &attrName,
-                  const char *alias = nullptr) : rm(rm), rid() {
+                  const char *alias = nullptr, bool indexOnly = false, bool descending = false)
+                  : rm(rm), rid(), indexOnly(indexOnly), descending(descending) {
             // Set members
             this->tableName = tableName;
             this->attrName = attrName;
 
             // Get Attributes from RM
-            rm.getAttributes(tableName, attrs);
+            rm.getAttributes(tableName, attrs, nullptr, nullptr, nullptr, indexOnly ? attrName : "");
 
             // Call rm indexScan to get iterator
-            rm.indexScan(tableName, attrName, nullptr, nullptr, true, true, iter);
+            rm.indexScan(tableName, attrName, nullptr, nullptr, true, true, iter, descending);
 
             // Set alias
             if (alias) this->tableName = alias;
         }
 
-        // Start a new iterator given the new key range
+        // Start a new iterator given the new key range, on the index file the constructor opened
         void setIterator(void *lowKey, void *highKey, bool lowKeyInclusive, bool highKeyInclusive) {
-            iter.close();
-            rm.indexScan(tableName, attrName, lowKey, highKey, lowKeyInclusive, highKeyInclusive, iter);
+            iter.rescan(lowKey, highKey, lowKeyInclusive, highKeyInclusive);
+            batchRids.clear();
+            batchPos = 0;
+            entriesDone = false;
         }
 
         RC getNextTuple(void *data) override {
-            RC rc = iter.getNextEntry(rid, key);
-            if (rc == 0) {
-                rc = rm.readTuple(tableName, rid, data);
-            }
-            return rc;
+            if (indexOnly) return iter.getNextKeyTuple(rid, data) == 0 ? 0 : QE_EOF;
+            if (batchPos == batchRids.size() && fetchBatch() != 0) return QE_EOF;
+            const char *tuple = batchData.data() + batchOffsets[batchPos++];
+            memmove(data, tuple, RecordBasedFileManager::instance().recordLength(attrs, tuple));
+            return 0;
         }
 
         RC getAttributes(std::vector<Attribute> &attributes) const override {
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <unordered_map>
+#include <map>
 #include "pfm.h"
 
 namespace PeterDB {
@@ -39,6 +40,81 @@ namespace PeterDB {
         AttrLength length; // attribute length
     } Attribute;
 
+    // Page layout of a record-based file, chosen when the file is created
+    typedef enum {
+        LayoutSlotted = 0,  // slotted pages holding whole records
+        LayoutPax,          // PAX pages grouping each attribute's values into a minipage
+        LayoutColumnar      // row groups storing each attribute's values on pages of their own
+    } PageLayout;
+
+    // Geometry of a PAX page for one record descriptor
+    struct PaxGeometry {
+        SizeType capacity = 0;                  // number of record slots on the page
+        SizeType bitmapBytes = 0;               // bytes used by the presence bitmap and each null bitmap
+        std::vector<SizeType> minipageOffsets;  // start of each attribute's minipage (its null bitmap)
+        std::vector<SizeType> fieldWidths;      // fixed bytes reserved for each attribute value
+    };
+
+    // An open zone map keeps its capacity and the entry page last changed in memory. The page is written back once
+    // another entry page is needed or the file is closed, so writes to neighbouring data pages share one zone map write.
+    struct ZoneMapHandle : public FileHandle {
+        SizeType capacity = 0;                  // attributes tracked per entry, 0 until read
+        unsigned cachedPageNum = 0;
+        bool pageCached = false;
+        bool pageDirty = false;
+        char cachedPage[PAGE_SIZE];
+    };
+
+    // Geometry of a columnar row group: a header page, then one chunk of pages per attribute
+    struct ColumnarGeometry {
+        SizeType capacity = 0;                  // number of rows in the row group
+        SizeType bitmapBytes = 0;               // bytes used by the presence bitmap and each null bitmap
+        unsigned groupPages = 0;                // header page plus every chunk page
+        std::vector<unsigned> chunkOffsets;     // first page of each attribute's chunk, counted from the header page
+        std::vector<SizeType> fieldWidths;      // fixed bytes reserved for each attribute value
+        std::vector<SizeType> valuesPerPage;    // values of each attribute that fit on one chunk page
+    };
+
+    // Value offsets shared by every record of a descriptor: the leading attributes that are not varchar sit at fixed
+    // offsets from the first value whenever the record has no nulls. Computed once per schema and set on the file handle
+    struct RecordLayout {
+        SizeType numFields = 0;                 // attributes of the descriptor the layout was computed for
+        SizeType fixedPrefix = 0;               // number of leading fixed-width attributes
+        std::vector<SizeType> prefixOffsets;    // offset of each of them, followed by the end of the last one
+    };
+
+    // Forwarding chains of a record-based file, as found by a vacuum before it changes anything
+    struct ChainStats {
+        unsigned tombstones = 0;                // forwarding tombstones in the file
+        unsigned chains = 0;                    // records reached through at least one tombstone
+        unsigned maxChainLength = 0;            // most tombstones followed to reach a record
+        std::vector<unsigned> chainLengths;     // chainLengths[n] is the number of chains of n tombstones
+        unsigned collapsed = 0;                 // chains shortened to a single tombstone
+        unsigned reclaimed = 0;                 // tombstones removed
+    };
+
+    // What a block sample of a record-based file looked at, e.g. to scale counts up to the whole file
+    struct SampleStats {
+        unsigned pagesInFile = 0;
+        unsigned pagesSampled = 0;
+        unsigned recordsSeen = 0;               // records on the sampled pages, the sample is drawn from these
+    };
+
+# define HEAP_FILL_BUCKETS 10  // buckets of the page fill histogram, each a tenth of a page wide
+
+    // Page usage of a record-based file, gathered in one pass to decide when to vacuum or rebuild it
+    struct HeapStats {
+        unsigned pages = 0;
+        unsigned records = 0;                   // live records, tombstones excluded
+        std::vector<unsigned> fillHistogram;    // fillHistogram[i] is the number of pages between i and i + 1 tenths full
+        unsigned long freeBytes = 0;            // free space over all pages, kept in one piece on each page
+        unsigned long fragmentedBytes = 0;      // free space on pages too full to take a record of average size
+        unsigned long reclaimableBytes = 0;     // tombstones and empty slot entries, given back by a rebuild
+        unsigned emptySlots = 0;                // slot entries of deleted records, waiting to be reused
+        ChainStats chains;                      // tombstones and the forwarding chains they form
+        std::vector<unsigned> versions;         // versions[v] is the number of records written with schema version v
+    };
+
     // Comparison Operator (NOT needed for part 1 of the project)
     typedef enum {
         EQ_OP = 0, // no condition// =
@@ -79,28 +155,54 @@ namespace PeterDB {
         float valueReal;
         std::string valueString;
         std::vector<std::string> attributeNames;
+        std::vector<Attribute> projectedDescriptor;
         bool firstScan;
         unsigned lastPageNum;
         unsigned short lastSlotNum;
+        std::string rowGroupHeader;             // columnar scans keep the current row group header
+        unsigned rowGroupPageNum;
+        std::vector<std::string> columnPages;   // and the last chunk page read for each attribute
+        std::vector<unsigned> columnPageNums;
+        bool batchInProgress;                   // keeps the cached pages between the records of one batch
+        int conditionAttrIndex;                 // position of the condition attribute in the scan's descriptor
+        SizeType scanVersion;                   // schema version of that descriptor, zone maps of other versions are not used
+        SizeType zoneCapacity;                  // attributes tracked by each zone map entry, 0 until read
+        std::string zonePage;                   // last zone map page read
+        unsigned zonePageNum;
 
         bool acceptedRecord(unsigned pageNum, unsigned short slotNum);
         void extractRecordData(const char * recordData, void * data);
         bool compareInt(int conditionAttr);
         bool compareReal(float conditionAttr);
         bool compareVarchar(const std::string & conditionAttr);
+        bool acceptedField(const char * field);
+        RC getNextPaxRecord(RID &rid, void *data, SizeType *version, bool *recoAccepted, bool *verifyRecord);
+        void extractPaxRecordData(const char * pageData, const PaxGeometry &geometry, SizeType slotNum, void * data);
+        void clearColumnCache();
+        RC readRowGroupHeader(unsigned groupPageNum);
+        RC readColumnField(const ColumnarGeometry &geometry, int attrIndex, SizeType slotNum, const char *& field);
+        RC getNextColumnarRecord(RID &rid, void *data, SizeType *version, bool *recoAccepted, bool *verifyRecord);
+        RC extractColumnarRecordData(const ColumnarGeometry &geometry, SizeType slotNum, void * data);
+        bool pageMayMatch(unsigned pageNum);
 
     public:
-        RBFM_ScanIterator() : fileHandle(nullptr) {}
+        RBFM_ScanIterator() : fileHandle(nullptr), scanVersion(1) {}
 
         ~RBFM_ScanIterator() = default;
 
-        void init(FileHandle & fHandle, const std::vector<Attribute> &recordDescriptor, const std::string &conditionAttribute,
-                  const CompOp compOp, const void *value, const std::vector<std::string> &attributeNames);
+        // fails for a projected or condition attribute the descriptor does not have
+        RC init(FileHandle & fHandle, const std::vector<Attribute> &recordDescriptor, const std::string &conditionAttribute,
+                const CompOp compOp, const void *value, const std::vector<std::string> &attributeNames);
         // Never keep the results in the memory. When getNextRecord() is called,
         // a satisfying record needs to be fetched from the file.
         // "data" follows the same format as RecordBasedFileManager::insertRecord().
         RC getNextRecord(RID &rid, void *data, SizeType *version = nullptr, bool *recoAccepted = nullptr, bool *verifyRecord = nullptr);
 
+        // Fetch up to maxRecords satisfying records at once, placed back to back in "data" with offsets[i] the start
+        // of the i-th record. "data" must be large enough for maxRecords projected records. Columnar files read each
+        // needed chunk page once per batch instead of once per record.
+        RC getNextBatch(std::vector<RID> &rids, void *data, std::vector<unsigned> &offsets, unsigned maxRecords);
+
         RC close();
     };
 
@@ -117,10 +219,15 @@ namespace PeterDB {
     public:
         static RecordBasedFileManager &instance();                          // Access to the singleton instance
 
-        RC createFile(const std::string &fileName);                         // Create a new record-based file
+        // zoneMaps keeps the min/max of every attribute on every page in a companion file, letting scans skip
+        // pages that cannot satisfy their condition. Only slotted files support it.
+        RC createFile(const std::string &fileName, PageLayout layout = LayoutSlotted,
+                      bool zoneMaps = false);                               // Create a new record-based file
 
         RC destroyFile(const std::string &fileName);                        // Destroy a record-based file
 
+        RC renameFile(const std::string &fileName, const std::string &newFileName);  // Rename a record-based file, replacing any at newFileName
+
         RC openFile(const std::string &fileName, FileHandle &fileHandle);   // Open a record-based file
 
         RC closeFile(FileHandle &fileHandle);                               // Close a record-based file
@@ -144,10 +251,22 @@ namespace PeterDB {
         RC insertRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const void *data,
                         RID &rid, SizeType version = 1);
 
-        // Read a record identified by the given rid.
+        // Insert several records at once, rids receiving where each went. A columnar file writes each chunk page of a
+        // row group once for all the records going to it.
+        RC insertRecords(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const std::vector<const void *> &records,
+                         std::vector<RID> &rids, SizeType version = 1);
+
+        // Read a record identified by the given rid. version, when given, also receives the schema version the record was
+        // written with; a slotted record of another version is copied with its own field count, for the caller to convert.
         RC
         readRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const RID &rid, void *data, SizeType *version = nullptr);
 
+        // Read several records at once, each page read once however many of the records it holds. Record i is placed
+        // at offsets[i] in "data", which must be large enough for all of them, and versions receives the version each
+        // was written with.
+        RC readRecords(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const std::vector<RID> &rids,
+                       void *data, std::vector<unsigned> &offsets, std::vector<SizeType> *versions = nullptr);
+
         // Print the record that is passed to this utility method.
         // This method will be mainly used for debugging/testing.
         // The format is as follows:
@@ -156,6 +275,13 @@ namespace PeterDB {
         //        age: NULL  height: 7.5  salary: 7500)
         RC printRecord(const std::vector<Attribute> &recordDescriptor, const void *data, std::ostream &out);
 
+        // Number of bytes used by data in the format above. A layout computed for the descriptor saves walking its attributes.
+        unsigned recordLength(const std::vector<Attribute> &recordDescriptor, const void *data, const RecordLayout *layout = nullptr);
+
+        // Compute the value offsets the slotted records of a descriptor share. Once set as a file handle's recordLayout,
+        // inserts and updates through that handle with the descriptor skip the walk over its attributes.
+        void getRecordLayout(const std::vector<Attribute> &recordDescriptor, RecordLayout &layout);
+
         /*****************************************************************************************************
         * IMPORTANT, PLEASE READ: All methods below this comment (other than the constructor and destructor) *
         * are NOT required to be implemented for Project 1                                                   *
@@ -167,10 +293,23 @@ namespace PeterDB {
         RC updateRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const void *data,
                         const RID &rid, SizeType version = 1);
 
-        // Read an attribute given its name and the rid.
+        // Overwrite one attribute of a record, "data" in the format returned by readAttribute(). Fixed-width values are
+        // written in place; the page is only shifted when the attribute's stored length changes. Only slotted files
+        // are supported, and only records written with the given version are updated.
+        RC updateAttribute(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const RID &rid,
+                           const std::string &attributeName, const void *data, SizeType version = 1);
+
+        // Read an attribute given its name and the rid. version, when given, also receives the schema version the record
+        // was written with, from the same lookup.
         RC readAttribute(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const RID &rid,
                          const std::string &attributeName, void *data, SizeType *version = nullptr);
 
+        // Read the attributes at attrIndexes in recordDescriptor, locating the record once. "data" receives them in the
+        // format of readRecord() for a descriptor holding only those attributes, in the order of attrIndexes. version,
+        // when given, receives the schema version the record was written with.
+        RC readAttributes(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const RID &rid,
+                          const std::vector<int> &attrIndexes, void *data, SizeType *version = nullptr);
+
         // Scan returns an iterator to allow the caller to go through the results one by one.
         RC scan(FileHandle &fileHandle,
                 const std::vector<Attribute> &recordDescriptor,
@@ -180,6 +319,26 @@ namespace PeterDB {
                 const std::vector<std::string> &attributeNames, // a list of projected attributes
                 RBFM_ScanIterator &rbfm_ScanIterator);
 
+        // Records stored on a page, tombstones excluded, with the schema version each was written with.
+        // Only slotted files are supported. When data is given, the records are also copied from the one page read,
+        // record i at (*offsets)[i], each in the format of its own version; a page-sized buffer holds them all.
+        RC getPageRecords(FileHandle &fileHandle, unsigned pageNum, std::vector<RID> &rids, std::vector<SizeType> &versions,
+                          void *data = nullptr, std::vector<unsigned> *offsets = nullptr);
+
+        // Draw up to sampleSize records uniformly from the records of up to maxPages pages picked at random, reading
+        // only those pages. The same seed gives the same sample of an unchanged file. Only slotted files are supported.
+        RC sampleRecords(FileHandle &fileHandle, unsigned maxPages, unsigned sampleSize, unsigned seed,
+                         std::vector<RID> &rids, SampleStats &stats);
+
+        // Collapse the forwarding chains left by updates, so every moved record is one tombstone away from the RID
+        // insertRecord returned. Tombstones left unreferenced by that, or leading to a deleted record, are removed.
+        // stats describes the chains found beforehand; with reportOnly set the file is not changed.
+        RC vacuum(FileHandle &fileHandle, ChainStats &stats, bool reportOnly = false);
+
+        // Report page fill, free and reclaimable space, empty slots, forwarding chains and the schema versions of the
+        // records, reading every page once. Only slotted files are supported.
+        RC analyze(FileHandle &fileHandle, HeapStats &stats);
+
     protected:
         RecordBasedFileManager();                                                   // Prevent construction
         ~RecordBasedFileManager();                                                  // Prevent unwanted destruction
@@ -187,10 +346,14 @@ namespace PeterDB {
         RecordBasedFileManager &operator=(const RecordBasedFileManager &);          // Prevent assignment
 
         // helper functions for insertRecord method
-        SizeType calcRecordSpace(const std::vector<Attribute> &recordDescriptor, const void * data);
-        SizeType putRecordInEmptyPage(const std::vector<Attribute> &recordDescriptor, const void * data, void * pageData, SizeType recordSpace, SizeType version);
-        SizeType putRecordInNonEmptyPage(const std::vector<Attribute> &recordDescriptor, const void * data, void * pageData, SizeType recordSpace, SizeType version);
-        void embedRecord(SizeType offset, const std::vector<Attribute> &recordDescriptor, const void * data, void * pageData, SizeType version);
+        SizeType calcRecordSpace(const std::vector<Attribute> &recordDescriptor, const void * data, const RecordLayout * layout);
+        SizeType putRecordInEmptyPage(const std::vector<Attribute> &recordDescriptor, const void * data, void * pageData, SizeType recordSpace, SizeType version,
+                                      const RecordLayout * layout);
+        SizeType putRecordInNonEmptyPage(const std::vector<Attribute> &recordDescriptor, const void * data, void * pageData, SizeType recordSpace, SizeType version,
+                                         const RecordLayout * layout);
+        SizeType decodeRecord(const char * record, SizeType recoLen, void * data);
+        void embedRecord(SizeType offset, const std::vector<Attribute> &recordDescriptor, const void * data, void * pageData, SizeType version,
+                         const RecordLayout * layout);
         void getFreeSpace(SizeType * freeSpace, const void * pageData);
         void setFreeSpace(SizeType * freeSpace, void * pageData);
         void setSlotCount(SizeType * slotCount, void * pageData);
@@ -201,16 +364,73 @@ namespace PeterDB {
         void setSlotLen(SizeType * len, SizeType slotNum, void * pageData);
         void setSlotOffsetAndLen(SizeType * offset, SizeType * len, SizeType slotNum, void * pageData);
         SizeType assignSlot(const void * pageData);
-        bool fitsOnPage(SizeType recordSpace, const void * pageData);
+        bool fitsOnPage(SizeType recordSpace, const void * pageData, SizeType reserved = 0);
         void shiftRecordsLeft(SizeType shiftPoint, SizeType shiftDistance, void * pageData);
         void shiftRecordsRight(SizeType shiftPoint, SizeType shiftDistance, void * pageData);
         RC deleteTombstone(FileHandle &fileHandle, char *pageData, unsigned pageNum, unsigned short slotNum, SizeType tombstoneOffset, SizeType tombstoneLen);
         RC findRealRecord(FileHandle &fileHandle, char *pageData, unsigned & pageNum, unsigned short & slotNum, SizeType & recoOffset, SizeType & recoLen, bool removeTombstones);
+        RC removeTombstone(FileHandle &fileHandle, const RID &tombstone);
+        RC setTombstoneTarget(FileHandle &fileHandle, const RID &tombstone, const RID &target);
+        // follow tombstones, mapped to the locations they forward to, into chains ending at their records
+        void findChains(const std::map<RID, RID> &forwards, ChainStats &stats, std::vector<std::vector<RID>> &chains, std::vector<RID> &ends);
         void getSlotCount(SizeType * slotCount, const void * pageData);
         void getSlotOffset(SizeType * offset, SizeType slotNum, const void * pageData);
         SizeType nullBytesNeeded(SizeType numFields);
+        void locateFields(const std::vector<Attribute> &recordDescriptor, const void * data, std::vector<const char *> &fields);
+        void projectFields(const std::vector<Attribute> &recordDescriptor, const std::vector<const char *> &fields,
+                           const std::vector<int> &attrIndexes, void * data);
+        unsigned spliceAttribute(const std::vector<Attribute> &recordDescriptor, const void * data, SizeType attrIndex, const void * value, void * out);
         bool nullBitOn(unsigned char nullByte, int bitNum);
         void getSlotOffsetAndLen(SizeType * offset, SizeType * len, SizeType slotNum, const void * pageData);
+
+        // helper functions for PAX pages
+        void getPaxGeometry(const std::vector<Attribute> &recordDescriptor, PaxGeometry &geometry);
+        void getPaxHeader(SizeType * version, SizeType * capacity, SizeType * recordCount, const void * pageData);
+        void setPaxRecordCount(SizeType * recordCount, void * pageData);
+        void initPaxPage(const PaxGeometry &geometry, void * pageData, SizeType version);
+        bool paxBitOn(const char * bitmap, SizeType index);
+        void setPaxBit(char * bitmap, SizeType index, bool on);
+        bool paxSlotUsed(SizeType slotNum, const void * pageData);
+        bool paxRecordFits(const std::vector<Attribute> &recordDescriptor, const void * data);
+        const char * paxFieldLocation(const PaxGeometry &geometry, const char * pageData, int attrIndex, SizeType slotNum);
+        void embedPaxRecord(const std::vector<Attribute> &recordDescriptor, const PaxGeometry &geometry, const void * data, char * pageData, SizeType slotNum);
+        void extractPaxRecord(const std::vector<Attribute> &recordDescriptor, const PaxGeometry &geometry, const char * pageData, SizeType slotNum, void * data);
+        RC readPaxSlot(FileHandle &fileHandle, const RID &rid, char * pageData);
+        RC insertPaxRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const void *data, RID &rid, SizeType version);
+        RC readPaxRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const RID &rid, void *data, SizeType *version);
+        RC deletePaxRecord(FileHandle &fileHandle, const RID &rid);
+        RC updatePaxRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const void *data, const RID &rid, SizeType version);
+        RC readPaxAttribute(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const RID &rid, int attrIndex, void *data, SizeType *version);
+
+        // helper functions for columnar row groups
+        void getColumnarGeometry(const std::vector<Attribute> &recordDescriptor, ColumnarGeometry &geometry);
+        void getRowGroupHeader(SizeType * version, SizeType * capacity, SizeType * recordCount, unsigned * groupPages, const void * headerData);
+        char * columnNullBitmap(const ColumnarGeometry &geometry, char * headerData, int attrIndex);
+        unsigned columnPageNum(const ColumnarGeometry &geometry, unsigned groupPageNum, int attrIndex, SizeType slotNum);
+        SizeType columnPageOffset(const ColumnarGeometry &geometry, int attrIndex, SizeType slotNum);
+        RC appendRowGroup(FileHandle &fileHandle, const ColumnarGeometry &geometry, char * headerData, SizeType version);
+        RC readRowGroupSlot(FileHandle &fileHandle, const RID &rid, char * headerData);
+        RC writeColumnarValues(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const ColumnarGeometry &geometry, unsigned groupPageNum, char * headerData,
+                               const std::vector<SizeType> &slotNums, const std::vector<const void *> &records);
+        RC readColumnarValue(FileHandle &fileHandle, const ColumnarGeometry &geometry, const Attribute &attr, unsigned groupPageNum, int attrIndex, SizeType slotNum, char * dest, SizeType &fieldBytes);
+        RC findRowGroup(FileHandle &fileHandle, const ColumnarGeometry &geometry, SizeType version, char * headerData, unsigned &groupPageNum);
+        RC insertColumnarRecords(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const std::vector<const void *> &records,
+                                 std::vector<RID> &rids, SizeType version);
+        RC readColumnarRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const RID &rid, void *data, SizeType *version);
+        RC deleteColumnarRecord(FileHandle &fileHandle, const RID &rid);
+        RC updateColumnarRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const void *data, const RID &rid, SizeType version);
+        RC readColumnarAttribute(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const RID &rid, int attrIndex, void *data, SizeType *version);
+
+        // helper functions for the slotted record encoding
+        const RecordLayout * fileRecordLayout(const FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor);
+        bool hasNulls(const void * data, SizeType nullFlagBytes);
+
+        // helper functions for zone maps
+        RC readZoneCapacity(ZoneMapHandle &zoneHandle, SizeType &capacity);
+        RC cacheZonePage(ZoneMapHandle &zoneHandle, unsigned zonePageNum);
+        RC flushZoneMap(ZoneMapHandle &zoneHandle);
+        void zoneEntryLocation(SizeType capacity, unsigned pageNum, unsigned &zonePageNum, SizeType &entryOffset);
+        RC updateZoneMap(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, unsigned pageNum, const char * record, bool removing);
     };
 
 } // namespace PeterDB
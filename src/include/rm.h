@@ -25,23 +25,40 @@ namespace PeterDB {
     class RM_ScanIterator {
         RBFM_ScanIterator recordScanner;
         std::string tableName;
-        std::vector<Attribute> attrDescriptor;
         std::unordered_map<std::string, int> attrPositions;
         int schemaVersion;
         std::string conditionAttrName;
         CompOp comparator;
+        std::vector<Attribute> projectedAttrs;                                  // projected attributes as returned
+        std::unordered_map<std::string, std::vector<std::string>> dictionaries; // values of projected encoded attributes
+
+        // what the record scanner needs to read records of one schema version, built once per version per scan
+        struct VersionLayout {
+            std::vector<Attribute> recordDescriptor;
+            std::unordered_map<std::string, int> attrNameIndexes;
+            std::vector<std::string> attributeNames;    // projection, empty names for attributes the version lacks
+            bool verifyRecord;                          // whether the condition can be checked on the version
+        };
+        std::unordered_map<int, VersionLayout> versionLayouts;
+        int loadedVersion;                              // version whose layout the record scanner currently holds
+
+        RC loadVersionLayout(int version, bool &verifyRecord);
 
     public:
         RM_ScanIterator();
 
         ~RM_ScanIterator();
 
-        void init(const std::string &tableName, FileHandle & fHandle, const std::vector<Attribute> &recordDescriptor, const std::string &conditionAttribute,
-                  const CompOp compOp, const void *value, const std::vector<std::string> &attributeNames, int version, const std::unordered_map<std::string, int> &attrToPos);
+        RC init(const std::string &tableName, FileHandle & fHandle, const std::vector<Attribute> &recordDescriptor, const std::string &conditionAttribute,
+                const CompOp compOp, const void *value, const std::vector<std::string> &attributeNames, int version, const std::unordered_map<std::string, int> &attrToPos,
+                const std::unordered_map<std::string, std::vector<std::string>> &attrDictionaries = {});
 
         // "data" follows the same format as RelationManager::insertTuple()
         RC getNextTuple(RID &rid, void *data);
 
+        // Fetch up to maxTuples tuples at once, back to back in "data" with offsets[i] the start of the i-th tuple
+        RC getNextBatch(std::vector<RID> &rids, void *data, std::vector<unsigned> &offsets, unsigned maxTuples);
+
         RC close();
     };
 
@@ -49,26 +66,57 @@ namespace PeterDB {
     class RM_IndexScanIterator {
         IX_ScanIterator ixScanner;
         IXFileHandle *iFh = nullptr;
+        Attribute attr;                     // the key as the index stores it
+        bool descending = false;
+        std::vector<Attribute> keyAttrs;    // attributes of a composite key, empty for an index on one attribute
+        std::vector<char> rangeKeys;        // copies of the scan bounds, which the index scanner only points at
 
     public:
         RM_IndexScanIterator();    // Constructor
         ~RM_IndexScanIterator();    // Destructor
 
-        void init(IXFileHandle *iFh, const Attribute &attr, const void *lowKey, const void *highKey, bool lowKeyInclusive, bool highKeyInclusive);
+        void init(IXFileHandle *iFh, const Attribute &attr, const void *lowKey, const void *highKey, bool lowKeyInclusive, bool highKeyInclusive,
+                  const std::vector<Attribute> &keyAttrs = {}, bool descending = false);
+
+        // Scan the same index again over a new key range, on the index file already open. An index nested loop join
+        // probes this way without looking the index up in the catalog each time.
+        RC rescan(const void *lowKey, const void *highKey, bool lowKeyInclusive, bool highKeyInclusive);
 
         // "key" follows the same format as in IndexManager::insertEntry()
         RC getNextEntry(RID &rid, void *key);    // Get next matching entry
+
+        // Next matching entry as a tuple of the indexed attribute alone, in the format of readAttribute(), read from the
+        // index leaf without touching the table. Composite keys come back as a tuple of their attributes.
+        RC getNextKeyTuple(RID &rid, void *data);
         RC close();                              // Terminate index scan
     };
 
     // Relation Manager
     class RelationManager {
+        // how far a table's records have been rewritten to one schema version
+        struct MigrationProgress {
+            int version;
+            RID next;       // first record location not yet visited
+        };
+
+        // a dictionary file read once, kept in step with the codes appended to it
+        struct Dictionary {
+            std::vector<std::string> values;                // the value of each code, at that index
+            std::unordered_map<std::string, int> codes;
+        };
+
         std::vector<Attribute> tablesDescriptor;
         std::vector<Attribute> columnsDescriptor;
         std::vector<Attribute> schemasDescriptor;
         std::vector<Attribute> indicesDescriptor;
+        std::vector<Attribute> dictionaryDescriptor;
         std::vector<std::string> columnsColumns;
         int nextTableID;
+        bool catalogOpen = false;       // the catalog on disk has been checked and nextTableID set
+        std::unordered_map<std::string, MigrationProgress> migrations;
+        std::unordered_map<std::string, unsigned> fillFactors;  // catalog fill factors of tables written to so far
+        std::unordered_map<std::string, Dictionary> dictionaryCache;  // dictionaries read so far, by file name
+        std::unordered_map<std::string, std::unordered_map<int, RecordLayout>> recordLayouts;  // record layouts by table and version
         friend class RM_ScanIterator;
 
     public:
@@ -78,12 +126,19 @@ namespace PeterDB {
 
         RC deleteCatalog();
 
-        RC createTable(const std::string &tableName, const std::vector<Attribute> &attrs);
+        // layout selects the storage of the table file, e.g. LayoutColumnar for analytic tables.
+        // dictionaryAttrs names varchar attributes stored as integer codes into a per-attribute dictionary, which suits
+        // low-cardinality columns. Scans on those attributes only support EQ_OP and NE_OP conditions.
+        // fillFactor is the percentage of each slotted page that inserts may fill; the rest is left for updates to grow
+        // records in place instead of forwarding them to another page.
+        RC createTable(const std::string &tableName, const std::vector<Attribute> &attrs, PageLayout layout = LayoutSlotted,
+                       const std::vector<std::string> &dictionaryAttrs = {}, unsigned fillFactor = FULL_FILL_FACTOR);
 
         RC deleteTable(const std::string &tableName);
 
         RC getAttributes(const std::string &tableName, std::vector<Attribute> &attrs, int *isSystemTable = nullptr, int *version = nullptr,
-                         std::unordered_map<std::string, int> *attrPositions = nullptr, const std::string &specificAttr = "");
+                         std::unordered_map<std::string, int> *attrPositions = nullptr, const std::string &specificAttr = "",
+                         std::unordered_set<std::string> *dictionaryAttrs = nullptr);
 
         RC insertTuple(const std::string &tableName, const void *data, RID &rid);
 
@@ -91,14 +146,26 @@ namespace PeterDB {
 
         RC updateTuple(const std::string &tableName, const void *data, const RID &rid);
 
+        // Change one attribute of a tuple, "data" in the format returned by readAttribute(). Only an index on that
+        // attribute is maintained.
+        RC updateAttribute(const std::string &tableName, const RID &rid, const std::string &attributeName, const void *data);
+
         RC readTuple(const std::string &tableName, const RID &rid, void *data);
 
+        // Read several tuples at once, reading each page that holds some of them once. Tuple i is placed at
+        // offsets[i] in "data", which must be large enough for all of them.
+        RC readTuples(const std::string &tableName, const std::vector<RID> &rids, void *data, std::vector<unsigned> &offsets);
+
         // Print a tuple that is passed to this utility method.
         // The format is the same as printRecord().
         RC printTuple(const std::vector<Attribute> &attrs, const void *data, std::ostream &out);
 
         RC readAttribute(const std::string &tableName, const RID &rid, const std::string &attributeName, void *data);
 
+        // Read several attributes of a tuple at once. "data" holds them in the order of attributeNames, preceded by
+        // their null indicator bytes, like a tuple of a table with just those attributes.
+        RC readAttributes(const std::string &tableName, const RID &rid, const std::vector<std::string> &attributeNames, void *data);
+
         // Scan returns an iterator to allow the caller to go through the results one by one.
         // Do not store entire results in the scan iterator.
         RC scan(const std::string &tableName,
@@ -113,19 +180,71 @@ namespace PeterDB {
 
         RC dropAttribute(const std::string &tableName, const std::string &attributeName);
 
+        // Rewrite records stored under older schema versions to the current one, so reading them needs no conversion.
+        // Each call rewrites at most maxRecords records and resumes where the previous call on the table stopped, so
+        // the migration can run in small steps between other operations. done is set once the whole table has been
+        // visited; a later schema change starts the migration over. Only slotted tables are supported.
+        RC migrateTable(const std::string &tableName, unsigned maxRecords, unsigned &migrated, bool &done);
+
+        // Sample up to sampleSize tuples from up to maxPages random pages of the table, see
+        // RecordBasedFileManager::sampleRecords(). Tuple i of rids is placed at offsets[i] in "data", which must be
+        // large enough for sampleSize tuples.
+        RC sampleTable(const std::string &tableName, unsigned maxPages, unsigned sampleSize, unsigned seed,
+                       std::vector<RID> &rids, void *data, std::vector<unsigned> &offsets, SampleStats &stats);
+
+        // Collapse the table's forwarding chains to a single hop and remove dead tombstones, see
+        // RecordBasedFileManager::vacuum(). With reportOnly set only the chain statistics are gathered.
+        RC vacuumTable(const std::string &tableName, ChainStats &stats, bool reportOnly = false);
+
+        // Page usage of the table's file, see RecordBasedFileManager::analyze(). Catalog tables can be analyzed too.
+        RC analyzeTable(const std::string &tableName, HeapStats &stats);
+
+        // Copy the table's live records into a freshly packed file, filling pages up to the table's fill factor and
+        // writing every record under the current schema version, and bulk load its indexes from the new RIDs. The new
+        // files replace the old ones only once all of them are complete, keeping their names, so the catalog still
+        // describes the table. A manifest naming them commits the swap, and a swap cut short by a crash is finished when
+        // the catalog is next opened. RIDs handed out before the rebuild are no longer valid. Only slotted tables are supported.
+        RC rebuildTable(const std::string &tableName);
+
         // QE IX related
-        RC createIndex(const std::string &tableName, const std::string &attributeName);
+        // The index is bulk loaded from the table's entries, sorted and packed into pages filled up to fillFactor
+        // percent, so later inserts find room before splitting; a full fill factor suits tables no longer written to. Indexes on varchar attributes, and
+        // composite ones, compress their keys by the prefix each node shares and store each key of a leaf once with
+        // the list of its RIDs (IndexPostingBTree).
+        RC createIndex(const std::string &tableName, const std::string &attributeName, unsigned fillFactor = DEFAULT_INDEX_FILL_FACTOR);
+
+        // A hash index serves equality scans, like the probes of an index nested-loop join, from the key's bucket.
+        // Other scans visit every bucket and return entries in no particular order. fillFactor only applies to B+ trees.
+        RC createIndex(const std::string &tableName, const std::string &attributeName, IndexKind kind, unsigned fillFactor = DEFAULT_INDEX_FILL_FACTOR);
+
+        // A composite index orders tuples by several attributes, compared in the given order. The catalog names it by
+        // the attribute names joined with commas, which destroyIndex and indexScan also accept. Its keys are encoded by
+        // IndexManager::encodeCompositeKey, and tuples with null values are indexed too.
+        RC createIndex(const std::string &tableName, const std::vector<std::string> &attributeNames, unsigned fillFactor = DEFAULT_INDEX_FILL_FACTOR);
 
         RC destroyIndex(const std::string &tableName, const std::string &attributeName);
 
-        // indexScan returns an iterator to allow the caller to go through qualified entries in index
+        RC destroyIndex(const std::string &tableName, const std::vector<std::string> &attributeNames);
+
+        // indexScan returns an iterator to allow the caller to go through qualified entries in index, from the high key
+        // down when descending, which hash indexes do not support
         RC indexScan(const std::string &tableName,
                      const std::string &attributeName,
                      const void *lowKey,
                      const void *highKey,
                      bool lowKeyInclusive,
                      bool highKeyInclusive,
-                     RM_IndexScanIterator &rm_IndexScanIterator);
+                     RM_IndexScanIterator &rm_IndexScanIterator,
+                     bool descending = false);
+
+        // Scan a composite index for the tuples whose first prefixCount attributes hold the values in "prefix", a tuple
+        // of those attributes in the insertTuple() format. No prefix scans the whole index.
+        RC indexScan(const std::string &tableName,
+                     const std::vector<std::string> &attributeNames,
+                     const void *prefix,
+                     unsigned prefixCount,
+                     RM_IndexScanIterator &rm_IndexScanIterator,
+                     bool descending = false);
 
     protected:
         RelationManager();                                                  // Prevent construction
@@ -135,18 +254,34 @@ namespace PeterDB {
         void craftTupleData(char *data, const std::vector<tupleVal> & values);
         RC initTablesTable(FileHandle &fh);
         RC initColumnsTable(FileHandle &fh);
-        RC addTablesEntry(FileHandle &fh, int table_id, int tableNameLen, const char *tableName, int fileNameLen, const char *fileName, int isSystem, char *data);
-        RC addColumnsEntry(FileHandle &fh, int table_id, int nameLen, const char *name, AttrType columnType, int columnLen, int pos, char *data);
+        RC openCatalog();
+        RC addTablesEntry(FileHandle &fh, int table_id, int tableNameLen, const char *tableName, int fileNameLen, const char *fileName, int isSystem, int fillFactor, char *data);
+        RC addColumnsEntry(FileHandle &fh, int table_id, int nameLen, const char *name, int columnType, int columnLen, int pos, char *data);
         RC addSchemasEntry(FileHandle &fh, int table_id, int version, int fieldCount, const char *fields, char *data);
         RC addIndicesEntry(FileHandle &fh, int table_id, int attrNameLen, const char *attrName, int fileNameLen, const char *fileName, char *data);
-        RC getTableID(const std::string &tableName, int &tableID, bool deleteEntry, int *isSystemTable);
+        RC getTableID(const std::string &tableName, int &tableID, bool deleteEntry, int *isSystemTable, int *fillFactor = nullptr);
+        RC getFillFactor(const std::string &tableName, unsigned &fillFactor);
+        RC finishRebuild(const std::string &tableName);
+        const RecordLayout *getRecordLayout(const std::string &tableName, int version, const std::vector<Attribute> &storedAttrs);
         void formatString(const std::string &str, char *value);
         RC getSchemaVersionInfo(const std::string &tableName, int &tableID, int &version, int &pos, std::unordered_map<std::string, int> &names, std::unordered_set<int> &positions);
         void convertDataToCurrSchema(void *data, const std::vector<Attribute> &currDescriptor, const std::vector<Attribute> &recordDescriptor,
                                                       std::unordered_map<std::string, int> &currAttrPos, std::unordered_map<std::string, int> &recoVersionAttrPos);
         RC getIndexFile(int tableID, const std::string &attrName, std::string &fileName);
         RC getIndexFiles(int tableID, std::unordered_map<std::string, std::string> &attrIndexFiles);
+        RC registerIndex(int tableID, const std::string &indexName, const std::string &fileName, IndexKind kind = IndexBTree);
+        RC getKeyAttributes(const std::string &tableName, const std::vector<std::string> &attributeNames, std::vector<Attribute> &keyAttrs);
+        RC compositeIndexKey(const std::vector<Attribute> &attrs, const void *data, const std::string &indexName, Attribute &keyAttr, char *key);
         RC updateIndexFiles(const std::string &tableName, const std::vector<Attribute> &attrs, const void *data, const RID &rid, bool isInsertion);
+        RC updateIndexEntries(const std::string &tableName, const std::vector<Attribute> &attrs, const void *oldData, const void *newData, const RID &rid);
+        void storedDescriptor(std::vector<Attribute> &attrs, const std::unordered_set<std::string> &dictionaryAttrs);
+        RC cachedDictionary(const std::string &fileName, Dictionary *&dictionary);
+        RC loadDictionary(const std::string &tableName, const std::string &attrName, std::vector<std::string> &values);
+        RC loadDictionaries(const std::string &tableName, const std::unordered_set<std::string> &dictionaryAttrs,
+                            std::unordered_map<std::string, std::vector<std::string>> &dictionaries);
+        RC encodeTuple(const std::string &tableName, const std::vector<Attribute> &attrs, const std::unordered_set<std::string> &dictionaryAttrs,
+                       const void *data, void *encoded);
+        void decodeTuple(const std::vector<Attribute> &attrs, const std::unordered_map<std::string, std::vector<std::string>> &dictionaries, void *data);
     };
 
 } // namespace PeterDB
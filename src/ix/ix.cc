@@ -1,5 +1,9 @@
 #include "src/include/ix.h"
 #include <cstring>
+#include <climits>
+#include <algorithm>
+#include <queue>
+#include <unordered_set>
 #include <iomanip>
 #include <iostream>
 
@@ -11,6 +15,29 @@ constexpr unsigned short LEAF_CHECK_BYTE = 1;
 constexpr unsigned short LEAF_BYTES_BEFORE_KEYS = LEAF_CHECK_BYTE + PAGE_NUM_BYTES + OFFSET_BYTES;
 constexpr unsigned short NODE_BYTES_BEFORE_KEYS = LEAF_CHECK_BYTE + OFFSET_BYTES + PAGE_NUM_BYTES;
 constexpr unsigned short INT_BYTES = sizeof(int);
+constexpr unsigned short FREE_LIST_OFFSET = PAGE_NUM_BYTES;       // page 0 holds the root page, then the first free page
+constexpr unsigned char FREE_PAGE_FLAG = 2;                       // in place of the leaf check byte of a freed page
+constexpr PeterDB::SizeType UNDERFLOW_BYTES = PAGE_SIZE / 2;      // a node using fewer bytes is merged or refilled
+constexpr PeterDB::SizeType MERGE_SLACK = PAGE_SIZE / 4;          // free bytes a merged node keeps, so the next inserts do not split it again
+constexpr unsigned char COMPOSITE_NULL = 1;                       // marks each attribute of a composite key
+constexpr unsigned char COMPOSITE_VALUE = 2;
+constexpr unsigned char COMPOSITE_ESCAPE = 0xFF;                  // follows zero bytes of a varchar, and ends prefix ranges
+constexpr unsigned short VARCHAR_TERMINATOR_BYTES = 2;
+constexpr unsigned short BITS_PER_BYTE = 8;
+constexpr unsigned short HASH_DIR_COUNT_OFFSET = FREE_LIST_OFFSET + PAGE_NUM_BYTES;   // page 0 of a hash index: global depth, free list, directory pages
+constexpr unsigned short HASH_DIR_PAGES_OFFSET = HASH_DIR_COUNT_OFFSET + PAGE_NUM_BYTES;
+constexpr unsigned DIR_ENTRIES_PER_PAGE = PAGE_SIZE / PAGE_NUM_BYTES;
+constexpr unsigned MAX_HASH_DEPTH = 19;                           // a directory of 2^19 entries fills 512 pages, which page 0 can list
+constexpr unsigned char HASH_BUCKET_FLAG = 3;                     // bucket: flag, local depth, overflow page, end offset
+constexpr unsigned short HASH_OVERFLOW_OFFSET = LEAF_CHECK_BYTE + 1;
+constexpr unsigned short HASH_END_OFFSET = HASH_OVERFLOW_OFFSET + PAGE_NUM_BYTES;
+constexpr unsigned short HASH_BYTES_BEFORE_KEYS = HASH_END_OFFSET + OFFSET_BYTES;
+constexpr unsigned FNV_OFFSET_BASIS = 2166136261u;
+constexpr unsigned FNV_PRIME = 16777619u;
+constexpr PeterDB::SizeType PREFIX_LENGTH_OFFSET = PAGE_SIZE - OFFSET_BYTES;   // a prefix-compressed node ends with its prefix, then its length
+constexpr unsigned short POSTING_COUNT_BYTES = sizeof(PeterDB::SizeType);     // follows each key of a posting leaf
+constexpr unsigned char VARINT_MORE = 0x80;                                   // set in every byte of a varint but its last
+constexpr unsigned short VARINT_BITS = 7;
 
 
 namespace PeterDB {
@@ -19,14 +46,25 @@ namespace PeterDB {
         return _index_manager;
     }
 
-    RC IndexManager::createFile(const std::string &fileName) {
-        return PagedFileManager::instance().createFile(fileName);
+    RC IndexManager::createFile(const std::string &fileName, IndexKind kind) {
+        if (PagedFileManager::instance().createFile(fileName) == -1) return -1;
+        if (kind == IndexBTree) return 0;
+
+        // other kinds are recorded in the hidden page, their pages are laid out by the first insert
+        IXFileHandle ixFileHandle;
+        if (openFile(fileName, ixFileHandle) == -1) return -1;
+        ixFileHandle.pageLayout = kind;
+        return closeFile(ixFileHandle);
     }
 
     RC IndexManager::destroyFile(const std::string &fileName) {
         return PagedFileManager::instance().destroyFile(fileName);
     }
 
+    RC IndexManager::renameFile(const std::string &fileName, const std::string &newFileName) {
+        return PagedFileManager::instance().renameFile(fileName, newFileName);
+    }
+
     RC IndexManager::openFile(const std::string &fileName, IXFileHandle &ixFileHandle) {
         return PagedFileManager::instance().openFile(fileName, ixFileHandle);
     }
@@ -45,74 +83,400 @@ namespace PeterDB {
         return entrySize;
     }
 
-    char * IndexManager::determinePos(char *pagePtr, const Attribute &attr, const void *key, const RID &rid, char *endPtr, bool isLeaf, int typeOfSearch) {
-        char *prevKey = nullptr;
-        switch (attr.type) {
-            case TypeInt: {
-                Key<int> iKey{*static_cast<const int *>(key), rid};
-                SizeType entrySize = nodeEntrySize(attr, key, isLeaf);
-                while (pagePtr < endPtr) {
-                    RID entryRID{*reinterpret_cast<unsigned *>(pagePtr + attr.length), *reinterpret_cast<unsigned short *>(pagePtr + attr.length + PAGE_NUM_BYTES)};
-                    Key<int> posKey{*reinterpret_cast<int *>(pagePtr), entryRID};
-
-                    switch (typeOfSearch) {
-                        case 1:
-                            if (iKey == posKey) return pagePtr;
-                        break;
-                        case 2:
-                            if (iKey <= posKey) return pagePtr;
-                        break;
-                        case 3:
-                            if (iKey < posKey) return prevKey;
-                        prevKey = pagePtr;
-                    }
-                    pagePtr += entrySize;
-                }
-                break;
-            } case TypeReal: {
-                Key<float> fKey{*static_cast<const float *>(key), rid};
-                SizeType entrySize = nodeEntrySize(attr, key, isLeaf);
-                while (pagePtr < endPtr) {
-                    RID entryRID{*reinterpret_cast<unsigned *>(pagePtr + attr.length), *reinterpret_cast<unsigned short *>(pagePtr + attr.length + PAGE_NUM_BYTES)};
-                    Key<float> posKey{*reinterpret_cast<float *>(pagePtr), entryRID};
-
-                    switch (typeOfSearch) {
-                        case 1:
-                            if (fKey == posKey) return pagePtr;
-                        break;
-                        case 2:
-                            if (fKey <= posKey) return pagePtr;
-                        break;
-                        case 3:
-                            if (fKey < posKey) return prevKey;
-                        prevKey = pagePtr;
-                    }
-                    pagePtr += entrySize;
-                }
-                break;
-            } case TypeVarChar: {
-                unsigned strLen = *static_cast<const unsigned *>(key);
-                Key<std::string> strKey{{static_cast<const char *>(key) + INT_BYTES, strLen}, rid};
+    // Entries of int and real keys all have the same size, so a node is searched by bisection, with the same results
+    // as the walk over varchar entries in determinePos
+    template <typename T>
+    static char * bisectEntries(char *pagePtr, char *endPtr, SizeType entrySize, const Key<T> &key, int typeOfSearch) {
+        auto entryKey = [entrySize, pagePtr](SizeType i) {
+            const char *entry = pagePtr + i * entrySize;
+            RID entryRID{*reinterpret_cast<const unsigned *>(entry + sizeof(T)), *reinterpret_cast<const unsigned short *>(entry + (sizeof(T) + PAGE_NUM_BYTES))};
+            return Key<T>{*reinterpret_cast<const T *>(entry), entryRID};
+        };
+
+        // first entry not below the key, or for typeOfSearch 3 the first one above it
+        SizeType low = 0, high = (endPtr - pagePtr) / entrySize, entryCount = high;
+        while (low < high) {
+            SizeType mid = low + (high - low) / 2;
+            if (typeOfSearch == 3 ? entryKey(mid) <= key : entryKey(mid) < key)
+                low = mid + 1;
+            else
+                high = mid;
+        }
 
-                while (pagePtr < endPtr) {
-                    strLen = *reinterpret_cast<unsigned *>(pagePtr);
-                    RID entryRID{*reinterpret_cast<unsigned *>(pagePtr + (INT_BYTES + strLen)), *reinterpret_cast<unsigned short *>(pagePtr + (INT_BYTES + strLen + PAGE_NUM_BYTES))};
-                    Key<std::string> posKey{{pagePtr + INT_BYTES, strLen}, entryRID};
+        switch (typeOfSearch) {
+            case 1:
+                return low < entryCount && entryKey(low) == key ? pagePtr + low * entrySize : endPtr;
+            case 2:
+                return pagePtr + low * entrySize;
+            default:
+                return low == 0 ? nullptr : pagePtr + (low - 1) * entrySize;
+        }
+    }
 
-                    switch (typeOfSearch) {
-                        case 1:
-                            if (strKey == posKey) return pagePtr;
-                        break;
-                        case 2:
-                            if (strKey <= posKey) return pagePtr;
-                        break;
-                        case 3:
-                            if (strKey < posKey) return prevKey;
-                        prevKey = pagePtr;
-                    }
-                    pagePtr += nodeEntrySize(attr, pagePtr, isLeaf);
+    // orders varchar keys like std::string without building one
+    // holds a tree latch shared for its scope
+    struct SharedTreeLatch {
+        TreeLatch &latch;
+        explicit SharedTreeLatch(TreeLatch &treeLatch) : latch(treeLatch) {latch.lockShared();}
+        ~SharedTreeLatch() {latch.unlockShared();}
+    };
+
+    static int compareVarChar(const char *left, unsigned leftLen, const char *right, unsigned rightLen) {
+        int cmp = memcmp(left, right, std::min(leftLen, rightLen));
+        if (cmp != 0) return cmp;
+        return leftLen < rightLen ? -1 : (leftLen == rightLen ? 0 : 1);
+    }
+
+    static int compareKeys(const Attribute &attr, const char *left, const char *right) {
+        if (attr.type == TypeInt) {
+            int leftInt = *reinterpret_cast<const int *>(left), rightInt = *reinterpret_cast<const int *>(right);
+            return leftInt < rightInt ? -1 : (leftInt == rightInt ? 0 : 1);
+        }
+        if (attr.type == TypeReal) {
+            float leftFloat = *reinterpret_cast<const float *>(left), rightFloat = *reinterpret_cast<const float *>(right);
+            return leftFloat < rightFloat ? -1 : (leftFloat == rightFloat ? 0 : 1);
+        }
+        unsigned leftLen = *reinterpret_cast<const unsigned *>(left), rightLen = *reinterpret_cast<const unsigned *>(right);
+        return compareVarChar(left + INT_BYTES, leftLen, right + INT_BYTES, rightLen);
+    }
+
+    // orders leaf entries by key, then by RID
+    static int compareEntries(const Attribute &attr, const char *left, const char *right) {
+        int cmp = compareKeys(attr, left, right);
+        if (cmp != 0) return cmp;
+
+        SizeType leftKeyBytes = attr.length, rightKeyBytes = attr.length;
+        if (attr.type == TypeVarChar) {
+            leftKeyBytes = INT_BYTES + *reinterpret_cast<const unsigned *>(left);
+            rightKeyBytes = INT_BYTES + *reinterpret_cast<const unsigned *>(right);
+        }
+
+        RID leftRID{*reinterpret_cast<const unsigned *>(left + leftKeyBytes), *reinterpret_cast<const unsigned short *>(left + (leftKeyBytes + PAGE_NUM_BYTES))};
+        RID rightRID{*reinterpret_cast<const unsigned *>(right + rightKeyBytes), *reinterpret_cast<const unsigned short *>(right + (rightKeyBytes + PAGE_NUM_BYTES))};
+        return leftRID < rightRID ? -1 : (leftRID == rightRID ? 0 : 1);
+    }
+
+    static SizeType entryKeyBytes(const Attribute &attr, const char *entry) {
+        return attr.type == TypeVarChar ? INT_BYTES + *reinterpret_cast<const int *>(entry) : attr.length;
+    }
+
+    static RID entryRID(const Attribute &attr, const char *entry) {
+        const char *ridPtr = entry + entryKeyBytes(attr, entry);
+        return RID{*reinterpret_cast<const unsigned *>(ridPtr), *reinterpret_cast<const unsigned short *>(ridPtr + PAGE_NUM_BYTES)};
+    }
+
+    // page an internal node entry points at
+    static unsigned entryChild(const Attribute &attr, const char *entry) {
+        return *reinterpret_cast<const unsigned *>(entry + (entryKeyBytes(attr, entry) + RID_BYTES));
+    }
+
+    // The keys in a node's range all start with the bytes its two fences, the separators around it in its parent, have
+    // in common, since they sort between them. A node of a prefix-compressed index keeps such a prefix at the end of
+    // its page and the rest of each key in its entries. The leftmost and rightmost nodes of a level have no prefix.
+    static bool prefixCompressed(const IXFileHandle &fh, const Attribute &attr) {
+        return (fh.pageLayout == IndexPrefixBTree || fh.pageLayout == IndexPostingBTree) && attr.type == TypeVarChar;
+    }
+
+    // A posting leaf stores each run of entries with the same key as the key, how many entries there are, and their
+    // RIDs. A RID is two varints, the step of its page number from the RID before it, then the step of its slot number
+    // on the same page or the whole slot number on a new one, and the first RID of a run steps from {0, 0}. A run too
+    // long for one leaf goes on in the next, under a separator holding the RID it goes on at.
+    static bool postingLeaves(const IXFileHandle &fh) {
+        return fh.pageLayout == IndexPostingBTree;
+    }
+
+    static SizeType prefixLength(const char *page, bool compressed) {
+        return compressed ? *reinterpret_cast<const SizeType *>(page + PREFIX_LENGTH_OFFSET) : 0;
+    }
+
+    static const char * prefixBytes(const char *page, bool compressed) {
+        return compressed ? page + (PREFIX_LENGTH_OFFSET - prefixLength(page, true)) : nullptr;
+    }
+
+    // keeps the first "length" bytes of varchar "key" as the node's prefix
+    static void putPrefix(char *page, const char *key, SizeType length) {
+        *reinterpret_cast<SizeType *>(page + PREFIX_LENGTH_OFFSET) = length;
+        if (length > 0) memmove(page + (PREFIX_LENGTH_OFFSET - length), key + INT_BYTES, length);
+    }
+
+    // bytes the header and entries of a node may take up
+    static SizeType nodeCapacity(const char *page, bool compressed) {
+        return compressed ? PREFIX_LENGTH_OFFSET - prefixLength(page, true) : PAGE_SIZE;
+    }
+
+    static SizeType * nodeEnd(char *page, bool isLeaf) {
+        return reinterpret_cast<SizeType *>(page + (isLeaf ? LEAF_CHECK_BYTE + PAGE_NUM_BYTES : LEAF_CHECK_BYTE));
+    }
+
+    static SizeType commonBytes(const char *left, SizeType leftLength, const char *right, SizeType rightLength) {
+        SizeType common = 0;
+        while (common < leftLength && common < rightLength && left[common] == right[common]) ++common;
+        return common;
+    }
+
+    // bytes of varchar keys in common, none when either is missing
+    static SizeType commonPrefix(const char *left, const char *right) {
+        if (left == nullptr || right == nullptr) return 0;
+        return commonBytes(left + INT_BYTES, *reinterpret_cast<const unsigned *>(left), right + INT_BYTES, *reinterpret_cast<const unsigned *>(right));
+    }
+
+    // copies an entry stored after "prefix" to "out" with its whole key
+    static void wholeEntry(const Attribute &attr, const char *entry, const char *prefix, SizeType prefixLength, bool isLeaf, char *out) {
+        SizeType keyBytes = entryKeyBytes(attr, entry), restBytes = isLeaf ? RID_BYTES : RID_BYTES + PAGE_NUM_BYTES;
+        if (prefixLength == 0) {
+            memmove(out, entry, keyBytes + restBytes);
+            return;
+        }
+        *reinterpret_cast<unsigned *>(out) = prefixLength + *reinterpret_cast<const unsigned *>(entry);
+        memmove(out + INT_BYTES, prefix, prefixLength);
+        memmove(out + (INT_BYTES + prefixLength), entry + INT_BYTES, (keyBytes - INT_BYTES) + restBytes);
+    }
+
+    static SizeType varintBytes(unsigned value) {
+        SizeType bytes = 1;
+        while (value >>= VARINT_BITS) ++bytes;
+        return bytes;
+    }
+
+    static char * putVarint(char *to, unsigned value) {
+        for (; value >= VARINT_MORE; value >>= VARINT_BITS) *to++ = static_cast<char>(value | VARINT_MORE);
+        *to++ = static_cast<char>(value);
+        return to;
+    }
+
+    static const char * getVarint(const char *from, unsigned &value) {
+        value = 0;
+        for (unsigned short shift = 0;; shift += VARINT_BITS) {
+            unsigned char byte = *from++;
+            value |= static_cast<unsigned>(byte & ~VARINT_MORE) << shift;
+            if (byte < VARINT_MORE) return from;
+        }
+    }
+
+    // bytes of the RID of a posting list after the one before it
+    static SizeType ridStepBytes(const RID &prev, const RID &rid) {
+        unsigned pageStep = rid.pageNum - prev.pageNum;
+        return varintBytes(pageStep) + varintBytes(pageStep == 0 ? rid.slotNum - prev.slotNum : rid.slotNum);
+    }
+
+    // keys of the same bytes share a posting list, so both zeros of a real keep theirs
+    static bool sameKey(const Attribute &attr, const char *left, const char *right) {
+        SizeType keyBytes = entryKeyBytes(attr, left);
+        return keyBytes == entryKeyBytes(attr, right) && memcmp(left, right, keyBytes) == 0;
+    }
+
+    // bytes a leaf entry with a whole key takes after "prev", the entry before it or null, stored after prefixLength
+    // bytes of its key. In a posting leaf, an entry with the key before it takes only its RID.
+    static SizeType storedBytes(const Attribute &attr, bool posting, const char *prev, const char *entry, SizeType prefixLength) {
+        if (!posting) return entryKeyBytes(attr, entry) + RID_BYTES - prefixLength;
+        if (prev != nullptr && sameKey(attr, prev, entry)) return ridStepBytes(entryRID(attr, prev), entryRID(attr, entry));
+        return entryKeyBytes(attr, entry) - prefixLength + POSTING_COUNT_BYTES + ridStepBytes(RID{0, 0}, entryRID(attr, entry));
+    }
+
+    // appends the posting lists in [pos, end), with keys stored after "prefix", as leaf entries with whole keys
+    static unsigned decodePostings(const Attribute &attr, const char *pos, const char *end, const char *prefix, SizeType prefixLength,
+                                   std::vector<char> &out) {
+        unsigned count = 0;
+        while (pos < end) {
+            SizeType keyBytes = entryKeyBytes(attr, pos);
+            char key[prefixLength + keyBytes];
+            if (prefixLength == 0) {
+                memmove(key, pos, keyBytes);
+            } else {
+                *reinterpret_cast<unsigned *>(key) = prefixLength + *reinterpret_cast<const unsigned *>(pos);
+                memmove(key + INT_BYTES, prefix, prefixLength);
+                memmove(key + (INT_BYTES + prefixLength), pos + INT_BYTES, keyBytes - INT_BYTES);
+            }
+            SizeType ridCount = *reinterpret_cast<const SizeType *>(pos + keyBytes);
+            pos += keyBytes + POSTING_COUNT_BYTES;
+
+            RID rid{0, 0};
+            for (SizeType i = 0; i < ridCount; ++i, ++count) {
+                unsigned pageStep, slot;
+                pos = getVarint(getVarint(pos, pageStep), slot);
+                rid = RID{rid.pageNum + pageStep, static_cast<unsigned short>(pageStep == 0 ? rid.slotNum + slot : slot)};
+                size_t offset = out.size();
+                out.resize(offset + (prefixLength + keyBytes + RID_BYTES));
+                memmove(&out[offset], key, prefixLength + keyBytes);
+                memmove(&out[offset + (prefixLength + keyBytes)], &rid.pageNum, PAGE_NUM_BYTES);
+                memmove(&out[offset + (prefixLength + keyBytes + PAGE_NUM_BYTES)], &rid.slotNum, SLOT_BYTES);
+            }
+        }
+        return count;
+    }
+
+    // stores the leaf entries with whole keys in [pos, end) at "to" as posting lists, keys without their first
+    // prefixLength bytes, and returns the end
+    static char * encodePostings(const Attribute &attr, const char *pos, const char *end, SizeType prefixLength, char *to) {
+        const char *prev = nullptr;
+        char *ridCount = nullptr;
+        RID prevRID{0, 0};
+        for (; pos < end; prev = pos, pos += entryKeyBytes(attr, pos) + RID_BYTES) {
+            if (prev == nullptr || !sameKey(attr, prev, pos)) {
+                SizeType keyBytes = entryKeyBytes(attr, pos) - prefixLength;
+                if (prefixLength == 0) {
+                    memmove(to, pos, keyBytes);
+                } else {
+                    *reinterpret_cast<unsigned *>(to) = *reinterpret_cast<const unsigned *>(pos) - prefixLength;
+                    memmove(to + INT_BYTES, pos + (INT_BYTES + prefixLength), keyBytes - INT_BYTES);
                 }
+                ridCount = to + keyBytes;
+                *reinterpret_cast<SizeType *>(ridCount) = 0;
+                to = ridCount + POSTING_COUNT_BYTES;
+                prevRID = RID{0, 0};
+            }
+            RID rid = entryRID(attr, pos);
+            unsigned pageStep = rid.pageNum - prevRID.pageNum;
+            to = putVarint(putVarint(to, pageStep), pageStep == 0 ? rid.slotNum - prevRID.slotNum : rid.slotNum);
+            ++*reinterpret_cast<SizeType *>(ridCount);
+            prevRID = rid;
+        }
+        return to;
+    }
+
+    // appends the entries in [pos, end), stored after "prefix", with their whole keys and returns how many there were
+    static unsigned decodeEntries(const Attribute &attr, const char *pos, const char *end, bool isLeaf, const char *prefix,
+                                  SizeType prefixLength, std::vector<char> &out, bool posting = false) {
+        if (isLeaf && posting) return decodePostings(attr, pos, end, prefix, prefixLength, out);
+        unsigned count = 0;
+        for (; pos < end; ++count) {
+            SizeType entrySize = entryKeyBytes(attr, pos) + (isLeaf ? RID_BYTES : RID_BYTES + PAGE_NUM_BYTES);
+            size_t offset = out.size();
+            out.resize(offset + prefixLength + entrySize);
+            wholeEntry(attr, pos, prefix, prefixLength, isLeaf, &out[offset]);
+            pos += entrySize;
+        }
+        return count;
+    }
+
+    // stores the entries with whole keys in [pos, end) at "to" without their first prefixLength key bytes, returns the end
+    static char * encodeEntries(const Attribute &attr, const char *pos, const char *end, bool isLeaf, SizeType prefixLength, char *to,
+                                bool posting = false) {
+        if (isLeaf && posting) return encodePostings(attr, pos, end, prefixLength, to);
+        while (pos < end) {
+            SizeType entrySize = entryKeyBytes(attr, pos) + (isLeaf ? RID_BYTES : RID_BYTES + PAGE_NUM_BYTES);
+            if (prefixLength == 0) {
+                memmove(to, pos, entrySize);
+            } else {
+                *reinterpret_cast<unsigned *>(to) = *reinterpret_cast<const unsigned *>(pos) - prefixLength;
+                memmove(to + INT_BYTES, pos + (INT_BYTES + prefixLength), entrySize - (INT_BYTES + prefixLength));
+            }
+            to += entrySize - prefixLength;
+            pos += entrySize;
+        }
+        return to;
+    }
+
+    // bytes of a leaf holding the entries with whole keys in [pos, end), stored after prefixLength bytes of their keys
+    static size_t leafPageBytes(const Attribute &attr, bool posting, const char *pos, const char *end, SizeType prefixLength) {
+        size_t bytes = LEAF_BYTES_BEFORE_KEYS;
+        for (const char *prev = nullptr; pos < end; prev = pos, pos += entryKeyBytes(attr, pos) + RID_BYTES)
+            bytes += storedBytes(attr, posting, prev, pos, prefixLength);
+        return bytes;
+    }
+
+    // stores the entries of a compressed node, kept after "prefix", after the first "length" bytes of "key" instead
+    static void changePrefix(const Attribute &attr, char *page, bool isLeaf, const char *prefix, SizeType prefixLength,
+                             const char *key, SizeType length, bool posting = false) {
+        char *keysStart = page + (isLeaf ? LEAF_BYTES_BEFORE_KEYS : NODE_BYTES_BEFORE_KEYS);
+        SizeType *end = nodeEnd(page, isLeaf);
+        std::vector<char> entries;
+        decodeEntries(attr, keysStart, page + *end, isLeaf, prefix, prefixLength, entries, posting);
+        *end = encodeEntries(attr, entries.data(), entries.data() + entries.size(), isLeaf, length, keysStart, posting) - page;
+        putPrefix(page, key, length);
+    }
+
+    // bytes a node takes with entryBytes of entries holding whole keys, once they are stored after a prefix
+    static size_t nodeBytes(SizeType headerBytes, size_t entryBytes, unsigned entryCount, SizeType prefixLength, bool compressed) {
+        return headerBytes + (entryBytes - entryCount * prefixLength) + (compressed ? OFFSET_BYTES + prefixLength : 0);
+    }
+
+    // The separator of two leaf entries, whole, as a leaf entry. Different keys are cut after the first byte that tells
+    // them apart, which keeps the separator above the left entry and not above the right one, and a RID of zeros.
+    static void shortestSeparator(const Attribute &attr, const char *left, const char *right, char *separator) {
+        if (compareKeys(attr, left, right) == 0) {
+            memmove(separator, right, entryKeyBytes(attr, right) + RID_BYTES);
+            return;
+        }
+        unsigned length = std::min<unsigned>(commonPrefix(left, right) + 1, *reinterpret_cast<const unsigned *>(right));
+        *reinterpret_cast<unsigned *>(separator) = length;
+        memmove(separator + INT_BYTES, right + INT_BYTES, length);
+        memset(separator + (INT_BYTES + length), 0, RID_BYTES);
+    }
+
+    // Sets the separator to the first entry of the right one of two leaves just split apart. Compressed leaves get the
+    // shortest separator instead, and prefixes as long as it and the fences of the leaf before the split allow.
+    static void separateLeaves(const Attribute &attr, bool compressed, bool posting, char *leftPage, char *rightPage, const char *prefix,
+                               SizeType prefixLength, const char *lowFence, const char *highFence, char *separator) {
+        char *first = rightPage + LEAF_BYTES_BEFORE_KEYS;
+        if (!compressed && !posting) {
+            memmove(separator, first, entryKeyBytes(attr, first) + RID_BYTES);
+            return;
+        }
+        std::vector<char> leftEntries, rightEntries;
+        decodeEntries(attr, leftPage + LEAF_BYTES_BEFORE_KEYS, leftPage + *nodeEnd(leftPage, true), true, prefix, prefixLength, leftEntries, posting);
+        decodeEntries(attr, first, rightPage + *nodeEnd(rightPage, true), true, prefix, prefixLength, rightEntries, posting);
+        const char *last = leftEntries.data(), *leftEnd = last + leftEntries.size();
+        while (last + (entryKeyBytes(attr, last) + RID_BYTES) < leftEnd) last += entryKeyBytes(attr, last) + RID_BYTES;
+        if (!compressed) {
+            memmove(separator, rightEntries.data(), entryKeyBytes(attr, rightEntries.data()) + RID_BYTES);
+            return;
+        }
+        shortestSeparator(attr, last, rightEntries.data(), separator);
+        changePrefix(attr, rightPage, true, prefix, prefixLength, separator, commonPrefix(separator, highFence), posting);
+        changePrefix(attr, leftPage, true, prefix, prefixLength, separator, commonPrefix(lowFence, separator), posting);
+    }
+
+    // FNV-1a over the key bytes, with both zeros of a real hashing alike since they compare equal
+    static unsigned hashKey(const Attribute &attr, const void *key) {
+        const unsigned char *bytes = static_cast<const unsigned char *>(key);
+        float zero = 0;
+        if (attr.type == TypeReal && *static_cast<const float *>(key) == 0) bytes = reinterpret_cast<const unsigned char *>(&zero);
+        unsigned hash = FNV_OFFSET_BASIS;
+        for (SizeType i = 0; i < entryKeyBytes(attr, static_cast<const char *>(key)); ++i)
+            hash = (hash ^ bytes[i]) * FNV_PRIME;
+        return hash;
+    }
+
+    char * IndexManager::determinePos(char *pagePtr, const Attribute &attr, const void *key, const RID &rid, char *endPtr, bool isLeaf, int typeOfSearch,
+                                      const char *prefix, SizeType prefixLength) {
+        if (attr.type == TypeInt)
+            return bisectEntries(pagePtr, endPtr, nodeEntrySize(attr, key, isLeaf), Key<int>{*static_cast<const int *>(key), rid}, typeOfSearch);
+        if (attr.type == TypeReal)
+            return bisectEntries(pagePtr, endPtr, nodeEntrySize(attr, key, isLeaf), Key<float>{*static_cast<const float *>(key), rid}, typeOfSearch);
+
+        // varchar entries vary in size and are walked in order
+        char *prevKey = nullptr;
+        unsigned keyLen = *static_cast<const unsigned *>(key);
+        const char *keyChars = static_cast<const char *>(key) + INT_BYTES;
+
+        // entries hold their keys after the node's prefix, and a key without it sorts before or after all of them
+        int prefixOrder = 0;
+        if (prefixLength > 0) {
+            prefixOrder = compareVarChar(keyChars, std::min<unsigned>(keyLen, prefixLength), prefix, prefixLength);
+            if (prefixOrder == 0) {
+                keyChars += prefixLength;
+                keyLen -= prefixLength;
+            }
+        }
+        while (pagePtr < endPtr) {
+            unsigned strLen = *reinterpret_cast<unsigned *>(pagePtr);
+            RID entryRID{*reinterpret_cast<unsigned *>(pagePtr + (INT_BYTES + strLen)), *reinterpret_cast<unsigned short *>(pagePtr + (INT_BYTES + strLen + PAGE_NUM_BYTES))};
+            int cmp = prefixOrder != 0 ? prefixOrder : compareVarChar(keyChars, keyLen, pagePtr + INT_BYTES, strLen);
+            if (cmp == 0) cmp = rid < entryRID ? -1 : (rid == entryRID ? 0 : 1);
+
+            switch (typeOfSearch) {
+                case 1:
+                    if (cmp == 0) return pagePtr;
+                break;
+                case 2:
+                    if (cmp <= 0) return pagePtr;
+                break;
+                case 3:
+                    if (cmp < 0) return prevKey;
+                prevKey = pagePtr;
             }
+            pagePtr += nodeEntrySize(attr, pagePtr, isLeaf);
         }
 
         return typeOfSearch == 3 ? prevKey : endPtr;
@@ -122,10 +486,11 @@ namespace PeterDB {
         memmove(newLoc, oldLoc, bytesToShift);
     }
 
-    char * IndexManager::putEntryOnPage(char *pagePtr, const Attribute &attr, const void *key, const RID &rid, unsigned childPage) {
+    char * IndexManager::putEntryOnPage(char *pagePtr, const Attribute &attr, const void *key, const RID &rid, unsigned childPage, SizeType prefixLength) {
         if (attr.type == TypeVarChar) {
-            int varCharLen = *static_cast<const int *>(key);
-            memmove(pagePtr, key, varCharLen + INT_BYTES);
+            int varCharLen = *static_cast<const int *>(key) - prefixLength;
+            memmove(pagePtr + INT_BYTES, static_cast<const char *>(key) + (INT_BYTES + prefixLength), varCharLen);
+            memmove(pagePtr, &varCharLen, INT_BYTES);
             pagePtr += varCharLen + INT_BYTES;
         } else {
             memmove(pagePtr, key, attr.length);
@@ -146,47 +511,98 @@ namespace PeterDB {
 
     RC IndexManager::insertEntryIntoEmptyIndex(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid) {
         char rootPage[PAGE_SIZE];
+        memset(rootPage, 0, PAGE_SIZE);
         *reinterpret_cast<unsigned *>(rootPage) = 1;
         if (ixFileHandle.appendPage(rootPage) == -1) return -1;  // placing down page to act as "pointer" to root node
         memset(rootPage, 0, LEAF_CHECK_BYTE + PAGE_NUM_BYTES);
         memset(rootPage, 1, LEAF_CHECK_BYTE);
-        char *endPos = putEntryOnPage(rootPage + LEAF_BYTES_BEFORE_KEYS, attribute, key, rid);
+        char entry[nodeEntrySize(attribute, key, true)];
+        putEntryOnPage(entry, attribute, key, rid);
+        char *endPos = encodeEntries(attribute, entry, entry + sizeof(entry), true, 0, rootPage + LEAF_BYTES_BEFORE_KEYS, postingLeaves(ixFileHandle));
         *reinterpret_cast<SizeType *>(rootPage + (LEAF_CHECK_BYTE + PAGE_NUM_BYTES)) = endPos - rootPage;
         return ixFileHandle.appendPage(rootPage);
     }
 
-    void IndexManager::splitLeaf(IXFileHandle &fh, char *leftPage, char *rightPage, const Attribute &attr, const void *key, const RID &rid, char *insertPos) {
+    void IndexManager::splitLeaf(unsigned rightPageNum, char *leftPage, char *rightPage, const Attribute &attr, const void *key, const RID &rid, char *insertPos, SizeType prefixLength) {
         char newLeft[PAGE_SIZE];
         memset(newLeft, 1, LEAF_CHECK_BYTE);
         memset(rightPage, 1, LEAF_CHECK_BYTE);
         memmove(rightPage + LEAF_CHECK_BYTE, leftPage + LEAF_CHECK_BYTE, PAGE_NUM_BYTES);
-        memmove(newLeft + LEAF_CHECK_BYTE, &fh.pageCount, PAGE_NUM_BYTES);
+        memmove(newLeft + LEAF_CHECK_BYTE, &rightPageNum, PAGE_NUM_BYTES);
         char *leftPtr = leftPage + LEAF_BYTES_BEFORE_KEYS;
         char * ptrs[2] = {newLeft + LEAF_BYTES_BEFORE_KEYS, rightPage + LEAF_BYTES_BEFORE_KEYS};
         char *leftEnd = leftPage + *reinterpret_cast<SizeType *>(leftPtr - OFFSET_BYTES);
 
+        // the left leaf takes entries while it stays within half a page, so neither side starts out above the other
         SizeType entrySize;
-        int i;
+        int i = 0;
         while (leftPtr < leftEnd) {
-            i = (ptrs[0] - newLeft < PAGE_SIZE / 2) ? 0 : 1;
+            entrySize = leftPtr == insertPos ? nodeEntrySize(attr, key, true) - prefixLength : nodeEntrySize(attr, leftPtr, true);
+            if (i == 0 && ptrs[0] > newLeft + LEAF_BYTES_BEFORE_KEYS && (ptrs[0] - newLeft) + entrySize > PAGE_SIZE / 2) i = 1;
             if (leftPtr == insertPos) {
-                ptrs[i] = putEntryOnPage(ptrs[i], attr, key, rid);
+                ptrs[i] = putEntryOnPage(ptrs[i], attr, key, rid, 0, prefixLength);
                 insertPos = nullptr;
             } else {
-                entrySize = nodeEntrySize(attr, leftPtr, true);
                 memmove(ptrs[i], leftPtr, entrySize);
                 ptrs[i] += entrySize;
                 leftPtr += entrySize;
             }
         }
 
-        if (insertPos != nullptr) ptrs[1] = putEntryOnPage(ptrs[1], attr, key, rid);
+        if (insertPos != nullptr) ptrs[1] = putEntryOnPage(ptrs[1], attr, key, rid, 0, prefixLength);
         *reinterpret_cast<SizeType *>(newLeft + (LEAF_CHECK_BYTE + PAGE_NUM_BYTES)) = ptrs[0] - newLeft;
         *reinterpret_cast<SizeType *>(rightPage + (LEAF_CHECK_BYTE + PAGE_NUM_BYTES)) = ptrs[1] - rightPage;
         memmove(leftPage, newLeft, PAGE_SIZE);
     }
 
-    void IndexManager::splitNode(IXFileHandle &fh, char *leftPage, char *rightPage, const Attribute &attr, const void *key, const RID &rid, unsigned pageNum, char *insertPos, void *pushUpKey) {
+    RC IndexManager::editPostings(char *page, const Attribute &attr, bool compressed, const void *key, const RID &rid, bool isInsertion,
+                                  std::vector<char> &entries) {
+        decodeEntries(attr, page + LEAF_BYTES_BEFORE_KEYS, page + *nodeEnd(page, true), true, prefixBytes(page, compressed),
+                      prefixLength(page, compressed), entries, true);
+        char *entriesEnd = entries.data() + entries.size();
+        size_t offset = determinePos(entries.data(), attr, key, rid, entriesEnd, true, isInsertion ? 2 : 1) - entries.data();
+        if (isInsertion) {
+            SizeType entrySize = nodeEntrySize(attr, key, true);
+            entries.insert(entries.begin() + offset, entrySize, 0);
+            putEntryOnPage(&entries[offset], attr, key, rid);
+            return 0;
+        }
+        if (offset == entries.size()) return -1;
+        entries.erase(entries.begin() + offset, entries.begin() + (offset + nodeEntrySize(attr, &entries[offset], true)));
+        return 0;
+    }
+
+    void IndexManager::splitPostingLeaf(unsigned rightPageNum, char *leftPage, char *rightPage, const Attribute &attr, const void *key,
+                                        const RID &rid, const char *prefix, SizeType prefixLength) {
+        std::vector<char> entries;
+        decodeEntries(attr, leftPage + LEAF_BYTES_BEFORE_KEYS, leftPage + *nodeEnd(leftPage, true), true, prefix, prefixLength, entries, true);
+        char *entriesEnd = entries.data() + entries.size();
+        size_t offset = determinePos(entries.data(), attr, key, rid, entriesEnd, true, 2) - entries.data();
+        entries.insert(entries.begin() + offset, nodeEntrySize(attr, key, true), 0);
+        putEntryOnPage(&entries[offset], attr, key, rid);
+
+        // the left leaf takes entries while it stays within half a page, as in splitLeaf
+        char *entriesStart = entries.data(), *splitPos = entriesStart, *prevPos = nullptr;
+        entriesEnd = entriesStart + entries.size();
+        size_t leftBytes = LEAF_BYTES_BEFORE_KEYS;
+        while (splitPos < entriesEnd) {
+            SizeType bytes = storedBytes(attr, true, prevPos, splitPos, prefixLength);
+            if (prevPos != nullptr && leftBytes + bytes > PAGE_SIZE / 2) break;
+            if (splitPos + nodeEntrySize(attr, splitPos, true) >= entriesEnd) break;
+            leftBytes += bytes;
+            prevPos = splitPos;
+            splitPos += nodeEntrySize(attr, splitPos, true);
+        }
+
+        memset(rightPage, 1, LEAF_CHECK_BYTE);
+        memmove(rightPage + LEAF_CHECK_BYTE, leftPage + LEAF_CHECK_BYTE, PAGE_NUM_BYTES);
+        memmove(leftPage + LEAF_CHECK_BYTE, &rightPageNum, PAGE_NUM_BYTES);
+        *nodeEnd(leftPage, true) = encodeEntries(attr, entriesStart, splitPos, true, prefixLength, leftPage + LEAF_BYTES_BEFORE_KEYS, true) - leftPage;
+        *nodeEnd(rightPage, true) = encodeEntries(attr, splitPos, entriesEnd, true, prefixLength, rightPage + LEAF_BYTES_BEFORE_KEYS, true) - rightPage;
+    }
+
+    void IndexManager::splitNode(IXFileHandle &fh, char *leftPage, char *rightPage, const Attribute &attr, const void *key, const RID &rid, unsigned pageNum, char *insertPos, void *pushUpKey,
+                                 const char *prefix, SizeType prefixLength) {
         char newLeft[PAGE_SIZE];
         memset(newLeft, 0, LEAF_CHECK_BYTE);
         memmove(newLeft + (LEAF_CHECK_BYTE + OFFSET_BYTES), leftPage + (LEAF_CHECK_BYTE + OFFSET_BYTES), PAGE_NUM_BYTES);
@@ -205,16 +621,16 @@ namespace PeterDB {
                     putEntryOnPage(static_cast<char *>(pushUpKey), attr, key, rid, pageNum);
                     insertPos = nullptr;
                 } else {
-                    entrySize = nodeEntrySize(attr, leftPtr, false);
-                    memmove(pushUpKey, leftPtr, entrySize);
-                    leftPtr += entrySize;
+                    // the entry moves up with its whole key
+                    wholeEntry(attr, leftPtr, prefix, prefixLength, false, static_cast<char *>(pushUpKey));
+                    leftPtr += nodeEntrySize(attr, leftPtr, false);
                 }
                 valuePushed = true;
                 continue;
             }
 
             if (leftPtr == insertPos) {
-                ptrs[i] = putEntryOnPage(ptrs[i], attr, key, rid, pageNum);
+                ptrs[i] = putEntryOnPage(ptrs[i], attr, key, rid, pageNum, prefixLength);
                 insertPos = nullptr;
             } else {
                 entrySize = nodeEntrySize(attr, leftPtr, false);
@@ -224,24 +640,30 @@ namespace PeterDB {
             }
         }
 
-        if (insertPos != nullptr) ptrs[1] = putEntryOnPage(ptrs[1], attr, key, rid, pageNum);
+        if (insertPos != nullptr) ptrs[1] = putEntryOnPage(ptrs[1], attr, key, rid, pageNum, prefixLength);
         *reinterpret_cast<SizeType *>(newLeft + LEAF_CHECK_BYTE) = ptrs[0] - newLeft;
         *reinterpret_cast<SizeType *>(rightPage + LEAF_CHECK_BYTE) = ptrs[1] - rightPage;
         memmove(leftPage, newLeft, PAGE_SIZE);
     }
 
-    RC IndexManager::getLeafPage(IXFileHandle &fh, char *pageData, unsigned &pageNum, const Attribute &attr, const void *key, const RID &rid) {
+    RC IndexManager::getLeafPage(IXFileHandle &fh, char *pageData, unsigned &pageNum, const Attribute &attr, const void *key, const RID &rid, unsigned *leafVersion, bool *isRoot) {
         char *keysStart = pageData + NODE_BYTES_BEFORE_KEYS;
         char *pos, *end;
+        bool compressed = prefixCompressed(fh, attr);
         if (fh.readPage(0, pageData) == -1) return -1;
         unsigned currPageNum = *reinterpret_cast<unsigned *>(pageData);
+        if (isRoot != nullptr) *isRoot = true;
 
         while (true) {
+            // the version of the page as it is read, which only counts for the leaf
+            if (leafVersion != nullptr) *leafVersion = fh.leafVersions[currPageNum % LEAF_LATCH_STRIPES].load();
             if (fh.readPage(currPageNum, pageData) == -1) return -1;
             if (*reinterpret_cast<unsigned char *>(pageData) == 1) break;
+            if (isRoot != nullptr) *isRoot = false;
             end = pageData + *reinterpret_cast<SizeType *>(pageData + LEAF_CHECK_BYTE);
 
-            pos = key == nullptr ? nullptr : determinePos(keysStart, attr, key, rid, end, false, 3);
+            pos = key == nullptr ? nullptr : determinePos(keysStart, attr, key, rid, end, false, 3, prefixBytes(pageData, compressed),
+                                                          prefixLength(pageData, compressed));
             if (pos == nullptr) {
                 memmove(&currPageNum, keysStart - PAGE_NUM_BYTES, PAGE_NUM_BYTES);
             } else {
@@ -256,18 +678,72 @@ namespace PeterDB {
         return 0;
     }
 
-    RC IndexManager::visitInsertNode(IXFileHandle &fh, char *pageData, unsigned pageNum, const Attribute &attr, const void *key, const RID &rid, bool & needSplit, void *pushUpKey, RID &pushUpRID, unsigned &childPage) {
+    RC IndexManager::updateLeaf(IXFileHandle &fh, const Attribute &attr, const void *key, const RID &rid, bool isInsertion, bool &done) {
+        done = false;
+        char pageData[PAGE_SIZE];
+        unsigned pageNum, version;
+        bool isRoot;
+        if (getLeafPage(fh, pageData, pageNum, attr, key, rid, &version, &isRoot) == -1) return -1;
+
+        // nodes above the leaf cannot change while treeLatch is shared, the leaf itself is read again if it changed
+        // before it was latched
+        unsigned stripe = pageNum % LEAF_LATCH_STRIPES;
+        std::lock_guard<std::mutex> leafLatch(fh.leafLatches[stripe]);
+        if (fh.leafVersions[stripe].load() != version && fh.readPage(pageNum, pageData) == -1) return -1;
+        char *keysStart = pageData + LEAF_BYTES_BEFORE_KEYS;
+        char *endPos = pageData + *reinterpret_cast<SizeType *>(keysStart - OFFSET_BYTES);
+        bool compressed = prefixCompressed(fh, attr);
+        SizeType prefix = prefixLength(pageData, compressed);
+        if (postingLeaves(fh)) {
+            std::vector<char> entries;
+            if (editPostings(pageData, attr, compressed, key, rid, isInsertion, entries) == -1) return -1;
+            char *entriesStart = entries.data(), *entriesEnd = entriesStart + entries.size();
+            size_t bytes = leafPageBytes(attr, true, entriesStart, entriesEnd, prefix);
+            if (isInsertion ? bytes > nodeCapacity(pageData, compressed) : !isRoot && bytes < UNDERFLOW_BYTES) return 0;
+            *nodeEnd(pageData, true) = encodeEntries(attr, entriesStart, entriesEnd, true, prefix, keysStart, true) - pageData;
+        } else if (isInsertion) {
+            SizeType entrySize = nodeEntrySize(attr, key, true) - prefix;
+            if (entrySize + (endPos - pageData) > nodeCapacity(pageData, compressed)) return 0;
+            char *insertPos = determinePos(keysStart, attr, key, rid, endPos, true, 2, prefixBytes(pageData, compressed), prefix);
+            if (insertPos < endPos) shiftEntriesRight(insertPos, insertPos + entrySize, endPos - insertPos);
+            putEntryOnPage(insertPos, attr, key, rid, 0, prefix);
+            *reinterpret_cast<SizeType *>(keysStart - OFFSET_BYTES) = (endPos + entrySize) - pageData;
+        } else {
+            char *deletePos = determinePos(keysStart, attr, key, rid, endPos, true, 1, prefixBytes(pageData, compressed), prefix);
+            if (deletePos == endPos) return -1;
+            SizeType entrySize = nodeEntrySize(attr, deletePos, true);
+            if (!isRoot && (endPos - pageData) - entrySize < UNDERFLOW_BYTES) return 0;     // a root leaf never merges
+            shiftEntriesLeft(deletePos + entrySize, deletePos, endPos - (deletePos + entrySize));
+            *reinterpret_cast<SizeType *>(keysStart - OFFSET_BYTES) = (endPos - entrySize) - pageData;
+        }
+        if (fh.writePage(pageNum, pageData) == -1) return -1;
+        ++fh.leafVersions[stripe];
+        done = true;
+        return 0;
+    }
+
+    RC IndexManager::visitInsertNode(IXFileHandle &fh, char *rootPtr, char *pageData, unsigned pageNum, const Attribute &attr, const void *key, const RID &rid, bool & needSplit, void *pushUpKey, RID &pushUpRID, unsigned &childPage,
+                                     const char *lowFence, const char *highFence) {
         bool isLeaf = *reinterpret_cast<unsigned char *>(pageData) == 1;
+        bool compressed = prefixCompressed(fh, attr), posting = postingLeaves(fh);
+        SizeType prefix = prefixLength(pageData, compressed);
         
         if (isLeaf) {
             char *keysStart = pageData + LEAF_BYTES_BEFORE_KEYS;
             char *endPos = pageData + *reinterpret_cast<SizeType *>(keysStart - OFFSET_BYTES);
-            SizeType entrySize = nodeEntrySize(attr, key, true);
-            if (entrySize + (endPos - pageData) <= PAGE_SIZE) {
-                char *insertPos = determinePos(keysStart, attr, key, rid, endPos, true, 2);
-                if (insertPos < endPos) shiftEntriesRight(insertPos, insertPos + entrySize, endPos - insertPos);
-                putEntryOnPage(insertPos, attr, key, rid);
-                *reinterpret_cast<SizeType *>(pageData + (LEAF_CHECK_BYTE + PAGE_NUM_BYTES)) = (endPos + entrySize) - pageData;
+            SizeType entrySize = nodeEntrySize(attr, key, true) - prefix;
+            std::vector<char> entries;
+            if (posting) editPostings(pageData, attr, compressed, key, rid, true, entries);
+            size_t bytes = posting ? leafPageBytes(attr, true, entries.data(), entries.data() + entries.size(), prefix) : entrySize + (endPos - pageData);
+            if (bytes <= nodeCapacity(pageData, compressed)) {
+                if (posting) {
+                    *nodeEnd(pageData, true) = encodeEntries(attr, entries.data(), entries.data() + entries.size(), true, prefix, keysStart, true) - pageData;
+                } else {
+                    char *insertPos = determinePos(keysStart, attr, key, rid, endPos, true, 2, prefixBytes(pageData, compressed), prefix);
+                    if (insertPos < endPos) shiftEntriesRight(insertPos, insertPos + entrySize, endPos - insertPos);
+                    putEntryOnPage(insertPos, attr, key, rid, 0, prefix);
+                    *reinterpret_cast<SizeType *>(pageData + (LEAF_CHECK_BYTE + PAGE_NUM_BYTES)) = (endPos + entrySize) - pageData;
+                }
                 needSplit = false;
                 return fh.writePage(pageNum, pageData);
             } else {
@@ -283,7 +759,7 @@ namespace PeterDB {
         } else {
             char *keysStart = pageData + NODE_BYTES_BEFORE_KEYS;
             char *endPos = pageData + *reinterpret_cast<SizeType *>(pageData + LEAF_CHECK_BYTE);
-            char *pos = determinePos(keysStart, attr, key, rid, endPos, false, 3);
+            char *pos = determinePos(keysStart, attr, key, rid, endPos, false, 3, prefixBytes(pageData, compressed), prefix);
             unsigned nextVisit;
             if (pos == nullptr) {
                 memmove(&nextVisit, keysStart - PAGE_NUM_BYTES, PAGE_NUM_BYTES);
@@ -294,74 +770,76 @@ namespace PeterDB {
                     memmove(&nextVisit, pos + (attr.length + RID_BYTES), PAGE_NUM_BYTES);
             }
 
+            // the separators around the child are its fences
+            char childLow[attr.length + INT_BYTES + RID_BYTES + PAGE_NUM_BYTES], childHigh[attr.length + INT_BYTES + RID_BYTES + PAGE_NUM_BYTES];
+            const char *childLowFence = lowFence, *childHighFence = highFence;
+            if (compressed) {
+                char *next = pos == nullptr ? keysStart : pos + nodeEntrySize(attr, pos, false);
+                if (pos != nullptr) {
+                    wholeEntry(attr, pos, prefixBytes(pageData, true), prefix, false, childLow);
+                    childLowFence = childLow;
+                }
+                if (next < endPos) {
+                    wholeEntry(attr, next, prefixBytes(pageData, true), prefix, false, childHigh);
+                    childHighFence = childHigh;
+                }
+            }
+
             char *visitPage = new char[PAGE_SIZE];
             if (fh.readPage(nextVisit, visitPage) == -1) {delete[] visitPage; return -1;}
-            if (visitInsertNode(fh, visitPage, nextVisit, attr, key, rid, needSplit, pushUpKey, pushUpRID, childPage) == -1) {delete[] visitPage; return -1;}
+            if (visitInsertNode(fh, rootPtr, visitPage, nextVisit, attr, key, rid, needSplit, pushUpKey, pushUpRID, childPage, childLowFence, childHighFence) == -1) {delete[] visitPage; return -1;}
             if (!needSplit) {delete[] visitPage; return 0;}
 
+            unsigned newPageNum;
+            if (allocatePage(fh, rootPtr, newPageNum) == -1) {delete[] visitPage; return -1;}
             char *newPage = new char[PAGE_SIZE];
             bool leafVisited = *reinterpret_cast<unsigned char *>(visitPage) == 1;
-            char *visitEnd = visitPage + *reinterpret_cast<SizeType *>(visitPage + (leafVisited ? (LEAF_CHECK_BYTE + PAGE_NUM_BYTES) : LEAF_CHECK_BYTE));
-            char *visitInsert = determinePos(visitPage + (leafVisited ? LEAF_BYTES_BEFORE_KEYS : NODE_BYTES_BEFORE_KEYS), attr, pushUpKey, pushUpRID, visitEnd, leafVisited, 2);
 
+            // the split writes over the end of the child's page, where its prefix is kept
+            SizeType visitPrefix = prefixLength(visitPage, compressed);
+            char visitPrefixBytes[attr.length];
+            if (visitPrefix > 0) memmove(visitPrefixBytes, prefixBytes(visitPage, true), visitPrefix);
+            char *visitEnd = visitPage + *nodeEnd(visitPage, leafVisited);
+            char *visitInsert = leafVisited && posting ? nullptr
+                    : determinePos(visitPage + (leafVisited ? LEAF_BYTES_BEFORE_KEYS : NODE_BYTES_BEFORE_KEYS), attr, pushUpKey, pushUpRID, visitEnd, leafVisited, 2,
+                                   visitPrefixBytes, visitPrefix);
+
+            char splitKey[attr.length + INT_BYTES + RID_BYTES + PAGE_NUM_BYTES];
             if (leafVisited) {
-                splitLeaf(fh, visitPage, newPage, attr, pushUpKey, pushUpRID, visitInsert);
-                char *splitKey = newPage + LEAF_BYTES_BEFORE_KEYS;
-                char *ptr = splitKey;
-                if (attr.type == TypeVarChar)
-                    ptr += INT_BYTES + *reinterpret_cast<int *>(ptr);
+                if (posting)
+                    splitPostingLeaf(newPageNum, visitPage, newPage, attr, pushUpKey, pushUpRID, visitPrefixBytes, visitPrefix);
                 else
-                    ptr += attr.length;
-                RID r{*reinterpret_cast<unsigned *>(ptr), *reinterpret_cast<unsigned short *>(ptr + PAGE_NUM_BYTES)};
-
-                SizeType entrySize = nodeEntrySize(attr, splitKey, false);
-                if (entrySize + (endPos - pageData) <= PAGE_SIZE) {
-                    char *insertPos = determinePos(keysStart, attr, splitKey, r, endPos, false, 2);
-                    if (insertPos < endPos) shiftEntriesRight(insertPos, insertPos + entrySize, endPos - insertPos);
-                    putEntryOnPage(insertPos, attr, splitKey, r, fh.pageCount);
-                    *reinterpret_cast<SizeType *>(pageData + LEAF_CHECK_BYTE) = (endPos + entrySize) - pageData;
-                    needSplit = false;
-                    if (fh.writePage(pageNum, pageData) == -1) {delete[] visitPage; delete[] newPage; return -1;}
-                } else {
-                    needSplit = true;
-                    memmove(pushUpKey, splitKey, ptr - splitKey);
-                    pushUpRID.pageNum = r.pageNum;
-                    pushUpRID.slotNum = r.slotNum;
-                    childPage = fh.pageCount;
-                }
+                    splitLeaf(newPageNum, visitPage, newPage, attr, pushUpKey, pushUpRID, visitInsert, visitPrefix);
+                separateLeaves(attr, compressed, posting, visitPage, newPage, visitPrefixBytes, visitPrefix, childLowFence, childHighFence, splitKey);
             } else {
-                char splitKey[attr.length + INT_BYTES + RID_BYTES + PAGE_NUM_BYTES];
-                splitNode(fh, visitPage, newPage, attr, pushUpKey, pushUpRID, childPage, visitInsert, splitKey);
-                RID r{};
-                const char *ptr = splitKey;
-                if (attr.type == TypeVarChar)
-                    ptr += INT_BYTES + *reinterpret_cast<const int *>(ptr);
-                else
-                    ptr += attr.length;
-                r.pageNum = *reinterpret_cast<const unsigned *>(ptr);
-                r.slotNum = *reinterpret_cast<const unsigned short *>(ptr + PAGE_NUM_BYTES);
-                memmove(&childPage, ptr + RID_BYTES, PAGE_NUM_BYTES);
+                splitNode(fh, visitPage, newPage, attr, pushUpKey, pushUpRID, childPage, visitInsert, splitKey, visitPrefixBytes, visitPrefix);
+                if (compressed) {
+                    changePrefix(attr, newPage, false, visitPrefixBytes, visitPrefix, splitKey, commonPrefix(splitKey, childHighFence));
+                    changePrefix(attr, visitPage, false, visitPrefixBytes, visitPrefix, splitKey, commonPrefix(childLowFence, splitKey));
+                }
+                childPage = entryChild(attr, splitKey);
                 memmove(newPage + (LEAF_CHECK_BYTE + OFFSET_BYTES), &childPage, PAGE_NUM_BYTES);
+            }
 
-                SizeType entrySize = nodeEntrySize(attr, splitKey, false);
-                if (entrySize + (endPos - pageData) <= PAGE_SIZE) {
-                    char *insertPos = determinePos(keysStart, attr, splitKey, r, endPos, false, 2);
-                    if (insertPos < endPos) shiftEntriesRight(insertPos, insertPos + entrySize, endPos - insertPos);
-                    putEntryOnPage(insertPos, attr, splitKey, r, fh.pageCount);
-                    *reinterpret_cast<SizeType *>(pageData + LEAF_CHECK_BYTE) = (endPos + entrySize) - pageData;
-                    needSplit = false;
-                    if (fh.writePage(pageNum, pageData) == -1) {delete[] visitPage; delete[] newPage; return -1;}
-                } else {
-                    needSplit = true;
-                    memmove(pushUpKey, splitKey, ptr - splitKey);
-                    pushUpRID.pageNum = r.pageNum;
-                    pushUpRID.slotNum = r.slotNum;
-                    childPage = fh.pageCount;
-                }
+            RID r = entryRID(attr, splitKey);
+            SizeType entrySize = nodeEntrySize(attr, splitKey, false) - prefix;
+            if (entrySize + (endPos - pageData) <= nodeCapacity(pageData, compressed)) {
+                char *insertPos = determinePos(keysStart, attr, splitKey, r, endPos, false, 2, prefixBytes(pageData, compressed), prefix);
+                if (insertPos < endPos) shiftEntriesRight(insertPos, insertPos + entrySize, endPos - insertPos);
+                putEntryOnPage(insertPos, attr, splitKey, r, newPageNum, prefix);
+                *reinterpret_cast<SizeType *>(pageData + LEAF_CHECK_BYTE) = (endPos + entrySize) - pageData;
+                needSplit = false;
+                if (fh.writePage(pageNum, pageData) == -1) {delete[] visitPage; delete[] newPage; return -1;}
+            } else {
+                needSplit = true;
+                memmove(pushUpKey, splitKey, entryKeyBytes(attr, splitKey));
+                pushUpRID.pageNum = r.pageNum;
+                pushUpRID.slotNum = r.slotNum;
+                childPage = newPageNum;
             }
 
             if (fh.writePage(nextVisit, visitPage) == -1) {delete[] visitPage; delete[] newPage; return -1;}
-            RC status = fh.appendPage(newPage);
+            RC status = placePage(fh, newPageNum, newPage);
             delete[] visitPage;
             delete[] newPage;
             return status;
@@ -370,52 +848,66 @@ namespace PeterDB {
 
     RC IndexManager::createNewRoot(IXFileHandle &fh, char *rootPage, char *rootPtr, const Attribute &attr, const void *rootKey, const RID &rootRID, unsigned childPage) {
         bool rootIsLeaf = *reinterpret_cast<unsigned char *>(rootPage) == 1;
+        bool compressed = prefixCompressed(fh, attr), posting = postingLeaves(fh);
         unsigned rootPageNum = *reinterpret_cast<unsigned *>(rootPtr);
         char *keysStart = rootPage + (rootIsLeaf ? LEAF_BYTES_BEFORE_KEYS : NODE_BYTES_BEFORE_KEYS);
         char *endPos = rootPage + *reinterpret_cast<SizeType *>(rootPage + (LEAF_CHECK_BYTE + (rootIsLeaf ? PAGE_NUM_BYTES : 0)));
-        char *insertPos = determinePos(keysStart, attr, rootKey, rootRID, endPos, rootIsLeaf, 2);
+        char *insertPos = rootIsLeaf && posting ? nullptr : determinePos(keysStart, attr, rootKey, rootRID, endPos, rootIsLeaf, 2);
         char newPage[PAGE_SIZE];
         char newRoot[PAGE_SIZE];
+        unsigned newPageNum, newRootNum;
+        if (allocatePage(fh, rootPtr, newPageNum) == -1) return -1;
         memset(newRoot, 0, LEAF_CHECK_BYTE);
         memmove(newRoot + (LEAF_CHECK_BYTE + OFFSET_BYTES), &rootPageNum, PAGE_NUM_BYTES);
 
+        // the root has no fences, so neither it nor the two halves of the old one have a prefix
+        char splitKey[attr.length + INT_BYTES + RID_BYTES + PAGE_NUM_BYTES];
         if (rootIsLeaf) {
-            splitLeaf(fh, rootPage, newPage, attr, rootKey, rootRID, insertPos);
-            char *ptr = newPage + LEAF_BYTES_BEFORE_KEYS;
-            if (attr.type == TypeVarChar)
-                ptr += INT_BYTES + *reinterpret_cast<int *>(ptr);
+            if (posting)
+                splitPostingLeaf(newPageNum, rootPage, newPage, attr, rootKey, rootRID, nullptr, 0);
             else
-                ptr += attr.length;
-            RID r{*reinterpret_cast<unsigned *>(ptr), *reinterpret_cast<unsigned short *>(ptr + PAGE_NUM_BYTES)};
-            char *newRootEnd = putEntryOnPage(newRoot + NODE_BYTES_BEFORE_KEYS, attr, newPage + LEAF_BYTES_BEFORE_KEYS, r, fh.pageCount);
-            *reinterpret_cast<SizeType *>(newRoot + LEAF_CHECK_BYTE) = newRootEnd - newRoot;
+                splitLeaf(newPageNum, rootPage, newPage, attr, rootKey, rootRID, insertPos);
+            separateLeaves(attr, compressed, posting, rootPage, newPage, nullptr, 0, nullptr, nullptr, splitKey);
         } else {
-            char splitKey[attr.length + INT_BYTES + RID_BYTES + PAGE_NUM_BYTES];
             splitNode(fh, rootPage, newPage, attr, rootKey, rootRID, childPage, insertPos, splitKey);
-            RID r{};
-            const char *ptr = splitKey;
-            if (attr.type == TypeVarChar)
-                ptr += INT_BYTES + *reinterpret_cast<const int *>(ptr);
-            else
-                ptr += attr.length;
-            r.pageNum = *reinterpret_cast<const unsigned *>(ptr);
-            r.slotNum = *reinterpret_cast<const unsigned short *>(ptr + PAGE_NUM_BYTES);
-            memmove(&childPage, ptr + RID_BYTES, PAGE_NUM_BYTES);
-
+            if (compressed) {
+                putPrefix(rootPage, nullptr, 0);
+                putPrefix(newPage, nullptr, 0);
+            }
+            childPage = entryChild(attr, splitKey);
             memmove(newPage + (LEAF_CHECK_BYTE + OFFSET_BYTES), &childPage, PAGE_NUM_BYTES);
-            char *newRootEnd = putEntryOnPage(newRoot + NODE_BYTES_BEFORE_KEYS, attr, splitKey, r, fh.pageCount);
-            *reinterpret_cast<SizeType *>(newRoot + LEAF_CHECK_BYTE) = newRootEnd - newRoot;
         }
+        char *newRootEnd = putEntryOnPage(newRoot + NODE_BYTES_BEFORE_KEYS, attr, splitKey, entryRID(attr, splitKey), newPageNum);
+        *reinterpret_cast<SizeType *>(newRoot + LEAF_CHECK_BYTE) = newRootEnd - newRoot;
+        if (compressed) putPrefix(newRoot, nullptr, 0);
 
         if (fh.writePage(rootPageNum, rootPage) == -1) return -1;
-        if (fh.appendPage(newPage) == -1) return -1;
-        memmove(rootPtr, &fh.pageCount, PAGE_NUM_BYTES);
-        if (fh.writePage(0, rootPtr) == -1) return -1;
-        return fh.appendPage(newRoot);
+        if (placePage(fh, newPageNum, newPage) == -1) return -1;
+        if (allocatePage(fh, rootPtr, newRootNum) == -1) return -1;
+        if (placePage(fh, newRootNum, newRoot) == -1) return -1;
+        memmove(rootPtr, &newRootNum, PAGE_NUM_BYTES);
+        return fh.writePage(0, rootPtr);
     }
 
     RC
     IndexManager::insertEntry(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid) {
+        if (ixFileHandle.pageLayout == IndexHash) {
+            std::lock_guard<TreeLatch> latch(ixFileHandle.treeLatch);
+            return hashInsert(ixFileHandle, attribute, key, rid);
+        }
+        bool done = false;
+        {
+            SharedTreeLatch latch(ixFileHandle.treeLatch);
+            if (ixFileHandle.pageCount != 0 && updateLeaf(ixFileHandle, attribute, key, rid, true, done) == -1) return -1;
+        }
+        if (done) return 0;
+
+        // the leaf is full, or there is none yet
+        std::lock_guard<TreeLatch> latch(ixFileHandle.treeLatch);
+        return insertWithSplits(ixFileHandle, attribute, key, rid);
+    }
+
+    RC IndexManager::insertWithSplits(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid) {
         if (ixFileHandle.pageCount == 0)
             return insertEntryIntoEmptyIndex(ixFileHandle, attribute, key, rid);
 
@@ -429,7 +921,7 @@ namespace PeterDB {
         unsigned childPage;
         bool needSplit;
         char pushUpKey[attribute.length + INT_BYTES + RID_BYTES + PAGE_NUM_BYTES];
-        if (visitInsertNode(ixFileHandle, rootPage, rootPageNum, attribute, key, rid, needSplit, pushUpKey, pushUpRID, childPage) == -1) {delete[] rootPtr; delete[] rootPage; return -1;}
+        if (visitInsertNode(ixFileHandle, rootPtr, rootPage, rootPageNum, attribute, key, rid, needSplit, pushUpKey, pushUpRID, childPage, nullptr, nullptr) == -1) {delete[] rootPtr; delete[] rootPage; return -1;}
         if (!needSplit) {delete[] rootPtr; delete[] rootPage; return 0;}
 
         RC status = createNewRoot(ixFileHandle, rootPage, rootPtr, attribute, pushUpKey, pushUpRID, childPage);
@@ -442,24 +934,542 @@ namespace PeterDB {
         memmove(newLoc, oldLoc, bytesToShift);
     }
 
+    RC IndexManager::allocatePage(IXFileHandle &fh, char *rootPtr, unsigned &pageNum) {
+        unsigned freePageNum = *reinterpret_cast<unsigned *>(rootPtr + FREE_LIST_OFFSET);
+        if (freePageNum == 0) {
+            pageNum = fh.pageCount;     // appended by placePage
+            return 0;
+        }
+
+        char freePage[PAGE_SIZE];
+        if (fh.readPage(freePageNum, freePage) == -1) return -1;
+        memmove(rootPtr + FREE_LIST_OFFSET, freePage + LEAF_CHECK_BYTE, PAGE_NUM_BYTES);
+        pageNum = freePageNum;
+        return fh.writePage(0, rootPtr);
+    }
+
+    RC IndexManager::placePage(IXFileHandle &fh, unsigned pageNum, const char *pageData) {
+        return pageNum == fh.pageCount ? fh.appendPage(pageData) : fh.writePage(pageNum, pageData);
+    }
+
+    RC IndexManager::freePage(IXFileHandle &fh, char *rootPtr, unsigned pageNum) {
+        char freePage[PAGE_SIZE];
+        memset(freePage, 0, PAGE_SIZE);
+        memset(freePage, FREE_PAGE_FLAG, LEAF_CHECK_BYTE);
+        memmove(freePage + LEAF_CHECK_BYTE, rootPtr + FREE_LIST_OFFSET, PAGE_NUM_BYTES);
+        if (fh.writePage(pageNum, freePage) == -1) return -1;
+        memmove(rootPtr + FREE_LIST_OFFSET, &pageNum, PAGE_NUM_BYTES);
+        return fh.writePage(0, rootPtr);
+    }
+
+    RC IndexManager::rebalanceLeaves(IXFileHandle &fh, char *rootPtr, char *parent, const Attribute &attr, char *sepPos, char *leftPage, unsigned leftNum, char *rightPage, unsigned rightNum) {
+        bool compressed = prefixCompressed(fh, attr), posting = postingLeaves(fh);
+        SizeType *leftEnd = reinterpret_cast<SizeType *>(leftPage + (LEAF_CHECK_BYTE + PAGE_NUM_BYTES));
+        SizeType *rightEnd = reinterpret_cast<SizeType *>(rightPage + (LEAF_CHECK_BYTE + PAGE_NUM_BYTES));
+        SizeType *parentEnd = reinterpret_cast<SizeType *>(parent + LEAF_CHECK_BYTE);
+        SizeType sepSize = nodeEntrySize(attr, sepPos, false);
+        SizeType leftPrefix = prefixLength(leftPage, compressed), rightPrefix = prefixLength(rightPage, compressed);
+        SizeType parentPrefix = prefixLength(parent, compressed);
+
+        // both prefixes start the separator, so the shorter one is what all entries of the two leaves share
+        std::vector<char> entries;
+        decodeEntries(attr, leftPage + LEAF_BYTES_BEFORE_KEYS, leftPage + *leftEnd, true, prefixBytes(leftPage, compressed), leftPrefix, entries, posting);
+        decodeEntries(attr, rightPage + LEAF_BYTES_BEFORE_KEYS, rightPage + *rightEnd, true, prefixBytes(rightPage, compressed), rightPrefix, entries, posting);
+        SizeType shared = std::min(leftPrefix, rightPrefix);
+        size_t totalBytes = entries.size();
+        char *entriesStart = entries.data(), *entriesEnd = entriesStart + totalBytes;
+
+        if (leafPageBytes(attr, posting, entriesStart, entriesEnd, shared) + MERGE_SLACK <= (compressed ? PREFIX_LENGTH_OFFSET - shared : PAGE_SIZE)) {
+            // the right leaf moves into the left one and leaves the chain
+            *leftEnd = encodeEntries(attr, entriesStart, entriesEnd, true, shared, leftPage + LEAF_BYTES_BEFORE_KEYS, posting) - leftPage;
+            if (compressed) putPrefix(leftPage, entriesStart, shared);
+            memmove(leftPage + LEAF_CHECK_BYTE, rightPage + LEAF_CHECK_BYTE, PAGE_NUM_BYTES);
+            shiftEntriesLeft(sepPos + sepSize, sepPos, (parent + *parentEnd) - (sepPos + sepSize));
+            *parentEnd -= sepSize;
+            if (fh.writePage(leftNum, leftPage) == -1) return -1;
+            return freePage(fh, rootPtr, rightNum);
+        }
+
+        // too much for one page: the entries are split evenly again, under a new separator. Posting lists are split by
+        // the bytes they are stored in.
+        char *splitPos = entriesStart, *prevPos = nullptr;
+        size_t splitBytes = 0, halfBytes = posting ? leafPageBytes(attr, true, entriesStart, entriesEnd, shared) / 2 : totalBytes / 2;
+        while (true) {
+            SizeType entrySize = nodeEntrySize(attr, splitPos, true);
+            SizeType bytes = posting ? storedBytes(attr, true, prevPos, splitPos, shared) : entrySize;
+            if (splitPos > entriesStart && splitBytes + bytes > halfBytes) break;
+            if ((splitPos - entriesStart) + entrySize >= totalBytes) break;
+            splitBytes += bytes;
+            prevPos = splitPos;
+            splitPos += entrySize;
+        }
+
+        char separator[attr.length + INT_BYTES + RID_BYTES];
+        SizeType newLeftPrefix = 0, newRightPrefix = 0;
+        if (compressed) {
+            shortestSeparator(attr, prevPos, splitPos, separator);
+            unsigned sepLength = *reinterpret_cast<unsigned *>(separator);
+            newLeftPrefix = commonBytes(prefixBytes(leftPage, true), leftPrefix, separator + INT_BYTES, sepLength);
+            newRightPrefix = commonBytes(prefixBytes(rightPage, true), rightPrefix, separator + INT_BYTES, sepLength);
+        } else
+            memmove(separator, splitPos, entryKeyBytes(attr, splitPos) + RID_BYTES);
+
+        // shorter prefixes, or a posting list split in two, may leave either half too big, and the parent may have no room for a longer separator
+        size_t leftBytes = leafPageBytes(attr, posting, entriesStart, splitPos, newLeftPrefix);
+        size_t rightBytes = leafPageBytes(attr, posting, splitPos, entriesEnd, newRightPrefix);
+        SizeType newSepSize = nodeEntrySize(attr, separator, false) - parentPrefix;
+        if (leftBytes > (compressed ? PREFIX_LENGTH_OFFSET - newLeftPrefix : PAGE_SIZE)
+            || rightBytes > (compressed ? PREFIX_LENGTH_OFFSET - newRightPrefix : PAGE_SIZE)) return 0;
+        if (*parentEnd - sepSize + newSepSize > nodeCapacity(parent, compressed)) return 0;
+        shiftEntriesLeft(sepPos + sepSize, sepPos + newSepSize, (parent + *parentEnd) - (sepPos + sepSize));
+        *parentEnd = *parentEnd - sepSize + newSepSize;
+        putEntryOnPage(sepPos, attr, separator, entryRID(attr, separator), rightNum, parentPrefix);
+
+        *leftEnd = encodeEntries(attr, entriesStart, splitPos, true, newLeftPrefix, leftPage + LEAF_BYTES_BEFORE_KEYS, posting) - leftPage;
+        *rightEnd = encodeEntries(attr, splitPos, entriesEnd, true, newRightPrefix, rightPage + LEAF_BYTES_BEFORE_KEYS, posting) - rightPage;
+        if (compressed) {
+            putPrefix(leftPage, separator, newLeftPrefix);
+            putPrefix(rightPage, separator, newRightPrefix);
+        }
+        if (fh.writePage(leftNum, leftPage) == -1) return -1;
+        return fh.writePage(rightNum, rightPage);
+    }
+
+    RC IndexManager::rebalanceNodes(IXFileHandle &fh, char *rootPtr, char *parent, const Attribute &attr, char *sepPos, char *leftPage, unsigned leftNum, char *rightPage, unsigned rightNum) {
+        bool compressed = prefixCompressed(fh, attr);
+        SizeType *leftEnd = reinterpret_cast<SizeType *>(leftPage + LEAF_CHECK_BYTE);
+        SizeType *rightEnd = reinterpret_cast<SizeType *>(rightPage + LEAF_CHECK_BYTE);
+        SizeType *parentEnd = reinterpret_cast<SizeType *>(parent + LEAF_CHECK_BYTE);
+        SizeType sepSize = nodeEntrySize(attr, sepPos, false);
+        SizeType leftPrefix = prefixLength(leftPage, compressed), rightPrefix = prefixLength(rightPage, compressed);
+        SizeType parentPrefix = prefixLength(parent, compressed);
+        unsigned rightFirstChild;
+        memmove(&rightFirstChild, rightPage + (NODE_BYTES_BEFORE_KEYS - PAGE_NUM_BYTES), PAGE_NUM_BYTES);
+
+        // the separator comes down between the two nodes, pointing at the right node's first child
+        std::vector<char> entries;
+        unsigned count = decodeEntries(attr, leftPage + NODE_BYTES_BEFORE_KEYS, leftPage + *leftEnd, false, prefixBytes(leftPage, compressed), leftPrefix, entries);
+        size_t sepOffset = entries.size();
+        count += decodeEntries(attr, sepPos, sepPos + sepSize, false, prefixBytes(parent, compressed), parentPrefix, entries);
+        memmove(&entries[sepOffset + (entryKeyBytes(attr, &entries[sepOffset]) + RID_BYTES)], &rightFirstChild, PAGE_NUM_BYTES);
+        count += decodeEntries(attr, rightPage + NODE_BYTES_BEFORE_KEYS, rightPage + *rightEnd, false, prefixBytes(rightPage, compressed), rightPrefix, entries);
+        SizeType shared = std::min(leftPrefix, rightPrefix);
+        size_t totalBytes = entries.size();
+        char *entriesStart = entries.data(), *entriesEnd = entriesStart + totalBytes;
+
+        if (NODE_BYTES_BEFORE_KEYS + (totalBytes - count * shared) <= (compressed ? PREFIX_LENGTH_OFFSET - shared : PAGE_SIZE)) {
+            *leftEnd = encodeEntries(attr, entriesStart, entriesEnd, false, shared, leftPage + NODE_BYTES_BEFORE_KEYS) - leftPage;
+            if (compressed) putPrefix(leftPage, entriesStart, shared);
+            shiftEntriesLeft(sepPos + sepSize, sepPos, (parent + *parentEnd) - (sepPos + sepSize));
+            *parentEnd -= sepSize;
+            if (fh.writePage(leftNum, leftPage) == -1) return -1;
+            return freePage(fh, rootPtr, rightNum);
+        }
+
+        // the entry in the middle moves up instead, and its child starts the right node
+        char *upPos = entriesStart;
+        unsigned leftCount = 0;
+        while (true) {
+            SizeType entrySize = nodeEntrySize(attr, upPos, false);
+            if (upPos > entriesStart && (upPos - entriesStart) + entrySize > totalBytes / 2) break;
+            if (upPos + entrySize >= entriesEnd || upPos + entrySize >= entriesEnd - nodeEntrySize(attr, upPos + entrySize, false)) break;
+            upPos += entrySize;
+            ++leftCount;
+        }
+        SizeType upSize = nodeEntrySize(attr, upPos, false);
+        SizeType newLeftPrefix = 0, newRightPrefix = 0;
+        if (compressed) {
+            unsigned upLength = *reinterpret_cast<unsigned *>(upPos);
+            newLeftPrefix = commonBytes(prefixBytes(leftPage, true), leftPrefix, upPos + INT_BYTES, upLength);
+            newRightPrefix = commonBytes(prefixBytes(rightPage, true), rightPrefix, upPos + INT_BYTES, upLength);
+        }
+        size_t leftBytes = NODE_BYTES_BEFORE_KEYS + (upPos - entriesStart) - leftCount * newLeftPrefix;
+        size_t rightBytes = NODE_BYTES_BEFORE_KEYS + (entriesEnd - (upPos + upSize)) - (count - leftCount - 1) * newRightPrefix;
+        if (compressed && (leftBytes > PREFIX_LENGTH_OFFSET - newLeftPrefix || rightBytes > PREFIX_LENGTH_OFFSET - newRightPrefix)) return 0;
+        if (*parentEnd - sepSize + (upSize - parentPrefix) > nodeCapacity(parent, compressed)) return 0;    // the parent has no room for a longer separator
+
+        *leftEnd = encodeEntries(attr, entriesStart, upPos, false, newLeftPrefix, leftPage + NODE_BYTES_BEFORE_KEYS) - leftPage;
+        rightFirstChild = entryChild(attr, upPos);
+        memmove(rightPage + (NODE_BYTES_BEFORE_KEYS - PAGE_NUM_BYTES), &rightFirstChild, PAGE_NUM_BYTES);
+        *rightEnd = encodeEntries(attr, upPos + upSize, entriesEnd, false, newRightPrefix, rightPage + NODE_BYTES_BEFORE_KEYS) - rightPage;
+        if (compressed) {
+            putPrefix(leftPage, upPos, newLeftPrefix);
+            putPrefix(rightPage, upPos, newRightPrefix);
+        }
+
+        shiftEntriesLeft(sepPos + sepSize, sepPos + (upSize - parentPrefix), (parent + *parentEnd) - (sepPos + sepSize));
+        *parentEnd = *parentEnd - sepSize + (upSize - parentPrefix);
+        putEntryOnPage(sepPos, attr, upPos, entryRID(attr, upPos), rightNum, parentPrefix);
+        if (fh.writePage(leftNum, leftPage) == -1) return -1;
+        return fh.writePage(rightNum, rightPage);
+    }
+
+    RC IndexManager::visitDeleteNode(IXFileHandle &fh, char *rootPtr, char *pageData, unsigned pageNum, const Attribute &attr, const void *key, const RID &rid, bool &underflow) {
+        bool compressed = prefixCompressed(fh, attr);
+        if (*reinterpret_cast<unsigned char *>(pageData) == 1) {
+            char *keysStart = pageData + LEAF_BYTES_BEFORE_KEYS;
+            char *end = pageData + *reinterpret_cast<SizeType *>(keysStart - OFFSET_BYTES);
+            if (postingLeaves(fh)) {
+                std::vector<char> entries;
+                if (editPostings(pageData, attr, compressed, key, rid, false, entries) == -1) return -1;
+                *nodeEnd(pageData, true) = encodeEntries(attr, entries.data(), entries.data() + entries.size(), true,
+                                                         prefixLength(pageData, compressed), keysStart, true) - pageData;
+            } else {
+                char *deletePos = determinePos(keysStart, attr, key, rid, end, true, 1, prefixBytes(pageData, compressed), prefixLength(pageData, compressed));
+                if (deletePos == end) return -1;
+                char *nextPos = deletePos + nodeEntrySize(attr, deletePos, true);
+                shiftEntriesLeft(nextPos, deletePos, end - nextPos);
+                *reinterpret_cast<SizeType *>(keysStart - OFFSET_BYTES) = end - (nextPos - deletePos) - pageData;
+            }
+            underflow = *nodeEnd(pageData, true) < UNDERFLOW_BYTES;
+            return fh.writePage(pageNum, pageData);
+        }
+
+        char *keysStart = pageData + NODE_BYTES_BEFORE_KEYS;
+        char *end = pageData + *reinterpret_cast<SizeType *>(pageData + LEAF_CHECK_BYTE);
+        char *pos = determinePos(keysStart, attr, key, rid, end, false, 3, prefixBytes(pageData, compressed), prefixLength(pageData, compressed));
+        unsigned firstChild, childNum;
+        memmove(&firstChild, keysStart - PAGE_NUM_BYTES, PAGE_NUM_BYTES);
+        childNum = pos == nullptr ? firstChild : entryChild(attr, pos);
+
+        char *childPage = new char[PAGE_SIZE];
+        if (fh.readPage(childNum, childPage) == -1) {delete[] childPage; return -1;}
+        if (visitDeleteNode(fh, rootPtr, childPage, childNum, attr, key, rid, underflow) == -1) {delete[] childPage; return -1;}
+        if (!underflow || end == keysStart) {delete[] childPage; underflow = false; return 0;}
+
+        // the child is paired with its left sibling, or with its right one when it is the first child
+        char *sepPos = pos;
+        unsigned leftNum = childNum, rightNum;
+        if (pos == nullptr) {
+            sepPos = keysStart;
+            rightNum = entryChild(attr, sepPos);
+        } else {
+            rightNum = childNum;
+            leftNum = firstChild;
+            for (char *prev = keysStart; prev < pos; prev += nodeEntrySize(attr, prev, false))
+                leftNum = entryChild(attr, prev);
+        }
+
+        char *siblingPage = new char[PAGE_SIZE];
+        if (fh.readPage(pos == nullptr ? rightNum : leftNum, siblingPage) == -1) {delete[] childPage; delete[] siblingPage; return -1;}
+        char *leftPage = pos == nullptr ? childPage : siblingPage;
+        char *rightPage = pos == nullptr ? siblingPage : childPage;
+        RC status = *reinterpret_cast<unsigned char *>(childPage) == 1
+                ? rebalanceLeaves(fh, rootPtr, pageData, attr, sepPos, leftPage, leftNum, rightPage, rightNum)
+                : rebalanceNodes(fh, rootPtr, pageData, attr, sepPos, leftPage, leftNum, rightPage, rightNum);
+        delete[] childPage;
+        delete[] siblingPage;
+        if (status == -1) return -1;
+
+        underflow = *reinterpret_cast<SizeType *>(pageData + LEAF_CHECK_BYTE) < UNDERFLOW_BYTES;
+        return fh.writePage(pageNum, pageData);
+    }
+
     RC
     IndexManager::deleteEntry(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid) {
+        if (ixFileHandle.pageLayout == IndexHash) {
+            std::lock_guard<TreeLatch> latch(ixFileHandle.treeLatch);
+            return hashDelete(ixFileHandle, attribute, key, rid);
+        }
+        bool done = false;
+        {
+            SharedTreeLatch latch(ixFileHandle.treeLatch);
+            if (ixFileHandle.pageCount == 0 || updateLeaf(ixFileHandle, attribute, key, rid, false, done) == -1) return -1;
+        }
+        if (done) return 0;
+
+        // the leaf would underflow
+        std::lock_guard<TreeLatch> latch(ixFileHandle.treeLatch);
+        return deleteWithMerges(ixFileHandle, attribute, key, rid);
+    }
+
+    RC IndexManager::deleteWithMerges(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid) {
         if (ixFileHandle.pageCount == 0) return -1;
 
-        char leafPage[PAGE_SIZE];
-        unsigned leafPageNum;
-        if (getLeafPage(ixFileHandle, leafPage, leafPageNum, attribute, key, rid) == -1) return -1;
-        char *keysStart = leafPage + LEAF_BYTES_BEFORE_KEYS;
-        char *end = leafPage + *reinterpret_cast<SizeType *>(keysStart - OFFSET_BYTES);
-        if (end == keysStart) return -1;
+        char rootPtr[PAGE_SIZE];
+        char rootPage[PAGE_SIZE];
+        if (ixFileHandle.readPage(0, rootPtr) == -1) return -1;
+        unsigned rootPageNum = *reinterpret_cast<unsigned *>(rootPtr);
+        if (ixFileHandle.readPage(rootPageNum, rootPage) == -1) return -1;
+
+        bool underflow;
+        if (visitDeleteNode(ixFileHandle, rootPtr, rootPage, rootPageNum, attribute, key, rid, underflow) == -1) return -1;
+
+        // a root node left without keys hands the root over to its only child
+        if (*reinterpret_cast<unsigned char *>(rootPage) == 0 && *reinterpret_cast<SizeType *>(rootPage + LEAF_CHECK_BYTE) == NODE_BYTES_BEFORE_KEYS) {
+            memmove(rootPtr, rootPage + (NODE_BYTES_BEFORE_KEYS - PAGE_NUM_BYTES), PAGE_NUM_BYTES);
+            return freePage(ixFileHandle, rootPtr, rootPageNum);
+        }
+        return 0;
+    }
+
+    RC IndexManager::hashBucket(IXFileHandle &fh, const char *header, unsigned hash, unsigned &bucketPage) {
+        unsigned index = hash & ((1u << *reinterpret_cast<const unsigned *>(header)) - 1);
+        unsigned dirPage[DIR_ENTRIES_PER_PAGE];
+        const unsigned *dirPages = reinterpret_cast<const unsigned *>(header + HASH_DIR_PAGES_OFFSET);
+        if (fh.readPage(dirPages[index / DIR_ENTRIES_PER_PAGE], dirPage) == -1) return -1;
+        bucketPage = dirPage[index % DIR_ENTRIES_PER_PAGE];
+        return 0;
+    }
+
+    RC IndexManager::hashInsert(IXFileHandle &fh, const Attribute &attr, const void *key, const RID &rid) {
+        char header[PAGE_SIZE], page[PAGE_SIZE];
+        if (fh.pageCount == 0) {
+            // page 0, then a directory of one entry and the bucket it points at
+            memset(header, 0, PAGE_SIZE);
+            *reinterpret_cast<unsigned *>(header + HASH_DIR_COUNT_OFFSET) = 1;
+            *reinterpret_cast<unsigned *>(header + HASH_DIR_PAGES_OFFSET) = 1;
+            if (fh.appendPage(header) == -1) return -1;
+            memset(page, 0, PAGE_SIZE);
+            *reinterpret_cast<unsigned *>(page) = 2;
+            if (fh.appendPage(page) == -1) return -1;
+            memset(page, 0, PAGE_SIZE);
+            memset(page, HASH_BUCKET_FLAG, LEAF_CHECK_BYTE);
+            *reinterpret_cast<SizeType *>(page + HASH_END_OFFSET) = HASH_BYTES_BEFORE_KEYS;
+            if (fh.appendPage(page) == -1) return -1;
+        } else if (fh.readPage(0, header) == -1) return -1;
+
+        unsigned hash = hashKey(attr, key);
+        SizeType entrySize = nodeEntrySize(attr, key, true);
+        while (true) {
+            // the first page of the bucket takes the entry, so the rest of its chain is never read
+            unsigned bucketPage;
+            if (hashBucket(fh, header, hash, bucketPage) == -1 || fh.readPage(bucketPage, page) == -1) return -1;
+            SizeType endOffset = *reinterpret_cast<SizeType *>(page + HASH_END_OFFSET);
+            if (endOffset + entrySize <= PAGE_SIZE) {
+                putEntryOnPage(page + endOffset, attr, key, rid);
+                *reinterpret_cast<SizeType *>(page + HASH_END_OFFSET) = endOffset + entrySize;
+                return fh.writePage(bucketPage, page);
+            }
+
+            bool split;
+            if (splitBucket(fh, header, attr, hash, entrySize, bucketPage, page, split) == -1) return -1;
+            if (split) continue;
+
+            // no split can make room for the new entry, so the entries of the first page move to a new page behind it
+            unsigned overflowPage;
+            if (allocatePage(fh, header, overflowPage) == -1 || placePage(fh, overflowPage, page) == -1) return -1;
+            memmove(page + HASH_OVERFLOW_OFFSET, &overflowPage, PAGE_NUM_BYTES);
+            char *endPos = putEntryOnPage(page + HASH_BYTES_BEFORE_KEYS, attr, key, rid);
+            *reinterpret_cast<SizeType *>(page + HASH_END_OFFSET) = endPos - page;
+            return fh.writePage(bucketPage, page);
+        }
+    }
+
+    RC IndexManager::doubleDirectory(IXFileHandle &fh, char *header) {
+        unsigned globalDepth = *reinterpret_cast<unsigned *>(header);
+        unsigned dirSize = 1u << globalDepth;
+        unsigned *dirPages = reinterpret_cast<unsigned *>(header + HASH_DIR_PAGES_OFFSET);
+        unsigned dirPage[DIR_ENTRIES_PER_PAGE];
+        // the new half of the directory repeats the old one
+        if (dirSize < DIR_ENTRIES_PER_PAGE) {
+            if (fh.readPage(dirPages[0], dirPage) == -1) return -1;
+            memmove(dirPage + dirSize, dirPage, dirSize * PAGE_NUM_BYTES);
+            if (fh.writePage(dirPages[0], dirPage) == -1) return -1;
+        } else {
+            unsigned dirCount = *reinterpret_cast<unsigned *>(header + HASH_DIR_COUNT_OFFSET);
+            for (unsigned i = 0; i < dirCount; ++i) {
+                unsigned newPage;
+                if (fh.readPage(dirPages[i], dirPage) == -1 || allocatePage(fh, header, newPage) == -1) return -1;
+                if (placePage(fh, newPage, reinterpret_cast<char *>(dirPage)) == -1) return -1;
+                dirPages[dirCount + i] = newPage;
+            }
+            *reinterpret_cast<unsigned *>(header + HASH_DIR_COUNT_OFFSET) = dirCount * 2;
+        }
+        *reinterpret_cast<unsigned *>(header) = globalDepth + 1;
+        return fh.writePage(0, header);
+    }
+
+    // entries hashing like the new one stay with it however deep the split goes, and when they fill a page splitting
+    // cannot make room, e.g. for a key with many duplicates
+    size_t IndexManager::inseparableBytes(const Attribute &attr, const char *page, unsigned hash) const {
+        unsigned depthMask = (1u << MAX_HASH_DEPTH) - 1;
+        size_t bytes = 0;
+        const char *endPos = page + *reinterpret_cast<const SizeType *>(page + HASH_END_OFFSET);
+        for (const char *entry = page + HASH_BYTES_BEFORE_KEYS; entry < endPos; entry += nodeEntrySize(attr, entry, true))
+            if ((hashKey(attr, entry) & depthMask) == (hash & depthMask)) bytes += nodeEntrySize(attr, entry, true);
+        return bytes;
+    }
 
-        char *deletePos = determinePos(keysStart, attribute, key, rid, end, true, 1);
-        if (deletePos == end) return -1;
-        char *nextPos = deletePos + nodeEntrySize(attribute, deletePos, true);
-        shiftEntriesLeft(nextPos, deletePos, end - nextPos);
+    RC IndexManager::splitBucket(IXFileHandle &fh, char *header, const Attribute &attr, unsigned hash, SizeType entrySize, unsigned bucketPage,
+                                 const char *bucketHead, bool &split) {
+        split = false;
+        // the first page alone often shows the bucket cannot split, as new entries go there
+        unsigned char localDepth = bucketHead[LEAF_CHECK_BYTE];
+        size_t inseparable = HASH_BYTES_BEFORE_KEYS + entrySize;
+        if (localDepth == MAX_HASH_DEPTH || inseparable + inseparableBytes(attr, bucketHead, hash) > PAGE_SIZE) return 0;
+
+        // the chain is read whole, its overflow pages are reused for the two new chains or freed
+        std::vector<char> chain(bucketHead, bucketHead + PAGE_SIZE);
+        std::vector<unsigned> spare;
+        unsigned pageNum = *reinterpret_cast<const unsigned *>(bucketHead + HASH_OVERFLOW_OFFSET);
+        while (pageNum != 0) {
+            chain.resize(chain.size() + PAGE_SIZE);
+            char *page = chain.data() + (chain.size() - PAGE_SIZE);
+            if (fh.readPage(pageNum, page) == -1) return -1;
+            spare.push_back(pageNum);
+            pageNum = *reinterpret_cast<unsigned *>(page + HASH_OVERFLOW_OFFSET);
+        }
+
+        std::vector<const char *> entries;
+        for (size_t offset = 0; offset < chain.size(); offset += PAGE_SIZE) {
+            const char *page = chain.data() + offset;
+            const char *endPos = page + *reinterpret_cast<const SizeType *>(page + HASH_END_OFFSET);
+            for (const char *entry = page + HASH_BYTES_BEFORE_KEYS; entry < endPos; entry += nodeEntrySize(attr, entry, true))
+                entries.push_back(entry);
+            if (offset > 0) inseparable += inseparableBytes(attr, page, hash);
+        }
+        if (inseparable > PAGE_SIZE) return 0;
+        if (localDepth == *reinterpret_cast<unsigned *>(header) && doubleDirectory(fh, header) == -1) return -1;
+
+        unsigned splitBit = 1u << localDepth;
+        std::vector<const char *> kept, moved;
+        for (const char *entry : entries)
+            (hashKey(attr, entry) & splitBit ? moved : kept).push_back(entry);
+        unsigned newBucket;
+        char page[PAGE_SIZE];
+        memset(page, 0, PAGE_SIZE);
+        if (allocatePage(fh, header, newBucket) == -1 || placePage(fh, newBucket, page) == -1) return -1;
+        if (writeBucketChain(fh, header, attr, bucketPage, localDepth + 1, kept, spare) == -1) return -1;
+        if (writeBucketChain(fh, header, attr, newBucket, localDepth + 1, moved, spare) == -1) return -1;
+        for (unsigned sparePage : spare)
+            if (freePage(fh, header, sparePage) == -1) return -1;
+
+        // the directory entries sharing the bucket's low bits and having the split bit set move to the new bucket
+        unsigned dirSize = 1u << *reinterpret_cast<unsigned *>(header);
+        const unsigned *dirPages = reinterpret_cast<const unsigned *>(header + HASH_DIR_PAGES_OFFSET);
+        unsigned dirPage[DIR_ENTRIES_PER_PAGE];
+        unsigned loaded = dirSize;
+        for (unsigned index = (hash & (splitBit - 1)) | splitBit; index < dirSize; index += splitBit << 1) {
+            if (index / DIR_ENTRIES_PER_PAGE != loaded) {
+                if (loaded != dirSize && fh.writePage(dirPages[loaded], dirPage) == -1) return -1;
+                loaded = index / DIR_ENTRIES_PER_PAGE;
+                if (fh.readPage(dirPages[loaded], dirPage) == -1) return -1;
+            }
+            dirPage[index % DIR_ENTRIES_PER_PAGE] = newBucket;
+        }
+        if (fh.writePage(dirPages[loaded], dirPage) == -1) return -1;
+        split = true;
+        return 0;
+    }
+
+    RC IndexManager::writeBucketChain(IXFileHandle &fh, char *header, const Attribute &attr, unsigned pageNum, unsigned char localDepth,
+                                      const std::vector<const char *> &entries, std::vector<unsigned> &spare) {
+        char page[PAGE_SIZE];
+        size_t next = 0;
+        while (true) {
+            memset(page, 0, PAGE_SIZE);
+            memset(page, HASH_BUCKET_FLAG, LEAF_CHECK_BYTE);
+            page[LEAF_CHECK_BYTE] = localDepth;
+            char *pos = page + HASH_BYTES_BEFORE_KEYS;
+            for (; next < entries.size(); ++next) {
+                SizeType entrySize = nodeEntrySize(attr, entries[next], true);
+                if ((pos - page) + entrySize > PAGE_SIZE) break;
+                memmove(pos, entries[next], entrySize);
+                pos += entrySize;
+            }
+            *reinterpret_cast<SizeType *>(page + HASH_END_OFFSET) = pos - page;
+            if (next == entries.size()) return fh.writePage(pageNum, page);
+
+            // the rest goes on a page of the old chain, or a page placed now and filled in the next round
+            unsigned overflowPage;
+            if (!spare.empty()) {
+                overflowPage = spare.back();
+                spare.pop_back();
+            } else if (allocatePage(fh, header, overflowPage) == -1 || placePage(fh, overflowPage, page) == -1) return -1;
+            memmove(page + HASH_OVERFLOW_OFFSET, &overflowPage, PAGE_NUM_BYTES);
+            if (fh.writePage(pageNum, page) == -1) return -1;
+            pageNum = overflowPage;
+        }
+    }
 
-        *reinterpret_cast<SizeType *>(keysStart - OFFSET_BYTES) = end - (nextPos - deletePos) - leafPage;
-        return ixFileHandle.writePage(leafPageNum, leafPage);
+    RC IndexManager::hashDelete(IXFileHandle &fh, const Attribute &attr, const void *key, const RID &rid) {
+        if (fh.pageCount == 0) return -1;
+        char header[PAGE_SIZE], page[PAGE_SIZE], target[PAGE_SIZE];
+        if (fh.readPage(0, header) == -1) return -1;
+        unsigned pageNum, prevPage = 0;
+        if (hashBucket(fh, header, hashKey(attr, key), pageNum) == -1) return -1;
+        putEntryOnPage(target, attr, key, rid);
+
+        while (pageNum != 0) {
+            if (fh.readPage(pageNum, page) == -1) return -1;
+            char *endPos = page + *reinterpret_cast<SizeType *>(page + HASH_END_OFFSET);
+            for (char *entry = page + HASH_BYTES_BEFORE_KEYS; entry < endPos; entry += nodeEntrySize(attr, entry, true)) {
+                if (compareEntries(attr, entry, target) != 0) continue;
+                SizeType entrySize = nodeEntrySize(attr, entry, true);
+                shiftEntriesLeft(entry + entrySize, entry, endPos - (entry + entrySize));
+                *reinterpret_cast<SizeType *>(page + HASH_END_OFFSET) -= entrySize;
+                if (prevPage == 0 || endPos - entrySize > page + HASH_BYTES_BEFORE_KEYS)
+                    return fh.writePage(pageNum, page);
+
+                // an emptied overflow page leaves the chain
+                char prev[PAGE_SIZE];
+                if (fh.readPage(prevPage, prev) == -1) return -1;
+                memmove(prev + HASH_OVERFLOW_OFFSET, page + HASH_OVERFLOW_OFFSET, PAGE_NUM_BYTES);
+                if (fh.writePage(prevPage, prev) == -1) return -1;
+                return freePage(fh, header, pageNum);
+            }
+            prevPage = pageNum;
+            pageNum = *reinterpret_cast<unsigned *>(page + HASH_OVERFLOW_OFFSET);
+        }
+        return -1;
+    }
+
+    RC IndexManager::hashEntries(IXFileHandle &fh, const Attribute &attr, const void *lowKey, const void *highKey,
+                                 bool lowKeyInclusive, bool highKeyInclusive, std::vector<char> &entries) {
+        entries.clear();
+        if (fh.pageCount == 0) return 0;
+        char header[PAGE_SIZE], page[PAGE_SIZE];
+        {
+            // page 0 is read once per handle, and again only when a bucket shows the directory has grown since
+            std::lock_guard<std::mutex> latch(fh.headerLatch);
+            if (fh.hashHeader.empty()) {
+                fh.hashHeader.resize(PAGE_SIZE);
+                if (fh.readPage(0, fh.hashHeader.data()) == -1) {fh.hashHeader.clear(); return -1;}
+            }
+            memmove(header, fh.hashHeader.data(), PAGE_SIZE);
+        }
+        unsigned globalDepth = *reinterpret_cast<unsigned *>(header);
+
+        std::vector<unsigned> buckets;
+        const char *low = static_cast<const char *>(lowKey), *high = static_cast<const char *>(highKey);
+        if (low != nullptr && high != nullptr && lowKeyInclusive && highKeyInclusive && compareKeys(attr, low, high) == 0) {
+            // only the key's bucket can hold it
+            buckets.resize(1);
+            if (hashBucket(fh, header, hashKey(attr, low), buckets[0]) == -1) return -1;
+        } else {
+            unsigned dirSize = 1u << globalDepth;
+            const unsigned *dirPages = reinterpret_cast<const unsigned *>(header + HASH_DIR_PAGES_OFFSET);
+            unsigned dirPage[DIR_ENTRIES_PER_PAGE];
+            std::unordered_set<unsigned> seen;
+            for (unsigned index = 0; index < dirSize; ++index) {
+                if (index % DIR_ENTRIES_PER_PAGE == 0 && fh.readPage(dirPages[index / DIR_ENTRIES_PER_PAGE], dirPage) == -1) return -1;
+                if (seen.insert(dirPage[index % DIR_ENTRIES_PER_PAGE]).second) buckets.push_back(dirPage[index % DIR_ENTRIES_PER_PAGE]);
+            }
+        }
+
+        for (unsigned pageNum : buckets) {
+            bool bucketHead = true;
+            while (pageNum != 0) {
+                if (fh.readPage(pageNum, page) == -1) return -1;
+                if (bucketHead && static_cast<unsigned char>(page[LEAF_CHECK_BYTE]) > globalDepth) {
+                    // split deeper than the directory read: its entries may be in buckets this directory misses
+                    std::lock_guard<std::mutex> latch(fh.headerLatch);
+                    fh.hashHeader.clear();
+                    return hashEntries(fh, attr, lowKey, highKey, lowKeyInclusive, highKeyInclusive, entries);
+                }
+                bucketHead = false;
+                const char *endPos = page + *reinterpret_cast<SizeType *>(page + HASH_END_OFFSET);
+                for (const char *entry = page + HASH_BYTES_BEFORE_KEYS; entry < endPos; entry += nodeEntrySize(attr, entry, true)) {
+                    int lowCmp = low == nullptr ? 1 : compareKeys(attr, entry, low);
+                    int highCmp = high == nullptr ? -1 : compareKeys(attr, entry, high);
+                    if (lowCmp < 0 || (lowCmp == 0 && !lowKeyInclusive) || highCmp > 0 || (highCmp == 0 && !highKeyInclusive)) continue;
+                    entries.insert(entries.end(), entry, entry + nodeEntrySize(attr, entry, true));
+                }
+                pageNum = *reinterpret_cast<unsigned *>(page + HASH_OVERFLOW_OFFSET);
+            }
+        }
+        return 0;
     }
 
     RC IndexManager::scan(IXFileHandle &ixFileHandle,
@@ -468,14 +1478,18 @@ namespace PeterDB {
                           const void *highKey,
                           bool lowKeyInclusive,
                           bool highKeyInclusive,
-                          IX_ScanIterator &ix_ScanIterator) {
+                          IX_ScanIterator &ix_ScanIterator,
+                          bool descending) {
         if (!ixFileHandle.file.is_open()) return -1;
-        ix_ScanIterator.init(ixFileHandle, attribute, lowKey, highKey, lowKeyInclusive, highKeyInclusive);
+        if (descending && ixFileHandle.pageLayout == IndexHash) return -1;
+        ix_ScanIterator.init(ixFileHandle, attribute, lowKey, highKey, lowKeyInclusive, highKeyInclusive, descending);
         return 0;
     }
 
-    void IndexManager::printPageKeys(char * const pagePtr, bool isLeafPage, char * const endPos, const Attribute &attr, std::ostream &out) const {
+    void IndexManager::printPageKeys(char * const pagePtr, bool isLeafPage, char * const endPos, const Attribute &attr, std::ostream &out,
+                                     const char *prefix, SizeType prefixLength) const {
         char *pos = pagePtr;
+        std::string keyPrefix = prefixLength > 0 ? std::string{prefix, prefixLength} : std::string{};
         out << "{\"keys\":[";
 
         if (isLeafPage) {
@@ -495,7 +1509,7 @@ namespace PeterDB {
                             break;
                         case TypeVarChar:
                             unsigned varCharLen = *reinterpret_cast<unsigned *>(pos);
-                            prevStr = std::string{pos + INT_BYTES, varCharLen};
+                            prevStr = keyPrefix + std::string{pos + INT_BYTES, varCharLen};
                             out << "\"" << prevStr;
                             pos += INT_BYTES + varCharLen;
                     }
@@ -530,7 +1544,7 @@ namespace PeterDB {
                         break;
                     case TypeVarChar:
                         unsigned varCharLen = *reinterpret_cast<unsigned *>(pos);
-                        currStr = std::string{pos + INT_BYTES, varCharLen};
+                        currStr = keyPrefix + std::string{pos + INT_BYTES, varCharLen};
                         memmove(&ridPage, pos + (INT_BYTES + varCharLen), PAGE_NUM_BYTES);
                         memmove(&ridSlot, pos + (INT_BYTES + varCharLen + PAGE_NUM_BYTES), SLOT_BYTES);
                         if (currStr == prevStr) {
@@ -555,7 +1569,7 @@ namespace PeterDB {
                         out << *reinterpret_cast<float *>(pos);
                         break;
                     case TypeVarChar:
-                        out << std::string{pos + INT_BYTES, *reinterpret_cast<unsigned *>(pos)};
+                        out << keyPrefix << std::string{pos + INT_BYTES, *reinterpret_cast<unsigned *>(pos)};
                 }
             }
             out << "],\n";
@@ -566,13 +1580,19 @@ namespace PeterDB {
         char *pageData = new char[PAGE_SIZE];
         if (fh.readPage(pageNum, pageData) == -1) {delete[] pageData; return -1;}
         char *keysStart, *end;
+        bool compressed = prefixCompressed(fh, attr);
         out << std::setw(indents * 4) << "";
 
         if (*reinterpret_cast<unsigned char *>(pageData) == 1) {
             // leaf node
             keysStart = pageData + LEAF_BYTES_BEFORE_KEYS;
             end = pageData + *reinterpret_cast<SizeType *>(keysStart - OFFSET_BYTES);
-            printPageKeys(keysStart, true, end, attr, out);
+            if (postingLeaves(fh)) {
+                std::vector<char> entries;
+                decodeEntries(attr, keysStart, end, true, prefixBytes(pageData, compressed), prefixLength(pageData, compressed), entries, true);
+                printPageKeys(entries.data(), true, entries.data() + entries.size(), attr, out);
+            } else
+                printPageKeys(keysStart, true, end, attr, out, prefixBytes(pageData, compressed), prefixLength(pageData, compressed));
             delete[] pageData;
             return 0;
         }
@@ -580,7 +1600,7 @@ namespace PeterDB {
         // regular node
         keysStart = pageData + NODE_BYTES_BEFORE_KEYS;
         end = pageData + *reinterpret_cast<SizeType *>(pageData + LEAF_CHECK_BYTE);
-        printPageKeys(keysStart, false, end, attr, out);
+        printPageKeys(keysStart, false, end, attr, out, prefixBytes(pageData, compressed), prefixLength(pageData, compressed));
 
         out << std::setw(indents * 4 + 1) << "" << "\"children\":[\n";
         if (end > keysStart) {
@@ -614,6 +1634,7 @@ namespace PeterDB {
     }
 
     RC IndexManager::printBTree(IXFileHandle &ixFileHandle, const Attribute &attribute, std::ostream &out) const {
+        if (ixFileHandle.pageLayout == IndexHash) return -1;
         if (ixFileHandle.pageCount == 0) return 0;
         char rootPage[PAGE_SIZE];
 
@@ -623,34 +1644,157 @@ namespace PeterDB {
         return 0;
     }
 
+    Attribute IndexManager::compositeAttribute(const std::vector<Attribute> &keyAttrs) const {
+        Attribute attr{"", TypeVarChar, 1};     // room for the byte closing a prefix range
+        for (const Attribute &keyAttr : keyAttrs) {
+            attr.name += (attr.name.empty() ? "" : ",") + keyAttr.name;
+            // every zero byte of a varchar may be escaped
+            attr.length += 1 + (keyAttr.type == TypeVarChar ? 2 * keyAttr.length + VARCHAR_TERMINATOR_BYTES : keyAttr.length);
+        }
+        return attr;
+    }
+
+    // writes a 4-byte value most significant byte first, so that bytes compare like the value
+    static unsigned char * putOrdered(unsigned char *out, unsigned value) {
+        for (int shift = 24; shift >= 0; shift -= BITS_PER_BYTE) *out++ = value >> shift;
+        return out;
+    }
+
+    static unsigned getOrdered(const unsigned char *in) {
+        unsigned value = 0;
+        for (int i = 0; i < INT_BYTES; ++i) value = value << BITS_PER_BYTE | in[i];
+        return value;
+    }
+
+    void IndexManager::encodeCompositeKey(const std::vector<Attribute> &keyAttrs, const void *data, void *key) const {
+        const unsigned char *nullBytes = static_cast<const unsigned char *>(data);
+        const char *field = static_cast<const char *>(data) + (keyAttrs.size() + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
+        unsigned char *out = static_cast<unsigned char *>(key) + INT_BYTES;
+
+        for (SizeType i = 0; i < keyAttrs.size(); ++i) {
+            if (nullBytes[i / BITS_PER_BYTE] & (1 << (BITS_PER_BYTE - 1 - i % BITS_PER_BYTE))) {
+                *out++ = COMPOSITE_NULL;
+                continue;
+            }
+            *out++ = COMPOSITE_VALUE;
+            unsigned bits;
+            switch (keyAttrs[i].type) {
+                case TypeInt:
+                    // flipping the sign bit orders negative values below positive ones
+                    memmove(&bits, field, INT_BYTES);
+                    out = putOrdered(out, bits ^ 0x80000000u);
+                    field += keyAttrs[i].length;
+                    break;
+                case TypeReal:
+                    // negative floats order backwards in their bits, so all of them are flipped
+                    memmove(&bits, field, INT_BYTES);
+                    out = putOrdered(out, (bits & 0x80000000u) ? ~bits : bits ^ 0x80000000u);
+                    field += keyAttrs[i].length;
+                    break;
+                case TypeVarChar: {
+                    // zero bytes are escaped so that the terminator orders a string below its extensions
+                    int len;
+                    memmove(&len, field, INT_BYTES);
+                    const unsigned char *chars = reinterpret_cast<const unsigned char *>(field + INT_BYTES);
+                    for (int c = 0; c < len; ++c) {
+                        *out++ = chars[c];
+                        if (chars[c] == 0) *out++ = COMPOSITE_ESCAPE;
+                    }
+                    memset(out, 0, VARCHAR_TERMINATOR_BYTES);
+                    out += VARCHAR_TERMINATOR_BYTES;
+                    field += INT_BYTES + len;
+                }
+            }
+        }
+        *static_cast<int *>(key) = out - (static_cast<unsigned char *>(key) + INT_BYTES);
+    }
+
+    void IndexManager::decodeCompositeKey(const std::vector<Attribute> &keyAttrs, const void *key, void *data) const {
+        SizeType nullFlagBytes = (keyAttrs.size() + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
+        unsigned char *nullBytes = static_cast<unsigned char *>(data);
+        memset(nullBytes, 0, nullFlagBytes);
+        char *field = static_cast<char *>(data) + nullFlagBytes;
+        const unsigned char *in = static_cast<const unsigned char *>(key) + INT_BYTES;
+
+        for (SizeType i = 0; i < keyAttrs.size(); ++i) {
+            if (*in++ == COMPOSITE_NULL) {
+                nullBytes[i / BITS_PER_BYTE] |= 1 << (BITS_PER_BYTE - 1 - i % BITS_PER_BYTE);
+                continue;
+            }
+            unsigned bits;
+            switch (keyAttrs[i].type) {
+                case TypeInt:
+                    bits = getOrdered(in) ^ 0x80000000u;
+                    memmove(field, &bits, INT_BYTES);
+                    in += INT_BYTES;
+                    field += keyAttrs[i].length;
+                    break;
+                case TypeReal:
+                    bits = getOrdered(in);
+                    bits = (bits & 0x80000000u) ? bits ^ 0x80000000u : ~bits;
+                    memmove(field, &bits, INT_BYTES);
+                    in += INT_BYTES;
+                    field += keyAttrs[i].length;
+                    break;
+                case TypeVarChar: {
+                    int len = 0;
+                    while (in[0] != 0 || in[1] == COMPOSITE_ESCAPE) {
+                        field[INT_BYTES + len++] = *in;
+                        in += *in == 0 ? 2 : 1;
+                    }
+                    in += VARCHAR_TERMINATOR_BYTES;
+                    memmove(field, &len, INT_BYTES);
+                    field += INT_BYTES + len;
+                }
+            }
+        }
+    }
+
+    void IndexManager::compositePrefixRange(const std::vector<Attribute> &keyAttrs, const void *data, unsigned prefixCount,
+                                            void *lowKey, void *highKey) const {
+        // longer keys with the same leading bytes continue with an attribute marker, which is below the escape byte
+        std::vector<Attribute> prefixAttrs(keyAttrs.begin(), keyAttrs.begin() + prefixCount);
+        encodeCompositeKey(prefixAttrs, data, lowKey);
+        int len = *static_cast<int *>(lowKey);
+        memmove(highKey, lowKey, INT_BYTES + len);
+        static_cast<unsigned char *>(highKey)[INT_BYTES + len] = COMPOSITE_ESCAPE;
+        *static_cast<int *>(highKey) = len + 1;
+    }
+
     IX_ScanIterator::IX_ScanIterator()
-        : fh(nullptr), lowKey(nullptr), highKey(nullptr), currPos(nullptr), endPos(nullptr) {}
+        : fh(nullptr), lowKey(nullptr), highKey(nullptr), currPos(nullptr), endPos(nullptr), hashPos(0), descending(false) {}
 
     IX_ScanIterator::~IX_ScanIterator() {}
 
-    void IX_ScanIterator::init(IXFileHandle &fh, const Attribute &attr, const void *lowKey, const void *highKey, bool lowKeyInclusive, bool highKeyInclusive) {
+    void IX_ScanIterator::init(IXFileHandle &fh, const Attribute &attr, const void *lowKey, const void *highKey, bool lowKeyInclusive, bool highKeyInclusive,
+                               bool descending) {
         this->fh = &fh;
         this->attr = attr;
         this->lowKey = lowKey;
         this->highKey = highKey;
         this->lowKeyInclusive = lowKeyInclusive;
         this->highKeyInclusive = highKeyInclusive;
+        this->descending = descending;
         firstScan = true;
+        lastEntryKept = false;
+        hashMatches.clear();
+        hashPos = 0;
     }
 
     int IX_ScanIterator::acceptKey(RID &rid, void *key) {
-        // 0 for success, 1 for rejection, 2 for IX_EOF
+        // 0 for success, 1 for rejection, 2 for IX_EOF. A descending scan ends below the low key instead of above the high key.
+        int belowLow = descending ? 2 : 1, aboveHigh = descending ? 1 : 2;
         switch (attr.type) {
             case TypeInt: {
                 int entryInt = *reinterpret_cast<int *>(currPos);
                 currPos += attr.length + RID_BYTES;
                 if (lowKey) {
                     int lowKeyInt = *static_cast<const int *>(lowKey);
-                    if (entryInt < lowKeyInt || (entryInt == lowKeyInt && !lowKeyInclusive)) return 1;
+                    if (entryInt < lowKeyInt || (entryInt == lowKeyInt && !lowKeyInclusive)) return belowLow;
                 }
                 if (highKey) {
                     int highKeyInt = *static_cast<const int *>(highKey);
-                    if (entryInt > highKeyInt || (entryInt == highKeyInt && !highKeyInclusive)) return 2;
+                    if (entryInt > highKeyInt || (entryInt == highKeyInt && !highKeyInclusive)) return aboveHigh;
                 }
                 memmove(key, &entryInt, attr.length);
                 break;
@@ -659,25 +1803,30 @@ namespace PeterDB {
                 currPos += attr.length + RID_BYTES;
                 if (lowKey) {
                     float lowKeyFloat = *static_cast<const float *>(lowKey);
-                    if (entryFloat < lowKeyFloat || (entryFloat == lowKeyFloat && !lowKeyInclusive)) return 1;
+                    if (entryFloat < lowKeyFloat || (entryFloat == lowKeyFloat && !lowKeyInclusive)) return belowLow;
                 }
                 if (highKey) {
                     float highKeyFloat = *static_cast<const float *>(highKey);
-                    if (entryFloat > highKeyFloat || (entryFloat == highKeyFloat && !highKeyInclusive)) return 2;
+                    if (entryFloat > highKeyFloat || (entryFloat == highKeyFloat && !highKeyInclusive)) return aboveHigh;
                 }
                 memmove(key, &entryFloat, attr.length);
                 break;
             } case TypeVarChar: {
-                unsigned len = *reinterpret_cast<unsigned *>(currPos);
-                std::string entryStr{currPos + INT_BYTES, len};
-                currPos += len + INT_BYTES + RID_BYTES;
+                // the key continues the prefix of a compressed leaf, unless the leaf was decoded
+                bool compressed = prefixCompressed(*fh, attr) && !postingLeaves(*fh) && !descending;
+                SizeType prefixLen = prefixLength(currPage, compressed);
+                std::string entryStr = prefixLen > 0 ? std::string{prefixBytes(currPage, true), prefixLen} : std::string{};
+                unsigned suffixLen = *reinterpret_cast<unsigned *>(currPos);
+                entryStr.append(currPos + INT_BYTES, suffixLen);
+                currPos += suffixLen + INT_BYTES + RID_BYTES;
+                unsigned len = entryStr.size();
                 if (lowKey) {
                     std::string lowKeyStr{static_cast<const char *>(lowKey) + INT_BYTES, *static_cast<const unsigned *>(lowKey)};
-                    if (entryStr < lowKeyStr || (entryStr == lowKeyStr && !lowKeyInclusive)) return 1;
+                    if (entryStr < lowKeyStr || (entryStr == lowKeyStr && !lowKeyInclusive)) return belowLow;
                 }
                 if (highKey) {
                     std::string highKeyStr{static_cast<const char *>(highKey) + INT_BYTES, *static_cast<const unsigned *>(highKey)};
-                    if (entryStr > highKeyStr || (entryStr == highKeyStr && !highKeyInclusive)) return 2;
+                    if (entryStr > highKeyStr || (entryStr == highKeyStr && !highKeyInclusive)) return aboveHigh;
                 }
                 memmove(key, &len, INT_BYTES);
                 memmove(static_cast<char *>(key) + INT_BYTES, entryStr.c_str(), len);
@@ -690,38 +1839,455 @@ namespace PeterDB {
     }
 
     RC IX_ScanIterator::getNextEntry(RID &rid, void *key) {
-        if (firstScan) {
+        SharedTreeLatch latch(fh->treeLatch);
+        if (fh->pageLayout == IndexHash) {
+            // buckets keep no order to resume from, so the scan returns the entries in range when it started
+            if (firstScan && IndexManager::instance().hashEntries(*fh, attr, lowKey, highKey, lowKeyInclusive,
+                                                                  highKeyInclusive, hashMatches) == -1) return -1;
+            firstScan = false;
+            if (hashPos == hashMatches.size()) return IX_EOF;
+            const char *entry = hashMatches.data() + hashPos;
+            SizeType keyBytes = entryKeyBytes(attr, entry);
+            memmove(key, entry, keyBytes);
+            rid = entryRID(attr, entry);
+            hashPos += keyBytes + RID_BYTES;
+            return 0;
+        }
+
+        bool compressed = prefixCompressed(*fh, attr) && !postingLeaves(*fh);
+        if (firstScan || (lastEntryKept && fh->pageWrites() != writesSeen)) {
+            // entries may have moved, or the cached leaf been merged away, so the scan resumes after the last entry
             if (fh->pageCount == 0) return IX_EOF;
-            unsigned pgNum;
-            if (IndexManager::instance().getLeafPage(*fh, currPage, pgNum, attr, lowKey, RID{0, 1}) == -1) return -1;
-            currPos = currPage + LEAF_BYTES_BEFORE_KEYS;
-            endPos = currPage + *reinterpret_cast<SizeType *>(currPos - OFFSET_BYTES);
-            memmove(&nextPageNum, currPage + LEAF_CHECK_BYTE, PAGE_NUM_BYTES);
+            if ((descending ? resumeDescending() : resumeAscending(compressed)) == -1) return -1;
             firstScan = false;
         }
 
         while (true) {
             while (currPos < endPos) {
                 int status = acceptKey(rid, key);
-                if (status == 0) return 0;
+                if (status == 0) {
+                    IndexManager::instance().putEntryOnPage(lastEntry, attr, key, rid);
+                    writesSeen = fh->pageWrites();
+                    lastEntryKept = true;
+                    return 0;
+                }
                 if (status == 2) return IX_EOF;
             }
 
-            if (nextPageNum == 0) return IX_EOF;
-            if (fh->readPage(nextPageNum, currPage) == -1) return -1;
-            memmove(&nextPageNum, currPage + LEAF_CHECK_BYTE, PAGE_NUM_BYTES);
-            currPos = currPage + LEAF_BYTES_BEFORE_KEYS;
-            endPos = currPage + *reinterpret_cast<SizeType *>(currPos - OFFSET_BYTES);
+            if (descending) {
+                RC rc = previousLeaf();
+                if (rc != 0) return rc;
+                if (!leafFollows(compressed) && resumeDescending() == -1) return -1;
+            } else {
+                if (nextPageNum == 0) return IX_EOF;
+                if (fh->readPage(nextPageNum, currPage) == -1) return -1;
+                if (!leafFollows(compressed) && resumeAscending(compressed) == -1) return -1;
+            }
+        }
+    }
+
+    bool IX_ScanIterator::leafFollows(bool compressed) {
+        if (*reinterpret_cast<unsigned char *>(currPage) != 1) return false;
+        startLeaf();
+        if (!lastEntryKept || currPos == endPos) return true;
+        // a descending scan has the leaf's entries decoded whole
+        char entry[PAGE_SIZE];
+        bool prefixed = compressed && !descending;
+        wholeEntry(attr, currPos, prefixBytes(currPage, prefixed), prefixLength(currPage, prefixed), true, entry);
+        int order = compareEntries(attr, entry, lastEntry);
+        return descending ? order < 0 : order > 0;
+    }
+
+    RC IX_ScanIterator::resumeAscending(bool compressed) {
+        // before any entry is returned, the scan starts at the first entry that can match instead of rejecting the ones before it
+        unsigned pgNum;
+        const void *key = lastEntryKept ? lastEntry : lowKey;
+        RID rid = lastEntryKept ? entryRID(attr, lastEntry) : RID{0, 0};
+        if (IndexManager::instance().getLeafPage(*fh, currPage, pgNum, attr, key, rid) == -1) return -1;
+        startLeaf();
+        if (key == nullptr) return 0;
+        SizeType prefix = prefixLength(currPage, compressed);
+        currPos = IndexManager::instance().determinePos(currPos, attr, key, rid, endPos, true, 2, prefixBytes(currPage, compressed), prefix);
+        if (lastEntryKept && currPos < endPos) {
+            char entry[PAGE_SIZE];
+            wholeEntry(attr, currPos, prefixBytes(currPage, compressed), prefix, true, entry);
+            if (compareEntries(attr, entry, lastEntry) == 0) currPos += IndexManager::instance().nodeEntrySize(attr, currPos, true);
+        }
+        return 0;
+    }
+
+    RC IX_ScanIterator::resumeDescending() {
+        // the scan starts at the leaf where the high key goes with the largest RID, or the last leaf, and resumes at
+        // the leaf of the last entry, at the entry before it
+        if (fh->readPage(0, currPage) == -1) return -1;
+        unsigned root = *reinterpret_cast<unsigned *>(currPage);
+        pathChildren.clear();
+        pathIndex.clear();
+        if (descendTo(root, lastEntryKept ? lastEntry : highKey, lastEntryKept ? entryRID(attr, lastEntry) : RID{UINT_MAX, USHRT_MAX}) == -1) return -1;
+        startLeaf();
+        if (lastEntryKept) {
+            while (currPos < endPos && compareEntries(attr, currPos, lastEntry) >= 0)
+                currPos += IndexManager::instance().nodeEntrySize(attr, currPos, true);
+        }
+        return 0;
+    }
+
+    void IX_ScanIterator::startLeaf() {
+        memmove(&nextPageNum, currPage + LEAF_CHECK_BYTE, PAGE_NUM_BYTES);
+        currPos = currPage + LEAF_BYTES_BEFORE_KEYS;
+        endPos = currPage + *reinterpret_cast<SizeType *>(currPos - OFFSET_BYTES);
+        if (!postingLeaves(*fh) && !descending) return;
+
+        // posting lists are walked as the entries they hold
+        bool compressed = prefixCompressed(*fh, attr);
+        leafEntries.clear();
+        decodeEntries(attr, currPos, endPos, true, prefixBytes(currPage, compressed), prefixLength(currPage, compressed), leafEntries,
+                      postingLeaves(*fh));
+        if (descending) {
+            // entries vary in size, so they are laid out again last to first
+            std::vector<size_t> starts;
+            for (size_t offset = 0; offset < leafEntries.size(); offset += entryKeyBytes(attr, &leafEntries[offset]) + RID_BYTES)
+                starts.push_back(offset);
+            std::vector<char> reversed;
+            reversed.reserve(leafEntries.size());
+            size_t end = leafEntries.size();
+            for (auto it = starts.rbegin(); it != starts.rend(); end = *it++)
+                reversed.insert(reversed.end(), leafEntries.begin() + *it, leafEntries.begin() + end);
+            leafEntries.swap(reversed);
+        }
+        currPos = leafEntries.data();
+        endPos = currPos + leafEntries.size();
+    }
+
+    RC IX_ScanIterator::descendTo(unsigned pageNum, const void *key, const RID &rid) {
+        bool compressed = prefixCompressed(*fh, attr);
+        while (true) {
+            if (fh->readPage(pageNum, currPage) == -1) return -1;
+            // a leaf, or a page freed since the path to it was read, which leafFollows turns down
+            if (*reinterpret_cast<unsigned char *>(currPage) != 0) return 0;
+
+            char *keysStart = currPage + NODE_BYTES_BEFORE_KEYS, *end = currPage + *nodeEnd(currPage, false);
+            char *pos = key == nullptr ? nullptr : IndexManager::instance().determinePos(keysStart, attr, key, rid, end, false, 3,
+                                                                                        prefixBytes(currPage, compressed),
+                                                                                        prefixLength(currPage, compressed));
+            std::vector<unsigned> children{*reinterpret_cast<unsigned *>(keysStart - PAGE_NUM_BYTES)};
+            unsigned index = 0;
+            for (char *entry = keysStart; entry < end; entry += IndexManager::instance().nodeEntrySize(attr, entry, false)) {
+                children.push_back(entryChild(attr, entry));
+                if (key == nullptr || entry == pos) index = children.size() - 1;
+            }
+            pathChildren.push_back(children);
+            pathIndex.push_back(index);
+            pageNum = children[index];
+        }
+    }
+
+    RC IX_ScanIterator::previousLeaf() {
+        while (!pathIndex.empty() && pathIndex.back() == 0) {
+            pathChildren.pop_back();
+            pathIndex.pop_back();
         }
+        if (pathIndex.empty()) return IX_EOF;
+        unsigned child = pathChildren.back()[--pathIndex.back()];
+        return descendTo(child, nullptr, RID{});
     }
 
     RC IX_ScanIterator::close() {
         fh = nullptr;
+        hashMatches.clear();
+        leafEntries.clear();
+        pathChildren.clear();
+        pathIndex.clear();
         return 0;
     }
 
-    IXFileHandle::IXFileHandle() : FileHandle() {}
+    IX_BulkLoader::IX_BulkLoader()
+        : fh(nullptr), fillFactor(DEFAULT_INDEX_FILL_FACTOR), memoryBytes(BULK_LOAD_MEMORY), lastLeafEntry(0), leafEntryCount(0), leafBytes(0), leafKeys(0) {}
+
+    IX_BulkLoader::~IX_BulkLoader() {
+        for (FILE *run : runs) fclose(run);
+    }
+
+    void IX_BulkLoader::init(IXFileHandle &fh, const Attribute &attr, unsigned fillFactor, size_t memoryBytes) {
+        this->fh = &fh;
+        this->attr = attr;
+        this->fillFactor = fillFactor;
+        this->memoryBytes = memoryBytes;
+        entries.clear();
+        entryOffsets.clear();
+        for (FILE *run : runs) fclose(run);
+        runs.clear();
+        separators.clear();
+        leafEntries.clear();
+        leafEntryCount = 0;
+        leafBytes = 0;
+        leafKeys = 0;
+        lowFence.clear();
+    }
+
+    RC IX_BulkLoader::addEntry(const void *key, const RID &rid) {
+        IndexManager & ix = IndexManager::instance();
+        if (fh->pageLayout == IndexHash) return ix.insertEntry(*fh, attr, key, rid);   // buckets have no order to sort for
+        size_t offset = entries.size();
+        entries.resize(offset + ix.nodeEntrySize(attr, key, true));
+        ix.putEntryOnPage(entries.data() + offset, attr, key, rid);
+        entryOffsets.push_back(offset);
+        return entries.size() >= memoryBytes ? spillRun() : 0;
+    }
+
+    RC IX_BulkLoader::spillRun() {
+        std::sort(entryOffsets.begin(), entryOffsets.end(), [this](size_t left, size_t right) {
+            return compareEntries(attr, entries.data() + left, entries.data() + right) < 0;
+        });
+        FILE *run = tmpfile();
+        if (run == nullptr) return -1;
+        runs.push_back(run);
+
+        IndexManager & ix = IndexManager::instance();
+        for (size_t offset : entryOffsets) {
+            const char *entry = entries.data() + offset;
+            if (fwrite(entry, ix.nodeEntrySize(attr, entry, true), 1, run) != 1) return -1;
+        }
+        entries.clear();
+        entryOffsets.clear();
+        return 0;
+    }
+
+    // reads the next leaf entry of a sorted run, false at its end
+    static bool readRunEntry(FILE *run, const Attribute &attr, char *entry) {
+        SizeType keyBytes = attr.length;
+        if (attr.type == TypeVarChar) {
+            if (fread(entry, INT_BYTES, 1, run) != 1) return false;
+            keyBytes = *reinterpret_cast<int *>(entry);
+            entry += INT_BYTES;
+        }
+        return fread(entry, keyBytes + RID_BYTES, 1, run) == 1;
+    }
+
+    RC IX_BulkLoader::finish() {
+        if (fh != nullptr && fh->pageLayout == IndexHash) return 0;
+        if (fh == nullptr || fh->pageCount != 0) return -1;
+
+        if (runs.empty()) {
+            std::sort(entryOffsets.begin(), entryOffsets.end(), [this](size_t left, size_t right) {
+                return compareEntries(attr, entries.data() + left, entries.data() + right) < 0;
+            });
+            for (size_t offset : entryOffsets)
+                if (addSorted(entries.data() + offset) == -1) return -1;
+        } else {
+            if (!entries.empty() && spillRun() == -1) return -1;
+
+            // merge the runs, always taking the smallest of their next entries
+            SizeType maxEntrySize = attr.length + INT_BYTES + RID_BYTES;
+            std::vector<char> heads(runs.size() * maxEntrySize);
+            auto later = [this, &heads, maxEntrySize](size_t left, size_t right) {
+                return compareEntries(attr, &heads[left * maxEntrySize], &heads[right * maxEntrySize]) > 0;
+            };
+            std::priority_queue<size_t, std::vector<size_t>, decltype(later)> next(later);
+            for (size_t i = 0; i < runs.size(); ++i) {
+                rewind(runs[i]);
+                if (readRunEntry(runs[i], attr, &heads[i * maxEntrySize])) next.push(i);
+            }
+            while (!next.empty()) {
+                size_t i = next.top();
+                next.pop();
+                if (addSorted(&heads[i * maxEntrySize]) == -1) return -1;
+                if (readRunEntry(runs[i], attr, &heads[i * maxEntrySize])) next.push(i);
+            }
+        }
+        entries.clear();
+        entryOffsets.clear();
+        if (leafEntryCount == 0) return 0;  // nothing to load, the index stays empty
+
+        // the last leaf has no fence above it to share a prefix with, and leaves its last entry to a leaf of its own
+        // when that makes it too big
+        if (leafEntryCount > 1 && nodeBytes(LEAF_BYTES_BEFORE_KEYS, leafBytes, leafKeys, 0, prefixCompressed(*fh, attr)) > PAGE_SIZE * fillFactor / 100) {
+            std::vector<char> last(leafEntries.begin() + lastLeafEntry, leafEntries.end());
+            if (writeLeaf(lastLeafEntry, last.data()) == -1 || addSorted(last.data()) == -1) return -1;
+        }
+        unsigned rootPage;
+        if (writeLeaf(leafEntries.size(), nullptr) == -1 || buildNodes(rootPage) == -1) return -1;
+        char rootPtr[PAGE_SIZE];
+        memset(rootPtr, 0, PAGE_SIZE);
+        memmove(rootPtr, &rootPage, PAGE_NUM_BYTES);
+        return fh->writePage(0, rootPtr);
+    }
+
+    RC IX_BulkLoader::addSorted(const char *entry) {
+        bool compressed = prefixCompressed(*fh, attr);
+        if (leafEntryCount > 0) {
+            // the leaf could end before the entry, stored after what its keys then share with its fences, unless that
+            // takes it above the fill factor. It ends before its own last entry then, where it was known to fit.
+            SizeType prefix = compressed ? commonPrefix(lowFence.empty() ? nullptr : lowFence.data(), entry) : 0;
+            if (nodeBytes(LEAF_BYTES_BEFORE_KEYS, leafBytes, leafKeys, prefix, compressed) > PAGE_SIZE * fillFactor / 100) {
+                if (leafEntryCount == 1) {
+                    if (writeLeaf(leafEntries.size(), entry) == -1) return -1;
+                } else {
+                    std::vector<char> last(leafEntries.begin() + lastLeafEntry, leafEntries.end());
+                    if (writeLeaf(lastLeafEntry, last.data()) == -1 || addSorted(last.data()) == -1) return -1;
+                }
+            }
+        }
+        bool posting = postingLeaves(*fh);
+        const char *prev = leafEntryCount > 0 ? &leafEntries[lastLeafEntry] : nullptr;
+        leafBytes += storedBytes(attr, posting, prev, entry, 0);
+        if (!posting || prev == nullptr || !sameKey(attr, prev, entry)) ++leafKeys;
+        lastLeafEntry = leafEntries.size();
+        leafEntries.insert(leafEntries.end(), entry, entry + IndexManager::instance().nodeEntrySize(attr, entry, true));
+        ++leafEntryCount;
+        return 0;
+    }
+
+    RC IX_BulkLoader::writeLeaf(size_t end, const char *next) {
+        // page 0 points at the root, which is only known once every level is written
+        if (fh->pageCount == 0) {
+            char rootPtr[PAGE_SIZE];
+            memset(rootPtr, 0, PAGE_SIZE);
+            if (fh->appendPage(rootPtr) == -1) return -1;
+        }
+        bool compressed = prefixCompressed(*fh, attr);
+        char leafPage[PAGE_SIZE];
+        memset(leafPage, 0, PAGE_SIZE);
+        memset(leafPage, 1, LEAF_CHECK_BYTE);
+        unsigned nextLeaf = next == nullptr ? 0 : fh->pageCount + 1;
+        memmove(leafPage + LEAF_CHECK_BYTE, &nextLeaf, PAGE_NUM_BYTES);
+
+        // the next entry starts the leaf written next, and separates it from this one, cut short when compressed
+        char separator[attr.length + INT_BYTES + RID_BYTES];
+        SizeType prefix = 0;
+        if (next != nullptr && compressed) {
+            const char *last = leafEntries.data();
+            while (last + IndexManager::instance().nodeEntrySize(attr, last, true) < leafEntries.data() + end)
+                last += IndexManager::instance().nodeEntrySize(attr, last, true);
+            shortestSeparator(attr, last, next, separator);
+            prefix = commonPrefix(lowFence.empty() ? nullptr : lowFence.data(), separator);
+            putPrefix(leafPage, separator, prefix);
+        } else if (next != nullptr)
+            memmove(separator, next, entryKeyBytes(attr, next) + RID_BYTES);
+        *nodeEnd(leafPage, true) = encodeEntries(attr, leafEntries.data(), leafEntries.data() + end, true, prefix, leafPage + LEAF_BYTES_BEFORE_KEYS,
+                                                 postingLeaves(*fh)) - leafPage;
+        if (fh->appendPage(leafPage) == -1) return -1;
+
+        if (next != nullptr) {
+            SizeType separatorBytes = entryKeyBytes(attr, separator) + RID_BYTES;
+            size_t offset = separators.size();
+            separators.resize(offset + separatorBytes + PAGE_NUM_BYTES);
+            memmove(&separators[offset], separator, separatorBytes);
+            memmove(&separators[offset + separatorBytes], &fh->pageCount, PAGE_NUM_BYTES);
+            lowFence.assign(separator, separator + entryKeyBytes(attr, separator));
+        }
+        leafEntries.clear();
+        leafEntryCount = 0;
+        leafBytes = 0;
+        leafKeys = 0;
+        return 0;
+    }
+
+    RC IX_BulkLoader::buildNodes(unsigned &rootPage) {
+        IndexManager & ix = IndexManager::instance();
+        bool compressed = prefixCompressed(*fh, attr);
+        unsigned firstChild = 1;    // the first leaf directly follows page 0
+        std::vector<char> level, upper;
+        level.swap(separators);
+        char node[PAGE_SIZE];
+
+        // each level holds the separators of the one below, until a single node is left
+        while (!level.empty()) {
+            unsigned firstNode = fh->pageCount;
+            std::vector<size_t> offsets;
+            for (size_t offset = 0; offset < level.size(); offset += ix.nodeEntrySize(attr, &level[offset], false))
+                offsets.push_back(offset);
+            size_t count = offsets.size();
+            offsets.push_back(level.size());
+
+            // a node takes entries while it fits with the prefix it would share with its fences, then the entry after
+            // them moves up to separate it from the next node, whose first child is that entry's child
+            const char *lowKey = nullptr;
+            unsigned nodeChild = firstChild;
+            for (size_t i = 0;;) {
+                auto prefixBefore = [&](size_t j) -> SizeType {
+                    return compressed && j < count ? commonPrefix(lowKey, &level[offsets[j]]) : 0;
+                };
+                size_t j = std::min(i + 1, count);
+                while (j < count && nodeBytes(NODE_BYTES_BEFORE_KEYS, offsets[j + 1] - offsets[i], j + 1 - i, prefixBefore(j + 1), compressed)
+                                    <= PAGE_SIZE * fillFactor / 100)
+                    ++j;
+
+                memset(node, 0, PAGE_SIZE);
+                memmove(node + (LEAF_CHECK_BYTE + OFFSET_BYTES), &nodeChild, PAGE_NUM_BYTES);
+                SizeType prefix = prefixBefore(j);
+                if (prefix > 0) putPrefix(node, &level[offsets[j]], prefix);
+                *nodeEnd(node, false) = encodeEntries(attr, &level[offsets[i]], &level[offsets[j]], false, prefix, node + NODE_BYTES_BEFORE_KEYS) - node;
+                if (fh->appendPage(node) == -1) return -1;
+                if (j == count) break;
+
+                const char *entry = &level[offsets[j]];
+                SizeType entrySize = offsets[j + 1] - offsets[j];
+                size_t upperOffset = upper.size();
+                upper.insert(upper.end(), entry, entry + entrySize);
+                memmove(&upper[upperOffset + entrySize - PAGE_NUM_BYTES], &fh->pageCount, PAGE_NUM_BYTES);
+                nodeChild = entryChild(attr, entry);
+                lowKey = entry;
+                i = j + 1;
+            }
+
+            firstChild = firstNode;
+            level.swap(upper);
+            upper.clear();
+        }
+        rootPage = firstChild;
+        return 0;
+    }
+
+    IXFileHandle::IXFileHandle() : FileHandle() {
+        for (std::atomic<unsigned> &version : leafVersions) version.store(0);
+    }
 
     IXFileHandle::~IXFileHandle() = default;
 
+    RC IXFileHandle::readPage(PageNum pageNum, void *data) {
+        std::lock_guard<std::mutex> latch(ioLatch);
+        return FileHandle::readPage(pageNum, data);
+    }
+
+    RC IXFileHandle::writePage(PageNum pageNum, const void *data) {
+        std::lock_guard<std::mutex> latch(ioLatch);
+        return FileHandle::writePage(pageNum, data);
+    }
+
+    RC IXFileHandle::appendPage(const void *data) {
+        std::lock_guard<std::mutex> latch(ioLatch);
+        return FileHandle::appendPage(data);
+    }
+
+    unsigned IXFileHandle::pageWrites() {
+        std::lock_guard<std::mutex> latch(ioLatch);
+        return writePageCounter + appendPageCounter;
+    }
+
+    void TreeLatch::lock() {
+        std::unique_lock<std::mutex> guard(mutex);
+        ++writersWaiting;
+        released.wait(guard, [this] {return !writer && readers == 0;});
+        --writersWaiting;
+        writer = true;
+    }
+
+    void TreeLatch::unlock() {
+        std::lock_guard<std::mutex> guard(mutex);
+        writer = false;
+        released.notify_all();
+    }
+
+    void TreeLatch::lockShared() {
+        std::unique_lock<std::mutex> guard(mutex);
+        released.wait(guard, [this] {return !writer && writersWaiting == 0;});
+        ++readers;
+    }
+
+    void TreeLatch::unlockShared() {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (--readers == 0) released.notify_all();
+    }
+
 } // namespace PeterDB
\ No newline at end of file
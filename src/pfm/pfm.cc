@@ -36,6 +36,12 @@ namespace PeterDB {
         return removeStatus == 0 ? 0 : -1;
     }
 
+    RC PagedFileManager::renameFile(const std::string &fileName, const std::string &newFileName) {
+        // rename replaces an existing file in one step, so the old name never goes missing
+        RC renameStatus = rename(fileName.c_str(), newFileName.c_str());
+        return renameStatus == 0 ? 0 : -1;
+    }
+
     RC PagedFileManager::openFile(const std::string &fileName, FileHandle &fileHandle) {
         // error code if fileHandle associated to file already
         if (fileHandle.file.is_open()) return -1;
@@ -56,6 +62,11 @@ namespace PeterDB {
         writePageCounter = 0;
         appendPageCounter = 0;
         pageCount = 0;
+        pageLayout = 0;
+        zoneMap = nullptr;
+        fillFactor = FULL_FILL_FACTOR;
+        insertHint = 0;
+        recordLayout = nullptr;
     }
 
     FileHandle::FileHandle(const FileHandle & fh) {
@@ -64,6 +75,11 @@ namespace PeterDB {
         writePageCounter = fh.writePageCounter;
         appendPageCounter = fh.appendPageCounter;
         pageCount = fh.pageCount;
+        pageLayout = fh.pageLayout;
+        zoneMap = fh.zoneMap;
+        fillFactor = fh.fillFactor;
+        insertHint = fh.insertHint;
+        recordLayout = fh.recordLayout;
     }
 
     FileHandle::~FileHandle() = default;
@@ -74,6 +90,12 @@ namespace PeterDB {
         writePageCounter = other.writePageCounter;
         appendPageCounter = other.appendPageCounter;
         pageCount = other.pageCount;
+        pageLayout = other.pageLayout;
+        // the zone map is shared, and only closed along with the file it was opened with
+        zoneMap = other.zoneMap;
+        fillFactor = other.fillFactor;
+        insertHint = other.insertHint;
+        recordLayout = other.recordLayout;
         return *this;
     }
 
@@ -101,6 +123,16 @@ namespace PeterDB {
         file >> readPageCounter;
         file >> writePageCounter;
         file >> appendPageCounter;
+        // layout value was added after the counters, files without it use the default layout
+        if (!(file >> pageLayout)) {
+            file.clear();
+            pageLayout = 0;
+        }
+        // so was the insert hint, which then starts at the first page
+        if (!(file >> insertHint)) {
+            file.clear();
+            insertHint = 0;
+        }
 
         return 0;
     }
@@ -156,7 +188,7 @@ namespace PeterDB {
 
     void FileHandle::detachFile() {
         file.seekp(0, std::ios::beg);
-        file << pageCount << ' ' << readPageCounter << ' ' << writePageCounter << ' ' << appendPageCounter << " \n";
+        file << pageCount << ' ' << readPageCounter << ' ' << writePageCounter << ' ' << appendPageCounter << ' ' << pageLayout << ' ' << insertHint << " \n";
         file.close();
     }
 } // namespace PeterDB
\ No newline at end of file
@@ -1,6 +1,11 @@
 #include "src/include/rbfm.h"
 #include <cstring>
+#include <algorithm>
 #include <iostream>
+#include <climits>
+#include <map>
+#include <set>
+#include <random>
 
 constexpr PeterDB::SizeType BYTES_FOR_SLOT_DIR_OFFSET = 2;
 constexpr PeterDB::SizeType BYTES_FOR_SLOT_DIR_LENGTH = 2;
@@ -18,6 +23,19 @@ constexpr PeterDB::SizeType BYTES_FOR_SLOT_NUM = 2;
 constexpr PeterDB::SizeType MAX_RECORD_SIZE = PAGE_SIZE - BYTES_FOR_PAGE_STATS - BYTES_FOR_SLOT_DIR_ENTRY;
 constexpr PeterDB::SizeType BYTES_FOR_VERSION_NUM = 2;
 constexpr PeterDB::SizeType BYTES_BEFORE_NULL_FLAGS = TOMBSTONE_BYTE + BYTES_FOR_VERSION_NUM + BYTES_FOR_RECORD_FIELD_COUNT;
+constexpr PeterDB::SizeType BYTES_FOR_PAX_CAPACITY = 2;
+constexpr PeterDB::SizeType BYTES_FOR_PAX_RECORD_COUNT = 2;
+constexpr PeterDB::SizeType BYTES_FOR_PAX_HEADER = BYTES_FOR_VERSION_NUM + BYTES_FOR_PAX_CAPACITY + BYTES_FOR_PAX_RECORD_COUNT;
+constexpr PeterDB::SizeType BYTES_FOR_ROW_GROUP_PAGES = 4;
+constexpr PeterDB::SizeType BYTES_FOR_ROW_GROUP_HEADER = BYTES_FOR_PAX_HEADER + BYTES_FOR_ROW_GROUP_PAGES;
+constexpr unsigned MAX_ROW_GROUP_CAPACITY = 1024;
+constexpr PeterDB::SizeType BYTES_FOR_ZONE_CAPACITY = 2;
+constexpr PeterDB::SizeType BYTES_FOR_ZONE_COUNT = 2;
+constexpr PeterDB::SizeType BYTES_FOR_ZONE_ENTRY_HEADER = BYTES_FOR_VERSION_NUM + BYTES_FOR_ZONE_COUNT;
+constexpr PeterDB::SizeType BYTES_FOR_ZONE_ATTR = INT_BYTES + INT_BYTES + BYTES_FOR_ZONE_COUNT + BYTES_FOR_ZONE_COUNT;
+constexpr PeterDB::SizeType MAX_ZONE_ATTRS = (PAGE_SIZE - BYTES_FOR_ZONE_ENTRY_HEADER) / BYTES_FOR_ZONE_ATTR;
+constexpr PeterDB::SizeType ZONE_MIXED_VERSION = USHRT_MAX;
+constexpr const char * ZONE_MAP_SUFFIX = ".zone";
 
 
 namespace PeterDB {
@@ -34,20 +52,58 @@ namespace PeterDB {
 
     RecordBasedFileManager &RecordBasedFileManager::operator=(const RecordBasedFileManager &) = default;
 
-    RC RecordBasedFileManager::createFile(const std::string &fileName) {
-        return PagedFileManager::instance().createFile(fileName);
+    RC RecordBasedFileManager::createFile(const std::string &fileName, PageLayout layout, bool zoneMaps) {
+        if (zoneMaps && layout != LayoutSlotted) return -1;
+        if (PagedFileManager::instance().createFile(fileName) == -1) return -1;
+        // a zone map outliving its data file (e.g. one removed by hand) is stale and would be picked up by openFile
+        PagedFileManager::instance().destroyFile(fileName + ZONE_MAP_SUFFIX);
+        if (zoneMaps && PagedFileManager::instance().createFile(fileName + ZONE_MAP_SUFFIX) == -1) return -1;
+        if (layout == LayoutSlotted) return 0;
+
+        // other layouts are recorded in the hidden page so later opens know how to read the data pages
+        FileHandle fileHandle;
+        if (openFile(fileName, fileHandle) == -1) return -1;
+        fileHandle.pageLayout = layout;
+        return closeFile(fileHandle);
     }
 
     RC RecordBasedFileManager::destroyFile(const std::string &fileName) {
-        return PagedFileManager::instance().destroyFile(fileName);
+        RC destroyStatus = PagedFileManager::instance().destroyFile(fileName);
+        if (destroyStatus == 0) PagedFileManager::instance().destroyFile(fileName + ZONE_MAP_SUFFIX);  // zone map, if any
+        return destroyStatus;
+    }
+
+    RC RecordBasedFileManager::renameFile(const std::string &fileName, const std::string &newFileName) {
+        // the zone map moves along, and one left at the new name by the replaced file would be stale
+        PagedFileManager &pfm = PagedFileManager::instance();
+        if (pfm.renameFile(fileName + ZONE_MAP_SUFFIX, newFileName + ZONE_MAP_SUFFIX) == -1)
+            pfm.destroyFile(newFileName + ZONE_MAP_SUFFIX);
+        return pfm.renameFile(fileName, newFileName);
     }
 
     RC RecordBasedFileManager::openFile(const std::string &fileName, FileHandle &fileHandle) {
-        return PagedFileManager::instance().openFile(fileName, fileHandle);
+        if (PagedFileManager::instance().openFile(fileName, fileHandle) == -1) return -1;
+
+        // files created with zone maps have their companion file opened alongside
+        ZoneMapHandle *zoneHandle = new ZoneMapHandle{};
+        if (PagedFileManager::instance().openFile(fileName + ZONE_MAP_SUFFIX, *zoneHandle) == 0)
+            fileHandle.zoneMap = zoneHandle;
+        else
+            delete zoneHandle;
+        return 0;
     }
 
     RC RecordBasedFileManager::closeFile(FileHandle &fileHandle) {
-        return PagedFileManager::instance().closeFile(fileHandle);
+        RC zoneStatus = 0;
+        if (fileHandle.zoneMap != nullptr && fileHandle.file.is_open()) {
+            auto *zoneHandle = static_cast<ZoneMapHandle *>(fileHandle.zoneMap);
+            zoneStatus = flushZoneMap(*zoneHandle);
+            PagedFileManager::instance().closeFile(*zoneHandle);
+            delete zoneHandle;
+        }
+        fileHandle.zoneMap = nullptr;
+        RC closeStatus = PagedFileManager::instance().closeFile(fileHandle);
+        return zoneStatus == -1 ? -1 : closeStatus;
     }
 
     SizeType RecordBasedFileManager::nullBytesNeeded(SizeType numFields) {
@@ -124,10 +180,12 @@ namespace PeterDB {
         return slotCount + 1;
     }
 
-    bool RecordBasedFileManager::fitsOnPage(SizeType recordSpace, const void * pageData) {
-        // get this page's free space value
+    bool RecordBasedFileManager::fitsOnPage(SizeType recordSpace, const void * pageData, SizeType reserved) {
+        // get this page's free space value, less the bytes held back for records already on it to grow in place
         SizeType freeSpace;
         getFreeSpace(&freeSpace, pageData);
+        if (freeSpace < reserved) return false;
+        freeSpace -= reserved;
 
         // fitsOnPage is true when there's enough free space, false when there's not even enough space for bare record
         if (recordSpace <= freeSpace) return true;
@@ -139,13 +197,49 @@ namespace PeterDB {
         return assignSlot(pageData) <= slotsOnPage;
     }
 
-    SizeType RecordBasedFileManager::calcRecordSpace(const std::vector<Attribute> &recordDescriptor, const void * data) {
+    void RecordBasedFileManager::getRecordLayout(const std::vector<Attribute> &recordDescriptor, RecordLayout &layout) {
+        layout = RecordLayout{};
+        layout.numFields = recordDescriptor.size();
+        layout.prefixOffsets.push_back(0);
+        // the prefix ends at the first varchar
+        for (; layout.fixedPrefix < recordDescriptor.size() && recordDescriptor[layout.fixedPrefix].type != TypeVarChar; ++layout.fixedPrefix)
+            layout.prefixOffsets.push_back(layout.prefixOffsets.back() + recordDescriptor[layout.fixedPrefix].length);
+    }
+
+    const RecordLayout * RecordBasedFileManager::fileRecordLayout(const FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor) {
+        // the layout is the caller's, computed when it loaded the schema, so only its width is checked here
+        if (fileHandle.recordLayout == nullptr || fileHandle.recordLayout->numFields != recordDescriptor.size()) return nullptr;
+        return fileHandle.recordLayout;
+    }
+
+    bool RecordBasedFileManager::hasNulls(const void * data, SizeType nullFlagBytes) {
+        for (SizeType i = 0; i < nullFlagBytes; ++i)
+            if (static_cast<const char *>(data)[i] != 0) return true;
+        return false;
+    }
+
+    SizeType RecordBasedFileManager::calcRecordSpace(const std::vector<Attribute> &recordDescriptor, const void * data, const RecordLayout * layout) {
         // need bytes for record directory entry, for offset and length
         // need more for number of fields, and byte for tombstone check
         SizeType recordSpace = BYTES_FOR_SLOT_DIR_ENTRY + BYTES_BEFORE_NULL_FLAGS;
         SizeType nullFlagBytes = nullBytesNeeded(recordDescriptor.size());
         recordSpace += nullFlagBytes;
 
+        // with a layout and no nulls the fixed-width prefix has a known size, and only the varchar lengths after it are read
+        if (layout && !hasNulls(data, nullFlagBytes)) {
+            SizeType valueBytes = layout->prefixOffsets.back();
+            for (SizeType i = layout->fixedPrefix; i < recordDescriptor.size(); ++i) {
+                if (recordDescriptor[i].type != TypeVarChar) {
+                    valueBytes += recordDescriptor[i].length;
+                    continue;
+                }
+                int varcharLen = 0;
+                memmove(&varcharLen, static_cast<const char *>(data) + (nullFlagBytes + valueBytes), INT_BYTES);
+                valueBytes += INT_BYTES + varcharLen;
+            }
+            return recordSpace + BYTES_FOR_POINTER_TO_RECORD_FIELD * recordDescriptor.size() + valueBytes;
+        }
+
         // each non-null field needs 2 bytes for offset pointer, plus data type size
         int fieldsRemaining = recordDescriptor.size();
         SizeType dataPos = nullFlagBytes;
@@ -174,7 +268,8 @@ namespace PeterDB {
         return recordSpace;
     }
 
-    void RecordBasedFileManager::embedRecord(SizeType offset, const std::vector<Attribute> &recordDescriptor, const void * data, void * pageData, SizeType version) {
+    void RecordBasedFileManager::embedRecord(SizeType offset, const std::vector<Attribute> &recordDescriptor, const void * data, void * pageData, SizeType version,
+                                             const RecordLayout * layout) {
         char * recoStart = static_cast<char *>(pageData) + offset;
         char * recoPos = recoStart;  // starting position of record entry in pageData
         unsigned short numFields = recordDescriptor.size();  // number of fields
@@ -189,42 +284,38 @@ namespace PeterDB {
         memmove(recoPos, data, nullFlagBytes);  // get null flag bits
         recoPos += nullFlagBytes;
 
-        SizeType currFieldOffset = BYTES_BEFORE_NULL_FLAGS + nullFlagBytes + BYTES_FOR_POINTER_TO_RECORD_FIELD * numFields;  // field offsets go from record start
-        long fieldsRemaining = numFields;
-        SizeType dataPos = nullFlagBytes;  // this keeps track of how far into data byte stream to be
-        unsigned char flagByte;
-        for (SizeType i = 0; i < nullFlagBytes; ++i, fieldsRemaining -= BITS_IN_BYTE) {
-            // get byte of null flag bits
-            memmove(&flagByte, static_cast<const char *>(data) + i, 1);
-
-            for (int j = 1; j <= BITS_IN_BYTE && j <= fieldsRemaining; ++j) {
-                memmove(recoPos, &currFieldOffset, BYTES_FOR_POINTER_TO_RECORD_FIELD);  // set directory pointer for field
-                recoPos += BYTES_FOR_POINTER_TO_RECORD_FIELD;
+        SizeType valuesStart = BYTES_BEFORE_NULL_FLAGS + nullFlagBytes + BYTES_FOR_POINTER_TO_RECORD_FIELD * numFields;  // field offsets go from record start
+        SizeType currFieldOffset = valuesStart;
+        const char * values = static_cast<const char *>(data) + nullFlagBytes;
+        SizeType field = 0;
+        if (layout && !hasNulls(data, nullFlagBytes)) {
+            // the fixed-width prefix has precomputed offsets
+            for (; field < layout->fixedPrefix; ++field, recoPos += BYTES_FOR_POINTER_TO_RECORD_FIELD) {
+                SizeType fieldOffset = valuesStart + layout->prefixOffsets[field];
+                memmove(recoPos, &fieldOffset, BYTES_FOR_POINTER_TO_RECORD_FIELD);
+            }
+            currFieldOffset += layout->prefixOffsets.back();
+        }
 
-                if (!nullBitOn(flagByte, j)) {
-                    // non-null attribute value means field length must be considered
-                    Attribute attr{recordDescriptor[i * BITS_IN_BYTE + j - 1]};
-                    if (attr.type != TypeVarChar) {
-                        // copy field data to the record byte stream at current pointer offset
-                        memmove(recoStart + currFieldOffset, static_cast<const char *>(data) + dataPos, attr.length);
-                        currFieldOffset += attr.length;
-                        dataPos += attr.length;
-                    } else {
-                        // must get int sized length value from varchar field to know needed space
-                        int varcharLen = 0;
-                        memmove(&varcharLen, static_cast<const char *>(data) + dataPos, INT_BYTES);
-                        // copy field data to the record byte stream at current pointer offset
-                        int fieldBytes = INT_BYTES + varcharLen;
-                        memmove(recoStart + currFieldOffset, static_cast<const char *>(data) + dataPos, fieldBytes);
-                        currFieldOffset += fieldBytes;
-                        dataPos += fieldBytes;
-                    }
-                }
+        for (; field < numFields; ++field, recoPos += BYTES_FOR_POINTER_TO_RECORD_FIELD) {
+            memmove(recoPos, &currFieldOffset, BYTES_FOR_POINTER_TO_RECORD_FIELD);  // set directory pointer for field
+            if (nullBitOn(static_cast<const char *>(data)[field / BITS_IN_BYTE], field % BITS_IN_BYTE + 1)) continue;
+            if (recordDescriptor[field].type != TypeVarChar) {
+                currFieldOffset += recordDescriptor[field].length;
+            } else {
+                // must get int sized length value from varchar field to know needed space
+                int varcharLen = 0;
+                memmove(&varcharLen, values + (currFieldOffset - valuesStart), INT_BYTES);
+                currFieldOffset += INT_BYTES + varcharLen;
             }
         }
+
+        // values keep their order and encoding in the record, so they are copied as one block
+        memmove(recoStart + valuesStart, values, currFieldOffset - valuesStart);
     }
 
-    SizeType RecordBasedFileManager::putRecordInEmptyPage(const std::vector<Attribute> &recordDescriptor, const void * data, void * pageData, SizeType recordSpace, SizeType version) {
+    SizeType RecordBasedFileManager::putRecordInEmptyPage(const std::vector<Attribute> &recordDescriptor, const void * data, void * pageData, SizeType recordSpace, SizeType version,
+                                                          const RecordLayout * layout) {
         SizeType initFreeSpace = PAGE_SIZE - recordSpace - BYTES_FOR_PAGE_STATS;  // bytes for N value and F value
         SizeType N = 1;
         setFreeSpaceAndSlotCount(&initFreeSpace, &N, pageData);  // adds N value for number of records, F value for free space
@@ -235,11 +326,12 @@ namespace PeterDB {
         setSlotOffsetAndLen(&offset, &length, 1, pageData);
 
         // record itself is placed into page
-        embedRecord(offset, recordDescriptor, data, pageData, version);
+        embedRecord(offset, recordDescriptor, data, pageData, version, layout);
         return 1;
     }
 
-    SizeType RecordBasedFileManager::putRecordInNonEmptyPage(const std::vector<Attribute> &recordDescriptor, const void * data, void * pageData, SizeType recordSpace, SizeType version) {
+    SizeType RecordBasedFileManager::putRecordInNonEmptyPage(const std::vector<Attribute> &recordDescriptor, const void * data, void * pageData, SizeType recordSpace, SizeType version,
+                                                             const RecordLayout * layout) {
         // get current free space value and N value
         SizeType freeSpace, N;
         getFreeSpaceAndSlotCount(&freeSpace, &N, pageData);
@@ -261,31 +353,41 @@ namespace PeterDB {
         setFreeSpaceAndSlotCount(&freeSpace, &N, pageData);
 
         // record itself is placed into page, return slot number
-        embedRecord(offset, recordDescriptor, data, pageData, version);
+        embedRecord(offset, recordDescriptor, data, pageData, version, layout);
         return assignedSlot;
     }
 
     RC RecordBasedFileManager::insertRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
                                             const void *data, RID &rid, SizeType version) {
+        if (fileHandle.pageLayout == LayoutPax) return insertPaxRecord(fileHandle, recordDescriptor, data, rid, version);
+        if (fileHandle.pageLayout == LayoutColumnar) {
+            std::vector<RID> rids;
+            if (insertColumnarRecords(fileHandle, recordDescriptor, {data}, rids, version) == -1) return -1;
+            rid = rids[0];
+            return 0;
+        }
         char pageData[PAGE_SIZE];
         memset(pageData, 0, PAGE_SIZE);
         unsigned pageNum;  // page which record will be inserted to, starts with last page
-        SizeType recordSpace = calcRecordSpace(recordDescriptor, data);
+        const RecordLayout * layout = fileRecordLayout(fileHandle, recordDescriptor);
+        SizeType recordSpace = calcRecordSpace(recordDescriptor, data, layout);
         if (recordSpace - BYTES_FOR_SLOT_DIR_ENTRY > MAX_RECORD_SIZE) return -1;  // record will not fit on a page
         SizeType slotNum;
+        // a fill factor below full keeps part of every page free for updates that grow records
+        SizeType reserved = fileHandle.fillFactor < FULL_FILL_FACTOR ? PAGE_SIZE * (FULL_FILL_FACTOR - fileHandle.fillFactor) / FULL_FILL_FACTOR : 0;
 
         if (fileHandle.pageCount == 0) {
             pageNum = 0;  // no need to check pages
-            slotNum = putRecordInEmptyPage(recordDescriptor, data, pageData, recordSpace, version);
+            slotNum = putRecordInEmptyPage(recordDescriptor, data, pageData, recordSpace, version, layout);
         } else {
             pageNum = fileHandle.pageCount - 1;
             if (fileHandle.readPage(pageNum, pageData) == -1) return -1;
 
             // if not enough space, need to start iterating through other pages
-            if (!fitsOnPage(recordSpace, pageData)) {
+            if (!fitsOnPage(recordSpace, pageData, reserved)) {
                 for (pageNum = 0; pageNum < fileHandle.pageCount - 1; ++pageNum) {
                     if (fileHandle.readPage(pageNum, pageData) == -1) return -1;
-                    if (fitsOnPage(recordSpace, pageData)) break;  // stop searching if enough space
+                    if (fitsOnPage(recordSpace, pageData, reserved)) break;  // stop searching if enough space
                 }
 
                 if (pageNum == fileHandle.pageCount - 1) {
@@ -296,14 +398,18 @@ namespace PeterDB {
 
             // now that pageNum is determined, must call function to construct new page data
             if (pageNum >= fileHandle.pageCount)
-                slotNum = putRecordInEmptyPage(recordDescriptor, data, pageData, recordSpace, version);
+                slotNum = putRecordInEmptyPage(recordDescriptor, data, pageData, recordSpace, version, layout);
             else
-                slotNum = putRecordInNonEmptyPage(recordDescriptor, data, pageData, recordSpace, version);
+                slotNum = putRecordInNonEmptyPage(recordDescriptor, data, pageData, recordSpace, version, layout);
         }
 
         // set the record id, then write back updated page with inserted record
         rid.pageNum = pageNum;
         rid.slotNum = slotNum;
+        // the zone map is widened before the page is written, so a failed write leaves it too wide rather than too narrow
+        SizeType recoOffset;
+        getSlotOffset(&recoOffset, slotNum, pageData);
+        if (updateZoneMap(fileHandle, recordDescriptor, pageNum, pageData + recoOffset, false) == -1) return -1;
         RC writeStatus;
         if (pageNum >= fileHandle.pageCount)
             writeStatus = fileHandle.appendPage(pageData);
@@ -349,45 +455,125 @@ namespace PeterDB {
         return 0;
     }
 
+    RC RecordBasedFileManager::insertRecords(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
+                                             const std::vector<const void *> &records, std::vector<RID> &rids, SizeType version) {
+        if (fileHandle.pageLayout == LayoutColumnar) return insertColumnarRecords(fileHandle, recordDescriptor, records, rids, version);
+        rids.resize(records.size());
+        for (size_t i = 0; i < records.size(); ++i)
+            if (insertRecord(fileHandle, recordDescriptor, records[i], rids[i], version) == -1) return -1;
+        return 0;
+    }
+
     RC RecordBasedFileManager::readRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
                                           const RID &rid, void *data, SizeType *version) {
+        if (fileHandle.pageLayout == LayoutPax) return readPaxRecord(fileHandle, recordDescriptor, rid, data, version);
+        if (fileHandle.pageLayout == LayoutColumnar) return readColumnarRecord(fileHandle, recordDescriptor, rid, data, version);
         char pageData[PAGE_SIZE];
         unsigned short startingSlot = rid.slotNum;
         unsigned startingPage = rid.pageNum;
         SizeType recoOffset, recoLen;
         if (findRealRecord(fileHandle, pageData, startingPage, startingSlot, recoOffset, recoLen, false) == -1) return -1;
+        if (version != nullptr) memmove(version, pageData + recoOffset + TOMBSTONE_BYTE, BYTES_FOR_VERSION_NUM);
+        decodeRecord(pageData + recoOffset, recoLen, data);
+        return 0;
+    }
+
+    SizeType RecordBasedFileManager::decodeRecord(const char * record, SizeType recoLen, void * data) {
         SizeType bytesFromStart = BYTES_BEFORE_NULL_FLAGS;  // start looking after the initial values
-        if (version != nullptr) {
-            memmove(version, pageData + recoOffset + TOMBSTONE_BYTE, BYTES_FOR_VERSION_NUM);
-            return 0;
-        }
 
-        // calculate number of null flag bytes, copy those bytes from the record
-        SizeType nullFlagBytes = nullBytesNeeded(recordDescriptor.size());
-        memmove(data, pageData + recoOffset + bytesFromStart, nullFlagBytes);
-        data = static_cast<char *>(data) + nullFlagBytes;
+        // calculate number of null flag bytes from the record's own field count, copy those bytes from the record
+        SizeType numFields;
+        memmove(&numFields, record + (TOMBSTONE_BYTE + BYTES_FOR_VERSION_NUM), BYTES_FOR_RECORD_FIELD_COUNT);
+        SizeType nullFlagBytes = nullBytesNeeded(numFields);
+        memmove(data, record + bytesFromStart, nullFlagBytes);
 
         // now skip over the null bytes and all the directory bytes
-        bytesFromStart += nullFlagBytes + BYTES_FOR_POINTER_TO_RECORD_FIELD * recordDescriptor.size();
+        bytesFromStart += nullFlagBytes + BYTES_FOR_POINTER_TO_RECORD_FIELD * numFields;
 
         // copy rest of record into data variable
-        memmove(data, pageData + recoOffset + bytesFromStart, recoLen - bytesFromStart);
+        memmove(static_cast<char *>(data) + nullFlagBytes, record + bytesFromStart, recoLen - bytesFromStart);
+        return nullFlagBytes + recoLen - bytesFromStart;
+    }
+
+    RC RecordBasedFileManager::readRecords(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
+                                           const std::vector<RID> &rids, void *data, std::vector<unsigned> &offsets,
+                                           std::vector<SizeType> *versions) {
+        offsets.assign(rids.size(), 0);
+        if (versions) versions->assign(rids.size(), 0);
+        char *dataPtr = static_cast<char *>(data);
+        unsigned used = 0;
+        SizeType version;
+        if (fileHandle.pageLayout != LayoutSlotted) {
+            for (unsigned i = 0; i < rids.size(); ++i) {
+                if (readRecord(fileHandle, recordDescriptor, rids[i], dataPtr + used, &version) == -1) return -1;
+                if (versions) (*versions)[i] = version;
+                offsets[i] = used;
+                used += recordLength(recordDescriptor, dataPtr + used);
+            }
+            return 0;
+        }
+
+        // visit the records in page order, so each page holding some of them is read once
+        std::vector<unsigned> order(rids.size());
+        for (unsigned i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](unsigned a, unsigned b) {return rids[a] < rids[b];});
+
+        char pageData[PAGE_SIZE], forwardedPage[PAGE_SIZE];
+        unsigned loadedPage = 0;
+        bool pageLoaded = false;
+        for (unsigned i : order) {
+            if (!pageLoaded || rids[i].pageNum != loadedPage) {
+                if (fileHandle.readPage(rids[i].pageNum, pageData) == -1) return -1;
+                loadedPage = rids[i].pageNum;
+                pageLoaded = true;
+            }
+            SizeType recoOffset, recoLen;
+            getSlotOffsetAndLen(&recoOffset, &recoLen, rids[i].slotNum, pageData);
+            if (recoLen == 0) return -1;
+            const char *recoStart = pageData + recoOffset;
+            if (*recoStart == 1) {
+                // forwarded records are followed from their tombstone without evicting the loaded page
+                unsigned pageNum;
+                unsigned short slotNum;
+                memmove(&pageNum, recoStart + TOMBSTONE_BYTE, BYTES_FOR_PAGE_NUM);
+                memmove(&slotNum, recoStart + (TOMBSTONE_BYTE + BYTES_FOR_PAGE_NUM), BYTES_FOR_SLOT_NUM);
+                if (findRealRecord(fileHandle, forwardedPage, pageNum, slotNum, recoOffset, recoLen, false) == -1) return -1;
+                recoStart = forwardedPage + recoOffset;
+            }
+
+            // records of another version are copied with their own field count, for the caller to convert
+            SizeType numFields;
+            memmove(&version, recoStart + TOMBSTONE_BYTE, BYTES_FOR_VERSION_NUM);
+            memmove(&numFields, recoStart + (TOMBSTONE_BYTE + BYTES_FOR_VERSION_NUM), BYTES_FOR_RECORD_FIELD_COUNT);
+            SizeType nullFlagBytes = nullBytesNeeded(numFields);
+            SizeType fieldsStart = BYTES_BEFORE_NULL_FLAGS + nullFlagBytes + BYTES_FOR_POINTER_TO_RECORD_FIELD * numFields;
+            if (versions) (*versions)[i] = version;
+            offsets[i] = used;
+            memmove(dataPtr + used, recoStart + BYTES_BEFORE_NULL_FLAGS, nullFlagBytes);
+            memmove(dataPtr + (used + nullFlagBytes), recoStart + fieldsStart, recoLen - fieldsStart);
+            used += nullFlagBytes + recoLen - fieldsStart;
+        }
         return 0;
     }
 
     RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
                                             const RID &rid) {
+        if (fileHandle.pageLayout == LayoutPax) return deletePaxRecord(fileHandle, rid);
+        if (fileHandle.pageLayout == LayoutColumnar) return deleteColumnarRecord(fileHandle, rid);
         char pageData[PAGE_SIZE];
         SizeType recoOffset, recoLen;
         unsigned pageNum = rid.pageNum;
         unsigned short slotNum = rid.slotNum;
         if (findRealRecord(fileHandle, pageData, pageNum, slotNum, recoOffset, recoLen, true) == -1) return -1;
 
+        // keep the record's bytes for the zone map, which is only narrowed once the page is written
+        char record[recoLen];
+        memmove(record, pageData + recoOffset, recoLen);
         shiftRecordsLeft(recoOffset + recoLen, recoLen, pageData);
         SizeType zero = 0;
         setSlotOffsetAndLen(&zero, &zero, slotNum, pageData);
-        RC writeStatus = fileHandle.writePage(pageNum, pageData);
-        return writeStatus;
+        if (fileHandle.writePage(pageNum, pageData) == -1) return -1;
+        return updateZoneMap(fileHandle, recordDescriptor, pageNum, record, true);
     }
 
     RC RecordBasedFileManager::printRecord(const std::vector<Attribute> &recordDescriptor, const void *data,
@@ -451,6 +637,12 @@ namespace PeterDB {
         return 0;
     }
 
+    unsigned RecordBasedFileManager::recordLength(const std::vector<Attribute> &recordDescriptor, const void *data, const RecordLayout *layout) {
+        // the values and null flags are what a stored record holds beyond its header and field directory
+        return calcRecordSpace(recordDescriptor, data, layout) - BYTES_FOR_SLOT_DIR_ENTRY - BYTES_BEFORE_NULL_FLAGS
+               - BYTES_FOR_POINTER_TO_RECORD_FIELD * recordDescriptor.size();
+    }
+
     void RecordBasedFileManager::shiftRecordsLeft(SizeType shiftPoint, SizeType shiftDistance, void *pageData) {
         SizeType slotCount, freeSpace;
         getFreeSpaceAndSlotCount(&freeSpace, &slotCount, pageData);
@@ -489,8 +681,11 @@ namespace PeterDB {
 
     RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
                                             const void *data, const RID &rid, SizeType version) {
+        if (fileHandle.pageLayout == LayoutPax) return updatePaxRecord(fileHandle, recordDescriptor, data, rid, version);
+        if (fileHandle.pageLayout == LayoutColumnar) return updateColumnarRecord(fileHandle, recordDescriptor, data, rid, version);
         // get length of what new record will be for comparison to current record
-        SizeType newRecoLen = calcRecordSpace(recordDescriptor, data) - BYTES_FOR_SLOT_DIR_ENTRY;
+        const RecordLayout * layout = fileRecordLayout(fileHandle, recordDescriptor);
+        SizeType newRecoLen = calcRecordSpace(recordDescriptor, data, layout) - BYTES_FOR_SLOT_DIR_ENTRY;
         if (newRecoLen > MAX_RECORD_SIZE) return -1;  // updated record cannot fit on a page
         // initialize variables for page, record offset on page, current record's length, slot number it's using
         char pageData[PAGE_SIZE];
@@ -501,47 +696,389 @@ namespace PeterDB {
         if (findRealRecord(fileHandle, pageData, pageNum, slotNum, recoOffset, recoLen, false) == -1) return -1;
         SizeType freeSpace;
         getFreeSpace(&freeSpace, pageData);
+        char oldRecord[recoLen];
+        memmove(oldRecord, pageData + recoOffset, recoLen);
+        bool relocated = false;
 
         if (newRecoLen < recoLen) {
             // updated record will be shorter, so shift page's records to the left
             shiftRecordsLeft(recoOffset + recoLen, recoLen - newRecoLen, pageData);
-            embedRecord(recoOffset, recordDescriptor, data, pageData, version);
+            embedRecord(recoOffset, recordDescriptor, data, pageData, version, layout);
         } else if (newRecoLen > recoLen) {
             SizeType diff = newRecoLen - recoLen;
             if (diff <= freeSpace) {
                 // if there is enough free space, shift records over and put in updated record
                 shiftRecordsRight(recoOffset + recoLen, diff, pageData);
-                embedRecord(recoOffset, recordDescriptor, data, pageData, version);
+                embedRecord(recoOffset, recordDescriptor, data, pageData, version, layout);
             } else {
                 // if not enough space, make this record a tombstone then put updated record on new page
                 RID newRid;
-                if (insertRecord(fileHandle, recordDescriptor, data, newRid) == -1) return -1;
+                if (insertRecord(fileHandle, recordDescriptor, data, newRid, version) == -1) return -1;
                 memset(pageData + recoOffset, 1, TOMBSTONE_BYTE);
                 memmove(pageData + (recoOffset + TOMBSTONE_BYTE), &newRid.pageNum, BYTES_FOR_PAGE_NUM);
                 memmove(pageData + (recoOffset + TOMBSTONE_BYTE + BYTES_FOR_PAGE_NUM), &newRid.slotNum, BYTES_FOR_SLOT_NUM);
                 newRecoLen = recoLen;
+                relocated = true;
             }
         } else
-            embedRecord(recoOffset, recordDescriptor, data, pageData, version);
+            embedRecord(recoOffset, recordDescriptor, data, pageData, version, layout);
 
+        // the new values are added to the zone map before the write and the old ones removed after it
+        if (!relocated && updateZoneMap(fileHandle, recordDescriptor, pageNum, pageData + recoOffset, false) == -1) return -1;
         setSlotLen(&newRecoLen, slotNum, pageData);
-        RC writeStatus = fileHandle.writePage(pageNum, pageData);
-        return writeStatus;
+        if (fileHandle.writePage(pageNum, pageData) == -1) return -1;
+        return updateZoneMap(fileHandle, recordDescriptor, pageNum, oldRecord, true);
+    }
+
+    unsigned RecordBasedFileManager::spliceAttribute(const std::vector<Attribute> &recordDescriptor, const void * data,
+                                                     SizeType attrIndex, const void * value, void * out) {
+        // copy the record with one attribute replaced by a value in readAttribute() format, returning its length
+        SizeType nullFlagBytes = nullBytesNeeded(recordDescriptor.size());
+        const char * dataPos = static_cast<const char *>(data) + nullFlagBytes;
+        char * outPos = static_cast<char *>(out) + nullFlagBytes;
+        memmove(out, data, nullFlagBytes);
+        unsigned char * nullByte = static_cast<unsigned char *>(out) + attrIndex / BITS_IN_BYTE;
+        unsigned char nullBit = 128 >> (attrIndex % BITS_IN_BYTE);
+        bool valueIsNull = *static_cast<const unsigned char *>(value) & 128;
+        *nullByte = valueIsNull ? *nullByte | nullBit : *nullByte & ~nullBit;
+
+        for (SizeType i = 0; i < recordDescriptor.size(); ++i) {
+            SizeType fieldBytes = 0;
+            if (!nullBitOn(static_cast<const char *>(data)[i / BITS_IN_BYTE], i % BITS_IN_BYTE + 1)) {
+                fieldBytes = recordDescriptor[i].length;
+                if (recordDescriptor[i].type == TypeVarChar) {
+                    int varcharLen;
+                    memmove(&varcharLen, dataPos, INT_BYTES);
+                    fieldBytes = INT_BYTES + varcharLen;
+                }
+            }
+            if (i == attrIndex) {
+                if (!valueIsNull) {
+                    const char * valuePos = static_cast<const char *>(value) + 1;
+                    SizeType valueBytes = recordDescriptor[i].length;
+                    if (recordDescriptor[i].type == TypeVarChar) {
+                        int varcharLen;
+                        memmove(&varcharLen, valuePos, INT_BYTES);
+                        valueBytes = INT_BYTES + varcharLen;
+                    }
+                    memmove(outPos, valuePos, valueBytes);
+                    outPos += valueBytes;
+                }
+            } else {
+                memmove(outPos, dataPos, fieldBytes);
+                outPos += fieldBytes;
+            }
+            dataPos += fieldBytes;
+        }
+        return outPos - static_cast<char *>(out);
+    }
+
+    RC RecordBasedFileManager::updateAttribute(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const RID &rid,
+                                               const std::string &attributeName, const void *data, SizeType version) {
+        if (fileHandle.pageLayout != LayoutSlotted) return -1;
+        SizeType attrIndex = 0;
+        while (attrIndex < recordDescriptor.size() && attributeName != recordDescriptor[attrIndex].name) ++attrIndex;
+        if (attrIndex == recordDescriptor.size()) return -1;
+
+        char pageData[PAGE_SIZE];
+        unsigned pageNum = rid.pageNum;
+        unsigned short slotNum = rid.slotNum;
+        SizeType recoOffset, recoLen, recoVersion;
+        if (findRealRecord(fileHandle, pageData, pageNum, slotNum, recoOffset, recoLen, false) == -1) return -1;
+        memmove(&recoVersion, pageData + (recoOffset + TOMBSTONE_BYTE), BYTES_FOR_VERSION_NUM);
+        if (recoVersion != version) return -1;  // the record's fields do not follow recordDescriptor
+
+        // the attribute's bytes run from its field offset to the next field's offset, or to the end of the record
+        char * recoStart = pageData + recoOffset;
+        SizeType numFields = recordDescriptor.size();
+        SizeType nullFlagBytes = nullBytesNeeded(numFields);
+        char * fieldOffsets = recoStart + (BYTES_BEFORE_NULL_FLAGS + nullFlagBytes);
+        SizeType fieldStart, fieldEnd = recoLen;
+        memmove(&fieldStart, fieldOffsets + BYTES_FOR_POINTER_TO_RECORD_FIELD * attrIndex, BYTES_FOR_POINTER_TO_RECORD_FIELD);
+        if (attrIndex + 1 < numFields)
+            memmove(&fieldEnd, fieldOffsets + BYTES_FOR_POINTER_TO_RECORD_FIELD * (attrIndex + 1), BYTES_FOR_POINTER_TO_RECORD_FIELD);
+
+        bool valueIsNull = *static_cast<const unsigned char *>(data) & 128;
+        const char * valuePos = static_cast<const char *>(data) + 1;
+        SizeType valueBytes = 0;
+        if (!valueIsNull) {
+            valueBytes = recordDescriptor[attrIndex].length;
+            if (recordDescriptor[attrIndex].type == TypeVarChar) {
+                int varcharLen;
+                memmove(&varcharLen, valuePos, INT_BYTES);
+                valueBytes = INT_BYTES + varcharLen;
+            }
+        }
+        SizeType freeSpace;
+        getFreeSpace(&freeSpace, pageData);
+        SizeType fieldBytes = fieldEnd - fieldStart;
+        if (valueBytes > fieldBytes && valueBytes - fieldBytes > freeSpace) {
+            // the grown record has to move off the page, which updateRecord already handles
+            char record[PAGE_SIZE], updated[PAGE_SIZE];
+            if (readRecord(fileHandle, recordDescriptor, rid, record) == -1) return -1;
+            spliceAttribute(recordDescriptor, record, attrIndex, data, updated);
+            return updateRecord(fileHandle, recordDescriptor, updated, rid, version);
+        }
+
+        char oldRecord[recoLen];
+        memmove(oldRecord, recoStart, recoLen);
+        if (valueBytes != fieldBytes) {
+            // only a change of length moves the rest of the page, and the offsets of the fields after this one
+            if (valueBytes < fieldBytes)
+                shiftRecordsLeft(recoOffset + fieldEnd, fieldBytes - valueBytes, pageData);
+            else
+                shiftRecordsRight(recoOffset + fieldEnd, valueBytes - fieldBytes, pageData);
+            for (SizeType i = attrIndex + 1; i < numFields; ++i) {
+                SizeType offset;
+                memmove(&offset, fieldOffsets + BYTES_FOR_POINTER_TO_RECORD_FIELD * i, BYTES_FOR_POINTER_TO_RECORD_FIELD);
+                offset = offset + valueBytes - fieldBytes;
+                memmove(fieldOffsets + BYTES_FOR_POINTER_TO_RECORD_FIELD * i, &offset, BYTES_FOR_POINTER_TO_RECORD_FIELD);
+            }
+            recoLen = recoLen + valueBytes - fieldBytes;
+            setSlotLen(&recoLen, slotNum, pageData);
+        }
+        memmove(recoStart + fieldStart, valuePos, valueBytes);
+        unsigned char * nullByte = reinterpret_cast<unsigned char *>(recoStart + (BYTES_BEFORE_NULL_FLAGS + attrIndex / BITS_IN_BYTE));
+        unsigned char nullBit = 128 >> (attrIndex % BITS_IN_BYTE);
+        *nullByte = valueIsNull ? *nullByte | nullBit : *nullByte & ~nullBit;
+
+        if (updateZoneMap(fileHandle, recordDescriptor, pageNum, recoStart, false) == -1) return -1;
+        if (fileHandle.writePage(pageNum, pageData) == -1) return -1;
+        return updateZoneMap(fileHandle, recordDescriptor, pageNum, oldRecord, true);
+    }
+
+    RC RecordBasedFileManager::getPageRecords(FileHandle &fileHandle, unsigned pageNum, std::vector<RID> &rids, std::vector<SizeType> &versions,
+                                              void *data, std::vector<unsigned> *offsets) {
+        if (fileHandle.pageLayout != LayoutSlotted) return -1;
+        rids.clear();
+        versions.clear();
+        if (offsets) offsets->clear();
+        unsigned used = 0;
+        char pageData[PAGE_SIZE];
+        if (fileHandle.readPage(pageNum, pageData) == -1) return -1;
+
+        SizeType slotCount, recoOffset, recoLen, version;
+        unsigned char tombstoneCheck;
+        getSlotCount(&slotCount, pageData);
+        for (SizeType slotNum = 1; slotNum <= slotCount; ++slotNum) {
+            getSlotOffsetAndLen(&recoOffset, &recoLen, slotNum, pageData);
+            if (recoLen == 0) continue;
+            memmove(&tombstoneCheck, pageData + recoOffset, TOMBSTONE_BYTE);
+            if (tombstoneCheck == 1) continue;
+            memmove(&version, pageData + (recoOffset + TOMBSTONE_BYTE), BYTES_FOR_VERSION_NUM);
+            rids.push_back(RID{pageNum, static_cast<unsigned short>(slotNum)});
+            versions.push_back(version);
+            if (data == nullptr) continue;
+            offsets->push_back(used);
+            used += decodeRecord(pageData + recoOffset, recoLen, static_cast<char *>(data) + used);
+        }
+        return 0;
+    }
+
+    RC RecordBasedFileManager::sampleRecords(FileHandle &fileHandle, unsigned maxPages, unsigned sampleSize, unsigned seed,
+                                             std::vector<RID> &rids, SampleStats &stats) {
+        rids.clear();
+        stats = SampleStats{};
+        if (fileHandle.pageLayout != LayoutSlotted) return -1;
+        stats.pagesInFile = fileHandle.pageCount;
+        std::mt19937 random(seed);
+
+        // pick distinct pages with Floyd's algorithm, which takes time in the number picked, not in the file size
+        std::set<unsigned> pages;
+        unsigned pageCount = fileHandle.pageCount;
+        for (unsigned upper = pageCount - std::min(maxPages, pageCount); upper < pageCount; ++upper) {
+            unsigned pageNum = std::uniform_int_distribution<unsigned>(0, upper)(random);
+            if (!pages.insert(pageNum).second) pages.insert(upper);
+        }
+
+        // reservoir sampling keeps every record seen equally likely to be drawn
+        std::vector<RID> pageRids;
+        std::vector<SizeType> versions;
+        for (unsigned pageNum : pages) {
+            if (getPageRecords(fileHandle, pageNum, pageRids, versions) == -1) return -1;
+            ++stats.pagesSampled;
+            for (const RID &rid : pageRids) {
+                if (rids.size() < sampleSize)
+                    rids.push_back(rid);
+                else {
+                    unsigned pick = std::uniform_int_distribution<unsigned>(0, stats.recordsSeen)(random);
+                    if (pick < sampleSize) rids[pick] = rid;
+                }
+                ++stats.recordsSeen;
+            }
+        }
+        return 0;
+    }
+
+    RC RecordBasedFileManager::removeTombstone(FileHandle &fileHandle, const RID &tombstone) {
+        char pageData[PAGE_SIZE];
+        SizeType recoOffset, recoLen;
+        if (fileHandle.readPage(tombstone.pageNum, pageData) == -1) return -1;
+        getSlotOffsetAndLen(&recoOffset, &recoLen, tombstone.slotNum, pageData);
+        return deleteTombstone(fileHandle, pageData, tombstone.pageNum, tombstone.slotNum, recoOffset, recoLen);
+    }
+
+    RC RecordBasedFileManager::setTombstoneTarget(FileHandle &fileHandle, const RID &tombstone, const RID &target) {
+        char pageData[PAGE_SIZE];
+        SizeType recoOffset;
+        if (fileHandle.readPage(tombstone.pageNum, pageData) == -1) return -1;
+        getSlotOffset(&recoOffset, tombstone.slotNum, pageData);
+        memmove(pageData + (recoOffset + TOMBSTONE_BYTE), &target.pageNum, BYTES_FOR_PAGE_NUM);
+        memmove(pageData + (recoOffset + TOMBSTONE_BYTE + BYTES_FOR_PAGE_NUM), &target.slotNum, BYTES_FOR_SLOT_NUM);
+        return fileHandle.writePage(tombstone.pageNum, pageData);
+    }
+
+    void RecordBasedFileManager::findChains(const std::map<RID, RID> &forwards, ChainStats &stats,
+                                            std::vector<std::vector<RID>> &chains, std::vector<RID> &ends) {
+        stats.tombstones = forwards.size();
+
+        // chains start at the tombstones no other tombstone forwards to, i.e. at the RIDs handed out by insertRecord
+        std::set<RID> forwarded;
+        for (const auto &forward : forwards)
+            forwarded.insert(forward.second);
+        for (const auto &forward : forwards) {
+            if (forwarded.find(forward.first) != forwarded.end()) continue;
+            std::vector<RID> chain;
+            RID end = forward.first;
+            for (auto next = forwards.find(end); next != forwards.end() && chain.size() < forwards.size(); next = forwards.find(end)) {
+                chain.push_back(end);
+                end = next->second;
+            }
+
+            ++stats.chains;
+            if (stats.chainLengths.size() <= chain.size()) stats.chainLengths.resize(chain.size() + 1);
+            ++stats.chainLengths[chain.size()];
+            if (chain.size() > stats.maxChainLength) stats.maxChainLength = chain.size();
+            chains.push_back(std::move(chain));
+            ends.push_back(end);
+        }
+    }
+
+    RC RecordBasedFileManager::vacuum(FileHandle &fileHandle, ChainStats &stats, bool reportOnly) {
+        stats = ChainStats{};
+        if (fileHandle.pageLayout != LayoutSlotted) return 0;  // other layouts update in place and never forward
+
+        // map every tombstone to the location it forwards to
+        std::map<RID, RID> forwards;
+        char pageData[PAGE_SIZE];
+        SizeType slotCount, recoOffset, recoLen;
+        unsigned char tombstoneCheck;
+        for (unsigned pageNum = 0; pageNum < fileHandle.pageCount; ++pageNum) {
+            if (fileHandle.readPage(pageNum, pageData) == -1) return -1;
+            getSlotCount(&slotCount, pageData);
+            for (SizeType slotNum = 1; slotNum <= slotCount; ++slotNum) {
+                getSlotOffsetAndLen(&recoOffset, &recoLen, slotNum, pageData);
+                if (recoLen == 0) continue;
+                memmove(&tombstoneCheck, pageData + recoOffset, TOMBSTONE_BYTE);
+                if (tombstoneCheck == 0) continue;
+                RID &target = forwards[RID{pageNum, static_cast<unsigned short>(slotNum)}];
+                memmove(&target.pageNum, pageData + (recoOffset + TOMBSTONE_BYTE), BYTES_FOR_PAGE_NUM);
+                memmove(&target.slotNum, pageData + (recoOffset + TOMBSTONE_BYTE + BYTES_FOR_PAGE_NUM), BYTES_FOR_SLOT_NUM);
+            }
+        }
+
+        std::vector<std::vector<RID>> chains;
+        std::vector<RID> ends;
+        findChains(forwards, stats, chains, ends);
+        if (reportOnly) return 0;
+
+        for (size_t c = 0; c < chains.size(); ++c) {
+            const std::vector<RID> &chain = chains[c];
+            const RID &end = ends[c];
+
+            // a chain leading to a deleted record is removed whole, otherwise its head points straight at the record
+            recoLen = 0;
+            if (end.pageNum < fileHandle.pageCount) {
+                if (fileHandle.readPage(end.pageNum, pageData) == -1) return -1;
+                getSlotCount(&slotCount, pageData);
+                if (end.slotNum >= 1 && end.slotNum <= slotCount) getSlotLen(&recoLen, end.slotNum, pageData);
+            }
+            size_t keep = recoLen == 0 ? 0 : 1;
+            if (keep == 1 && chain.size() > 1) {
+                if (setTombstoneTarget(fileHandle, chain[0], end) == -1) return -1;
+                ++stats.collapsed;
+            }
+            for (size_t i = keep; i < chain.size(); ++i) {
+                if (removeTombstone(fileHandle, chain[i]) == -1) return -1;
+                ++stats.reclaimed;
+            }
+        }
+        return 0;
+    }
+
+    RC RecordBasedFileManager::analyze(FileHandle &fileHandle, HeapStats &stats) {
+        stats = HeapStats{};
+        if (fileHandle.pageLayout != LayoutSlotted) return -1;
+        stats.pages = fileHandle.pageCount;
+        stats.fillHistogram.assign(HEAP_FILL_BUCKETS, 0);
+
+        std::map<RID, RID> forwards;
+        std::vector<SizeType> pageFreeSpace(fileHandle.pageCount);
+        unsigned long recordBytes = 0;
+        char pageData[PAGE_SIZE];
+        SizeType freeSpace, slotCount, recoOffset, recoLen, version;
+        unsigned char tombstoneCheck;
+        for (unsigned pageNum = 0; pageNum < fileHandle.pageCount; ++pageNum) {
+            if (fileHandle.readPage(pageNum, pageData) == -1) return -1;
+            getFreeSpaceAndSlotCount(&freeSpace, &slotCount, pageData);
+            pageFreeSpace[pageNum] = freeSpace;
+            stats.freeBytes += freeSpace;
+            unsigned bucket = (PAGE_SIZE - freeSpace) * HEAP_FILL_BUCKETS / PAGE_SIZE;
+            ++stats.fillHistogram[std::min(bucket, HEAP_FILL_BUCKETS - 1u)];
+
+            for (SizeType slotNum = 1; slotNum <= slotCount; ++slotNum) {
+                getSlotOffsetAndLen(&recoOffset, &recoLen, slotNum, pageData);
+                if (recoLen == 0) {
+                    ++stats.emptySlots;
+                    stats.reclaimableBytes += BYTES_FOR_SLOT_DIR_ENTRY;
+                    continue;
+                }
+                memmove(&tombstoneCheck, pageData + recoOffset, TOMBSTONE_BYTE);
+                if (tombstoneCheck == 1) {
+                    RID &target = forwards[RID{pageNum, static_cast<unsigned short>(slotNum)}];
+                    memmove(&target.pageNum, pageData + (recoOffset + TOMBSTONE_BYTE), BYTES_FOR_PAGE_NUM);
+                    memmove(&target.slotNum, pageData + (recoOffset + TOMBSTONE_BYTE + BYTES_FOR_PAGE_NUM), BYTES_FOR_SLOT_NUM);
+                    stats.reclaimableBytes += recoLen + BYTES_FOR_SLOT_DIR_ENTRY;
+                    continue;
+                }
+                memmove(&version, pageData + (recoOffset + TOMBSTONE_BYTE), BYTES_FOR_VERSION_NUM);
+                if (stats.versions.size() <= version) stats.versions.resize(version + 1);
+                ++stats.versions[version];
+                ++stats.records;
+                recordBytes += recoLen + BYTES_FOR_SLOT_DIR_ENTRY;
+            }
+        }
+
+        // free space too small for a record of average size is left to smaller records and to records growing in place
+        if (stats.records > 0) {
+            unsigned long averageRecord = recordBytes / stats.records;
+            for (SizeType pageFree : pageFreeSpace)
+                if (pageFree < averageRecord) stats.fragmentedBytes += pageFree;
+        }
+
+        std::vector<std::vector<RID>> chains;
+        std::vector<RID> ends;
+        findChains(forwards, stats.chains, chains, ends);
+        return 0;
     }
 
     RC RecordBasedFileManager::readAttribute(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
                                              const RID &rid, const std::string &attributeName, void *data, SizeType *version) {
+        if (fileHandle.pageLayout != LayoutSlotted) {
+            int attrIndex = 0;
+            while (attrIndex < recordDescriptor.size() && attributeName != recordDescriptor[attrIndex].name) ++attrIndex;
+            if (fileHandle.pageLayout == LayoutColumnar)
+                return readColumnarAttribute(fileHandle, recordDescriptor, rid, attrIndex, data, version);
+            return readPaxAttribute(fileHandle, recordDescriptor, rid, attrIndex, data, version);
+        }
         char pageData[PAGE_SIZE];
         unsigned short startingSlot = rid.slotNum;
         unsigned startingPage = rid.pageNum;
         SizeType recoOffset, recoLen;
         if (findRealRecord(fileHandle, pageData, startingPage, startingSlot, recoOffset, recoLen, false) == -1) return -1;
-        if (version != nullptr) {
-            memmove(version, pageData + recoOffset + TOMBSTONE_BYTE, BYTES_FOR_VERSION_NUM);
-            return 0;
-        }
+        if (version != nullptr) memmove(version, pageData + recoOffset + TOMBSTONE_BYTE, BYTES_FOR_VERSION_NUM);
 
-        int attrIndex;
+        SizeType attrIndex;
         AttrType attrType;
         AttrLength attrLen;
 
@@ -554,11 +1091,14 @@ namespace PeterDB {
         }
         if (attrIndex == recordDescriptor.size()) return -1;
 
+        // the record's own field count locates its directory, so records of other versions are read safely
+        SizeType numFields;
+        memmove(&numFields, pageData + (recoOffset + TOMBSTONE_BYTE + BYTES_FOR_VERSION_NUM), BYTES_FOR_RECORD_FIELD_COUNT);
         SizeType nullFlagBytesBeforeAttr = nullBytesNeeded(attrIndex + 1) - 1;
         unsigned char nullByte;
         memmove(&nullByte, pageData + (recoOffset + BYTES_BEFORE_NULL_FLAGS + nullFlagBytesBeforeAttr), 1);
 
-        if (nullBitOn(nullByte, attrIndex % BITS_IN_BYTE + 1)) {
+        if (attrIndex >= numFields || nullBitOn(nullByte, attrIndex % BITS_IN_BYTE + 1)) {
             memset(data, 128, 1);
             return 0;
         }
@@ -566,7 +1106,7 @@ namespace PeterDB {
         data = static_cast<char *>(data) + 1;
 
         SizeType attrOffset;
-        memmove(&attrOffset, pageData + (recoOffset + BYTES_BEFORE_NULL_FLAGS + nullBytesNeeded(recordDescriptor.size()) + BYTES_FOR_POINTER_TO_RECORD_FIELD * attrIndex), BYTES_FOR_POINTER_TO_RECORD_FIELD);
+        memmove(&attrOffset, pageData + (recoOffset + BYTES_BEFORE_NULL_FLAGS + nullBytesNeeded(numFields) + BYTES_FOR_POINTER_TO_RECORD_FIELD * attrIndex), BYTES_FOR_POINTER_TO_RECORD_FIELD);
         char * attrLocation = pageData + (recoOffset + attrOffset);
 
         if (attrType == TypeVarChar) {
@@ -580,15 +1120,726 @@ namespace PeterDB {
         return 0;
     }
 
+    RC RecordBasedFileManager::readAttributes(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const RID &rid,
+                                              const std::vector<int> &attrIndexes, void *data, SizeType *version) {
+        for (int attrIndex : attrIndexes)
+            if (attrIndex < 0 || attrIndex >= static_cast<int>(recordDescriptor.size())) return -1;
+
+        std::vector<const char *> fields;
+        char pageData[PAGE_SIZE];
+        if (fileHandle.pageLayout != LayoutSlotted) {
+            if (readRecord(fileHandle, recordDescriptor, rid, pageData, version) == -1) return -1;
+            locateFields(recordDescriptor, pageData, fields);
+        } else {
+            unsigned pageNum = rid.pageNum;
+            unsigned short slotNum = rid.slotNum;
+            SizeType recoOffset, recoLen, attrOffset, numFields;
+            if (findRealRecord(fileHandle, pageData, pageNum, slotNum, recoOffset, recoLen, false) == -1) return -1;
+            // the field directory points straight at the wanted fields, the record's own field count locating it
+            const char *recoStart = pageData + recoOffset;
+            if (version != nullptr) memmove(version, recoStart + TOMBSTONE_BYTE, BYTES_FOR_VERSION_NUM);
+            memmove(&numFields, recoStart + (TOMBSTONE_BYTE + BYTES_FOR_VERSION_NUM), BYTES_FOR_RECORD_FIELD_COUNT);
+            const char *recordNulls = recoStart + BYTES_BEFORE_NULL_FLAGS;
+            const char *recordDir = recordNulls + nullBytesNeeded(numFields);
+            fields.assign(recordDescriptor.size(), nullptr);
+            for (int attrIndex : attrIndexes) {
+                if (attrIndex >= numFields || nullBitOn(recordNulls[attrIndex / BITS_IN_BYTE], attrIndex % BITS_IN_BYTE + 1)) continue;
+                memmove(&attrOffset, recordDir + BYTES_FOR_POINTER_TO_RECORD_FIELD * attrIndex, BYTES_FOR_POINTER_TO_RECORD_FIELD);
+                fields[attrIndex] = recoStart + attrOffset;
+            }
+        }
+        projectFields(recordDescriptor, fields, attrIndexes, data);
+        return 0;
+    }
+
+    void RecordBasedFileManager::locateFields(const std::vector<Attribute> &recordDescriptor, const void * data, std::vector<const char *> &fields) {
+        // start of each non-null field of a record in the insertRecord() format, nullptr for null fields
+        fields.assign(recordDescriptor.size(), nullptr);
+        const char *fieldPos = static_cast<const char *>(data) + nullBytesNeeded(recordDescriptor.size());
+        for (SizeType i = 0; i < recordDescriptor.size(); ++i) {
+            if (nullBitOn(static_cast<const char *>(data)[i / BITS_IN_BYTE], i % BITS_IN_BYTE + 1)) continue;
+            fields[i] = fieldPos;
+            if (recordDescriptor[i].type == TypeVarChar) {
+                int varcharLen;
+                memmove(&varcharLen, fieldPos, INT_BYTES);
+                fieldPos += INT_BYTES + varcharLen;
+            } else
+                fieldPos += recordDescriptor[i].length;
+        }
+    }
+
+    void RecordBasedFileManager::projectFields(const std::vector<Attribute> &recordDescriptor, const std::vector<const char *> &fields,
+                                               const std::vector<int> &attrIndexes, void * data) {
+        SizeType nullFlagBytes = nullBytesNeeded(attrIndexes.size());
+        unsigned char nullBytes[nullFlagBytes];
+        memset(nullBytes, 0, nullFlagBytes);
+        char *dataPtr = static_cast<char *>(data) + nullFlagBytes;
+        for (SizeType i = 0; i < attrIndexes.size(); ++i) {
+            const Attribute &attr = recordDescriptor[attrIndexes[i]];
+            const char *field = fields[attrIndexes[i]];
+            if (field == nullptr) {
+                nullBytes[i / BITS_IN_BYTE] |= 1 << (BITS_IN_BYTE - i % BITS_IN_BYTE - 1);
+                continue;
+            }
+            int fieldBytes = attr.length;
+            if (attr.type == TypeVarChar) {
+                memmove(&fieldBytes, field, INT_BYTES);
+                fieldBytes += INT_BYTES;
+            }
+            memmove(dataPtr, field, fieldBytes);
+            dataPtr += fieldBytes;
+        }
+        memmove(data, nullBytes, nullFlagBytes);
+    }
+
+    void RecordBasedFileManager::getPaxGeometry(const std::vector<Attribute> &recordDescriptor, PaxGeometry &geometry) {
+        // every slot needs its fixed value widths, plus a presence bit and one null bit per attribute
+        SizeType numFields = recordDescriptor.size();
+        unsigned rowBytes = 0;
+        geometry.fieldWidths.clear();
+        for (const Attribute &attr : recordDescriptor) {
+            geometry.fieldWidths.push_back(attr.type == TypeVarChar ? INT_BYTES + attr.length : attr.length);
+            rowBytes += geometry.fieldWidths.back();
+        }
+
+        // start from the bit-level estimate, then back off until the rounded up bitmaps also fit
+        unsigned capacity = (PAGE_SIZE - BYTES_FOR_PAX_HEADER) * BITS_IN_BYTE / (BITS_IN_BYTE * rowBytes + 1 + numFields);
+        while (capacity > 0 && BYTES_FOR_PAX_HEADER + nullBytesNeeded(capacity) * (1 + numFields) + capacity * rowBytes > PAGE_SIZE)
+            --capacity;
+        geometry.capacity = capacity;
+        geometry.bitmapBytes = nullBytesNeeded(capacity);
+
+        // minipages follow the header and presence bitmap, in attribute order
+        geometry.minipageOffsets.clear();
+        SizeType offset = BYTES_FOR_PAX_HEADER + geometry.bitmapBytes;
+        for (SizeType width : geometry.fieldWidths) {
+            geometry.minipageOffsets.push_back(offset);
+            offset += geometry.bitmapBytes + capacity * width;
+        }
+    }
+
+    void RecordBasedFileManager::getPaxHeader(SizeType * version, SizeType * capacity, SizeType * recordCount, const void * pageData) {
+        const char * header = static_cast<const char *>(pageData);
+        if (version != nullptr) memmove(version, header, BYTES_FOR_VERSION_NUM);
+        if (capacity != nullptr) memmove(capacity, header + BYTES_FOR_VERSION_NUM, BYTES_FOR_PAX_CAPACITY);
+        if (recordCount != nullptr) memmove(recordCount, header + (BYTES_FOR_VERSION_NUM + BYTES_FOR_PAX_CAPACITY), BYTES_FOR_PAX_RECORD_COUNT);
+    }
+
+    void RecordBasedFileManager::setPaxRecordCount(SizeType * recordCount, void * pageData) {
+        memmove(static_cast<char *>(pageData) + (BYTES_FOR_VERSION_NUM + BYTES_FOR_PAX_CAPACITY), recordCount, BYTES_FOR_PAX_RECORD_COUNT);
+    }
+
+    void RecordBasedFileManager::initPaxPage(const PaxGeometry &geometry, void * pageData, SizeType version) {
+        memset(pageData, 0, PAGE_SIZE);
+        memmove(pageData, &version, BYTES_FOR_VERSION_NUM);
+        memmove(static_cast<char *>(pageData) + BYTES_FOR_VERSION_NUM, &geometry.capacity, BYTES_FOR_PAX_CAPACITY);
+    }
+
+    bool RecordBasedFileManager::paxBitOn(const char * bitmap, SizeType index) {
+        // index starts from 0, bits are ordered from the left like the null flags
+        return nullBitOn(bitmap[index / BITS_IN_BYTE], index % BITS_IN_BYTE + 1);
+    }
+
+    void RecordBasedFileManager::setPaxBit(char * bitmap, SizeType index, bool on) {
+        unsigned char mask = 1 << (BITS_IN_BYTE - index % BITS_IN_BYTE - 1);
+        if (on)
+            bitmap[index / BITS_IN_BYTE] |= mask;
+        else
+            bitmap[index / BITS_IN_BYTE] &= ~mask;
+    }
+
+    bool RecordBasedFileManager::paxSlotUsed(SizeType slotNum, const void * pageData) {
+        SizeType capacity;
+        getPaxHeader(nullptr, &capacity, nullptr, pageData);
+        if (slotNum == 0 || slotNum > capacity) return false;
+        return paxBitOn(static_cast<const char *>(pageData) + BYTES_FOR_PAX_HEADER, slotNum - 1);
+    }
+
+    bool RecordBasedFileManager::paxRecordFits(const std::vector<Attribute> &recordDescriptor, const void * data) {
+        // values are stored at fixed width, so a varchar may not exceed its declared length
+        SizeType nullFlagBytes = nullBytesNeeded(recordDescriptor.size());
+        const char * dataPos = static_cast<const char *>(data) + nullFlagBytes;
+        for (int i = 0; i < recordDescriptor.size(); ++i) {
+            if (nullBitOn(static_cast<const char *>(data)[i / BITS_IN_BYTE], i % BITS_IN_BYTE + 1)) continue;
+            if (recordDescriptor[i].type != TypeVarChar) {
+                dataPos += recordDescriptor[i].length;
+                continue;
+            }
+            int varcharLen;
+            memmove(&varcharLen, dataPos, INT_BYTES);
+            if (varcharLen < 0 || varcharLen > recordDescriptor[i].length) return false;
+            dataPos += INT_BYTES + varcharLen;
+        }
+        return true;
+    }
+
+    const char * RecordBasedFileManager::paxFieldLocation(const PaxGeometry &geometry, const char * pageData, int attrIndex, SizeType slotNum) {
+        // returns nullptr when the field is null
+        const char * minipage = pageData + geometry.minipageOffsets[attrIndex];
+        if (paxBitOn(minipage, slotNum - 1)) return nullptr;
+        return minipage + geometry.bitmapBytes + (slotNum - 1) * geometry.fieldWidths[attrIndex];
+    }
+
+    void RecordBasedFileManager::embedPaxRecord(const std::vector<Attribute> &recordDescriptor, const PaxGeometry &geometry,
+                                                const void * data, char * pageData, SizeType slotNum) {
+        SizeType nullFlagBytes = nullBytesNeeded(recordDescriptor.size());
+        const char * dataPos = static_cast<const char *>(data) + nullFlagBytes;
+
+        for (int i = 0; i < recordDescriptor.size(); ++i) {
+            char * minipage = pageData + geometry.minipageOffsets[i];
+            bool isNull = nullBitOn(static_cast<const char *>(data)[i / BITS_IN_BYTE], i % BITS_IN_BYTE + 1);
+            setPaxBit(minipage, slotNum - 1, isNull);
+            if (isNull) continue;
+
+            SizeType fieldBytes = recordDescriptor[i].length;
+            if (recordDescriptor[i].type == TypeVarChar) {
+                int varcharLen;
+                memmove(&varcharLen, dataPos, INT_BYTES);
+                fieldBytes = INT_BYTES + varcharLen;
+            }
+            memmove(minipage + geometry.bitmapBytes + (slotNum - 1) * geometry.fieldWidths[i], dataPos, fieldBytes);
+            dataPos += fieldBytes;
+        }
+    }
+
+    void RecordBasedFileManager::extractPaxRecord(const std::vector<Attribute> &recordDescriptor, const PaxGeometry &geometry,
+                                                  const char * pageData, SizeType slotNum, void * data) {
+        SizeType nullFlagBytes = nullBytesNeeded(recordDescriptor.size());
+        memset(data, 0, nullFlagBytes);
+        char * dataPos = static_cast<char *>(data) + nullFlagBytes;
+
+        for (int i = 0; i < recordDescriptor.size(); ++i) {
+            const char * field = paxFieldLocation(geometry, pageData, i, slotNum);
+            if (field == nullptr) {
+                setPaxBit(static_cast<char *>(data), i, true);
+                continue;
+            }
+
+            SizeType fieldBytes = recordDescriptor[i].length;
+            if (recordDescriptor[i].type == TypeVarChar) {
+                int varcharLen;
+                memmove(&varcharLen, field, INT_BYTES);
+                fieldBytes = INT_BYTES + varcharLen;
+            }
+            memmove(dataPos, field, fieldBytes);
+            dataPos += fieldBytes;
+        }
+    }
+
+    RC RecordBasedFileManager::readPaxSlot(FileHandle &fileHandle, const RID &rid, char * pageData) {
+        // reads the page of the rid, failing if the slot holds no record
+        if (fileHandle.readPage(rid.pageNum, pageData) == -1) return -1;
+        return paxSlotUsed(rid.slotNum, pageData) ? 0 : -1;
+    }
+
+    RC RecordBasedFileManager::insertPaxRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
+                                               const void *data, RID &rid, SizeType version) {
+        PaxGeometry geometry;
+        getPaxGeometry(recordDescriptor, geometry);
+        if (geometry.capacity == 0 || !paxRecordFits(recordDescriptor, data)) return -1;
+
+        // a page only holds records of one schema version, since its minipages follow that version's descriptor
+        char pageData[PAGE_SIZE];
+        SizeType pageVersion, recordCount;
+        unsigned pageNum = fileHandle.pageCount;
+        if (fileHandle.pageCount > 0) {
+            // try the last page first, then look through earlier pages for a free slot
+            unsigned lastPage = fileHandle.pageCount - 1;
+            if (fileHandle.readPage(lastPage, pageData) == -1) return -1;
+            getPaxHeader(&pageVersion, nullptr, &recordCount, pageData);
+            if (pageVersion == version && recordCount < geometry.capacity) {
+                pageNum = lastPage;
+            } else {
+                for (unsigned p = 0; p < lastPage; ++p) {
+                    if (fileHandle.readPage(p, pageData) == -1) return -1;
+                    getPaxHeader(&pageVersion, nullptr, &recordCount, pageData);
+                    if (pageVersion == version && recordCount < geometry.capacity) {
+                        pageNum = p;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (pageNum == fileHandle.pageCount) {
+            initPaxPage(geometry, pageData, version);
+            recordCount = 0;
+        }
+
+        SizeType slotNum = 1;
+        while (paxSlotUsed(slotNum, pageData)) ++slotNum;
+        setPaxBit(pageData + BYTES_FOR_PAX_HEADER, slotNum - 1, true);
+        ++recordCount;
+        setPaxRecordCount(&recordCount, pageData);
+        embedPaxRecord(recordDescriptor, geometry, data, pageData, slotNum);
+
+        rid.pageNum = pageNum;
+        rid.slotNum = slotNum;
+        if (pageNum == fileHandle.pageCount) return fileHandle.appendPage(pageData);
+        return fileHandle.writePage(pageNum, pageData);
+    }
+
+    RC RecordBasedFileManager::readPaxRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
+                                             const RID &rid, void *data, SizeType *version) {
+        char pageData[PAGE_SIZE];
+        if (readPaxSlot(fileHandle, rid, pageData) == -1) return -1;
+        if (version != nullptr) getPaxHeader(version, nullptr, nullptr, pageData);
+
+        PaxGeometry geometry;
+        getPaxGeometry(recordDescriptor, geometry);
+        extractPaxRecord(recordDescriptor, geometry, pageData, rid.slotNum, data);
+        return 0;
+    }
+
+    RC RecordBasedFileManager::deletePaxRecord(FileHandle &fileHandle, const RID &rid) {
+        char pageData[PAGE_SIZE];
+        if (readPaxSlot(fileHandle, rid, pageData) == -1) return -1;
+
+        // clearing the presence bit frees the slot, the stale values are overwritten by the next insert
+        SizeType recordCount;
+        getPaxHeader(nullptr, nullptr, &recordCount, pageData);
+        --recordCount;
+        setPaxRecordCount(&recordCount, pageData);
+        setPaxBit(pageData + BYTES_FOR_PAX_HEADER, rid.slotNum - 1, false);
+        return fileHandle.writePage(rid.pageNum, pageData);
+    }
+
+    RC RecordBasedFileManager::updatePaxRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
+                                               const void *data, const RID &rid, SizeType version) {
+        char pageData[PAGE_SIZE];
+        if (readPaxSlot(fileHandle, rid, pageData) == -1) return -1;
+
+        // slots are fixed width so updates always happen in place, but only within the page's schema version
+        SizeType pageVersion;
+        getPaxHeader(&pageVersion, nullptr, nullptr, pageData);
+        if (pageVersion != version || !paxRecordFits(recordDescriptor, data)) return -1;
+
+        PaxGeometry geometry;
+        getPaxGeometry(recordDescriptor, geometry);
+        embedPaxRecord(recordDescriptor, geometry, data, pageData, rid.slotNum);
+        return fileHandle.writePage(rid.pageNum, pageData);
+    }
+
+    RC RecordBasedFileManager::readPaxAttribute(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
+                                                const RID &rid, int attrIndex, void *data, SizeType *version) {
+        char pageData[PAGE_SIZE];
+        if (readPaxSlot(fileHandle, rid, pageData) == -1) return -1;
+        if (version != nullptr) getPaxHeader(version, nullptr, nullptr, pageData);
+        if (attrIndex < 0 || attrIndex >= static_cast<int>(recordDescriptor.size())) return -1;
+
+        PaxGeometry geometry;
+        getPaxGeometry(recordDescriptor, geometry);
+        const char * field = paxFieldLocation(geometry, pageData, attrIndex, rid.slotNum);
+        if (field == nullptr) {
+            memset(data, 128, 1);
+            return 0;
+        }
+        memset(data, 0, 1);
+
+        SizeType fieldBytes = recordDescriptor[attrIndex].length;
+        if (recordDescriptor[attrIndex].type == TypeVarChar) {
+            int varcharLen;
+            memmove(&varcharLen, field, INT_BYTES);
+            fieldBytes = INT_BYTES + varcharLen;
+        }
+        memmove(static_cast<char *>(data) + 1, field, fieldBytes);
+        return 0;
+    }
+
+    void RecordBasedFileManager::getColumnarGeometry(const std::vector<Attribute> &recordDescriptor, ColumnarGeometry &geometry) {
+        // the header page holds the presence bitmap and one null bitmap per attribute, so wide tables get smaller row groups
+        SizeType numFields = recordDescriptor.size();
+        unsigned capacity = (PAGE_SIZE - BYTES_FOR_ROW_GROUP_HEADER) / (1 + numFields) * BITS_IN_BYTE;
+        geometry.capacity = capacity < MAX_ROW_GROUP_CAPACITY ? capacity : MAX_ROW_GROUP_CAPACITY;
+        geometry.bitmapBytes = nullBytesNeeded(geometry.capacity);
+
+        // values never straddle a page, so each chunk page holds a whole number of values
+        geometry.groupPages = 1;
+        geometry.chunkOffsets.clear();
+        geometry.fieldWidths.clear();
+        geometry.valuesPerPage.clear();
+        for (const Attribute &attr : recordDescriptor) {
+            SizeType width = attr.type == TypeVarChar ? INT_BYTES + attr.length : attr.length;
+            SizeType perPage = width == 0 || width > PAGE_SIZE ? 0 : PAGE_SIZE / width;
+            if (perPage == 0) {
+                geometry.capacity = 0;
+                return;
+            }
+            geometry.fieldWidths.push_back(width);
+            geometry.valuesPerPage.push_back(perPage);
+            geometry.chunkOffsets.push_back(geometry.groupPages);
+            geometry.groupPages += (geometry.capacity + perPage - 1) / perPage;
+        }
+    }
+
+    void RecordBasedFileManager::getRowGroupHeader(SizeType * version, SizeType * capacity, SizeType * recordCount, unsigned * groupPages, const void * headerData) {
+        // a row group header starts like a PAX page header, followed by the row group's page count
+        getPaxHeader(version, capacity, recordCount, headerData);
+        if (groupPages != nullptr) memmove(groupPages, static_cast<const char *>(headerData) + BYTES_FOR_PAX_HEADER, BYTES_FOR_ROW_GROUP_PAGES);
+    }
+
+    char * RecordBasedFileManager::columnNullBitmap(const ColumnarGeometry &geometry, char * headerData, int attrIndex) {
+        // the presence bitmap comes first, then the null bitmap of each attribute
+        return headerData + BYTES_FOR_ROW_GROUP_HEADER + geometry.bitmapBytes * (attrIndex + 1);
+    }
+
+    unsigned RecordBasedFileManager::columnPageNum(const ColumnarGeometry &geometry, unsigned groupPageNum, int attrIndex, SizeType slotNum) {
+        return groupPageNum + geometry.chunkOffsets[attrIndex] + (slotNum - 1) / geometry.valuesPerPage[attrIndex];
+    }
+
+    SizeType RecordBasedFileManager::columnPageOffset(const ColumnarGeometry &geometry, int attrIndex, SizeType slotNum) {
+        return (slotNum - 1) % geometry.valuesPerPage[attrIndex] * geometry.fieldWidths[attrIndex];
+    }
+
+    RC RecordBasedFileManager::appendRowGroup(FileHandle &fileHandle, const ColumnarGeometry &geometry, char * headerData, SizeType version) {
+        // the whole row group is allocated at once so its chunks stay contiguous
+        memset(headerData, 0, PAGE_SIZE);
+        memmove(headerData, &version, BYTES_FOR_VERSION_NUM);
+        memmove(headerData + BYTES_FOR_VERSION_NUM, &geometry.capacity, BYTES_FOR_PAX_CAPACITY);
+        memmove(headerData + BYTES_FOR_PAX_HEADER, &geometry.groupPages, BYTES_FOR_ROW_GROUP_PAGES);
+        if (fileHandle.appendPage(headerData) == -1) return -1;
+
+        char emptyPage[PAGE_SIZE];
+        memset(emptyPage, 0, PAGE_SIZE);
+        for (unsigned i = 1; i < geometry.groupPages; ++i)
+            if (fileHandle.appendPage(emptyPage) == -1) return -1;
+        return 0;
+    }
+
+    RC RecordBasedFileManager::readRowGroupSlot(FileHandle &fileHandle, const RID &rid, char * headerData) {
+        // reads the row group header of the rid, failing if the slot holds no record
+        if (fileHandle.readPage(rid.pageNum, headerData) == -1) return -1;
+        SizeType capacity;
+        getRowGroupHeader(nullptr, &capacity, nullptr, nullptr, headerData);
+        if (rid.slotNum == 0 || rid.slotNum > capacity) return -1;
+        return paxBitOn(headerData + BYTES_FOR_ROW_GROUP_HEADER, rid.slotNum - 1) ? 0 : -1;
+    }
+
+    RC RecordBasedFileManager::writeColumnarValues(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const ColumnarGeometry &geometry,
+                                                   unsigned groupPageNum, char * headerData, const std::vector<SizeType> &slotNums,
+                                                   const std::vector<const void *> &records) {
+        // null flags are set on the header, which the caller writes back. Values go to their chunk pages one attribute
+        // at a time, and slotNums ascend, so each chunk page is read and written once for all the records.
+        SizeType nullFlagBytes = nullBytesNeeded(recordDescriptor.size());
+        std::vector<const char *> dataPos;
+        for (const void *data : records) dataPos.push_back(static_cast<const char *>(data) + nullFlagBytes);
+        char pageData[PAGE_SIZE];
+
+        for (unsigned i = 0; i < recordDescriptor.size(); ++i) {
+            unsigned loadedPage = 0;
+            bool pageLoaded = false;
+            for (size_t r = 0; r < records.size(); ++r) {
+                bool isNull = nullBitOn(static_cast<const char *>(records[r])[i / BITS_IN_BYTE], i % BITS_IN_BYTE + 1);
+                setPaxBit(columnNullBitmap(geometry, headerData, i), slotNums[r] - 1, isNull);
+                if (isNull) continue;
+
+                SizeType fieldBytes = recordDescriptor[i].length;
+                if (recordDescriptor[i].type == TypeVarChar) {
+                    int varcharLen;
+                    memmove(&varcharLen, dataPos[r], INT_BYTES);
+                    fieldBytes = INT_BYTES + varcharLen;
+                }
+                unsigned pageNum = columnPageNum(geometry, groupPageNum, i, slotNums[r]);
+                if (!pageLoaded || pageNum != loadedPage) {
+                    if (pageLoaded && fileHandle.writePage(loadedPage, pageData) == -1) return -1;
+                    if (fileHandle.readPage(pageNum, pageData) == -1) return -1;
+                    loadedPage = pageNum;
+                    pageLoaded = true;
+                }
+                memmove(pageData + columnPageOffset(geometry, i, slotNums[r]), dataPos[r], fieldBytes);
+                dataPos[r] += fieldBytes;
+            }
+            if (pageLoaded && fileHandle.writePage(loadedPage, pageData) == -1) return -1;
+        }
+        return 0;
+    }
+
+    RC RecordBasedFileManager::readColumnarValue(FileHandle &fileHandle, const ColumnarGeometry &geometry, const Attribute &attr,
+                                                 unsigned groupPageNum, int attrIndex, SizeType slotNum, char * dest, SizeType &fieldBytes) {
+        char pageData[PAGE_SIZE];
+        if (fileHandle.readPage(columnPageNum(geometry, groupPageNum, attrIndex, slotNum), pageData) == -1) return -1;
+        const char * field = pageData + columnPageOffset(geometry, attrIndex, slotNum);
+        fieldBytes = attr.length;
+        if (attr.type == TypeVarChar) {
+            int varcharLen;
+            memmove(&varcharLen, field, INT_BYTES);
+            fieldBytes = INT_BYTES + varcharLen;
+        }
+        memmove(dest, field, fieldBytes);
+        return 0;
+    }
+
+    RC RecordBasedFileManager::findRowGroup(FileHandle &fileHandle, const ColumnarGeometry &geometry, SizeType version,
+                                            char * headerData, unsigned &groupPageNum) {
+        // the row group the last insert went to usually has room, otherwise the headers are walked for one of this
+        // schema version with a free row, and a new one is appended when none has
+        SizeType groupVersion, recordCount;
+        unsigned groupPages;
+        if (fileHandle.insertHint < fileHandle.pageCount) {
+            if (fileHandle.readPage(fileHandle.insertHint, headerData) == -1) return -1;
+            getRowGroupHeader(&groupVersion, nullptr, &recordCount, nullptr, headerData);
+            if (groupVersion == version && recordCount < geometry.capacity) {
+                groupPageNum = fileHandle.insertHint;
+                return 0;
+            }
+        }
+
+        for (groupPageNum = 0; groupPageNum < fileHandle.pageCount; groupPageNum += groupPages) {
+            if (fileHandle.readPage(groupPageNum, headerData) == -1) return -1;
+            getRowGroupHeader(&groupVersion, nullptr, &recordCount, &groupPages, headerData);
+            if (groupVersion == version && recordCount < geometry.capacity) break;
+        }
+        if (groupPageNum >= fileHandle.pageCount) {
+            groupPageNum = fileHandle.pageCount;
+            if (appendRowGroup(fileHandle, geometry, headerData, version) == -1) return -1;
+        }
+        fileHandle.insertHint = groupPageNum;
+        return 0;
+    }
+
+    RC RecordBasedFileManager::insertColumnarRecords(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
+                                                     const std::vector<const void *> &records, std::vector<RID> &rids, SizeType version) {
+        ColumnarGeometry geometry;
+        getColumnarGeometry(recordDescriptor, geometry);
+        if (geometry.capacity == 0) return -1;
+        for (const void *data : records)
+            if (!paxRecordFits(recordDescriptor, data)) return -1;
+
+        // records fill the free rows of one row group after another
+        rids.clear();
+        char headerData[PAGE_SIZE];
+        while (rids.size() < records.size()) {
+            unsigned groupPageNum;
+            if (findRowGroup(fileHandle, geometry, version, headerData, groupPageNum) == -1) return -1;
+            SizeType recordCount;
+            getRowGroupHeader(nullptr, nullptr, &recordCount, nullptr, headerData);
+
+            std::vector<SizeType> slotNums;
+            std::vector<const void *> groupRecords;
+            for (SizeType slotNum = 1; slotNum <= geometry.capacity && rids.size() < records.size(); ++slotNum) {
+                if (paxBitOn(headerData + BYTES_FOR_ROW_GROUP_HEADER, slotNum - 1)) continue;
+                groupRecords.push_back(records[rids.size()]);
+                slotNums.push_back(slotNum);
+                rids.push_back(RID{groupPageNum, slotNum});
+            }
+            if (writeColumnarValues(fileHandle, recordDescriptor, geometry, groupPageNum, headerData, slotNums, groupRecords) == -1) return -1;
+            for (SizeType slotNum : slotNums) setPaxBit(headerData + BYTES_FOR_ROW_GROUP_HEADER, slotNum - 1, true);
+            recordCount += slotNums.size();
+            setPaxRecordCount(&recordCount, headerData);
+            if (fileHandle.writePage(groupPageNum, headerData) == -1) return -1;
+        }
+        return 0;
+    }
+
+    RC RecordBasedFileManager::readColumnarRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
+                                                  const RID &rid, void *data, SizeType *version) {
+        char headerData[PAGE_SIZE];
+        if (readRowGroupSlot(fileHandle, rid, headerData) == -1) return -1;
+        if (version != nullptr) getRowGroupHeader(version, nullptr, nullptr, nullptr, headerData);
+
+        ColumnarGeometry geometry;
+        getColumnarGeometry(recordDescriptor, geometry);
+        SizeType nullFlagBytes = nullBytesNeeded(recordDescriptor.size());
+        memset(data, 0, nullFlagBytes);
+        char * dataPos = static_cast<char *>(data) + nullFlagBytes;
+        SizeType fieldBytes;
+
+        for (int i = 0; i < recordDescriptor.size(); ++i) {
+            if (paxBitOn(columnNullBitmap(geometry, headerData, i), rid.slotNum - 1)) {
+                setPaxBit(static_cast<char *>(data), i, true);
+                continue;
+            }
+            if (readColumnarValue(fileHandle, geometry, recordDescriptor[i], rid.pageNum, i, rid.slotNum, dataPos, fieldBytes) == -1) return -1;
+            dataPos += fieldBytes;
+        }
+        return 0;
+    }
+
+    RC RecordBasedFileManager::deleteColumnarRecord(FileHandle &fileHandle, const RID &rid) {
+        char headerData[PAGE_SIZE];
+        if (readRowGroupSlot(fileHandle, rid, headerData) == -1) return -1;
+
+        // only the header changes, the row's chunk values are overwritten by the next insert
+        SizeType recordCount;
+        getRowGroupHeader(nullptr, nullptr, &recordCount, nullptr, headerData);
+        --recordCount;
+        setPaxRecordCount(&recordCount, headerData);
+        setPaxBit(headerData + BYTES_FOR_ROW_GROUP_HEADER, rid.slotNum - 1, false);
+        return fileHandle.writePage(rid.pageNum, headerData);
+    }
+
+    RC RecordBasedFileManager::updateColumnarRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
+                                                    const void *data, const RID &rid, SizeType version) {
+        char headerData[PAGE_SIZE];
+        if (readRowGroupSlot(fileHandle, rid, headerData) == -1) return -1;
+
+        // like PAX pages, a row group is updated in place and only within its schema version
+        SizeType groupVersion;
+        getRowGroupHeader(&groupVersion, nullptr, nullptr, nullptr, headerData);
+        if (groupVersion != version || !paxRecordFits(recordDescriptor, data)) return -1;
+
+        ColumnarGeometry geometry;
+        getColumnarGeometry(recordDescriptor, geometry);
+        if (writeColumnarValues(fileHandle, recordDescriptor, geometry, rid.pageNum, headerData, {rid.slotNum}, {data}) == -1) return -1;
+        return fileHandle.writePage(rid.pageNum, headerData);
+    }
+
+    RC RecordBasedFileManager::readColumnarAttribute(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
+                                                     const RID &rid, int attrIndex, void *data, SizeType *version) {
+        char headerData[PAGE_SIZE];
+        if (readRowGroupSlot(fileHandle, rid, headerData) == -1) return -1;
+        if (version != nullptr) getRowGroupHeader(version, nullptr, nullptr, nullptr, headerData);
+        if (attrIndex < 0 || attrIndex >= static_cast<int>(recordDescriptor.size())) return -1;
+
+        ColumnarGeometry geometry;
+        getColumnarGeometry(recordDescriptor, geometry);
+        if (paxBitOn(columnNullBitmap(geometry, headerData, attrIndex), rid.slotNum - 1)) {
+            memset(data, 128, 1);
+            return 0;
+        }
+        memset(data, 0, 1);
+        SizeType fieldBytes;
+        return readColumnarValue(fileHandle, geometry, recordDescriptor[attrIndex], rid.pageNum, attrIndex, rid.slotNum,
+                                 static_cast<char *>(data) + 1, fieldBytes);
+    }
+
+    RC RecordBasedFileManager::readZoneCapacity(ZoneMapHandle &zoneHandle, SizeType &capacity) {
+        if (zoneHandle.capacity == 0) {
+            char headerData[PAGE_SIZE];
+            if (zoneHandle.readPage(0, headerData) == -1) return -1;
+            memmove(&zoneHandle.capacity, headerData, BYTES_FOR_ZONE_CAPACITY);
+        }
+        capacity = zoneHandle.capacity;
+        return 0;
+    }
+
+    RC RecordBasedFileManager::cacheZonePage(ZoneMapHandle &zoneHandle, unsigned zonePageNum) {
+        if (zoneHandle.pageCached && zoneHandle.cachedPageNum == zonePageNum) return 0;
+        if (flushZoneMap(zoneHandle) == -1) return -1;
+        zoneHandle.pageCached = false;
+        memset(zoneHandle.cachedPage, 0, PAGE_SIZE);
+        while (zoneHandle.pageCount <= zonePageNum) {
+            if (zoneHandle.appendPage(zoneHandle.cachedPage) == -1) return -1;
+        }
+        if (zoneHandle.readPage(zonePageNum, zoneHandle.cachedPage) == -1) return -1;
+        zoneHandle.cachedPageNum = zonePageNum;
+        zoneHandle.pageCached = true;
+        return 0;
+    }
+
+    RC RecordBasedFileManager::flushZoneMap(ZoneMapHandle &zoneHandle) {
+        if (!zoneHandle.pageDirty) return 0;
+        if (zoneHandle.writePage(zoneHandle.cachedPageNum, zoneHandle.cachedPage) == -1) return -1;
+        zoneHandle.pageDirty = false;
+        return 0;
+    }
+
+    void RecordBasedFileManager::zoneEntryLocation(SizeType capacity, unsigned pageNum, unsigned &zonePageNum, SizeType &entryOffset) {
+        // page zero of the zone map holds the capacity, entries of consecutive data pages follow it
+        SizeType entrySize = BYTES_FOR_ZONE_ENTRY_HEADER + capacity * BYTES_FOR_ZONE_ATTR;
+        unsigned entriesPerPage = PAGE_SIZE / entrySize;
+        zonePageNum = 1 + pageNum / entriesPerPage;
+        entryOffset = pageNum % entriesPerPage * entrySize;
+    }
+
+    RC RecordBasedFileManager::updateZoneMap(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
+                                             unsigned pageNum, const char * record, bool removing) {
+        if (fileHandle.zoneMap == nullptr) return 0;
+        ZoneMapHandle &zoneHandle = *static_cast<ZoneMapHandle *>(fileHandle.zoneMap);
+        SizeType capacity;
+
+        if (zoneHandle.pageCount == 0) {
+            // the first record decides how many attributes every entry tracks
+            char headerData[PAGE_SIZE];
+            capacity = recordDescriptor.size() < MAX_ZONE_ATTRS ? recordDescriptor.size() : MAX_ZONE_ATTRS;
+            memset(headerData, 0, PAGE_SIZE);
+            memmove(headerData, &capacity, BYTES_FOR_ZONE_CAPACITY);
+            if (zoneHandle.appendPage(headerData) == -1) return -1;
+            zoneHandle.capacity = capacity;
+        } else if (readZoneCapacity(zoneHandle, capacity) == -1) return -1;
+
+        // the entry is changed on the cached page, written back with the file or once another page is needed
+        unsigned zonePageNum;
+        SizeType entryOffset;
+        zoneEntryLocation(capacity, pageNum, zonePageNum, entryOffset);
+        if (cacheZonePage(zoneHandle, zonePageNum) == -1) return -1;
+        char *zonePage = zoneHandle.cachedPage;
+        zoneHandle.pageDirty = true;
+
+        // entry: [version][record count], then per attribute [min][max][null count][value count]
+        char *entry = zonePage + entryOffset;
+        SizeType entryVersion, recordCount, recoVersion, fieldCount;
+        memmove(&entryVersion, entry, BYTES_FOR_VERSION_NUM);
+        memmove(&recordCount, entry + BYTES_FOR_VERSION_NUM, BYTES_FOR_ZONE_COUNT);
+        memmove(&recoVersion, record + TOMBSTONE_BYTE, BYTES_FOR_VERSION_NUM);
+        memmove(&fieldCount, record + TOMBSTONE_BYTE + BYTES_FOR_VERSION_NUM, BYTES_FOR_RECORD_FIELD_COUNT);
+
+        if (removing && recordCount <= 1) {
+            // an empty page starts over with a blank entry
+            memset(entry, 0, BYTES_FOR_ZONE_ENTRY_HEADER + capacity * BYTES_FOR_ZONE_ATTR);
+            return 0;
+        }
+        recordCount = removing ? recordCount - 1 : recordCount + 1;
+        memmove(entry + BYTES_FOR_VERSION_NUM, &recordCount, BYTES_FOR_ZONE_COUNT);
+
+        // values are only summarized while every record on the page shares one schema version
+        if (!removing && entryVersion == 0) entryVersion = recoVersion;
+        if (entryVersion != recoVersion || fieldCount != recordDescriptor.size()) entryVersion = ZONE_MIXED_VERSION;
+        memmove(entry, &entryVersion, BYTES_FOR_VERSION_NUM);
+        if (entryVersion == ZONE_MIXED_VERSION) return 0;
+
+        const char *recordNulls = record + BYTES_BEFORE_NULL_FLAGS;
+        const char *recordDir = recordNulls + nullBytesNeeded(fieldCount);
+        SizeType nullCount, valueCount, fieldOffset;
+        for (int i = 0; i < capacity && i < fieldCount; ++i) {
+            char *stats = entry + BYTES_FOR_ZONE_ENTRY_HEADER + i * BYTES_FOR_ZONE_ATTR;
+            memmove(&nullCount, stats + 2 * INT_BYTES, BYTES_FOR_ZONE_COUNT);
+            memmove(&valueCount, stats + 2 * INT_BYTES + BYTES_FOR_ZONE_COUNT, BYTES_FOR_ZONE_COUNT);
+
+            if (nullBitOn(recordNulls[i / BITS_IN_BYTE], i % BITS_IN_BYTE + 1)) {
+                if (!removing) ++nullCount;
+                else if (nullCount > 0) --nullCount;
+            } else if (removing) {
+                // min and max are left as they are, they only need to cover the remaining values
+                if (valueCount > 0) --valueCount;
+            } else {
+                memmove(&fieldOffset, recordDir + BYTES_FOR_POINTER_TO_RECORD_FIELD * i, BYTES_FOR_POINTER_TO_RECORD_FIELD);
+                const char *field = record + fieldOffset;
+                if (valueCount == 0) {
+                    memmove(stats, field, INT_BYTES);
+                    memmove(stats + INT_BYTES, field, INT_BYTES);
+                } else if (recordDescriptor[i].type == TypeInt) {
+                    int value, minVal, maxVal;
+                    memmove(&value, field, INT_BYTES);
+                    memmove(&minVal, stats, INT_BYTES);
+                    memmove(&maxVal, stats + INT_BYTES, INT_BYTES);
+                    if (value < minVal) memmove(stats, &value, INT_BYTES);
+                    if (value > maxVal) memmove(stats + INT_BYTES, &value, INT_BYTES);
+                } else if (recordDescriptor[i].type == TypeReal) {
+                    float value, minVal, maxVal;
+                    memmove(&value, field, INT_BYTES);
+                    memmove(&minVal, stats, INT_BYTES);
+                    memmove(&maxVal, stats + INT_BYTES, INT_BYTES);
+                    if (value < minVal) memmove(stats, &value, INT_BYTES);
+                    if (value > maxVal) memmove(stats + INT_BYTES, &value, INT_BYTES);
+                }
+                ++valueCount;
+            }
+
+            memmove(stats + 2 * INT_BYTES, &nullCount, BYTES_FOR_ZONE_COUNT);
+            memmove(stats + 2 * INT_BYTES + BYTES_FOR_ZONE_COUNT, &valueCount, BYTES_FOR_ZONE_COUNT);
+        }
+        return 0;
+    }
+
     RC RecordBasedFileManager::scan(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
                                     const std::string &conditionAttribute, const CompOp compOp, const void *value,
                                     const std::vector<std::string> &attributeNames,
                                     RBFM_ScanIterator &rbfm_ScanIterator) {
-        rbfm_ScanIterator.init(fileHandle, recordDescriptor, conditionAttribute, compOp, value, attributeNames);
-        return 0;
+        return rbfm_ScanIterator.init(fileHandle, recordDescriptor, conditionAttribute, compOp, value, attributeNames);
     }
 
-    void RBFM_ScanIterator::init(FileHandle & fHandle, const std::vector<Attribute> &recordDescriptor,
+    RC RBFM_ScanIterator::init(FileHandle & fHandle, const std::vector<Attribute> &recordDescriptor,
                                  const std::string &conditionAttribute, const CompOp compOp, const void *value,
                                  const std::vector<std::string> &attributeNames) {
         // initialize main variables
@@ -600,14 +1851,28 @@ namespace PeterDB {
         this->conditionAttribute = conditionAttribute;
         this->compOp = compOp;
         this->attributeNames = attributeNames;
+        projectedDescriptor.clear();
+        for (const std::string &name : attributeNames) {
+            auto attrIndex = attrNameIndexes.find(name);
+            if (attrIndex == attrNameIndexes.end()) return -1;
+            projectedDescriptor.push_back(recordDescriptor[attrIndex->second]);
+        }
         firstScan = true;
-
-        if (compOp == NO_OP) return;  // if no operation, comparison value is irrelevant
+        batchInProgress = false;
+        clearColumnCache();
+        conditionAttrIndex = -1;
+        scanVersion = 1;
+        zoneCapacity = 0;
+        zonePage.clear();
+
+        if (compOp == NO_OP) return 0;  // if no operation, comparison value is irrelevant
+        if (attrNameIndexes.find(conditionAttribute) == attrNameIndexes.end()) return -1;
         // get the type of the comparison value
-        for (auto attr : recordDescriptor) {
-            if (attr.name == conditionAttribute) {
-                valueType = attr.type;
-                conditionAttrLen = attr.length;
+        for (int i = 0; i < recordDescriptor.size(); ++i) {
+            if (recordDescriptor[i].name == conditionAttribute) {
+                valueType = recordDescriptor[i].type;
+                conditionAttrLen = recordDescriptor[i].length;
+                conditionAttrIndex = i;
                 break;
             }
         }
@@ -626,6 +1891,7 @@ namespace PeterDB {
             valString[varcharLen] = '\0';
             valueString = std::string{valString};
         }
+        return 0;
     }
 
     RC RBFM_ScanIterator::close() {
@@ -702,21 +1968,27 @@ namespace PeterDB {
         unsigned char nullByte;
         memmove(&nullByte, conditionAttrVal, 1);
         if (nullByte == 128) return false;
+        return acceptedField(conditionAttrVal + 1);
+    }
+
+    bool RBFM_ScanIterator::acceptedField(const char * field) {
+        // a null field never satisfies a condition
+        if (field == nullptr) return false;
 
         if (valueType == TypeInt) {
             int attrVal;
-            memmove(&attrVal, conditionAttrVal + 1, INT_BYTES);
+            memmove(&attrVal, field, INT_BYTES);
             return compareInt(attrVal);
         } else if (valueType == TypeReal) {
             float attrVal;
-            memmove(&attrVal, conditionAttrVal + 1, INT_BYTES);
+            memmove(&attrVal, field, INT_BYTES);
             return compareReal(attrVal);
         } else {
             // if value is varchar, get length of the character section, append null character, then convert into string object
             int varcharLen;
-            memmove(&varcharLen, conditionAttrVal + 1, INT_BYTES);
+            memmove(&varcharLen, field, INT_BYTES);
             char valString[varcharLen + 1];
-            memmove(valString, conditionAttrVal + 1 + INT_BYTES, varcharLen);
+            memmove(valString, field + INT_BYTES, varcharLen);
             valString[varcharLen] = '\0';
             std::string attrVal{valString};
 
@@ -763,6 +2035,12 @@ namespace PeterDB {
     }
 
     RC RBFM_ScanIterator::getNextRecord(RID &rid, void *data, SizeType *version, bool *recoAccepted, bool *verifyRecord) {
+        if (fileHandle->pageLayout == LayoutPax) return getNextPaxRecord(rid, data, version, recoAccepted, verifyRecord);
+        if (fileHandle->pageLayout == LayoutColumnar) {
+            // outside of a batch, every call sees the current pages
+            if (!batchInProgress) clearColumnCache();
+            return getNextColumnarRecord(rid, data, version, recoAccepted, verifyRecord);
+        }
         unsigned currPageNum;
         unsigned short currSlotNum;
         if (firstScan) {
@@ -780,8 +2058,11 @@ namespace PeterDB {
         SizeType currSlotCount;
         SizeType recoOffset, recoLen;
         unsigned char tombstoneCheck;
+        if (!batchInProgress) zonePage.clear();
 
         for (; currPageNum < fileHandle->pageCount; ++currPageNum, currSlotNum = 1) {
+            // pages whose zone map rules out the condition are not read at all
+            if (currSlotNum == 1 && !pageMayMatch(currPageNum)) continue;
             if (fileHandle->readPage(currPageNum, pageData) == -1) return -1;
             RecordBasedFileManager::instance().getSlotCount(&currSlotCount, pageData);
 
@@ -824,5 +2105,284 @@ namespace PeterDB {
         return RBFM_EOF;
     }
 
+    bool RBFM_ScanIterator::pageMayMatch(unsigned pageNum) {
+        if (compOp == NO_OP || conditionAttrIndex < 0 || fileHandle->zoneMap == nullptr) return true;
+        RecordBasedFileManager &rbfm = RecordBasedFileManager::instance();
+        ZoneMapHandle &zoneHandle = *static_cast<ZoneMapHandle *>(fileHandle->zoneMap);
+        if (zoneHandle.pageCount == 0) return true;
+        if (zoneCapacity == 0 && rbfm.readZoneCapacity(zoneHandle, zoneCapacity) == -1) return true;
+
+        unsigned entryPageNum;
+        SizeType entryOffset;
+        rbfm.zoneEntryLocation(zoneCapacity, pageNum, entryPageNum, entryOffset);
+        if (entryPageNum >= zoneHandle.pageCount) return true;
+        if (zonePage.empty() || zonePageNum != entryPageNum) {
+            // the page writes through this handle changed last may not be written back yet
+            zonePage.resize(PAGE_SIZE);
+            if (zoneHandle.pageCached && zoneHandle.cachedPageNum == entryPageNum)
+                memmove(&zonePage[0], zoneHandle.cachedPage, PAGE_SIZE);
+            else if (zoneHandle.readPage(entryPageNum, &zonePage[0]) == -1) {
+                zonePage.clear();
+                return true;
+            }
+            zonePageNum = entryPageNum;
+        }
+
+        const char *entry = zonePage.data() + entryOffset;
+        SizeType entryVersion, recordCount, valueCount;
+        memmove(&entryVersion, entry, BYTES_FOR_VERSION_NUM);
+        memmove(&recordCount, entry + BYTES_FOR_VERSION_NUM, BYTES_FOR_ZONE_COUNT);
+        if (recordCount == 0) return false;
+        if (entryVersion != scanVersion || conditionAttrIndex >= zoneCapacity) return true;
+
+        const char *stats = entry + BYTES_FOR_ZONE_ENTRY_HEADER + conditionAttrIndex * BYTES_FOR_ZONE_ATTR;
+        memmove(&valueCount, stats + 2 * INT_BYTES + BYTES_FOR_ZONE_COUNT, BYTES_FOR_ZONE_COUNT);
+        if (valueCount == 0) return false;  // only nulls, which never satisfy a condition
+        if (valueType == TypeVarChar) return true;
+
+        // some value in [min, max] can satisfy the condition
+        if (valueType == TypeInt) {
+            int minVal, maxVal;
+            memmove(&minVal, stats, INT_BYTES);
+            memmove(&maxVal, stats + INT_BYTES, INT_BYTES);
+            switch (compOp) {
+                case EQ_OP:
+                    return minVal <= valueInt && valueInt <= maxVal;
+                case LT_OP:
+                case LE_OP:
+                    return compareInt(minVal);
+                case GT_OP:
+                case GE_OP:
+                    return compareInt(maxVal);
+                default:
+                    return compareInt(minVal) || compareInt(maxVal);
+            }
+        }
+        float minVal, maxVal;
+        memmove(&minVal, stats, INT_BYTES);
+        memmove(&maxVal, stats + INT_BYTES, INT_BYTES);
+        switch (compOp) {
+            case EQ_OP:
+                return minVal <= valueReal && valueReal <= maxVal;
+            case LT_OP:
+            case LE_OP:
+                return compareReal(minVal);
+            case GT_OP:
+            case GE_OP:
+                return compareReal(maxVal);
+            default:
+                return compareReal(minVal) || compareReal(maxVal);
+        }
+    }
+
+    void RBFM_ScanIterator::extractPaxRecordData(const char * pageData, const PaxGeometry &geometry, SizeType slotNum, void * data) {
+        SizeType newNullByteCount = RecordBasedFileManager::instance().nullBytesNeeded(attributeNames.size());
+        unsigned char newNullBytes[newNullByteCount] = {0};
+        char *dataPtr = static_cast<char *>(data) + newNullByteCount;
+        const char *field;
+        int recordDescIndex;
+
+        for (int attrNamesIndex = 0; attrNamesIndex < attributeNames.size(); attrNamesIndex++) {
+            field = nullptr;
+            if (!attributeNames[attrNamesIndex].empty()) {
+                recordDescIndex = attrNameIndexes[attributeNames[attrNamesIndex]];
+                field = RecordBasedFileManager::instance().paxFieldLocation(geometry, pageData, recordDescIndex, slotNum);
+            }
+
+            if (field == nullptr) {
+                newNullBytes[attrNamesIndex / BITS_IN_BYTE] |= 1 << (BITS_IN_BYTE - attrNamesIndex % BITS_IN_BYTE - 1);
+            } else if (recordDescriptor[recordDescIndex].type != TypeVarChar) {
+                memmove(dataPtr, field, recordDescriptor[recordDescIndex].length);
+                dataPtr += recordDescriptor[recordDescIndex].length;
+            } else {
+                int varcharLen;
+                memmove(&varcharLen, field, INT_BYTES);
+                memmove(dataPtr, field, varcharLen + INT_BYTES);
+                dataPtr += varcharLen + INT_BYTES;
+            }
+        }
+        memmove(data, newNullBytes, newNullByteCount);
+    }
+
+    RC RBFM_ScanIterator::getNextPaxRecord(RID &rid, void *data, SizeType *version, bool *recoAccepted, bool *verifyRecord) {
+        RecordBasedFileManager &rbfm = RecordBasedFileManager::instance();
+        unsigned currPageNum = firstScan ? 0 : lastPageNum;
+        SizeType currSlotNum = firstScan ? 1 : lastSlotNum + 1;
+        firstScan = false;
+
+        // the condition is checked straight from the condition attribute's minipage, without rebuilding the record
+        char pageData[PAGE_SIZE];
+        PaxGeometry geometry;
+        rbfm.getPaxGeometry(recordDescriptor, geometry);
+        int conditionIndex = compOp == NO_OP ? -1 : attrNameIndexes[conditionAttribute];
+        SizeType pageVersion;
+
+        for (; currPageNum < fileHandle->pageCount; ++currPageNum, currSlotNum = 1) {
+            if (fileHandle->readPage(currPageNum, pageData) == -1) return -1;
+            rbfm.getPaxHeader(&pageVersion, nullptr, nullptr, pageData);
+
+            for (; currSlotNum <= geometry.capacity; ++currSlotNum) {
+                if (!rbfm.paxSlotUsed(currSlotNum, pageData)) continue;
+                lastPageNum = currPageNum;
+
+                if (version != nullptr) {
+                    *version = pageVersion;
+                    lastSlotNum = currSlotNum - 1;
+                    return 0;
+                }
+
+                lastSlotNum = currSlotNum;
+                bool accepted = verifyRecord == nullptr || *verifyRecord;
+                if (accepted && conditionIndex >= 0)
+                    accepted = acceptedField(rbfm.paxFieldLocation(geometry, pageData, conditionIndex, currSlotNum));
+                if (accepted) {
+                    extractPaxRecordData(pageData, geometry, currSlotNum, data);
+                    rid.pageNum = currPageNum;
+                    rid.slotNum = currSlotNum;
+                }
+
+                if (verifyRecord != nullptr) {
+                    *recoAccepted = accepted;
+                    return 0;
+                }
+                if (accepted) return 0;
+            }
+        }
+
+        return RBFM_EOF;
+    }
+
+    void RBFM_ScanIterator::clearColumnCache() {
+        rowGroupPageNum = UINT_MAX;
+        columnPageNums.assign(recordDescriptor.size(), UINT_MAX);
+        columnPages.resize(recordDescriptor.size());
+    }
+
+    RC RBFM_ScanIterator::readRowGroupHeader(unsigned groupPageNum) {
+        if (groupPageNum == rowGroupPageNum) return 0;
+        rowGroupHeader.resize(PAGE_SIZE);
+        if (fileHandle->readPage(groupPageNum, &rowGroupHeader[0]) == -1) return -1;
+        rowGroupPageNum = groupPageNum;
+        return 0;
+    }
+
+    RC RBFM_ScanIterator::readColumnField(const ColumnarGeometry &geometry, int attrIndex, SizeType slotNum, const char *& field) {
+        // field is set to nullptr when the value is null, chunk pages are only read when the row moves past the cached one
+        RecordBasedFileManager &rbfm = RecordBasedFileManager::instance();
+        field = nullptr;
+        if (rbfm.paxBitOn(rbfm.columnNullBitmap(geometry, &rowGroupHeader[0], attrIndex), slotNum - 1)) return 0;
+
+        unsigned pageNum = rbfm.columnPageNum(geometry, rowGroupPageNum, attrIndex, slotNum);
+        if (columnPageNums[attrIndex] != pageNum) {
+            columnPages[attrIndex].resize(PAGE_SIZE);
+            if (fileHandle->readPage(pageNum, &columnPages[attrIndex][0]) == -1) return -1;
+            columnPageNums[attrIndex] = pageNum;
+        }
+        field = columnPages[attrIndex].data() + rbfm.columnPageOffset(geometry, attrIndex, slotNum);
+        return 0;
+    }
+
+    RC RBFM_ScanIterator::extractColumnarRecordData(const ColumnarGeometry &geometry, SizeType slotNum, void * data) {
+        SizeType newNullByteCount = RecordBasedFileManager::instance().nullBytesNeeded(attributeNames.size());
+        unsigned char newNullBytes[newNullByteCount] = {0};
+        char *dataPtr = static_cast<char *>(data) + newNullByteCount;
+        const char *field;
+        int recordDescIndex;
+
+        for (int attrNamesIndex = 0; attrNamesIndex < attributeNames.size(); attrNamesIndex++) {
+            field = nullptr;
+            if (!attributeNames[attrNamesIndex].empty()) {
+                recordDescIndex = attrNameIndexes[attributeNames[attrNamesIndex]];
+                if (readColumnField(geometry, recordDescIndex, slotNum, field) == -1) return -1;
+            }
+
+            if (field == nullptr) {
+                newNullBytes[attrNamesIndex / BITS_IN_BYTE] |= 1 << (BITS_IN_BYTE - attrNamesIndex % BITS_IN_BYTE - 1);
+            } else if (recordDescriptor[recordDescIndex].type != TypeVarChar) {
+                memmove(dataPtr, field, recordDescriptor[recordDescIndex].length);
+                dataPtr += recordDescriptor[recordDescIndex].length;
+            } else {
+                int varcharLen;
+                memmove(&varcharLen, field, INT_BYTES);
+                memmove(dataPtr, field, varcharLen + INT_BYTES);
+                dataPtr += varcharLen + INT_BYTES;
+            }
+        }
+        memmove(data, newNullBytes, newNullByteCount);
+        return 0;
+    }
+
+    RC RBFM_ScanIterator::getNextColumnarRecord(RID &rid, void *data, SizeType *version, bool *recoAccepted, bool *verifyRecord) {
+        RecordBasedFileManager &rbfm = RecordBasedFileManager::instance();
+        unsigned currGroupNum = firstScan ? 0 : lastPageNum;
+        SizeType currSlotNum = firstScan ? 1 : lastSlotNum + 1;
+        firstScan = false;
+
+        // only the row group headers and the chunks of the condition and projected attributes are read
+        ColumnarGeometry geometry;
+        rbfm.getColumnarGeometry(recordDescriptor, geometry);
+        int conditionIndex = compOp == NO_OP ? -1 : attrNameIndexes[conditionAttribute];
+        SizeType groupVersion, capacity;
+        unsigned groupPages;
+        const char *field;
+
+        for (; currGroupNum < fileHandle->pageCount; currGroupNum += groupPages, currSlotNum = 1) {
+            if (readRowGroupHeader(currGroupNum) == -1) return -1;
+            rbfm.getRowGroupHeader(&groupVersion, &capacity, nullptr, &groupPages, rowGroupHeader.data());
+
+            for (; currSlotNum <= capacity; ++currSlotNum) {
+                if (!rbfm.paxBitOn(rowGroupHeader.data() + BYTES_FOR_ROW_GROUP_HEADER, currSlotNum - 1)) continue;
+                lastPageNum = currGroupNum;
+
+                if (version != nullptr) {
+                    *version = groupVersion;
+                    lastSlotNum = currSlotNum - 1;
+                    return 0;
+                }
+
+                lastSlotNum = currSlotNum;
+                bool accepted = verifyRecord == nullptr || *verifyRecord;
+                if (accepted && conditionIndex >= 0) {
+                    if (readColumnField(geometry, conditionIndex, currSlotNum, field) == -1) return -1;
+                    accepted = acceptedField(field);
+                }
+                if (accepted) {
+                    if (extractColumnarRecordData(geometry, currSlotNum, data) == -1) return -1;
+                    rid.pageNum = currGroupNum;
+                    rid.slotNum = currSlotNum;
+                }
+
+                if (verifyRecord != nullptr) {
+                    *recoAccepted = accepted;
+                    return 0;
+                }
+                if (accepted) return 0;
+            }
+        }
+
+        return RBFM_EOF;
+    }
+
+    RC RBFM_ScanIterator::getNextBatch(std::vector<RID> &rids, void *data, std::vector<unsigned> &offsets, unsigned maxRecords) {
+        rids.clear();
+        offsets.clear();
+        // a batch is read against one snapshot of the cached columnar pages
+        clearColumnCache();
+        batchInProgress = true;
+
+        RecordBasedFileManager &rbfm = RecordBasedFileManager::instance();
+        char *dataPtr = static_cast<char *>(data);
+        unsigned used = 0;
+        RID rid{};
+        while (rids.size() < maxRecords && getNextRecord(rid, dataPtr + used) != RBFM_EOF) {
+            rids.push_back(rid);
+            offsets.push_back(used);
+            used += rbfm.recordLength(projectedDescriptor, dataPtr + used);
+        }
+
+        batchInProgress = false;
+        return rids.empty() ? RBFM_EOF : 0;
+    }
+
 } // namespace PeterDB
 
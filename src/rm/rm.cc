@@ -1,12 +1,18 @@
 #include "src/include/rm.h"
 #include <cstring>
 #include <map>
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
 constexpr int INT_BYTES = 4;
 constexpr int FLOAT_BYTES = 4;
 constexpr int BITS_PER_BYTE = 8;
+constexpr int DICTIONARY_ENCODED = 1 << 8;  // column-type flag of dictionary-encoded varchar attributes
+constexpr const char * DICTIONARY_FILE_SUFFIX = ".dict";
+constexpr const char * REBUILD_FILE_SUFFIX = ".rebuild";    // files written by rebuildTable before they are swapped in
+constexpr const char * REBUILD_MANIFEST_SUFFIX = ".swap";   // names the rebuilt files of a table still to be swapped in
+constexpr char COMPOSITE_INDEX_SEPARATOR = ',';             // between the attribute names of a composite index
 
 namespace PeterDB {
     RelationManager &RelationManager::instance() {
@@ -19,6 +25,7 @@ namespace PeterDB {
         tablesDescriptor.push_back(Attribute{"table-name", TypeVarChar, 50});
         tablesDescriptor.push_back(Attribute{"file-name", TypeVarChar, 50});
         tablesDescriptor.push_back(Attribute{"is-system-table", TypeInt, 4});
+        tablesDescriptor.push_back(Attribute{"fill-factor", TypeInt, 4});
 
         columnsDescriptor.push_back(Attribute{"table-id", TypeInt, 4});
         columnsDescriptor.push_back(Attribute{"column-name", TypeVarChar, 50});
@@ -34,6 +41,9 @@ namespace PeterDB {
         indicesDescriptor.push_back(Attribute{"attribute-name", TypeVarChar, 50});
         indicesDescriptor.push_back(Attribute{"file-name", TypeVarChar, 105});
 
+        dictionaryDescriptor.push_back(Attribute{"code", TypeInt, 4});
+        dictionaryDescriptor.push_back(Attribute{"value", TypeVarChar, PAGE_SIZE});
+
         columnsColumns.emplace_back("table-id");
         columnsColumns.emplace_back("column-name");
         columnsColumns.emplace_back("column-type");
@@ -66,8 +76,8 @@ namespace PeterDB {
         }
     }
 
-    RC RelationManager::addTablesEntry(FileHandle &fh, int table_id, int tableNameLen, const char *tableName, int fileNameLen, const char *fileName, int isSystem, char *data) {
-        std::vector<tupleVal> values{tupleVal{table_id}, tupleVal{tableNameLen}, tupleVal{tableName}, tupleVal{fileNameLen}, tupleVal{fileName}, tupleVal{isSystem}};
+    RC RelationManager::addTablesEntry(FileHandle &fh, int table_id, int tableNameLen, const char *tableName, int fileNameLen, const char *fileName, int isSystem, int fillFactor, char *data) {
+        std::vector<tupleVal> values{tupleVal{table_id}, tupleVal{tableNameLen}, tupleVal{tableName}, tupleVal{fileNameLen}, tupleVal{fileName}, tupleVal{isSystem}, tupleVal{fillFactor}};
         craftTupleData(data + 1, values);
         RID rid{};
         return RecordBasedFileManager::instance().insertRecord(fh, tablesDescriptor, data, rid);
@@ -79,15 +89,15 @@ namespace PeterDB {
         if (rbfm.openFile("Tables", fh) == -1) return -1;
         memset(data, 0, 1);
 
-        if (addTablesEntry(fh, 1, 6, "Tables", 6, "Tables", 1, data) == -1) return -1;
-        if (addTablesEntry(fh, 2, 7, "Columns", 7, "Columns", 1, data) == -1) return -1;
-        if (addTablesEntry(fh, 3, 7, "Schemas", 7, "Schemas", 1, data) == -1) return -1;
-        if (addTablesEntry(fh, 4, 7, "Indices", 7, "Indices", 1, data) == -1) return -1;
+        if (addTablesEntry(fh, 1, 6, "Tables", 6, "Tables", 1, FULL_FILL_FACTOR, data) == -1) return -1;
+        if (addTablesEntry(fh, 2, 7, "Columns", 7, "Columns", 1, FULL_FILL_FACTOR, data) == -1) return -1;
+        if (addTablesEntry(fh, 3, 7, "Schemas", 7, "Schemas", 1, FULL_FILL_FACTOR, data) == -1) return -1;
+        if (addTablesEntry(fh, 4, 7, "Indices", 7, "Indices", 1, FULL_FILL_FACTOR, data) == -1) return -1;
 
         return rbfm.closeFile(fh);
     }
 
-    RC RelationManager::addColumnsEntry(FileHandle &fh, int table_id, int nameLen, const char *name, AttrType columnType, int columnLen, int pos, char *data) {
+    RC RelationManager::addColumnsEntry(FileHandle &fh, int table_id, int nameLen, const char *name, int columnType, int columnLen, int pos, char *data) {
         std::vector<tupleVal> values{tupleVal{table_id}, tupleVal{nameLen}, tupleVal{name}, tupleVal{columnType}, tupleVal{columnLen}, tupleVal{pos}};
         craftTupleData(data + 1, values);
         RID rid{};
@@ -109,6 +119,7 @@ namespace PeterDB {
         if (addColumnsEntry(fh, 2, 13, "column-length", TypeInt, 4, 4, data) == -1) return -1;
         if (addColumnsEntry(fh, 2, 15, "column-position", TypeInt, 4, 5, data) == -1) return -1;
         if (addColumnsEntry(fh, 1, 15, "is-system-table", TypeInt, 4, 4, data) == -1) return -1;
+        if (addColumnsEntry(fh, 1, 11, "fill-factor", TypeInt, 4, 5, data) == -1) return -1;
         if (addColumnsEntry(fh, 3, 8, "table-id", TypeInt, 4, 1, data) == -1) return -1;
         if (addColumnsEntry(fh, 3, 7, "version", TypeInt, 4, 2, data) == -1) return -1;
         if (addColumnsEntry(fh, 3, 6, "fields", TypeVarChar, 100, 3, data) == -1) return -1;
@@ -140,13 +151,88 @@ namespace PeterDB {
         if (rbfm.createFile("Indices") == -1) return -1;
         FileHandle fh;
         nextTableID = 5;  // reset table ID tracker every time catalog is made
+        catalogOpen = true;
 
         if (initTablesTable(fh) == -1) return -1;
         return initColumnsTable(fh);
     }
 
+    RC RelationManager::openCatalog() {
+        // a catalog created by an earlier run is checked once, the first time it is used
+        if (catalogOpen) return 0;
+        RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
+        RBFM_ScanIterator scanner;
+        FileHandle *fh = new FileHandle{};
+        if (rbfm.openFile("Columns", *fh) == -1) {
+            delete fh;
+            return -1;
+        }
+        int systemTableID = 1;
+        std::vector<std::string> columnName{"column-name"};
+        if (rbfm.scan(*fh, columnsDescriptor, "table-id", EQ_OP, &systemTableID, columnName, scanner) == -1) {scanner.close(); return -1;}
+        RID rid{};
+        char data[PAGE_SIZE];
+        int nameLen;
+        bool hasFillFactor = false;
+        while (!hasFillFactor && scanner.getNextRecord(rid, data) != RBFM_EOF) {
+            memmove(&nameLen, data + 1, INT_BYTES);
+            hasFillFactor = std::string{data + (1 + INT_BYTES), static_cast<size_t>(nameLen)} == "fill-factor";
+        }
+        if (scanner.close() == -1) return -1;
+
+        // catalogs from before the fill-factor column get it, with every table filling whole pages
+        std::vector<Attribute> storedTablesDescriptor = tablesDescriptor;
+        if (!hasFillFactor) storedTablesDescriptor.pop_back();
+        std::vector<std::string> tablesColumns;
+        for (const Attribute &attr : storedTablesDescriptor) tablesColumns.push_back(attr.name);
+        fh = new FileHandle{};
+        if (rbfm.openFile("Tables", *fh) == -1) {
+            delete fh;
+            return -1;
+        }
+        if (rbfm.scan(*fh, storedTablesDescriptor, "", NO_OP, nullptr, tablesColumns, scanner) == -1) {scanner.close(); return -1;}
+        std::vector<RID> rids;
+        std::vector<std::string> entries, tableNames;
+        int tableID, maxTableID = 4;
+        while (scanner.getNextRecord(rid, data) != RBFM_EOF) {
+            memmove(&tableID, data + 1, INT_BYTES);
+            maxTableID = std::max(maxTableID, tableID);
+            memmove(&nameLen, data + (1 + INT_BYTES), INT_BYTES);
+            tableNames.emplace_back(data + (1 + 2 * INT_BYTES), static_cast<size_t>(nameLen));
+            if (hasFillFactor) continue;
+            rids.push_back(rid);
+            entries.emplace_back(data, rbfm.recordLength(storedTablesDescriptor, data));
+        }
+        if (scanner.close() == -1) return -1;
+
+        if (!hasFillFactor) {
+            FileHandle tablesHandle;
+            if (rbfm.openFile("Tables", tablesHandle) == -1) return -1;
+            int fillFactor = FULL_FILL_FACTOR;
+            for (size_t i = 0; i < rids.size(); ++i) {
+                memmove(data, entries[i].data(), entries[i].size());
+                memmove(data + entries[i].size(), &fillFactor, INT_BYTES);
+                if (rbfm.updateRecord(tablesHandle, tablesDescriptor, data, rids[i]) == -1) {rbfm.closeFile(tablesHandle); return -1;}
+            }
+            if (rbfm.closeFile(tablesHandle) == -1) return -1;
+
+            FileHandle columnsHandle;
+            memset(data, 0, 1);
+            if (rbfm.openFile("Columns", columnsHandle) == -1) return -1;
+            if (addColumnsEntry(columnsHandle, 1, 11, "fill-factor", TypeInt, 4, 5, data) == -1) {rbfm.closeFile(columnsHandle); return -1;}
+            if (rbfm.closeFile(columnsHandle) == -1) return -1;
+        }
+        // a rebuild that committed but was cut short before all its files were swapped in is finished
+        for (const std::string &tableName : tableNames)
+            if (finishRebuild(tableName) == -1) return -1;
+        nextTableID = maxTableID + 1;
+        catalogOpen = true;
+        return 0;
+    }
+
     RC RelationManager::deleteCatalog() {
         RC status = 0;
+        catalogOpen = false;
         if (RecordBasedFileManager::instance().destroyFile("Tables") == -1) status = -1;
         if (RecordBasedFileManager::instance().destroyFile("Columns") == -1) status = -1;
         if (RecordBasedFileManager::instance().destroyFile("Schemas") == -1) status = -1;
@@ -154,8 +240,20 @@ namespace PeterDB {
         return status;
     }
 
-    RC RelationManager::createTable(const std::string &tableName, const std::vector<Attribute> &attrs) {
+    RC RelationManager::createTable(const std::string &tableName, const std::vector<Attribute> &attrs, PageLayout layout,
+                                    const std::vector<std::string> &dictionaryAttrs, unsigned fillFactor) {
         RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
+        if (fillFactor == 0 || fillFactor > FULL_FILL_FACTOR) return -1;
+        // only varchar attributes of the table can be dictionary-encoded
+        std::unordered_set<std::string> encodedAttrs;
+        for (const std::string &attrName : dictionaryAttrs) {
+            bool isVarChar = false;
+            for (const Attribute &attr : attrs)
+                if (attr.name == attrName) isVarChar = attr.type == TypeVarChar;
+            if (!isVarChar) return -1;
+            encodedAttrs.insert(attrName);
+        }
+
         // verify Tables and Columns are present to be modified
         std::ifstream ifs{"Tables"};
         if (!ifs.is_open()) return -1;
@@ -164,14 +262,25 @@ namespace PeterDB {
         ifs.close(); ifs.open("Schemas");
         if (!ifs.is_open()) return -1;
         ifs.close();
-
-        if (rbfm.createFile(tableName) == -1) return -1;  // error if table already exists
+        if (openCatalog() == -1) return -1;
+
+        // slotted tables keep zone maps so range scans can skip pages
+        if (rbfm.createFile(tableName, layout, layout == LayoutSlotted) == -1) return -1;  // error if table already exists
+        migrations.erase(tableName);
+        fillFactors.erase(tableName);
+        recordLayouts.erase(tableName);
+        for (const std::string &attrName : encodedAttrs) {
+            // a dictionary left behind by a table file removed by hand is stale
+            dictionaryCache.erase(tableName + '_' + attrName + DICTIONARY_FILE_SUFFIX);
+            rbfm.destroyFile(tableName + '_' + attrName + DICTIONARY_FILE_SUFFIX);
+            if (rbfm.createFile(tableName + '_' + attrName + DICTIONARY_FILE_SUFFIX) == -1) return -1;
+        }
         FileHandle fh;
         char data[150];
         memset(data, 0, 1);
 
         if (rbfm.openFile("Tables", fh) == -1) return -1;
-        if (addTablesEntry(fh, nextTableID, tableName.size(), tableName.c_str(), tableName.size(), tableName.c_str(), 0, data) == -1) return -1;
+        if (addTablesEntry(fh, nextTableID, tableName.size(), tableName.c_str(), tableName.size(), tableName.c_str(), 0, fillFactor, data) == -1) return -1;
         if (rbfm.closeFile(fh) == -1) return -1;
 
         if (rbfm.openFile("Columns", fh) == -1) return -1;
@@ -179,7 +288,8 @@ namespace PeterDB {
         positions[attrs.size()] = '\0';
         int pos = 1;
         for (Attribute attr : attrs) {
-            if (addColumnsEntry(fh, nextTableID, attr.name.size(), attr.name.c_str(), attr.type,attr.length, pos, data) == -1) return -1;
+            int columnType = encodedAttrs.count(attr.name) ? attr.type | DICTIONARY_ENCODED : attr.type;
+            if (addColumnsEntry(fh, nextTableID, attr.name.size(), attr.name.c_str(), columnType, attr.length, pos, data) == -1) return -1;
             positions[pos - 1] = static_cast<char>(pos);
             ++pos;
         }
@@ -191,7 +301,7 @@ namespace PeterDB {
         return rbfm.closeFile(fh);
     }
 
-    RC RelationManager::getTableID(const std::string &tableName, int &tableID, bool deleteEntry, int *isSystemTable) {
+    RC RelationManager::getTableID(const std::string &tableName, int &tableID, bool deleteEntry, int *isSystemTable, int *fillFactor) {
         RM_ScanIterator scanner;
         std::string tables{"Tables"};
         std::string table_name_field{"table-name"};
@@ -200,14 +310,16 @@ namespace PeterDB {
         std::vector<std::string> neededAttributes;
         neededAttributes.emplace_back("table-id");
         neededAttributes.emplace_back("is-system-table");
+        neededAttributes.emplace_back("fill-factor");
         char value[tableName.size() + INT_BYTES];
         formatString(tableName, value);
         if (scan(tables, table_name_field, EQ_OP, value, neededAttributes, scanner) == -1) {scanner.close(); return -1;}
         RID rid{};
-        char data[15];
+        char data[20];
         if (scanner.getNextTuple(rid, data) == RM_EOF) {scanner.close(); return -1;}
         memmove(&tableID, data + 1, INT_BYTES);
         if (isSystemTable != nullptr) memmove(isSystemTable, data + (1 + INT_BYTES), INT_BYTES);
+        if (fillFactor != nullptr) memmove(fillFactor, data + (1 + 2 * INT_BYTES), INT_BYTES);
 
         if (scanner.close() == -1) return -1;
         if (deleteEntry && isSystemTable && *isSystemTable == 0) {
@@ -219,6 +331,29 @@ namespace PeterDB {
         return 0;
     }
 
+    RC RelationManager::getFillFactor(const std::string &tableName, unsigned &fillFactor) {
+        // the catalog is only scanned the first time a table is written to
+        auto cached = fillFactors.find(tableName);
+        if (cached != fillFactors.end()) {
+            fillFactor = cached->second;
+            return 0;
+        }
+        int tableID, catalogFillFactor;
+        if (getTableID(tableName, tableID, false, nullptr, &catalogFillFactor) == -1) return -1;
+        fillFactor = fillFactors[tableName] = catalogFillFactor;
+        return 0;
+    }
+
+    const RecordLayout *RelationManager::getRecordLayout(const std::string &tableName, int version, const std::vector<Attribute> &storedAttrs) {
+        // a schema version never changes, so its layout is computed the first time the version is written
+        std::unordered_map<int, RecordLayout> &tableLayouts = recordLayouts[tableName];
+        auto cached = tableLayouts.find(version);
+        if (cached != tableLayouts.end()) return &cached->second;
+        RecordLayout &layout = tableLayouts[version];
+        RecordBasedFileManager::instance().getRecordLayout(storedAttrs, layout);
+        return &layout;
+    }
+
     RC RelationManager::deleteTable(const std::string &tableName) {
         RM_ScanIterator scanner;
         std::string columns{"Columns"};
@@ -231,15 +366,23 @@ namespace PeterDB {
         RID rid{};
         char data[120];
 
-        // scan through the Columns table and delete all records associated to the table ID
-        std::vector<std::string> requestedAttributes;
-        requestedAttributes.emplace_back("table-id");
+        // scan through the Columns table and delete all records associated to the table ID, along with any dictionaries
+        std::vector<std::string> requestedAttributes{"column-name", "column-type"};
         if (scan(columns, table_id_str, EQ_OP, &tableID, requestedAttributes, scanner) == -1) {scanner.close(); return -1;}
 
         RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
         std::vector<RID> recordsToDelete;
-        while (scanner.getNextTuple(rid, data) != RM_EOF)
+        int nameLen, columnType;
+        while (scanner.getNextTuple(rid, data) != RM_EOF) {
             recordsToDelete.push_back(rid);
+            memmove(&nameLen, data + 1, INT_BYTES);
+            memmove(&columnType, data + (1 + INT_BYTES + nameLen), INT_BYTES);
+            if (columnType & DICTIONARY_ENCODED) {
+                std::string dictionaryFileName = tableName + '_' + std::string{data + (1 + INT_BYTES), static_cast<size_t>(nameLen)} + DICTIONARY_FILE_SUFFIX;
+                dictionaryCache.erase(dictionaryFileName);
+                rbfm.destroyFile(dictionaryFileName);
+            }
+        }
         if (scanner.close() == -1) return -1;
 
         FileHandle fh;
@@ -250,6 +393,7 @@ namespace PeterDB {
         if (rbfm.closeFile(fh) == -1) return -1;
 
         // scan through the Schemas table to find all schema version records related to this table
+        requestedAttributes = {"table-id"};
         if (scan(schemas, table_id_str, EQ_OP, &tableID, requestedAttributes, scanner) == -1) {scanner.close(); return -1;}
         recordsToDelete.clear();
         while (scanner.getNextTuple(rid, data) != RM_EOF)
@@ -281,12 +425,18 @@ namespace PeterDB {
         }
         if (rbfm.closeFile(fh) == -1) return -1;
 
+        migrations.erase(tableName);
+        fillFactors.erase(tableName);
+        recordLayouts.erase(tableName);
         return RecordBasedFileManager::instance().destroyFile(tableName);
     }
 
     RC RelationManager::getAttributes(const std::string &tableName, std::vector<Attribute> &attrs, int *isSystemTable, int *version,
-                                      std::unordered_map<std::string, int> *attrPositions, const std::string &specificAttr) {
+                                      std::unordered_map<std::string, int> *attrPositions, const std::string &specificAttr,
+                                      std::unordered_set<std::string> *dictionaryAttrs) {
         attrs = std::vector<Attribute>{};
+        if (dictionaryAttrs) dictionaryAttrs->clear();
+        if (openCatalog() == -1) return -1;
         if (tableName == "Tables" || tableName == "Columns" || tableName == "Schemas" || tableName == "Indices") {
             if (tableName == "Tables") attrs = tablesDescriptor;
             else if (tableName == "Columns") attrs = columnsDescriptor;
@@ -335,7 +485,9 @@ namespace PeterDB {
             name[nameLen] = '\0';
             attr.name = name;
             ptr += nameLen;
-            memmove(&attr.type, ptr, INT_BYTES);
+            int columnType;
+            memmove(&columnType, ptr, INT_BYTES);
+            attr.type = static_cast<AttrType>(columnType & ~DICTIONARY_ENCODED);
             ptr += INT_BYTES;
             memmove(&attr.length, ptr, INT_BYTES);
             ptr += INT_BYTES;
@@ -343,11 +495,14 @@ namespace PeterDB {
             if (specificAttr.empty()) {
                 int pos;
                 memmove(&pos, ptr, INT_BYTES);
-                if (positions.find(pos) != positions.end())
+                if (positions.find(pos) != positions.end()) {
                     attrOrdering[pos] = attr;
+                    if (dictionaryAttrs && (columnType & DICTIONARY_ENCODED)) dictionaryAttrs->insert(attr.name);
+                }
             } else {
                 if (attr.name == specificAttr) {
                     attrs.push_back(attr);
+                    if (dictionaryAttrs && (columnType & DICTIONARY_ENCODED)) dictionaryAttrs->insert(attr.name);
                     break;
                 }
             }
@@ -395,6 +550,71 @@ namespace PeterDB {
         return scanner.close();
     }
 
+    // attribute names of an index, more than one for a composite index
+    static std::vector<std::string> indexAttributeNames(const std::string &indexName) {
+        std::vector<std::string> names;
+        size_t start = 0, end;
+        while ((end = indexName.find(COMPOSITE_INDEX_SEPARATOR, start)) != std::string::npos) {
+            names.push_back(indexName.substr(start, end - start));
+            start = end + 1;
+        }
+        names.push_back(indexName.substr(start));
+        return names;
+    }
+
+    static std::string compositeIndexName(const std::vector<std::string> &attributeNames) {
+        std::string indexName;
+        for (const std::string &name : attributeNames)
+            indexName += (indexName.empty() ? "" : std::string(1, COMPOSITE_INDEX_SEPARATOR)) + name;
+        return indexName;
+    }
+
+    RC RelationManager::registerIndex(int tableID, const std::string &indexName, const std::string &fileName, IndexKind kind) {
+        if (IndexManager::instance().createFile(fileName, kind) == -1) return -1;
+        FileHandle fh;
+        RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
+        if (rbfm.openFile("Indices", fh) == -1) return -1;
+        char recoEntry[1 + INT_BYTES + INT_BYTES + indexName.size() + INT_BYTES + fileName.size()];
+        memset(recoEntry, 0, 1);
+        if (addIndicesEntry(fh, tableID, indexName.size(), indexName.c_str(),
+                 fileName.size(), fileName.c_str(), recoEntry) == -1) return -1;
+        return rbfm.closeFile(fh);
+    }
+
+    RC RelationManager::getKeyAttributes(const std::string &tableName, const std::vector<std::string> &attributeNames, std::vector<Attribute> &keyAttrs) {
+        std::vector<Attribute> attrs;
+        if (getAttributes(tableName, attrs) == -1) return -1;
+        keyAttrs.clear();
+        for (const std::string &name : attributeNames) {
+            auto attr = std::find_if(attrs.begin(), attrs.end(), [&name](const Attribute &a) {return a.name == name;});
+            bool repeated = std::any_of(keyAttrs.begin(), keyAttrs.end(), [&name](const Attribute &a) {return a.name == name;});
+            if (attr == attrs.end() || repeated) return -1;
+            keyAttrs.push_back(*attr);
+        }
+        return 0;
+    }
+
+    RC RelationManager::compositeIndexKey(const std::vector<Attribute> &attrs, const void *data, const std::string &indexName, Attribute &keyAttr, char *key) {
+        RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
+        std::vector<const char *> fields;
+        rbfm.locateFields(attrs, data, fields);
+        std::vector<int> attrIndexes;
+        std::vector<Attribute> keyAttrs;
+        for (const std::string &name : indexAttributeNames(indexName)) {
+            auto attr = std::find_if(attrs.begin(), attrs.end(), [&name](const Attribute &a) {return a.name == name;});
+            if (attr == attrs.end()) return -1;     // the tuple does not cover the index
+            attrIndexes.push_back(attr - attrs.begin());
+            keyAttrs.push_back(*attr);
+        }
+
+        char keyTuple[PAGE_SIZE];
+        rbfm.projectFields(attrs, fields, attrIndexes, keyTuple);
+        IndexManager & ix = IndexManager::instance();
+        keyAttr = ix.compositeAttribute(keyAttrs);
+        ix.encodeCompositeKey(keyAttrs, keyTuple, key);
+        return 0;
+    }
+
     RC RelationManager::updateIndexFiles(const std::string &tableName, const std::vector<Attribute> &attrs, const void *data, const RID &rid, bool isInsertion) {
         int tableID;
         if (getTableID(tableName, tableID, false, nullptr) == -1) return -1;
@@ -432,19 +652,252 @@ namespace PeterDB {
             else
                 dataPtr += attr.length;
         }
+
+        for (const auto &indexFile : attrIndexFiles) {
+            if (indexFile.first.find(COMPOSITE_INDEX_SEPARATOR) == std::string::npos) continue;
+            char key[2 * PAGE_SIZE];
+            if (compositeIndexKey(attrs, data, indexFile.first, attr, key) == -1) return -1;
+            if (ix.openFile(indexFile.second, iFh) == -1) return -1;
+            RC status = isInsertion ? ix.insertEntry(iFh, attr, key, rid) : ix.deleteEntry(iFh, attr, key, rid);
+            if (ix.closeFile(iFh) == -1 || status == -1) return -1;
+        }
+        return 0;
+    }
+
+    RC RelationManager::updateIndexEntries(const std::string &tableName, const std::vector<Attribute> &attrs, const void *oldData,
+                                           const void *newData, const RID &rid) {
+        int tableID;
+        if (getTableID(tableName, tableID, false, nullptr) == -1) return -1;
+        std::unordered_map<std::string, std::string> attrIndexFiles;
+        if (getIndexFiles(tableID, attrIndexFiles) == -1) return -1;
+        if (attrIndexFiles.empty()) return 0;
+
+        // only the indexes whose key changed are touched
+        IXFileHandle iFh;
+        IndexManager & ix = IndexManager::instance();
+        RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
+        SizeType nullFlagBytes = rbfm.nullBytesNeeded(attrs.size());
+        const char *oldPtr = static_cast<const char *>(oldData) + nullFlagBytes;
+        const char *newPtr = static_cast<const char *>(newData) + nullFlagBytes;
+        for (SizeType i = 0; i < attrs.size(); ++i) {
+            int bitNum = i % BITS_PER_BYTE + 1;
+            bool oldNull = rbfm.nullBitOn(static_cast<const char *>(oldData)[i / BITS_PER_BYTE], bitNum);
+            bool newNull = rbfm.nullBitOn(static_cast<const char *>(newData)[i / BITS_PER_BYTE], bitNum);
+            unsigned oldBytes = oldNull ? 0 : attrs[i].length, newBytes = newNull ? 0 : attrs[i].length;
+            if (attrs[i].type == TypeVarChar) {
+                int varcharLen;
+                if (!oldNull) {
+                    memmove(&varcharLen, oldPtr, INT_BYTES);
+                    oldBytes = INT_BYTES + varcharLen;
+                }
+                if (!newNull) {
+                    memmove(&varcharLen, newPtr, INT_BYTES);
+                    newBytes = INT_BYTES + varcharLen;
+                }
+            }
+
+            bool changed = oldNull != newNull || oldBytes != newBytes || memcmp(oldPtr, newPtr, oldBytes) != 0;
+            if (changed && attrIndexFiles.find(attrs[i].name) != attrIndexFiles.end()) {
+                if (ix.openFile(attrIndexFiles[attrs[i].name], iFh) == -1) return -1;
+                if (!oldNull && ix.deleteEntry(iFh, attrs[i], oldPtr, rid) == -1) {ix.closeFile(iFh); return -1;}
+                if (!newNull && ix.insertEntry(iFh, attrs[i], newPtr, rid) == -1) {ix.closeFile(iFh); return -1;}
+                if (ix.closeFile(iFh) == -1) return -1;
+            }
+            oldPtr += oldBytes;
+            newPtr += newBytes;
+        }
+
+        // a composite index is only touched when the tuples cover all of its attributes
+        for (const auto &indexFile : attrIndexFiles) {
+            if (indexFile.first.find(COMPOSITE_INDEX_SEPARATOR) == std::string::npos) continue;
+            Attribute keyAttr;
+            char oldKey[2 * PAGE_SIZE], newKey[2 * PAGE_SIZE];
+            if (compositeIndexKey(attrs, oldData, indexFile.first, keyAttr, oldKey) == -1 ||
+                compositeIndexKey(attrs, newData, indexFile.first, keyAttr, newKey) == -1) continue;
+            int keyLen;
+            memmove(&keyLen, oldKey, INT_BYTES);
+            if (memcmp(oldKey, newKey, INT_BYTES + keyLen) == 0) continue;
+            if (ix.openFile(indexFile.second, iFh) == -1) return -1;
+            if (ix.deleteEntry(iFh, keyAttr, oldKey, rid) == -1 || ix.insertEntry(iFh, keyAttr, newKey, rid) == -1) {ix.closeFile(iFh); return -1;}
+            if (ix.closeFile(iFh) == -1) return -1;
+        }
+        return 0;
+    }
+
+    void RelationManager::storedDescriptor(std::vector<Attribute> &attrs, const std::unordered_set<std::string> &dictionaryAttrs) {
+        // records hold a 4-byte code in place of each dictionary-encoded value
+        for (Attribute &attr : attrs) {
+            if (dictionaryAttrs.find(attr.name) != dictionaryAttrs.end()) {
+                attr.type = TypeInt;
+                attr.length = INT_BYTES;
+            }
+        }
+    }
+
+    RC RelationManager::cachedDictionary(const std::string &fileName, Dictionary *&dictionary) {
+        auto cached = dictionaryCache.find(fileName);
+        if (cached != dictionaryCache.end()) {
+            dictionary = &cached->second;
+            return 0;
+        }
+
+        RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
+        FileHandle *fh = new FileHandle{};
+        if (rbfm.openFile(fileName, *fh) == -1) {
+            delete fh;
+            return -1;
+        }
+        RBFM_ScanIterator scanner;
+        std::vector<std::string> neededValues{"code", "value"};
+        rbfm.scan(*fh, dictionaryDescriptor, "", NO_OP, nullptr, neededValues, scanner);
+
+        // the value of each code is placed at that index
+        Dictionary loaded;
+        RID rid{};
+        char data[PAGE_SIZE];
+        int code, valueLen;
+        while (scanner.getNextRecord(rid, data) != RBFM_EOF) {
+            memmove(&code, data + 1, INT_BYTES);
+            memmove(&valueLen, data + (1 + INT_BYTES), INT_BYTES);
+            if (code >= static_cast<int>(loaded.values.size())) loaded.values.resize(code + 1);
+            loaded.values[code] = std::string{data + (1 + INT_BYTES + INT_BYTES), static_cast<size_t>(valueLen)};
+            loaded.codes[loaded.values[code]] = code;
+        }
+        if (scanner.close() == -1) return -1;
+        dictionary = &(dictionaryCache[fileName] = std::move(loaded));
+        return 0;
+    }
+
+    RC RelationManager::loadDictionary(const std::string &tableName, const std::string &attrName, std::vector<std::string> &values) {
+        Dictionary *dictionary;
+        if (cachedDictionary(tableName + '_' + attrName + DICTIONARY_FILE_SUFFIX, dictionary) == -1) return -1;
+        values = dictionary->values;
+        return 0;
+    }
+
+    RC RelationManager::loadDictionaries(const std::string &tableName, const std::unordered_set<std::string> &dictionaryAttrs,
+                                         std::unordered_map<std::string, std::vector<std::string>> &dictionaries) {
+        dictionaries.clear();
+        for (const std::string &attrName : dictionaryAttrs) {
+            if (loadDictionary(tableName, attrName, dictionaries[attrName]) == -1) return -1;
+        }
+        return 0;
+    }
+
+    RC RelationManager::encodeTuple(const std::string &tableName, const std::vector<Attribute> &attrs, const std::unordered_set<std::string> &dictionaryAttrs,
+                                    const void *data, void *encoded) {
+        RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
+        SizeType nullByteCount = rbfm.nullBytesNeeded(attrs.size());
+        memmove(encoded, data, nullByteCount);
+        const char *dataPtr = static_cast<const char *>(data) + nullByteCount;
+        char *encodedPtr = static_cast<char *>(encoded) + nullByteCount;
+        unsigned char nullByte;
+        int varcharLen;
+
+        for (SizeType i = 0; i < attrs.size(); ++i) {
+            memmove(&nullByte, static_cast<const char *>(data) + i / BITS_PER_BYTE, 1);
+            if (rbfm.nullBitOn(nullByte, i % BITS_PER_BYTE + 1)) continue;
+
+            if (attrs[i].type != TypeVarChar) {
+                memmove(encodedPtr, dataPtr, attrs[i].length);
+                dataPtr += attrs[i].length;
+                encodedPtr += attrs[i].length;
+                continue;
+            }
+            memmove(&varcharLen, dataPtr, INT_BYTES);
+            if (dictionaryAttrs.find(attrs[i].name) == dictionaryAttrs.end()) {
+                memmove(encodedPtr, dataPtr, INT_BYTES + varcharLen);
+                encodedPtr += INT_BYTES + varcharLen;
+            } else {
+                // a value missing from the dictionary is appended to it with the next code
+                std::string fileName = tableName + '_' + attrs[i].name + DICTIONARY_FILE_SUFFIX;
+                Dictionary *dictionary;
+                if (cachedDictionary(fileName, dictionary) == -1) return -1;
+                std::string value{dataPtr + INT_BYTES, static_cast<size_t>(varcharLen)};
+                auto known = dictionary->codes.find(value);
+                int code = known != dictionary->codes.end() ? known->second : static_cast<int>(dictionary->values.size());
+                if (known == dictionary->codes.end()) {
+                    FileHandle fh;
+                    if (rbfm.openFile(fileName, fh) == -1) return -1;
+                    char entry[1 + INT_BYTES + INT_BYTES + varcharLen];
+                    memset(entry, 0, 1);
+                    memmove(entry + 1, &code, INT_BYTES);
+                    memmove(entry + (1 + INT_BYTES), dataPtr, INT_BYTES + varcharLen);
+                    RID rid{};
+                    if (rbfm.insertRecord(fh, dictionaryDescriptor, entry, rid) == -1) {rbfm.closeFile(fh); return -1;}
+                    if (rbfm.closeFile(fh) == -1) return -1;
+                    dictionary->values.push_back(value);
+                    dictionary->codes[value] = code;
+                }
+                memmove(encodedPtr, &code, INT_BYTES);
+                encodedPtr += INT_BYTES;
+            }
+            dataPtr += INT_BYTES + varcharLen;
+        }
         return 0;
     }
 
+    void RelationManager::decodeTuple(const std::vector<Attribute> &attrs, const std::unordered_map<std::string, std::vector<std::string>> &dictionaries, void *data) {
+        RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
+        char decoded[PAGE_SIZE];
+        SizeType nullByteCount = rbfm.nullBytesNeeded(attrs.size());
+        memmove(decoded, data, nullByteCount);
+        const char *dataPtr = static_cast<const char *>(data) + nullByteCount;
+        char *decodedPtr = decoded + nullByteCount;
+        unsigned char nullByte;
+        int code, varcharLen;
+
+        for (SizeType i = 0; i < attrs.size(); ++i) {
+            memmove(&nullByte, static_cast<const char *>(data) + i / BITS_PER_BYTE, 1);
+            if (rbfm.nullBitOn(nullByte, i % BITS_PER_BYTE + 1)) continue;
+
+            auto dictionary = dictionaries.find(attrs[i].name);
+            if (dictionary != dictionaries.end()) {
+                // codes are replaced by their values
+                memmove(&code, dataPtr, INT_BYTES);
+                dataPtr += INT_BYTES;
+                std::string value = code >= 0 && code < static_cast<int>(dictionary->second.size()) ? dictionary->second[code] : "";
+                varcharLen = value.size();
+                memmove(decodedPtr, &varcharLen, INT_BYTES);
+                memmove(decodedPtr + INT_BYTES, value.data(), varcharLen);
+                decodedPtr += INT_BYTES + varcharLen;
+            } else if (attrs[i].type == TypeVarChar) {
+                memmove(&varcharLen, dataPtr, INT_BYTES);
+                memmove(decodedPtr, dataPtr, INT_BYTES + varcharLen);
+                dataPtr += INT_BYTES + varcharLen;
+                decodedPtr += INT_BYTES + varcharLen;
+            } else {
+                memmove(decodedPtr, dataPtr, attrs[i].length);
+                dataPtr += attrs[i].length;
+                decodedPtr += attrs[i].length;
+            }
+        }
+        memmove(data, decoded, decodedPtr - decoded);
+    }
+
     RC RelationManager::insertTuple(const std::string &tableName, const void *data, RID &rid) {
         std::vector<Attribute> recordDescriptor;
+        std::unordered_set<std::string> dictionaryAttrs;
         int isSystemTable = 0, version = 0;
-        if (getAttributes(tableName, recordDescriptor, &isSystemTable, &version) == -1) return -1;
+        if (getAttributes(tableName, recordDescriptor, &isSystemTable, &version, nullptr, "", &dictionaryAttrs) == -1) return -1;
         if (isSystemTable == 1) return -1;
 
+        // dictionary-encoded attributes are stored as their codes
+        std::vector<Attribute> storedAttrs = recordDescriptor;
+        char encodedData[PAGE_SIZE];
+        const void *storedData = data;
+        if (!dictionaryAttrs.empty()) {
+            if (encodeTuple(tableName, recordDescriptor, dictionaryAttrs, data, encodedData) == -1) return -1;
+            storedDescriptor(storedAttrs, dictionaryAttrs);
+            storedData = encodedData;
+        }
+
         FileHandle fh;
         RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
+        if (getFillFactor(tableName, fh.fillFactor) == -1) return -1;
         if (rbfm.openFile(tableName, fh) == -1) return -1;
-        if (rbfm.insertRecord(fh, recordDescriptor, data, rid, version) == -1) {rbfm.closeFile(fh); return -1;}
+        fh.recordLayout = getRecordLayout(tableName, version, storedAttrs);
+        if (rbfm.insertRecord(fh, storedAttrs, storedData, rid, version) == -1) {rbfm.closeFile(fh); return -1;}
         if (rbfm.closeFile(fh) == -1) return -1;
 
         return updateIndexFiles(tableName, recordDescriptor, data, rid, true);
@@ -452,8 +905,9 @@ namespace PeterDB {
 
     RC RelationManager::deleteTuple(const std::string &tableName, const RID &rid) {
         std::vector<Attribute> recordDescriptor;
+        std::unordered_set<std::string> dictionaryAttrs;
         int isSystemTable = 0;
-        if (getAttributes(tableName, recordDescriptor, &isSystemTable) == -1) return -1;
+        if (getAttributes(tableName, recordDescriptor, &isSystemTable, nullptr, nullptr, "", &dictionaryAttrs) == -1) return -1;
         if (isSystemTable == 1) return -1;
 
         char data[PAGE_SIZE];
@@ -461,8 +915,10 @@ namespace PeterDB {
 
         FileHandle fh;
         RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
+        std::vector<Attribute> storedAttrs = recordDescriptor;
+        storedDescriptor(storedAttrs, dictionaryAttrs);
         if (rbfm.openFile(tableName, fh) == -1) return -1;
-        if (rbfm.deleteRecord(fh, recordDescriptor, rid) == -1) {rbfm.closeFile(fh); return -1;}
+        if (rbfm.deleteRecord(fh, storedAttrs, rid) == -1) {rbfm.closeFile(fh); return -1;}
         if (rbfm.closeFile(fh) == -1) return -1;
 
         return updateIndexFiles(tableName, recordDescriptor, data, rid, false);
@@ -470,21 +926,80 @@ namespace PeterDB {
 
     RC RelationManager::updateTuple(const std::string &tableName, const void *data, const RID &rid) {
         std::vector<Attribute> recordDescriptor;
+        std::unordered_set<std::string> dictionaryAttrs;
         int isSystemTable = 0, version = 0;
-        if (getAttributes(tableName, recordDescriptor, &isSystemTable, &version) == -1) return -1;
+        if (getAttributes(tableName, recordDescriptor, &isSystemTable, &version, nullptr, "", &dictionaryAttrs) == -1) return -1;
         if (isSystemTable == 1) return -1;
 
         char oldData[PAGE_SIZE];
         if (readTuple(tableName, rid, oldData) == -1) return -1;
 
+        std::vector<Attribute> storedAttrs = recordDescriptor;
+        char encodedData[PAGE_SIZE];
+        const void *storedData = data;
+        if (!dictionaryAttrs.empty()) {
+            if (encodeTuple(tableName, recordDescriptor, dictionaryAttrs, data, encodedData) == -1) return -1;
+            storedDescriptor(storedAttrs, dictionaryAttrs);
+            storedData = encodedData;
+        }
+
         FileHandle fh;
         RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
+        if (getFillFactor(tableName, fh.fillFactor) == -1) return -1;  // records forwarded off a full page honour it too
         if (rbfm.openFile(tableName, fh) == -1) return -1;
-        if (rbfm.updateRecord(fh, recordDescriptor, data, rid, version) == -1) {rbfm.closeFile(fh); return -1;}
+        fh.recordLayout = getRecordLayout(tableName, version, storedAttrs);
+        if (rbfm.updateRecord(fh, storedAttrs, storedData, rid, version) == -1) {rbfm.closeFile(fh); return -1;}
         if (rbfm.closeFile(fh) == -1) return -1;
 
-        if (updateIndexFiles(tableName, recordDescriptor, oldData, rid, false) == -1) return -1;
-        return updateIndexFiles(tableName, recordDescriptor, data, rid, true);
+        return updateIndexEntries(tableName, recordDescriptor, oldData, data, rid);
+    }
+
+    RC RelationManager::updateAttribute(const std::string &tableName, const RID &rid, const std::string &attributeName, const void *data) {
+        std::vector<Attribute> recordDescriptor;
+        std::unordered_set<std::string> dictionaryAttrs;
+        int isSystemTable = 0, version = 0;
+        if (getAttributes(tableName, recordDescriptor, &isSystemTable, &version, nullptr, "", &dictionaryAttrs) == -1) return -1;
+        if (isSystemTable == 1) return -1;
+        SizeType attrIndex = 0;
+        while (attrIndex < recordDescriptor.size() && recordDescriptor[attrIndex].name != attributeName) ++attrIndex;
+        if (attrIndex == recordDescriptor.size()) return -1;
+        std::vector<Attribute> storedAttrs = recordDescriptor;
+        storedDescriptor(storedAttrs, dictionaryAttrs);
+        int tableID;
+        std::unordered_map<std::string, std::string> attrIndexFiles;
+        if (getTableID(tableName, tableID, false, nullptr) == -1 || getIndexFiles(tableID, attrIndexFiles) == -1) return -1;
+        bool inCompositeIndex = false;
+        for (const auto &indexFile : attrIndexFiles) {
+            if (indexFile.first.find(COMPOSITE_INDEX_SEPARATOR) == std::string::npos) continue;
+            std::vector<std::string> names = indexAttributeNames(indexFile.first);
+            if (std::find(names.begin(), names.end(), attributeName) != names.end()) inCompositeIndex = true;
+        }
+
+        FileHandle fh;
+        RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
+        if (getFillFactor(tableName, fh.fillFactor) == -1) return -1;
+        if (rbfm.openFile(tableName, fh) == -1) return -1;
+        fh.recordLayout = getRecordLayout(tableName, version, storedAttrs);
+        char oldValue[PAGE_SIZE];
+        SizeType recoVersion = 0;
+        bool inPlace = fh.pageLayout == LayoutSlotted && dictionaryAttrs.find(attributeName) == dictionaryAttrs.end() && !inCompositeIndex;
+        // the one lookup yields both the version and the value the index entries are keyed on
+        if (inPlace && rbfm.readAttribute(fh, storedAttrs, rid, attributeName, oldValue, &recoVersion) == -1) {rbfm.closeFile(fh); return -1;}
+
+        if (!inPlace || recoVersion != version) {
+            // encoded values, composite keys, other layouts and records of older schema versions go through the whole tuple
+            if (rbfm.closeFile(fh) == -1) return -1;
+            char oldData[PAGE_SIZE], newData[PAGE_SIZE];
+            if (readTuple(tableName, rid, oldData) == -1) return -1;
+            rbfm.spliceAttribute(recordDescriptor, oldData, attrIndex, data, newData);
+            return updateTuple(tableName, newData, rid);
+        }
+
+        if (rbfm.updateAttribute(fh, storedAttrs, rid, attributeName, data, version) == -1) {rbfm.closeFile(fh); return -1;}
+        if (rbfm.closeFile(fh) == -1) return -1;
+
+        std::vector<Attribute> attr{recordDescriptor[attrIndex]};
+        return updateIndexEntries(tableName, attr, oldValue, data, rid);
     }
 
     void RelationManager::convertDataToCurrSchema(void *data, const std::vector<Attribute> &currDescriptor, const std::vector<Attribute> &recordDescriptor,
@@ -554,26 +1069,88 @@ namespace PeterDB {
     RC RelationManager::readTuple(const std::string &tableName, const RID &rid, void *data) {
         std::vector<Attribute> currentDescriptor;
         std::unordered_map<std::string, int> attrToPos;
+        std::unordered_set<std::string> dictionaryAttrs;
         int currVersion = 0;
-        if (getAttributes(tableName, currentDescriptor, nullptr, &currVersion, &attrToPos) == -1) return -1;
+        if (getAttributes(tableName, currentDescriptor, nullptr, &currVersion, &attrToPos, "", &dictionaryAttrs) == -1) return -1;
+        std::vector<Attribute> storedAttrs = currentDescriptor;
+        storedDescriptor(storedAttrs, dictionaryAttrs);
         FileHandle fh;
         RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
         if (rbfm.openFile(tableName, fh) == -1) return -1;
         SizeType version;
-        if (rbfm.readRecord(fh, currentDescriptor, rid, data, &version) == -1) {rbfm.closeFile(fh); return -1;}
+        if (rbfm.readRecord(fh, storedAttrs, rid, data, &version) == -1) {rbfm.closeFile(fh); return -1;}
 
-        if (version == currVersion) {
-            if (rbfm.readRecord(fh, currentDescriptor, rid, data) == -1) {rbfm.closeFile(fh); return -1;}
-        } else {
+        // a slotted tuple of an older version is read in that version's layout, and only needs converting
+        if (version != currVersion) {
             std::vector<Attribute> recordDescriptor;
             std::unordered_map<std::string, int> recordVersionAttrPos;
+            std::unordered_set<std::string> recordDictionaryAttrs;
             int versionInt = static_cast<int>(version);
-            if (getAttributes(tableName, recordDescriptor, nullptr, &versionInt, &recordVersionAttrPos) == -1) {rbfm.closeFile(fh); return -1;}
-            if (rbfm.readRecord(fh, recordDescriptor, rid, data) == -1) {rbfm.closeFile(fh); return -1;}
-            convertDataToCurrSchema(data, currentDescriptor, recordDescriptor, attrToPos, recordVersionAttrPos);
+            if (getAttributes(tableName, recordDescriptor, nullptr, &versionInt, &recordVersionAttrPos, "", &recordDictionaryAttrs) == -1) {rbfm.closeFile(fh); return -1;}
+            storedDescriptor(recordDescriptor, recordDictionaryAttrs);
+            if (fh.pageLayout != LayoutSlotted && rbfm.readRecord(fh, recordDescriptor, rid, data) == -1) {rbfm.closeFile(fh); return -1;}
+            convertDataToCurrSchema(data, storedAttrs, recordDescriptor, attrToPos, recordVersionAttrPos);
         }
+        if (rbfm.closeFile(fh) == -1) return -1;
 
-        return rbfm.closeFile(fh);
+        if (dictionaryAttrs.empty()) return 0;
+        std::unordered_map<std::string, std::vector<std::string>> dictionaries;
+        if (loadDictionaries(tableName, dictionaryAttrs, dictionaries) == -1) return -1;
+        decodeTuple(currentDescriptor, dictionaries, data);
+        return 0;
+    }
+
+    RC RelationManager::readTuples(const std::string &tableName, const std::vector<RID> &rids, void *data, std::vector<unsigned> &offsets) {
+        std::vector<Attribute> currentDescriptor;
+        std::unordered_map<std::string, int> attrToPos;
+        std::unordered_set<std::string> dictionaryAttrs;
+        int currVersion = 0;
+        if (getAttributes(tableName, currentDescriptor, nullptr, &currVersion, &attrToPos, "", &dictionaryAttrs) == -1) return -1;
+        std::vector<Attribute> storedAttrs = currentDescriptor;
+        storedDescriptor(storedAttrs, dictionaryAttrs);
+        FileHandle fh;
+        RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
+        if (rbfm.openFile(tableName, fh) == -1) return -1;
+        std::vector<SizeType> versions;
+        if (rbfm.readRecords(fh, storedAttrs, rids, data, offsets, &versions) == -1) {rbfm.closeFile(fh); return -1;}
+        if (rbfm.closeFile(fh) == -1) return -1;
+
+        bool converted = !dictionaryAttrs.empty();
+        for (SizeType version : versions) converted = converted || version != currVersion;
+        if (!converted) return 0;
+
+        // tuples of older versions or with encoded values change length, so the batch is laid out again
+        std::unordered_map<int, std::vector<Attribute>> recordDescriptors;
+        std::unordered_map<int, std::unordered_map<std::string, int>> recordAttrPositions;
+        recordDescriptors[currVersion] = storedAttrs;
+        unsigned rawLength = 0;
+        for (unsigned i = 0; i < rids.size(); ++i) {
+            int version = versions[i];
+            if (recordDescriptors.find(version) == recordDescriptors.end()) {
+                std::unordered_set<std::string> recordDictionaryAttrs;
+                if (getAttributes(tableName, recordDescriptors[version], nullptr, &version, &recordAttrPositions[version], "", &recordDictionaryAttrs) == -1) return -1;
+                storedDescriptor(recordDescriptors[version], recordDictionaryAttrs);
+            }
+            rawLength = std::max(rawLength, offsets[i] + rbfm.recordLength(recordDescriptors[version], static_cast<char *>(data) + offsets[i]));
+        }
+        std::vector<char> raw(static_cast<char *>(data), static_cast<char *>(data) + rawLength);
+        std::unordered_map<std::string, std::vector<std::string>> dictionaries;
+        if (!dictionaryAttrs.empty() && loadDictionaries(tableName, dictionaryAttrs, dictionaries) == -1) return -1;
+
+        char tuple[PAGE_SIZE];
+        unsigned used = 0;
+        for (unsigned i = 0; i < rids.size(); ++i) {
+            int version = versions[i];
+            memmove(tuple, raw.data() + offsets[i], rbfm.recordLength(recordDescriptors[version], raw.data() + offsets[i]));
+            if (version != currVersion)
+                convertDataToCurrSchema(tuple, storedAttrs, recordDescriptors[version], attrToPos, recordAttrPositions[version]);
+            if (!dictionaryAttrs.empty()) decodeTuple(currentDescriptor, dictionaries, tuple);
+            unsigned length = rbfm.recordLength(currentDescriptor, tuple);
+            memmove(static_cast<char *>(data) + used, tuple, length);
+            offsets[i] = used;
+            used += length;
+        }
+        return 0;
     }
 
     RC RelationManager::printTuple(const std::vector<Attribute> &attrs, const void *data, std::ostream &out) {
@@ -584,8 +1161,10 @@ namespace PeterDB {
                                       void *data) {
         std::vector<Attribute> currentDescriptor;
         std::unordered_map<std::string, int> attrToPos;
+        std::unordered_set<std::string> dictionaryAttrs;
         int currVersion = 0;
-        if (getAttributes(tableName, currentDescriptor, nullptr, &currVersion, &attrToPos) == -1) return -1;
+        if (getAttributes(tableName, currentDescriptor, nullptr, &currVersion, &attrToPos, "", &dictionaryAttrs) == -1) return -1;
+        storedDescriptor(currentDescriptor, dictionaryAttrs);
 
         FileHandle fh;
         RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
@@ -593,21 +1172,70 @@ namespace PeterDB {
         SizeType version;
         if (rbfm.readAttribute(fh, currentDescriptor, rid, attributeName, data, &version) == -1) {rbfm.closeFile(fh); return -1;}
 
-        if (version == currVersion) {
-            if (rbfm.readAttribute(fh, currentDescriptor, rid, attributeName, data) == -1) {rbfm.closeFile(fh); return -1;}
-        } else {
+        // the value read along with the version only stands for records of the current version
+        if (version != currVersion) {
             std::vector<Attribute> recordDescriptor;
             std::unordered_map<std::string, int> recordVersionAttrPos;
+            std::unordered_set<std::string> recordDictionaryAttrs;
             int versionInt = static_cast<int>(version);
-            if (getAttributes(tableName, recordDescriptor, nullptr, &versionInt, &recordVersionAttrPos) == -1) {rbfm.closeFile(fh); return -1;}
+            if (getAttributes(tableName, recordDescriptor, nullptr, &versionInt, &recordVersionAttrPos, "", &recordDictionaryAttrs) == -1) {rbfm.closeFile(fh); return -1;}
+            storedDescriptor(recordDescriptor, recordDictionaryAttrs);
 
             if (recordVersionAttrPos.find(attributeName) != recordVersionAttrPos.end() && attrToPos[attributeName] == recordVersionAttrPos[attributeName]) {
                 if (rbfm.readAttribute(fh, recordDescriptor, rid, attributeName, data) == -1) {rbfm.closeFile(fh); return -1;}
             } else
                 memset(data, 128, 1);
         }
+        if (rbfm.closeFile(fh) == -1) return -1;
 
-        return rbfm.closeFile(fh);
+        if (dictionaryAttrs.find(attributeName) == dictionaryAttrs.end()) return 0;
+        std::unordered_map<std::string, std::vector<std::string>> dictionaries;
+        if (loadDictionaries(tableName, {attributeName}, dictionaries) == -1) return -1;
+        decodeTuple({Attribute{attributeName, TypeVarChar, 0}}, dictionaries, data);
+        return 0;
+    }
+
+    RC RelationManager::readAttributes(const std::string &tableName, const RID &rid, const std::vector<std::string> &attributeNames,
+                                       void *data) {
+        std::vector<Attribute> currentDescriptor;
+        std::unordered_set<std::string> dictionaryAttrs;
+        int currVersion = 0;
+        if (getAttributes(tableName, currentDescriptor, nullptr, &currVersion, nullptr, "", &dictionaryAttrs) == -1) return -1;
+        std::unordered_map<std::string, int> attrIndex;
+        for (SizeType i = 0; i < currentDescriptor.size(); ++i) attrIndex[currentDescriptor[i].name] = i;
+        std::vector<int> attrIndexes;
+        std::vector<Attribute> projectedAttrs;
+        std::unordered_set<std::string> projectedDictionaryAttrs;
+        for (const std::string &name : attributeNames) {
+            if (attrIndex.find(name) == attrIndex.end()) return -1;
+            attrIndexes.push_back(attrIndex[name]);
+            projectedAttrs.push_back(currentDescriptor[attrIndex[name]]);
+            if (dictionaryAttrs.find(name) != dictionaryAttrs.end()) projectedDictionaryAttrs.insert(name);
+        }
+        std::vector<Attribute> storedAttrs = currentDescriptor;
+        storedDescriptor(storedAttrs, dictionaryAttrs);
+
+        FileHandle fh;
+        RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
+        if (rbfm.openFile(tableName, fh) == -1) return -1;
+        SizeType version;
+        if (rbfm.readAttributes(fh, storedAttrs, rid, attrIndexes, data, &version) == -1) {rbfm.closeFile(fh); return -1;}
+        if (rbfm.closeFile(fh) == -1) return -1;
+        if (version != currVersion) {
+            // older tuples are converted whole before projecting
+            char tuple[PAGE_SIZE];
+            if (readTuple(tableName, rid, tuple) == -1) return -1;
+            std::vector<const char *> fields;
+            rbfm.locateFields(currentDescriptor, tuple, fields);
+            rbfm.projectFields(currentDescriptor, fields, attrIndexes, data);
+            return 0;
+        }
+
+        if (projectedDictionaryAttrs.empty()) return 0;
+        std::unordered_map<std::string, std::vector<std::string>> dictionaries;
+        if (loadDictionaries(tableName, projectedDictionaryAttrs, dictionaries) == -1) return -1;
+        decodeTuple(projectedAttrs, dictionaries, data);
+        return 0;
     }
 
     RC RelationManager::scan(const std::string &tableName,
@@ -624,9 +1252,38 @@ namespace PeterDB {
 
         std::vector<Attribute> attrs;
         std::unordered_map<std::string, int> attrToPos;
+        std::unordered_set<std::string> dictionaryAttrs;
         int version = 0;
-        if (getAttributes(tableName, attrs, nullptr, &version, &attrToPos) == -1) return -1;
-        rm_ScanIterator.init(tableName, *fh, attrs, conditionAttribute, compOp, value, attributeNames, version, attrToPos);
+        if (getAttributes(tableName, attrs, nullptr, &version, &attrToPos, "", &dictionaryAttrs) == -1) {
+            RecordBasedFileManager::instance().closeFile(*fh);
+            delete fh;
+            return -1;
+        }
+
+        // conditions on dictionary-encoded attributes compare codes, which only preserve equality
+        int code;
+        std::unordered_map<std::string, std::vector<std::string>> dictionaries;
+        if (!dictionaryAttrs.empty()) {
+            if (loadDictionaries(tableName, dictionaryAttrs, dictionaries) == -1 ||
+                (compOp != NO_OP && compOp != EQ_OP && compOp != NE_OP && dictionaryAttrs.count(conditionAttribute))) {
+                RecordBasedFileManager::instance().closeFile(*fh);
+                delete fh;
+                return -1;
+            }
+            if (compOp != NO_OP && dictionaryAttrs.count(conditionAttribute)) {
+                // a value missing from the dictionary gets a code no record holds
+                const std::vector<std::string> &values = dictionaries[conditionAttribute];
+                std::string target{static_cast<const char *>(value) + INT_BYTES, *static_cast<const unsigned *>(value)};
+                code = std::find(values.begin(), values.end(), target) - values.begin();
+                if (code == values.size()) code = -1;
+                value = &code;
+            }
+            storedDescriptor(attrs, dictionaryAttrs);
+        }
+        if (rm_ScanIterator.init(tableName, *fh, attrs, conditionAttribute, compOp, value, attributeNames, version, attrToPos, dictionaries) == -1) {
+            rm_ScanIterator.close();
+            return -1;
+        }
         return 0;
     }
 
@@ -634,15 +1291,67 @@ namespace PeterDB {
 
     RM_ScanIterator::~RM_ScanIterator() = default;
 
-    void RM_ScanIterator::init(const std::string &tableName, FileHandle & fHandle, const std::vector<Attribute> &recordDescriptor, const std::string &conditionAttribute,
-                  const CompOp compOp, const void *value, const std::vector<std::string> &attributeNames, int version, const std::unordered_map<std::string, int> &attrToPos) {
+    RC RM_ScanIterator::init(const std::string &tableName, FileHandle & fHandle, const std::vector<Attribute> &recordDescriptor, const std::string &conditionAttribute,
+                  const CompOp compOp, const void *value, const std::vector<std::string> &attributeNames, int version, const std::unordered_map<std::string, int> &attrToPos,
+                  const std::unordered_map<std::string, std::vector<std::string>> &attrDictionaries) {
         this->tableName = tableName;
         comparator = compOp;
         schemaVersion = version;
-        attrDescriptor = recordDescriptor;
         attrPositions = attrToPos;
         conditionAttrName = conditionAttribute;
-        recordScanner.init(fHandle, recordDescriptor, conditionAttribute, compOp, value, attributeNames);
+        if (recordScanner.init(fHandle, recordDescriptor, conditionAttribute, compOp, value, attributeNames) == -1) return -1;
+        recordScanner.scanVersion = version;
+
+        // the scanner starts out holding the current version's layout
+        versionLayouts.clear();
+        VersionLayout &current = versionLayouts[version];
+        current.recordDescriptor = recordDescriptor;
+        current.attrNameIndexes = recordScanner.attrNameIndexes;
+        current.attributeNames = attributeNames;
+        current.verifyRecord = true;
+        loadedVersion = version;
+
+        // only the projected encoded attributes are decoded, and are returned as varchar
+        dictionaries.clear();
+        projectedAttrs = recordScanner.projectedDescriptor;
+        for (Attribute &attr : projectedAttrs) {
+            auto dictionary = attrDictionaries.find(attr.name);
+            if (dictionary == attrDictionaries.end()) continue;
+            dictionaries[attr.name] = dictionary->second;
+            attr.type = TypeVarChar;
+        }
+        return 0;
+    }
+
+    RC RM_ScanIterator::loadVersionLayout(int version, bool &verifyRecord) {
+        auto cached = versionLayouts.find(version);
+        if (cached == versionLayouts.end()) {
+            // the catalog is only consulted the first time a scan meets a version
+            VersionLayout layout;
+            std::unordered_map<std::string, int> recoAttrToPos;
+            std::unordered_set<std::string> recoDictionaryAttrs;
+            RelationManager &rm = RelationManager::instance();
+            if (rm.getAttributes(tableName, layout.recordDescriptor, nullptr, &version, &recoAttrToPos, "", &recoDictionaryAttrs) == -1) return -1;
+            rm.storedDescriptor(layout.recordDescriptor, recoDictionaryAttrs);
+            for (int i = 0; i < layout.recordDescriptor.size(); ++i)
+                layout.attrNameIndexes[layout.recordDescriptor[i].name] = i;
+            layout.verifyRecord = (comparator == NO_OP) || (recoAttrToPos.find(conditionAttrName) != recoAttrToPos.end() && recoAttrToPos[conditionAttrName] == attrPositions[conditionAttrName]);
+            layout.attributeNames = versionLayouts[schemaVersion].attributeNames;
+            for (std::string &aname : layout.attributeNames) {
+                if (recoAttrToPos.find(aname) == recoAttrToPos.end() || recoAttrToPos[aname] != attrPositions[aname])
+                    aname.clear();
+            }
+            cached = versionLayouts.emplace(version, std::move(layout)).first;
+        }
+
+        verifyRecord = cached->second.verifyRecord;
+        if (loadedVersion != version) {
+            recordScanner.recordDescriptor = cached->second.recordDescriptor;
+            recordScanner.attrNameIndexes = cached->second.attrNameIndexes;
+            recordScanner.attributeNames = cached->second.attributeNames;
+            loadedVersion = version;
+        }
+        return 0;
     }
 
     RC RM_ScanIterator::getNextTuple(RID &rid, void *data) {
@@ -651,31 +1360,34 @@ namespace PeterDB {
 
         while (true) {
             if (recordScanner.getNextRecord(rid, data, &nextRecoVersion) == -1) return -1;
+            if (loadVersionLayout(nextRecoVersion, verifyRecord) == -1) return -1;
 
-            if (nextRecoVersion == schemaVersion) {
-                recordScanner.recordDescriptor = attrDescriptor;
-                recordScanner.attrNameIndexes.clear();
-                for (int i = 0; i < attrDescriptor.size(); ++i)
-                    recordScanner.attrNameIndexes[attrDescriptor[i].name] = i;
-                verifyRecord = true;
-            } else {
-                std::vector<Attribute> recoDescriptor;
-                std::unordered_map<std::string, int> recoAttrToPos;
-                int nextRecoVersionInt = static_cast<int>(nextRecoVersion);
-                if (RelationManager::instance().getAttributes(tableName, recoDescriptor, nullptr, &nextRecoVersionInt, &recoAttrToPos) == -1) return -1;
-                recordScanner.attrNameIndexes.clear();
-                for (int i = 0; i < recoDescriptor.size(); ++i)
-                    recordScanner.attrNameIndexes[recoDescriptor[i].name] = i;
-                verifyRecord = (comparator == NO_OP) || (recoAttrToPos.find(conditionAttrName) != recoAttrToPos.end() && recoAttrToPos[conditionAttrName] == attrPositions[conditionAttrName]);
-                for (std::string &aname : recordScanner.attributeNames) {
-                    if (recoAttrToPos.find(aname) == recoAttrToPos.end() || recoAttrToPos[aname] != attrPositions[aname])
-                        aname.clear();
-                }
+            if (recordScanner.getNextRecord(rid, data, nullptr, &recoAccepted, &verifyRecord) == -1) return -1;
+            if (recoAccepted) {
+                if (!dictionaries.empty()) RelationManager::instance().decodeTuple(projectedAttrs, dictionaries, data);
+                return 0;
             }
+        }
+    }
 
-            if (recordScanner.getNextRecord(rid, data, nullptr, &recoAccepted, &verifyRecord) == -1) return -1;
-            if (recoAccepted) return 0;
+    RC RM_ScanIterator::getNextBatch(std::vector<RID> &rids, void *data, std::vector<unsigned> &offsets, unsigned maxTuples) {
+        rids.clear();
+        offsets.clear();
+        // the record scanner keeps its cached columnar pages for the whole batch
+        recordScanner.clearColumnCache();
+        recordScanner.batchInProgress = true;
+
+        char *dataPtr = static_cast<char *>(data);
+        unsigned used = 0;
+        RID rid{};
+        while (rids.size() < maxTuples && getNextTuple(rid, dataPtr + used) != RM_EOF) {
+            rids.push_back(rid);
+            offsets.push_back(used);
+            used += RecordBasedFileManager::instance().recordLength(projectedAttrs, dataPtr + used);
         }
+
+        recordScanner.batchInProgress = false;
+        return rids.empty() ? RM_EOF : 0;
     }
 
     RC RM_ScanIterator::close() {
@@ -793,6 +1505,242 @@ namespace PeterDB {
         return rbfm.closeFile(fh);
     }
 
+    RC RelationManager::migrateTable(const std::string &tableName, unsigned maxRecords, unsigned &migrated, bool &done) {
+        migrated = 0;
+        done = false;
+        std::vector<Attribute> currDescriptor;
+        std::unordered_map<std::string, int> currAttrPos;
+        std::unordered_set<std::string> dictionaryAttrs;
+        int isSystemTable = 0, currVersion = 0;
+        if (getAttributes(tableName, currDescriptor, &isSystemTable, &currVersion, &currAttrPos, "", &dictionaryAttrs) == -1) return -1;
+        if (isSystemTable == 1) return -1;
+        storedDescriptor(currDescriptor, dictionaryAttrs);
+
+        // a schema change since the last call starts the migration over
+        MigrationProgress &progress = migrations[tableName];
+        if (progress.version != currVersion) progress = MigrationProgress{currVersion, RID{0, 1}};
+        RID &next = progress.next;
+
+        FileHandle fh;
+        RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
+        if (getFillFactor(tableName, fh.fillFactor) == -1) return -1;  // records that outgrow their page are placed as inserts are
+        if (rbfm.openFile(tableName, fh) == -1) return -1;
+        fh.recordLayout = getRecordLayout(tableName, currVersion, currDescriptor);
+        std::unordered_map<int, std::vector<Attribute>> recoDescriptors;
+        std::unordered_map<int, std::unordered_map<std::string, int>> recoAttrPositions;
+        std::vector<RID> rids;
+        std::vector<SizeType> versions;
+        char data[PAGE_SIZE];
+
+        for (; next.pageNum < fh.pageCount; ++next.pageNum, next.slotNum = 1) {
+            if (rbfm.getPageRecords(fh, next.pageNum, rids, versions) == -1) {rbfm.closeFile(fh); return -1;}
+            for (int i = 0; i < rids.size(); ++i) {
+                if (rids[i].slotNum < next.slotNum || versions[i] == currVersion) continue;
+                if (migrated == maxRecords) {
+                    next.slotNum = rids[i].slotNum;
+                    return rbfm.closeFile(fh);
+                }
+
+                int version = versions[i];
+                if (recoDescriptors.find(version) == recoDescriptors.end()) {
+                    std::unordered_set<std::string> recoDictionaryAttrs;
+                    if (getAttributes(tableName, recoDescriptors[version], nullptr, &version, &recoAttrPositions[version], "", &recoDictionaryAttrs) == -1) {rbfm.closeFile(fh); return -1;}
+                    storedDescriptor(recoDescriptors[version], recoDictionaryAttrs);
+                }
+                // records are rewritten where they are stored, so they only move if they outgrow their page
+                if (rbfm.readRecord(fh, recoDescriptors[version], rids[i], data) == -1) {rbfm.closeFile(fh); return -1;}
+                convertDataToCurrSchema(data, currDescriptor, recoDescriptors[version], currAttrPos, recoAttrPositions[version]);
+                if (rbfm.updateRecord(fh, currDescriptor, data, rids[i], currVersion) == -1) {rbfm.closeFile(fh); return -1;}
+                ++migrated;
+            }
+        }
+
+        done = true;
+        return rbfm.closeFile(fh);
+    }
+
+    RC RelationManager::sampleTable(const std::string &tableName, unsigned maxPages, unsigned sampleSize, unsigned seed,
+                                    std::vector<RID> &rids, void *data, std::vector<unsigned> &offsets, SampleStats &stats) {
+        int tableID, isSystemTable;
+        if (getTableID(tableName, tableID, false, &isSystemTable) == -1) return -1;
+        if (isSystemTable == 1) return -1;
+
+        FileHandle fh;
+        RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
+        if (rbfm.openFile(tableName, fh) == -1) return -1;
+        if (rbfm.sampleRecords(fh, maxPages, sampleSize, seed, rids, stats) == -1) {rbfm.closeFile(fh); return -1;}
+        if (rbfm.closeFile(fh) == -1) return -1;
+        return readTuples(tableName, rids, data, offsets);
+    }
+
+    RC RelationManager::vacuumTable(const std::string &tableName, ChainStats &stats, bool reportOnly) {
+        int tableID, isSystemTable;
+        if (getTableID(tableName, tableID, false, &isSystemTable) == -1) return -1;
+        if (isSystemTable == 1) return -1;
+
+        FileHandle fh;
+        RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
+        if (rbfm.openFile(tableName, fh) == -1) return -1;
+        if (rbfm.vacuum(fh, stats, reportOnly) == -1) {rbfm.closeFile(fh); return -1;}
+        return rbfm.closeFile(fh);
+    }
+
+    RC RelationManager::analyzeTable(const std::string &tableName, HeapStats &stats) {
+        int tableID;
+        if (getTableID(tableName, tableID, false, nullptr) == -1) return -1;
+
+        FileHandle fh;
+        RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
+        if (rbfm.openFile(tableName, fh) == -1) return -1;
+        if (rbfm.analyze(fh, stats) == -1) {rbfm.closeFile(fh); return -1;}
+        return rbfm.closeFile(fh);
+    }
+
+    RC RelationManager::rebuildTable(const std::string &tableName) {
+        std::vector<Attribute> attrs;
+        std::unordered_map<std::string, int> currAttrPos;
+        std::unordered_set<std::string> dictionaryAttrs;
+        int tableID, isSystemTable = 0, currVersion = 0;
+        if (getAttributes(tableName, attrs, &isSystemTable, &currVersion, &currAttrPos, "", &dictionaryAttrs) == -1) return -1;
+        if (isSystemTable == 1) return -1;
+        if (getTableID(tableName, tableID, false, nullptr) == -1) return -1;
+        std::vector<Attribute> currDescriptor = attrs;
+        storedDescriptor(currDescriptor, dictionaryAttrs);
+        std::unordered_map<std::string, std::vector<std::string>> dictionaries;
+        if (loadDictionaries(tableName, dictionaryAttrs, dictionaries) == -1) return -1;
+        std::unordered_map<std::string, std::string> attrIndexFiles;
+        if (getIndexFiles(tableID, attrIndexFiles) == -1) return -1;
+
+        RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
+        IndexManager & ix = IndexManager::instance();
+        FileHandle fh, newFh;
+        if (getFillFactor(tableName, newFh.fillFactor) == -1) return -1;
+        if (finishRebuild(tableName) == -1) return -1;    // an earlier rebuild that committed is swapped in first
+        if (rbfm.openFile(tableName, fh) == -1) return -1;
+        std::string newFileName = tableName + REBUILD_FILE_SUFFIX;
+        rbfm.destroyFile(newFileName);      // left over from a rebuild that failed
+        if (fh.pageLayout != LayoutSlotted || rbfm.createFile(newFileName, LayoutSlotted, fh.zoneMap != nullptr) == -1) {
+            rbfm.closeFile(fh);
+            return -1;
+        }
+
+        RC status = rbfm.openFile(newFileName, newFh);
+        newFh.recordLayout = getRecordLayout(tableName, currVersion, currDescriptor);
+        std::unordered_map<std::string, IXFileHandle> indexHandles;
+        std::unordered_map<std::string, IX_BulkLoader> indexLoaders;
+        for (const auto &indexFile : attrIndexFiles) {
+            if (status == -1) break;
+            std::string newIndexName = indexFile.second + REBUILD_FILE_SUFFIX;
+            ix.destroyFile(newIndexName);   // left over from a rebuild that failed
+            IXFileHandle oldIndex;
+            if (ix.openFile(indexFile.second, oldIndex) == -1) {status = -1; break;}
+            auto kind = static_cast<IndexKind>(oldIndex.pageLayout);
+            if (ix.closeFile(oldIndex) == -1) {status = -1; break;}
+            if (ix.createFile(newIndexName, kind) == -1 || ix.openFile(newIndexName, indexHandles[indexFile.first]) == -1) {status = -1; break;}
+            std::vector<Attribute> keyAttrs;
+            if (getKeyAttributes(tableName, indexAttributeNames(indexFile.first), keyAttrs) == -1) {status = -1; break;}
+            Attribute indexAttr = keyAttrs.size() == 1 ? keyAttrs[0] : ix.compositeAttribute(keyAttrs);
+            indexLoaders[indexFile.first].init(indexHandles[indexFile.first], indexAttr, std::min(newFh.fillFactor, static_cast<unsigned>(DEFAULT_INDEX_FILL_FACTOR)));
+        }
+
+        // records are decoded from their page as it is read, so a table is read once and written once
+        std::unordered_map<int, std::vector<Attribute>> recoDescriptors;
+        std::unordered_map<int, std::unordered_map<std::string, int>> recoAttrPositions;
+        std::vector<RID> rids;
+        std::vector<SizeType> versions;
+        std::vector<unsigned> offsets;
+        char pageRecords[PAGE_SIZE], data[PAGE_SIZE];
+        for (unsigned pageNum = 0; status == 0 && pageNum < fh.pageCount; ++pageNum) {
+            if (rbfm.getPageRecords(fh, pageNum, rids, versions, pageRecords, &offsets) == -1) {status = -1; break;}
+            for (size_t i = 0; status == 0 && i < rids.size(); ++i) {
+                int version = versions[i];
+                if (recoDescriptors.find(version) == recoDescriptors.end()) {
+                    std::unordered_set<std::string> recoDictionaryAttrs;
+                    if (getAttributes(tableName, recoDescriptors[version], nullptr, &version, &recoAttrPositions[version], "", &recoDictionaryAttrs) == -1) {status = -1; break;}
+                    storedDescriptor(recoDescriptors[version], recoDictionaryAttrs);
+                }
+                // records are converted or decoded apart from the page's other records, as either may lengthen them
+                RID newRid;
+                const char *record = pageRecords + offsets[i];
+                if (version != currVersion) {
+                    memmove(data, record, rbfm.recordLength(recoDescriptors[version], record));
+                    convertDataToCurrSchema(data, currDescriptor, recoDescriptors[version], currAttrPos, recoAttrPositions[version]);
+                    record = data;
+                }
+                if (rbfm.insertRecord(newFh, currDescriptor, record, newRid, currVersion) == -1) {status = -1; break;}
+                if (indexLoaders.empty()) continue;
+                if (record != data) memmove(data, record, rbfm.recordLength(currDescriptor, record, newFh.recordLayout));
+
+                // index keys are the values, not the codes of dictionary-encoded attributes
+                if (!dictionaries.empty()) decodeTuple(attrs, dictionaries, data);
+                const char *dataPtr = data + rbfm.nullBytesNeeded(attrs.size());
+                unsigned char nullByte;
+                for (SizeType j = 0; j < attrs.size(); ++j) {
+                    memmove(&nullByte, data + j / BITS_PER_BYTE, 1);
+                    if (rbfm.nullBitOn(nullByte, j % BITS_PER_BYTE + 1)) continue;
+                    auto indexLoader = indexLoaders.find(attrs[j].name);
+                    if (indexLoader != indexLoaders.end() && indexLoader->second.addEntry(dataPtr, newRid) == -1) status = -1;
+                    dataPtr += attrs[j].type == TypeVarChar ? INT_BYTES + *reinterpret_cast<const int *>(dataPtr) : attrs[j].length;
+                }
+                for (auto &indexLoader : indexLoaders) {
+                    if (indexLoader.first.find(COMPOSITE_INDEX_SEPARATOR) == std::string::npos) continue;
+                    Attribute keyAttr;
+                    char key[2 * PAGE_SIZE];
+                    if (compositeIndexKey(attrs, data, indexLoader.first, keyAttr, key) == -1 ||
+                        indexLoader.second.addEntry(key, newRid) == -1) status = -1;
+                }
+            }
+        }
+
+        for (auto &indexLoader : indexLoaders)
+            if (status == 0 && indexLoader.second.finish() == -1) status = -1;
+        for (auto &indexHandle : indexHandles)
+            if (ix.closeFile(indexHandle.second) == -1) status = -1;
+        if (newFh.file.is_open() && rbfm.closeFile(newFh) == -1) status = -1;
+        if (rbfm.closeFile(fh) == -1) status = -1;
+        if (status == -1) {
+            for (const auto &indexFile : attrIndexFiles) ix.destroyFile(indexFile.second + REBUILD_FILE_SUFFIX);
+            rbfm.destroyFile(newFileName);
+            return -1;
+        }
+
+        // every file is complete: the manifest naming them commits the rebuild, as it appears in one rename
+        std::string manifestName = tableName + REBUILD_MANIFEST_SUFFIX;
+        std::ofstream manifest(manifestName + REBUILD_FILE_SUFFIX, std::ios::trunc);
+        for (const auto &indexFile : attrIndexFiles) manifest << indexFile.second << '\n';
+        manifest << tableName << '\n';
+        manifest.close();
+        if (manifest.fail() || PagedFileManager::instance().renameFile(manifestName + REBUILD_FILE_SUFFIX, manifestName) == -1) {
+            for (const auto &indexFile : attrIndexFiles) ix.destroyFile(indexFile.second + REBUILD_FILE_SUFFIX);
+            rbfm.destroyFile(newFileName);
+            return -1;
+        }
+        migrations.erase(tableName);    // nothing is left to migrate
+        return finishRebuild(tableName);
+    }
+
+    RC RelationManager::finishRebuild(const std::string &tableName) {
+        // each file named by a committed rebuild is swapped in, unless an attempt cut short already did
+        std::string manifestName = tableName + REBUILD_MANIFEST_SUFFIX;
+        std::ifstream manifest(manifestName);
+        if (!manifest.is_open()) return 0;
+        std::string fileName;
+        RC status = 0;
+        while (status == 0 && std::getline(manifest, fileName)) {
+            std::ifstream rebuilt(fileName + REBUILD_FILE_SUFFIX);
+            if (!rebuilt.is_open()) continue;
+            rebuilt.close();
+            // the table file is listed last, and brings its zone map along
+            if (fileName == tableName)
+                status = RecordBasedFileManager::instance().renameFile(fileName + REBUILD_FILE_SUFFIX, fileName);
+            else
+                status = IndexManager::instance().renameFile(fileName + REBUILD_FILE_SUFFIX, fileName);
+        }
+        manifest.close();
+        if (status == -1) return -1;
+        return PagedFileManager::instance().destroyFile(manifestName);
+    }
+
     RC RelationManager::addIndicesEntry(FileHandle &fh, int table_id, int attrNameLen, const char *attrName, int fileNameLen, const char *fileName, char *data) {
         std::vector<tupleVal> values{tupleVal{table_id}, tupleVal{attrNameLen}, tupleVal{attrName}, tupleVal{fileNameLen}, tupleVal{fileName}};
         craftTupleData(data + 1, values);
@@ -801,22 +1749,22 @@ namespace PeterDB {
     }
 
     // QE IX related
-    RC RelationManager::createIndex(const std::string &tableName, const std::string &attributeName) {
+    RC RelationManager::createIndex(const std::string &tableName, const std::string &attributeName, unsigned fillFactor) {
+        // varchar keys tend to share long prefixes, and to repeat, which their nodes then store once
+        std::vector<Attribute> attrInfo;
+        if (getAttributes(tableName, attrInfo, nullptr, nullptr, nullptr, attributeName) == -1 || attrInfo.empty()) return -1;
+        return createIndex(tableName, attributeName, attrInfo[0].type == TypeVarChar ? IndexPostingBTree : IndexBTree, fillFactor);
+    }
+
+    RC RelationManager::createIndex(const std::string &tableName, const std::string &attributeName, IndexKind kind, unsigned fillFactor) {
         int tableID, isSystemTable;
+        if (fillFactor == 0 || fillFactor > FULL_FILL_FACTOR) return -1;
         if (getTableID(tableName, tableID, false, &isSystemTable) == -1) return -1;
         if (isSystemTable == 1) return -1;
-        RecordBasedFileManager & rbfm = RecordBasedFileManager::instance();
         IndexManager & ix = IndexManager::instance();
 
         std::string fileName = tableName + '_' + attributeName + ".idx";
-        if (ix.createFile(fileName) == -1) return -1;
-        FileHandle fh;
-        if (rbfm.openFile("Indices", fh) == -1) return -1;
-        char recoEntry[1 + INT_BYTES + INT_BYTES + attributeName.size() + INT_BYTES + fileName.size()];
-        memset(recoEntry, 0, 1);
-        if (addIndicesEntry(fh, tableID, attributeName.size(), attributeName.c_str(),
-                 fileName.size(), fileName.c_str(), recoEntry) == -1) return -1;
-        if (rbfm.closeFile(fh) == -1) return -1;
+        if (registerIndex(tableID, attributeName, fileName, kind) == -1) return -1;
 
         RM_ScanIterator scanner;
         std::vector<std::string> requestedAttr;
@@ -831,18 +1779,62 @@ namespace PeterDB {
         Attribute attribute = attrInfo[0];
 
         RC status = 0;
+        IX_BulkLoader loader;
+        loader.init(iFh, attribute, fillFactor);
         unsigned char key[attribute.length + INT_BYTES + 1];
         while (scanner.getNextTuple(rid, key) != RM_EOF) {
             if (key[0] == 0) {
-                if (ix.insertEntry(iFh, attribute, key + 1, rid) == -1) status = -1;
+                if (loader.addEntry(key + 1, rid) == -1) status = -1;
             }
         }
 
         if (scanner.close() == -1) status = -1;
+        if (status == 0 && loader.finish() == -1) status = -1;
+        if (ix.closeFile(iFh) == -1) status = -1;
+        return status;
+    }
+
+    RC RelationManager::createIndex(const std::string &tableName, const std::vector<std::string> &attributeNames, unsigned fillFactor) {
+        if (attributeNames.size() == 1) return createIndex(tableName, attributeNames[0], fillFactor);
+        int tableID, isSystemTable;
+        if (attributeNames.empty() || fillFactor == 0 || fillFactor > FULL_FILL_FACTOR) return -1;
+        if (getTableID(tableName, tableID, false, &isSystemTable) == -1) return -1;
+        if (isSystemTable == 1) return -1;
+        std::vector<Attribute> keyAttrs;
+        if (getKeyAttributes(tableName, attributeNames, keyAttrs) == -1) return -1;
+        // the catalog keeps the joined names where an index on one attribute keeps its name
+        std::string indexName = compositeIndexName(attributeNames);
+        if (indexName.size() > indicesDescriptor[1].length) return -1;
+        IndexManager & ix = IndexManager::instance();
+
+        std::string fileName = tableName + '_' + indexName + ".idx";
+        if (registerIndex(tableID, indexName, fileName, IndexPostingBTree) == -1) return -1;
+
+        RM_ScanIterator scanner;
+        if (scan(tableName, "", NO_OP, nullptr, attributeNames, scanner) == -1) return -1;
+        IXFileHandle iFh;
+        if (ix.openFile(fileName, iFh) == -1) {scanner.close(); return -1;}
+
+        RC status = 0;
+        RID rid{};
+        IX_BulkLoader loader;
+        loader.init(iFh, ix.compositeAttribute(keyAttrs), fillFactor);
+        char tuple[PAGE_SIZE], key[2 * PAGE_SIZE];
+        while (scanner.getNextTuple(rid, tuple) != RM_EOF) {
+            ix.encodeCompositeKey(keyAttrs, tuple, key);
+            if (loader.addEntry(key, rid) == -1) status = -1;
+        }
+
+        if (scanner.close() == -1) status = -1;
+        if (status == 0 && loader.finish() == -1) status = -1;
         if (ix.closeFile(iFh) == -1) status = -1;
         return status;
     }
 
+    RC RelationManager::destroyIndex(const std::string &tableName, const std::vector<std::string> &attributeNames) {
+        return destroyIndex(tableName, compositeIndexName(attributeNames));
+    }
+
     RC RelationManager::destroyIndex(const std::string &tableName, const std::string &attributeName){
         RM_ScanIterator scanner;
         int tableID, isSystemTable;
@@ -885,35 +1877,87 @@ namespace PeterDB {
                  const void *highKey,
                  bool lowKeyInclusive,
                  bool highKeyInclusive,
-                 RM_IndexScanIterator &rm_IndexScanIterator){
+                 RM_IndexScanIterator &rm_IndexScanIterator,
+                 bool descending){
         int tableID;
         if (getTableID(tableName, tableID, false, nullptr) == -1) return -1;
         std::string indexFileName;
         if (getIndexFile(tableID, attributeName, indexFileName) == -1) return -1;
-        std::vector<Attribute> attrInfo;
-        if (getAttributes(tableName, attrInfo, nullptr, nullptr, nullptr, attributeName) == -1) return -1;
+        std::vector<Attribute> keyAttrs;
+        if (getKeyAttributes(tableName, indexAttributeNames(attributeName), keyAttrs) == -1) return -1;
 
+        IndexManager & ix = IndexManager::instance();
         IXFileHandle *iFh = new IXFileHandle;
-        if (IndexManager::instance().openFile(indexFileName, *iFh) == -1) {delete iFh; return -1;}
-        rm_IndexScanIterator.init(iFh, attrInfo[0], lowKey, highKey, lowKeyInclusive, highKeyInclusive);
+        if (ix.openFile(indexFileName, *iFh) == -1) {delete iFh; return -1;}
+        // hash buckets keep no order to scan backwards in
+        if (descending && iFh->pageLayout == IndexHash) {delete iFh; return -1;}
+        if (keyAttrs.size() == 1)
+            rm_IndexScanIterator.init(iFh, keyAttrs[0], lowKey, highKey, lowKeyInclusive, highKeyInclusive, {}, descending);
+        else
+            rm_IndexScanIterator.init(iFh, ix.compositeAttribute(keyAttrs), lowKey, highKey, lowKeyInclusive, highKeyInclusive, keyAttrs,
+                                      descending);
         return 0;
     }
 
+    RC RelationManager::indexScan(const std::string &tableName, const std::vector<std::string> &attributeNames, const void *prefix,
+                                  unsigned prefixCount, RM_IndexScanIterator &rm_IndexScanIterator, bool descending) {
+        if (attributeNames.size() < 2 || prefixCount > attributeNames.size()) return -1;
+        std::string indexName = compositeIndexName(attributeNames);
+        if (prefixCount == 0) return indexScan(tableName, indexName, nullptr, nullptr, true, true, rm_IndexScanIterator, descending);
+
+        std::vector<Attribute> keyAttrs;
+        if (getKeyAttributes(tableName, attributeNames, keyAttrs) == -1) return -1;
+        char lowKey[2 * PAGE_SIZE], highKey[2 * PAGE_SIZE];
+        IndexManager::instance().compositePrefixRange(keyAttrs, prefix, prefixCount, lowKey, highKey);
+        return indexScan(tableName, indexName, lowKey, highKey, true, true, rm_IndexScanIterator, descending);
+    }
+
 
     RM_IndexScanIterator::RM_IndexScanIterator() = default;
 
     RM_IndexScanIterator::~RM_IndexScanIterator() = default;
 
     void RM_IndexScanIterator::init(IXFileHandle *iFh, const Attribute &attr, const void *lowKey, const void *highKey,
-                                    bool lowKeyInclusive, bool highKeyInclusive) {
+                                    bool lowKeyInclusive, bool highKeyInclusive, const std::vector<Attribute> &keyAttrs, bool descending) {
         this->iFh = iFh;
-        ixScanner.init(*iFh, attr, lowKey, highKey, lowKeyInclusive, highKeyInclusive);
+        this->attr = attr;
+        this->descending = descending;
+        this->keyAttrs = keyAttrs;
+        rescan(lowKey, highKey, lowKeyInclusive, highKeyInclusive);
+    }
+
+    RC RM_IndexScanIterator::rescan(const void *lowKey, const void *highKey, bool lowKeyInclusive, bool highKeyInclusive) {
+        if (iFh == nullptr) return -1;
+        auto keyBytes = [this](const void *key) -> size_t {
+            if (key == nullptr) return 0;
+            return attr.type == TypeVarChar ? INT_BYTES + *static_cast<const int *>(key) : attr.length;
+        };
+        size_t lowBytes = keyBytes(lowKey), highBytes = keyBytes(highKey);
+        rangeKeys.resize(lowBytes + highBytes);
+        if (lowKey != nullptr) memmove(rangeKeys.data(), lowKey, lowBytes);
+        if (highKey != nullptr) memmove(rangeKeys.data() + lowBytes, highKey, highBytes);
+        return IndexManager::instance().scan(*iFh, attr, lowKey == nullptr ? nullptr : rangeKeys.data(),
+                                             highKey == nullptr ? nullptr : rangeKeys.data() + lowBytes, lowKeyInclusive, highKeyInclusive,
+                                             ixScanner, descending);
     }
 
     RC RM_IndexScanIterator::getNextEntry(RID &rid, void *key){
         return ixScanner.getNextEntry(rid, key);
     }
 
+    RC RM_IndexScanIterator::getNextKeyTuple(RID &rid, void *data) {
+        if (!keyAttrs.empty()) {
+            char key[2 * PAGE_SIZE];
+            if (ixScanner.getNextEntry(rid, key) == IX_EOF) return RM_EOF;
+            IndexManager::instance().decodeCompositeKey(keyAttrs, key, data);
+            return 0;
+        }
+        // null values are never indexed, so the null indicator is always clear
+        char *tuple = static_cast<char *>(data);
+        *tuple = 0;
+        return ixScanner.getNextEntry(rid, tuple + 1);
+    }
+
     RC RM_IndexScanIterator::close(){
         if (iFh != nullptr) {
             delete iFh;
@@ -1,4 +1,5 @@
 #include <random>
+#include <thread>
 
 #include "src/include/ix.h"
 #include "test/utils/ix_test_utils.h"
@@ -1272,6 +1273,629 @@ namespace PeterDBTesting {
         validateTree(stream, 1, 1, 0, 2, true);
     }
 
+    TEST_F(IX_Test, search_real_keys_in_nodes) {
+        // Functions tested
+        // 1. Insert real keys with duplicates in scrambled order
+        // 2. Scan ranges starting in the middle of leaves
+        // 3. Delete entries found by exact search
+
+        unsigned numOfKeys = 500, copies = 4;
+        for (unsigned c = 0; c < copies; c++) {
+            for (unsigned i = 0; i < numOfKeys; i++) {
+                unsigned k = (i * 197) % numOfKeys;
+                float key = (float) k / 2;
+                rid = PeterDB::RID{k, (unsigned short) c};
+                ASSERT_EQ(ix.insertEntry(ixFileHandle, heightAttr, &key, rid), success)
+                                            << "indexManager::insertEntry() should succeed.";
+            }
+        }
+
+        float lowKey = 100.0, highKey = 150.0, key, prevKey = lowKey;
+        ASSERT_EQ(ix.scan(ixFileHandle, heightAttr, &lowKey, &highKey, false, true, ix_ScanIterator), success)
+                                    << "indexManager::scan() should succeed.";
+        unsigned count = 0;
+        while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+            ASSERT_GT(key, lowKey);
+            ASSERT_LE(key, highKey);
+            ASSERT_GE(key, prevKey) << "Entries should be returned in order.";
+            ASSERT_EQ(rid.pageNum, (unsigned) (key * 2));
+            prevKey = key;
+            count++;
+        }
+        ASSERT_EQ(count, 100 * copies);
+        ASSERT_EQ(ix_ScanIterator.close(), success) << "IX_ScanIterator::close() should succeed.";
+
+        // every copy of a key is found by its RID, once
+        key = 120.5;
+        for (unsigned short c = 0; c < copies; c++) {
+            rid = PeterDB::RID{241, c};
+            ASSERT_EQ(ix.deleteEntry(ixFileHandle, heightAttr, &key, rid), success)
+                                        << "indexManager::deleteEntry() should succeed.";
+            ASSERT_NE(ix.deleteEntry(ixFileHandle, heightAttr, &key, rid), success)
+                                        << "A deleted entry should not be found again.";
+        }
+        lowKey = highKey = key;
+        ASSERT_EQ(ix.scan(ixFileHandle, heightAttr, &lowKey, &highKey, true, true, ix_ScanIterator), success);
+        ASSERT_EQ(ix_ScanIterator.getNextEntry(rid, &key), IX_EOF) << "No copy of the key should be left.";
+        ASSERT_EQ(ix_ScanIterator.close(), success) << "IX_ScanIterator::close() should succeed.";
+    }
+
+    TEST_F(IX_Test, merge_frees_pages_for_reuse) {
+        // Functions tested
+        // 1. Insert entries, then delete every other one while scanning the rest
+        // 2. Delete the rest, merging the tree down to an empty root
+        // 3. Insert again into the pages freed by the merges
+
+        unsigned numOfEntries = 3000;
+        for (unsigned i = 0; i < numOfEntries; i++) {
+            int key = (int) ((i * 7919) % numOfEntries);
+            ASSERT_EQ(ix.insertEntry(ixFileHandle, ageAttr, &key, PeterDB::RID{(unsigned) key, 1}), success)
+                                        << "indexManager::insertEntry() should succeed.";
+        }
+        unsigned pages = ixFileHandle.getNumberOfPages();
+
+        int key, prevKey = -1;
+        unsigned count = 0;
+        ASSERT_EQ(ix.scan(ixFileHandle, ageAttr, nullptr, nullptr, true, true, ix_ScanIterator), success);
+        while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+            ASSERT_EQ(key, prevKey + 1) << "The scan should go on past the merges.";
+            prevKey = key;
+            if (count++ % 2 == 0)
+                ASSERT_EQ(ix.deleteEntry(ixFileHandle, ageAttr, &key, rid), success)
+                                            << "indexManager::deleteEntry() should succeed.";
+        }
+        ASSERT_EQ(count, numOfEntries);
+        ASSERT_EQ(ix_ScanIterator.close(), success);
+
+        for (int k = 1; k < (int) numOfEntries; k += 2)
+            ASSERT_EQ(ix.deleteEntry(ixFileHandle, ageAttr, &k, PeterDB::RID{(unsigned) k, 1}), success)
+                                        << "indexManager::deleteEntry() should succeed.";
+        std::stringstream stream;
+        ASSERT_EQ(ix.printBTree(ixFileHandle, ageAttr, stream), success);
+        validateTree(stream, 0, 0, 0, 1, true);
+
+        ASSERT_EQ(ixFileHandle.collectCounterValues(rc, wc, ac), success);
+        for (unsigned i = 0; i < numOfEntries; i++) {
+            key = (int) ((i * 7919) % numOfEntries);
+            ASSERT_EQ(ix.insertEntry(ixFileHandle, ageAttr, &key, PeterDB::RID{(unsigned) key, 1}), success)
+                                        << "indexManager::insertEntry() should succeed.";
+        }
+        ASSERT_EQ(ixFileHandle.collectCounterValues(rcAfter, wcAfter, acAfter), success);
+        EXPECT_EQ(acAfter - ac, 0) << "Splits should take freed pages before appending.";
+        EXPECT_EQ(ixFileHandle.getNumberOfPages(), pages);
+    }
+
+    TEST_F(IX_Test, scan_survives_merges_through_another_handle) {
+        // Functions tested
+        // 1. Scan an index while a second handle on its file deletes entries ahead of the scan
+        // 2. The deletes merge and free the leaves the scan would go to next, and inserts take the freed pages
+        // 3. The scan returns each remaining entry once, in order, and skips the freed leaves
+
+        unsigned numOfEntries = 3000;
+        std::set<int> expected;
+        for (unsigned i = 0; i < numOfEntries; i++) {
+            int key = (int) ((i * 7919) % numOfEntries);
+            ASSERT_EQ(ix.insertEntry(ixFileHandle, ageAttr, &key, PeterDB::RID{(unsigned) key, 1}), success)
+                                        << "indexManager::insertEntry() should succeed.";
+            expected.insert(key);
+        }
+        ASSERT_EQ(ix.closeFile(ixFileHandle), success) << "indexManager::closeFile() should succeed.";
+        ASSERT_EQ(ix.openFile(indexFileName, ixFileHandle), success) << "indexManager::openFile() should succeed.";
+
+        int key;
+        std::vector<int> scanned;
+        ASSERT_EQ(ix.scan(ixFileHandle, ageAttr, nullptr, nullptr, true, true, ix_ScanIterator), success);
+        while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+            scanned.push_back(key);
+            if (key != 500) continue;
+            PeterDB::IXFileHandle writer;
+            ASSERT_EQ(ix.openFile(indexFileName, writer), success) << "indexManager::openFile() should succeed.";
+            for (int k = 501; k < 2500; k++) {
+                ASSERT_EQ(ix.deleteEntry(writer, ageAttr, &k, PeterDB::RID{(unsigned) k, 1}), success)
+                                            << "indexManager::deleteEntry() should succeed.";
+                expected.erase(k);
+            }
+            for (int k = 5000; k < 5600; k++) {
+                ASSERT_EQ(ix.insertEntry(writer, ageAttr, &k, PeterDB::RID{(unsigned) k, 1}), success)
+                                            << "indexManager::insertEntry() should succeed.";
+                expected.insert(k);
+            }
+            ASSERT_EQ(ix.closeFile(writer), success) << "indexManager::closeFile() should succeed.";
+        }
+        ASSERT_EQ(ix_ScanIterator.close(), success);
+
+        // entries of the leaf the scan was on when they were deleted may still be returned
+        for (unsigned i = 1; i < scanned.size(); i++)
+            ASSERT_LT(scanned[i - 1], scanned[i]) << "The scan should return entries once, in order.";
+        for (int k : scanned)
+            ASSERT_TRUE(expected.count(k) || (k > 500 && k < 2500)) << "The scan should not return entries of freed leaves.";
+        for (int k : expected)
+            ASSERT_TRUE(std::binary_search(scanned.begin(), scanned.end(), k)) << "The scan should return every remaining entry.";
+    }
+
+    TEST_F(IX_Test, bulk_load_packs_leaves) {
+        // Functions tested
+        // 1. Bulk load entries added out of order, spilling sorted runs
+        // 2. Scan the loaded index, then insert and delete in it
+        // 3. Bulk load varchar keys
+        // 4. Bulk load at the default fill factor, then insert into every leaf without splitting
+
+        unsigned numOfKeys = 10000, copies = 3;
+        PeterDB::IX_BulkLoader loader;
+        loader.init(ixFileHandle, ageAttr, 100, 16 * PAGE_SIZE);
+        for (unsigned i = 0; i < numOfKeys * copies; i++) {
+            int key = (int) ((i * 7919) % numOfKeys);
+            ASSERT_EQ(loader.addEntry(&key, PeterDB::RID{i, (unsigned short) (i % 100)}), success);
+        }
+        ASSERT_EQ(loader.finish(), success) << "IX_BulkLoader::finish() should succeed.";
+        // entries of 10 bytes, packed full, need fewer pages than this
+        ASSERT_LE(ixFileHandle.getNumberOfPages(), numOfKeys * copies * 10 / PAGE_SIZE + 4) << "Leaves should be packed.";
+
+        int key, prevKey = -1;
+        ASSERT_EQ(ix.scan(ixFileHandle, ageAttr, nullptr, nullptr, true, true, ix_ScanIterator), success);
+        unsigned count = 0;
+        while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+            ASSERT_GE(key, prevKey) << "Entries should be returned in order.";
+            ASSERT_EQ((rid.pageNum * 7919) % numOfKeys, key);
+            prevKey = key;
+            count++;
+        }
+        ASSERT_EQ(count, numOfKeys * copies);
+        ASSERT_EQ(ix_ScanIterator.close(), success);
+
+        key = 5000;
+        ASSERT_EQ(ix.insertEntry(ixFileHandle, ageAttr, &key, PeterDB::RID{7, 7}), success);
+        int lowKey = 5000, highKey = 5009;
+        ASSERT_EQ(ix.scan(ixFileHandle, ageAttr, &lowKey, &highKey, true, true, ix_ScanIterator), success);
+        count = 0;
+        while (ix_ScanIterator.getNextEntry(rid, &key) == success) count++;
+        ASSERT_EQ(count, 10 * copies + 1);
+        ASSERT_EQ(ix_ScanIterator.close(), success);
+        key = 5000;
+        ASSERT_EQ(ix.deleteEntry(ixFileHandle, ageAttr, &key, PeterDB::RID{7, 7}), success);
+
+        std::string varcharIndexFileName = "bulk_varchar_idx";
+        PeterDB::IXFileHandle varcharFileHandle;
+        remove(varcharIndexFileName.c_str());
+        ASSERT_EQ(ix.createFile(varcharIndexFileName), success);
+        ASSERT_EQ(ix.openFile(varcharIndexFileName, varcharFileHandle), success);
+        loader.init(varcharFileHandle, empNameAttr, 80, 4 * PAGE_SIZE);
+        char varcharKey[PAGE_SIZE];
+        for (unsigned i = 0; i < numOfKeys; i++) {
+            std::string name = std::to_string((i * 7919) % numOfKeys);
+            *(int *) varcharKey = (int) name.size();
+            memcpy(varcharKey + sizeof(int), name.data(), name.size());
+            ASSERT_EQ(loader.addEntry(varcharKey, PeterDB::RID{i, 1}), success);
+        }
+        ASSERT_EQ(loader.finish(), success) << "IX_BulkLoader::finish() should succeed.";
+
+        std::string prevName;
+        ASSERT_EQ(ix.scan(varcharFileHandle, empNameAttr, nullptr, nullptr, true, true, ix_ScanIterator), success);
+        count = 0;
+        while (ix_ScanIterator.getNextEntry(rid, varcharKey) == success) {
+            std::string name(varcharKey + sizeof(int), *(int *) varcharKey);
+            ASSERT_GE(name, prevName) << "Entries should be returned in order.";
+            ASSERT_EQ(name, std::to_string((rid.pageNum * 7919) % numOfKeys));
+            prevName = name;
+            count++;
+        }
+        ASSERT_EQ(count, numOfKeys);
+        ASSERT_EQ(ix_ScanIterator.close(), success);
+        ASSERT_EQ(ix.closeFile(varcharFileHandle), success);
+        ASSERT_EQ(ix.destroyFile(varcharIndexFileName), success);
+
+        std::string defaultIndexFileName = "bulk_default_idx";
+        PeterDB::IXFileHandle defaultFileHandle;
+        remove(defaultIndexFileName.c_str());
+        ASSERT_EQ(ix.createFile(defaultIndexFileName), success);
+        ASSERT_EQ(ix.openFile(defaultIndexFileName, defaultFileHandle), success);
+        loader.init(defaultFileHandle, ageAttr);
+        for (unsigned i = 0; i < numOfKeys; i++) {
+            key = (int) i;
+            ASSERT_EQ(loader.addEntry(&key, PeterDB::RID{i, 1}), success);
+        }
+        ASSERT_EQ(loader.finish(), success) << "IX_BulkLoader::finish() should succeed.";
+        unsigned loadedPages = defaultFileHandle.getNumberOfPages();
+        for (unsigned i = 0; i < numOfKeys; i += 100) {
+            key = (int) i;
+            ASSERT_EQ(ix.insertEntry(defaultFileHandle, ageAttr, &key, PeterDB::RID{i, 2}), success);
+        }
+        ASSERT_EQ(defaultFileHandle.getNumberOfPages(), loadedPages) << "Leaves should keep room for inserts.";
+        ASSERT_EQ(ix.closeFile(defaultFileHandle), success);
+        ASSERT_EQ(ix.destroyFile(defaultIndexFileName), success);
+    }
+
+    TEST_F(IX_Test, concurrent_inserts_deletes_and_scans) {
+        // Functions tested
+        // 1. Insert from several threads into one index while another thread scans it
+        // 2. Delete half of the entries from several threads
+        // 3. Scan what is left
+
+        unsigned numThreads = 4, perThread = 5000, numOfEntries = numThreads * perThread;
+        std::atomic<unsigned> failures{0};
+        std::atomic<bool> writing{true};
+        std::thread scanner([&] {
+            while (writing) {
+                PeterDB::IX_ScanIterator iterator;
+                PeterDB::RID scanRid;
+                int key, prevKey = -1;
+                if (ix.scan(ixFileHandle, ageAttr, nullptr, nullptr, true, true, iterator) != success) failures++;
+                while (iterator.getNextEntry(scanRid, &key) == success) {
+                    if (key <= prevKey || scanRid.pageNum != (unsigned) key) failures++;
+                    prevKey = key;
+                }
+                iterator.close();
+            }
+        });
+
+        auto runThreads = [&](bool isInsertion) {
+            std::vector<std::thread> threads;
+            for (unsigned t = 0; t < numThreads; t++)
+                threads.emplace_back([&, t] {
+                    for (unsigned i = 0; i < perThread; i++) {
+                        int key = (int) (((i * numThreads + t) * 7919) % numOfEntries);
+                        if (!isInsertion && key % 2 == 0) continue;
+                        PeterDB::RID entryRid{(unsigned) key, 1};
+                        PeterDB::RC status = isInsertion ? ix.insertEntry(ixFileHandle, ageAttr, &key, entryRid)
+                                            : ix.deleteEntry(ixFileHandle, ageAttr, &key, entryRid);
+                        if (status != success) failures++;
+                    }
+                });
+            for (std::thread &thread : threads) thread.join();
+        };
+        runThreads(true);
+        runThreads(false);
+        writing = false;
+        scanner.join();
+        ASSERT_EQ(failures, 0) << "Every insert, delete and scan should succeed and see the entries in order.";
+
+        int key, expectedKey = 0;
+        ASSERT_EQ(ix.scan(ixFileHandle, ageAttr, nullptr, nullptr, true, true, ix_ScanIterator), success);
+        while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+            ASSERT_EQ(key, expectedKey) << "Only the even keys should be left.";
+            expectedKey += 2;
+        }
+        ASSERT_EQ(expectedKey, numOfEntries);
+        ASSERT_EQ(ix_ScanIterator.close(), success);
+    }
+
+    TEST_F(IX_Test, hash_index_equality_probes) {
+        // Functions tested
+        // 1. Insert into a hash index until buckets split and a duplicated key overflows its bucket
+        // 2. Probe keys, each reading a directory page and the key's bucket, and the first one page 0
+        // 3. Delete entries, scan a range over every bucket, and insert into the freed pages
+
+        ASSERT_EQ(ix.closeFile(ixFileHandle), success) << "indexManager::closeFile() should succeed.";
+        ASSERT_EQ(ix.destroyFile(indexFileName), success) << "indexManager::destroyFile() should succeed.";
+        ASSERT_EQ(ix.createFile(indexFileName, PeterDB::IndexHash), success) << "indexManager::createFile() should succeed.";
+        ASSERT_EQ(ix.openFile(indexFileName, ixFileHandle), success) << "indexManager::openFile() should succeed.";
+
+        unsigned numOfKeys = 5000, copies = 2, hotCopies = 1500;
+        int key, hotKey = -7;
+        for (unsigned i = 0; i < numOfKeys * copies; i++) {
+            key = (int) ((i * 7919) % numOfKeys);
+            ASSERT_EQ(ix.insertEntry(ixFileHandle, ageAttr, &key, PeterDB::RID{i, 1}), success)
+                                        << "indexManager::insertEntry() should succeed.";
+        }
+        for (unsigned i = 0; i < hotCopies; i++)
+            ASSERT_EQ(ix.insertEntry(ixFileHandle, ageAttr, &hotKey, PeterDB::RID{i, 2}), success)
+                                        << "indexManager::insertEntry() should succeed.";
+        std::stringstream stream;
+        ASSERT_NE(ix.printBTree(ixFileHandle, ageAttr, stream), success) << "A hash index has no tree to print.";
+
+        unsigned count;
+        for (int probe = 0; probe < (int) numOfKeys; probe += 37) {
+            ASSERT_EQ(ixFileHandle.collectCounterValues(rc, wc, ac), success);
+            ASSERT_EQ(ix.scan(ixFileHandle, ageAttr, &probe, &probe, true, true, ix_ScanIterator), success);
+            count = 0;
+            while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+                ASSERT_EQ(key, probe);
+                ASSERT_EQ((rid.pageNum * 7919) % numOfKeys, key);
+                count++;
+            }
+            ASSERT_EQ(count, copies);
+            ASSERT_EQ(ix_ScanIterator.close(), success);
+            ASSERT_EQ(ixFileHandle.collectCounterValues(rcAfter, wcAfter, acAfter), success);
+            ASSERT_EQ(rcAfter - rc, probe == 0 ? 3 : 2) << "A probe should read one directory page and one bucket, and page 0 only once.";
+        }
+        ASSERT_EQ(ix.scan(ixFileHandle, ageAttr, &hotKey, &hotKey, true, true, ix_ScanIterator), success);
+        count = 0;
+        while (ix_ScanIterator.getNextEntry(rid, &key) == success) count++;
+        ASSERT_EQ(count, hotCopies) << "Entries on overflow pages should be found too.";
+        ASSERT_EQ(ix_ScanIterator.close(), success);
+
+        // the first copy of every key goes, and all of the duplicated key's entries
+        for (unsigned i = 0; i < numOfKeys; i++) {
+            key = (int) ((i * 7919) % numOfKeys);
+            ASSERT_EQ(ix.deleteEntry(ixFileHandle, ageAttr, &key, PeterDB::RID{i, 1}), success)
+                                        << "indexManager::deleteEntry() should succeed.";
+        }
+        key = 0;
+        ASSERT_NE(ix.deleteEntry(ixFileHandle, ageAttr, &key, PeterDB::RID{0, 1}), success) << "A deleted entry should be gone.";
+        for (unsigned i = 0; i < hotCopies; i++)
+            ASSERT_EQ(ix.deleteEntry(ixFileHandle, ageAttr, &hotKey, PeterDB::RID{i, 2}), success)
+                                        << "indexManager::deleteEntry() should succeed.";
+
+        int lowKey = 100, highKey = 200;
+        ASSERT_EQ(ix.scan(ixFileHandle, ageAttr, &lowKey, &highKey, true, false, ix_ScanIterator), success);
+        count = 0;
+        while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+            ASSERT_TRUE(key >= lowKey && key < highKey);
+            ASSERT_GE(rid.pageNum, numOfKeys) << "Only the second copies should be left.";
+            count++;
+        }
+        ASSERT_EQ(count, highKey - lowKey);
+        ASSERT_EQ(ix_ScanIterator.close(), success);
+
+        ASSERT_EQ(ixFileHandle.collectCounterValues(rc, wc, ac), success);
+        for (unsigned i = 0; i < hotCopies; i++)
+            ASSERT_EQ(ix.insertEntry(ixFileHandle, ageAttr, &hotKey, PeterDB::RID{i, 2}), success)
+                                        << "indexManager::insertEntry() should succeed.";
+        ASSERT_EQ(ixFileHandle.collectCounterValues(rcAfter, wcAfter, acAfter), success);
+        EXPECT_EQ(acAfter - ac, 0) << "Overflow pages freed by deletes should be used again.";
+
+        ASSERT_EQ(ixFileHandle.collectCounterValues(rc, wc, ac), success);
+        ASSERT_EQ(ix.insertEntry(ixFileHandle, ageAttr, &hotKey, PeterDB::RID{hotCopies, 2}), success)
+                                    << "indexManager::insertEntry() should succeed.";
+        ASSERT_EQ(ixFileHandle.collectCounterValues(rcAfter, wcAfter, acAfter), success);
+        EXPECT_LE(rcAfter - rc, 4) << "An insert should not read the overflow chain of its bucket.";
+    }
+
+    TEST_F(IX_Test, prefix_compressed_varchar_index) {
+        // Functions tested
+        // 1. Insert URL-like keys sharing long prefixes into a plain and a prefix-compressed B+ tree
+        // 2. Check the compressed tree takes fewer pages and reads no more of them per probe
+        // 3. Scan both in order, then delete half of the keys and scan a range of the rest
+
+        std::string prefixIndexFileName = "prefix_varchar_idx";
+        PeterDB::IXFileHandle prefixFileHandle;
+        remove(prefixIndexFileName.c_str());
+        ASSERT_EQ(ix.createFile(prefixIndexFileName, PeterDB::IndexPrefixBTree), success)
+                                    << "indexManager::createFile() should succeed.";
+        ASSERT_EQ(ix.openFile(prefixIndexFileName, prefixFileHandle), success) << "indexManager::openFile() should succeed.";
+
+        unsigned numOfKeys = 6000;
+        char key[PAGE_SIZE];
+        auto url = [&](unsigned i) {
+            std::string name = "https://www.example.com/catalog/products/category-" + std::to_string(i % 7) + "/item-"
+                               + std::to_string(i);
+            *(int *) key = (int) name.size();
+            memcpy(key + sizeof(int), name.data(), name.size());
+            return name;
+        };
+        for (unsigned i = 0; i < numOfKeys; i++) {
+            url((i * 7919) % numOfKeys);
+            ASSERT_EQ(ix.insertEntry(ixFileHandle, empNameAttr, key, PeterDB::RID{i, 1}), success)
+                                        << "indexManager::insertEntry() should succeed.";
+            ASSERT_EQ(ix.insertEntry(prefixFileHandle, empNameAttr, key, PeterDB::RID{i, 1}), success)
+                                        << "indexManager::insertEntry() should succeed.";
+        }
+        EXPECT_LT(prefixFileHandle.getNumberOfPages() * 2, ixFileHandle.getNumberOfPages())
+                            << "Nodes storing their shared prefix once should hold many more keys.";
+
+        unsigned readsPlain, readsPrefix;
+        url(4321);
+        ASSERT_EQ(ixFileHandle.collectCounterValues(rc, wc, ac), success);
+        ASSERT_EQ(ix.scan(ixFileHandle, empNameAttr, key, key, true, true, ix_ScanIterator), success);
+        ASSERT_EQ(ix_ScanIterator.getNextEntry(rid, key), success);
+        ASSERT_EQ(ix_ScanIterator.close(), success);
+        ASSERT_EQ(ixFileHandle.collectCounterValues(rcAfter, wcAfter, acAfter), success);
+        readsPlain = rcAfter - rc;
+        std::string probe = url(4321);
+        ASSERT_EQ(prefixFileHandle.collectCounterValues(rc, wc, ac), success);
+        ASSERT_EQ(ix.scan(prefixFileHandle, empNameAttr, key, key, true, true, ix_ScanIterator), success);
+        ASSERT_EQ(ix_ScanIterator.getNextEntry(rid, key), success);
+        ASSERT_EQ(std::string(key + sizeof(int), *(int *) key), probe) << "The whole key should be returned.";
+        ASSERT_EQ((rid.pageNum * 7919) % numOfKeys, 4321);
+        ASSERT_EQ(ix_ScanIterator.getNextEntry(rid, key), IX_EOF);
+        ASSERT_EQ(ix_ScanIterator.close(), success);
+        ASSERT_EQ(prefixFileHandle.collectCounterValues(rcAfter, wcAfter, acAfter), success);
+        readsPrefix = rcAfter - rc;
+        EXPECT_LE(readsPrefix, readsPlain) << "The compressed tree should be no taller.";
+
+        std::string prevName;
+        unsigned count = 0;
+        ASSERT_EQ(ix.scan(prefixFileHandle, empNameAttr, nullptr, nullptr, true, true, ix_ScanIterator), success);
+        while (ix_ScanIterator.getNextEntry(rid, key) == success) {
+            std::string name(key + sizeof(int), *(int *) key);
+            ASSERT_GT(name, prevName) << "Entries should be returned in order.";
+            ASSERT_EQ(name, url((rid.pageNum * 7919) % numOfKeys));
+            prevName = name;
+            count++;
+        }
+        ASSERT_EQ(count, numOfKeys);
+        ASSERT_EQ(ix_ScanIterator.close(), success);
+
+        // the keys of odd items go, leaving leaves to merge
+        for (unsigned i = 0; i < numOfKeys; i++) {
+            if ((i * 7919) % numOfKeys % 2 == 0) continue;
+            url((i * 7919) % numOfKeys);
+            ASSERT_EQ(ix.deleteEntry(prefixFileHandle, empNameAttr, key, PeterDB::RID{i, 1}), success)
+                                        << "indexManager::deleteEntry() should succeed.";
+        }
+        char lowKey[PAGE_SIZE], highKey[PAGE_SIZE];
+        std::string lowName = url(1001);
+        memcpy(lowKey, key, sizeof(int) + *(int *) key);
+        std::string highName = url(2002);
+        memcpy(highKey, key, sizeof(int) + *(int *) key);
+        ASSERT_EQ(ix.scan(prefixFileHandle, empNameAttr, lowKey, highKey, true, false, ix_ScanIterator), success);
+        count = 0;
+        while (ix_ScanIterator.getNextEntry(rid, key) == success) {
+            unsigned item = (rid.pageNum * 7919) % numOfKeys;
+            ASSERT_EQ(item % 2, 0) << "Deleted entries should be gone.";
+            ASSERT_EQ(std::string(key + sizeof(int), *(int *) key), url(item));
+            count++;
+        }
+        unsigned expected = 0;
+        for (unsigned i = 0; i < numOfKeys; i += 2) {
+            std::string name = url(i);
+            if (name >= lowName && name < highName) expected++;
+        }
+        ASSERT_EQ(count, expected);
+        ASSERT_EQ(ix_ScanIterator.close(), success);
+        ASSERT_EQ(ix.closeFile(prefixFileHandle), success);
+        ASSERT_EQ(ix.destroyFile(prefixIndexFileName), success);
+    }
+
+    TEST_F(IX_Test, posting_lists_store_each_key_once) {
+        // Functions tested
+        // 1. Insert many entries of few varchar keys into a plain and a posting B+ tree
+        // 2. Check the posting tree takes a fraction of the pages, and reads fewer of them to scan one key
+        // 3. Scan a key whose list spans leaves, delete it, and scan the rest
+
+        std::string postingIndexFileName = "posting_varchar_idx";
+        PeterDB::IXFileHandle postingFileHandle;
+        remove(postingIndexFileName.c_str());
+        ASSERT_EQ(ix.createFile(postingIndexFileName, PeterDB::IndexPostingBTree), success)
+                                    << "indexManager::createFile() should succeed.";
+        ASSERT_EQ(ix.openFile(postingIndexFileName, postingFileHandle), success) << "indexManager::openFile() should succeed.";
+
+        unsigned numOfKeys = 8, numOfEntries = 16000;
+        char key[PAGE_SIZE];
+        auto department = [&](unsigned i) {
+            std::string name = "department of " + std::string(60, 'x') + std::to_string(i);
+            *(int *) key = (int) name.size();
+            memcpy(key + sizeof(int), name.data(), name.size());
+            return name;
+        };
+        // the entries of a key are spread over pages and slots, in no particular order
+        for (unsigned i = 0; i < numOfEntries; i++) {
+            unsigned j = (i * 7919) % numOfEntries;
+            department(j % numOfKeys);
+            PeterDB::RID entryRID{j / 20, (unsigned short) (j % 20)};
+            ASSERT_EQ(ix.insertEntry(ixFileHandle, empNameAttr, key, entryRID), success)
+                                        << "indexManager::insertEntry() should succeed.";
+            ASSERT_EQ(ix.insertEntry(postingFileHandle, empNameAttr, key, entryRID), success)
+                                        << "indexManager::insertEntry() should succeed.";
+        }
+        EXPECT_LT(postingFileHandle.getNumberOfPages() * 5, ixFileHandle.getNumberOfPages())
+                            << "A key stored once with small RID steps should take far fewer pages.";
+
+        unsigned count, readsPlain, readsPosting;
+        char lowKey[PAGE_SIZE];
+        std::string name = department(3);
+        memcpy(lowKey, key, sizeof(int) + name.size());
+        ASSERT_EQ(ixFileHandle.collectCounterValues(rc, wc, ac), success);
+        ASSERT_EQ(ix.scan(ixFileHandle, empNameAttr, lowKey, lowKey, true, true, ix_ScanIterator), success);
+        for (count = 0; ix_ScanIterator.getNextEntry(rid, key) == success; count++);
+        ASSERT_EQ(ix_ScanIterator.close(), success);
+        ASSERT_EQ(ixFileHandle.collectCounterValues(rcAfter, wcAfter, acAfter), success);
+        ASSERT_EQ(count, numOfEntries / numOfKeys);
+        readsPlain = rcAfter - rc;
+
+        PeterDB::RID prevRID{0, 0};
+        ASSERT_EQ(postingFileHandle.collectCounterValues(rc, wc, ac), success);
+        ASSERT_EQ(ix.scan(postingFileHandle, empNameAttr, lowKey, lowKey, true, true, ix_ScanIterator), success);
+        for (count = 0; ix_ScanIterator.getNextEntry(rid, key) == success; count++) {
+            ASSERT_EQ(std::string(key + sizeof(int), *(int *) key), name) << "The whole key should be returned.";
+            ASSERT_EQ((rid.pageNum * 20 + rid.slotNum) % numOfKeys, 3);
+            if (count > 0) ASSERT_TRUE(prevRID < rid) << "RIDs of a key should be returned in order.";
+            prevRID = rid;
+        }
+        ASSERT_EQ(ix_ScanIterator.close(), success);
+        ASSERT_EQ(postingFileHandle.collectCounterValues(rcAfter, wcAfter, acAfter), success);
+        ASSERT_EQ(count, numOfEntries / numOfKeys);
+        readsPosting = rcAfter - rc;
+        EXPECT_LT(readsPosting * 3, readsPlain) << "Scanning a key should read a fraction of the leaves.";
+
+        // every entry of the key goes, and the lists around it are left whole
+        for (unsigned j = 3; j < numOfEntries; j += numOfKeys) {
+            department(3);
+            ASSERT_EQ(ix.deleteEntry(postingFileHandle, empNameAttr, key, PeterDB::RID{j / 20, (unsigned short) (j % 20)}), success)
+                                        << "indexManager::deleteEntry() should succeed.";
+        }
+        department(3);
+        ASSERT_NE(ix.deleteEntry(postingFileHandle, empNameAttr, key, PeterDB::RID{0, 3}), success) << "A deleted entry should be gone.";
+        ASSERT_EQ(ix.scan(postingFileHandle, empNameAttr, nullptr, nullptr, true, true, ix_ScanIterator), success);
+        std::string prevName;
+        for (count = 0; ix_ScanIterator.getNextEntry(rid, key) == success; count++) {
+            std::string entryName(key + sizeof(int), *(int *) key);
+            ASSERT_NE(entryName, name);
+            ASSERT_EQ(entryName, department((rid.pageNum * 20 + rid.slotNum) % numOfKeys));
+            ASSERT_GE(entryName, prevName) << "Entries should be returned in order.";
+            prevName = entryName;
+        }
+        ASSERT_EQ(count, numOfEntries - numOfEntries / numOfKeys);
+        ASSERT_EQ(ix_ScanIterator.close(), success);
+        ASSERT_EQ(ix.closeFile(postingFileHandle), success);
+        ASSERT_EQ(ix.destroyFile(postingIndexFileName), success);
+    }
+
+    TEST_F(IX_Test, descending_scan_reads_last_leaves) {
+        // Functions tested
+        // 1. Insert many int keys, then scan all of them and a range of them in descending order
+        // 2. Check the ten largest keys are read from a handful of pages, far fewer than a full scan reads
+        // 3. Delete each key a descending scan returns, and check a hash index refuses to scan in descending order
+
+        unsigned numOfKeys = 20000;
+        int key;
+        for (unsigned i = 0; i < numOfKeys; i++) {
+            key = (int) ((i * 7919) % numOfKeys);
+            ASSERT_EQ(ix.insertEntry(ixFileHandle, ageAttr, &key, PeterDB::RID{(unsigned) key, 1}), success)
+                                        << "indexManager::insertEntry() should succeed.";
+        }
+
+        unsigned count, readsAll, readsTop;
+        ASSERT_EQ(ixFileHandle.collectCounterValues(rc, wc, ac), success);
+        ASSERT_EQ(ix.scan(ixFileHandle, ageAttr, nullptr, nullptr, true, true, ix_ScanIterator), success);
+        for (count = 0; ix_ScanIterator.getNextEntry(rid, &key) == success; count++);
+        ASSERT_EQ(ix_ScanIterator.close(), success);
+        ASSERT_EQ(ixFileHandle.collectCounterValues(rcAfter, wcAfter, acAfter), success);
+        ASSERT_EQ(count, numOfKeys);
+        readsAll = rcAfter - rc;
+
+        ASSERT_EQ(ix.scan(ixFileHandle, ageAttr, nullptr, nullptr, true, true, ix_ScanIterator, true), success);
+        for (count = 0; ix_ScanIterator.getNextEntry(rid, &key) == success; count++) {
+            ASSERT_EQ(key, (int) (numOfKeys - 1 - count)) << "Keys should be returned from the largest down.";
+            ASSERT_EQ(rid.pageNum, (unsigned) key);
+        }
+        ASSERT_EQ(ix_ScanIterator.close(), success);
+        ASSERT_EQ(count, numOfKeys);
+
+        ASSERT_EQ(ixFileHandle.collectCounterValues(rc, wc, ac), success);
+        ASSERT_EQ(ix.scan(ixFileHandle, ageAttr, nullptr, nullptr, true, true, ix_ScanIterator, true), success);
+        for (count = 0; count < 10 && ix_ScanIterator.getNextEntry(rid, &key) == success; count++);
+        ASSERT_EQ(ix_ScanIterator.close(), success);
+        ASSERT_EQ(ixFileHandle.collectCounterValues(rcAfter, wcAfter, acAfter), success);
+        ASSERT_EQ(key, (int) numOfKeys - 10);
+        readsTop = rcAfter - rc;
+        EXPECT_LT(readsTop * 10, readsAll) << "The largest keys should be read from the last leaves only.";
+
+        int lowKey = 100, highKey = 5000;
+        ASSERT_EQ(ix.scan(ixFileHandle, ageAttr, &lowKey, &highKey, true, false, ix_ScanIterator, true), success);
+        for (count = 0; ix_ScanIterator.getNextEntry(rid, &key) == success; count++) {
+            ASSERT_EQ(key, highKey - 1 - (int) count) << "Keys in range should be returned from the largest down.";
+        }
+        ASSERT_EQ(ix_ScanIterator.close(), success);
+        ASSERT_EQ(count, (unsigned) (highKey - lowKey));
+
+        // the scan finds its place again after each deletion
+        ASSERT_EQ(ix.scan(ixFileHandle, ageAttr, &lowKey, nullptr, false, true, ix_ScanIterator, true), success);
+        for (count = 0; ix_ScanIterator.getNextEntry(rid, &key) == success; count++) {
+            ASSERT_EQ(key, (int) (numOfKeys - 1 - count));
+            ASSERT_EQ(ix.deleteEntry(ixFileHandle, ageAttr, &key, rid), success) << "indexManager::deleteEntry() should succeed.";
+        }
+        ASSERT_EQ(ix_ScanIterator.close(), success);
+        ASSERT_EQ(count, numOfKeys - 1 - lowKey);
+
+        ASSERT_EQ(ix.scan(ixFileHandle, ageAttr, nullptr, nullptr, true, true, ix_ScanIterator, true), success);
+        for (count = 0; ix_ScanIterator.getNextEntry(rid, &key) == success; count++) {
+            ASSERT_EQ(key, lowKey - (int) count);
+        }
+        ASSERT_EQ(ix_ScanIterator.close(), success);
+        ASSERT_EQ(count, (unsigned) lowKey + 1);
+
+        std::string hashIndexFileName = "descending_hash_idx";
+        PeterDB::IXFileHandle hashFileHandle;
+        remove(hashIndexFileName.c_str());
+        ASSERT_EQ(ix.createFile(hashIndexFileName, PeterDB::IndexHash), success) << "indexManager::createFile() should succeed.";
+        ASSERT_EQ(ix.openFile(hashIndexFileName, hashFileHandle), success) << "indexManager::openFile() should succeed.";
+        ASSERT_NE(ix.scan(hashFileHandle, ageAttr, nullptr, nullptr, true, true, ix_ScanIterator, true), success)
+                                    << "A hash index keeps no order to scan backwards in.";
+        ASSERT_EQ(ix.closeFile(hashFileHandle), success);
+        ASSERT_EQ(ix.destroyFile(hashIndexFileName), success);
+    }
+
     TEST_F(IX_Test, extra_duplicate_keys_span_multiple_pages) {
         // Checks whether duplicated entries spanning multiple page are handled properly or not.
         //
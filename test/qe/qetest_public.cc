@@ -447,6 +447,64 @@ namespace PeterDBTesting {
         }
     }
 
+    TEST_F(QE_Test, inljoin_on_hash_index) {
+        // 1. INLJoin -- probing a hash index on TypeReal Attribute
+        // SELECT * from left, right WHERE left.C = right.C
+
+        inBuffer = malloc(bufSize);
+        outBuffer = malloc(bufSize);
+
+        std::string leftTableName = "left";
+        createAndPopulateTable(leftTableName, {"B"}, 500);
+
+        // the hash index is created empty and filled by the inserts
+        std::string rightTableName = "right";
+        createAndPopulateTable(rightTableName, {}, 0);
+        ASSERT_EQ(rm.createIndex(rightTableName, "C", PeterDB::IndexHash), success)
+                                    << "RelationManager.createIndex() should succeed.";
+        populateTable(rightTableName, 500);
+
+        PeterDB::TableScan leftIn(rm, "left");
+        PeterDB::IndexScan rightIn(rm, "right", "C");
+        PeterDB::INLJoin inlJoin(&leftIn, &rightIn, {"left.C", PeterDB::EQ_OP, true, "right.C"});
+
+        std::vector<std::string> printed;
+        ASSERT_EQ(inlJoin.getAttributes(attrs), success) << "INLJoin.getAttributes() should succeed.";
+        while (inlJoin.getNextTuple(outBuffer) != QE_EOF) {
+            std::stringstream stream;
+            ASSERT_EQ(rm.printTuple(attrs, outBuffer, stream), success)
+                                        << "RelationManager.printTuple() should succeed.";
+            printed.emplace_back(stream.str());
+            memset(outBuffer, 0, bufSize);
+        }
+
+        std::vector<std::string> expected;
+        for (int i = 0; i < 500; i++) {
+            unsigned a = i % 203;
+            unsigned b1 = (i + 10) % 197;
+            float c1 = (float) (i % 167) + 50.5f;
+            for (int j = 0; j < 500; j++) {
+                unsigned b2 = j % 251 + 20;
+                float c2 = (float) (j % 261) + 25.5f;
+                unsigned d = j % 179;
+                if (c1 == c2) {
+                    expected.emplace_back(
+                            "left.A: " + std::to_string(a) + ", left.B: " + std::to_string(b1) + ", left.C: " +
+                            std::to_string(c1) + ", right.B: " + std::to_string(b2) + ", right.C: " +
+                            std::to_string(c2) + ", right.D: " + std::to_string(d));
+                }
+            }
+        }
+        sort(expected.begin(), expected.end());
+        sort(printed.begin(), printed.end());
+
+        ASSERT_EQ(expected.size(), printed.size()) << "The number of returned tuple is not correct.";
+
+        for (int i = 0; i < expected.size(); ++i) {
+            checkPrintRecord(expected[i], printed[i], false, {});
+        }
+    }
+
     TEST_F(QE_Test, inljoin_with_filter_and_project) {
         // 1. Filter
         // 2. Project
@@ -571,6 +629,42 @@ namespace PeterDBTesting {
 
     }
 
+    TEST_F(QE_Test, index_only_scan_with_count_aggregation) {
+        // 1. Aggregation answered from index leaves - COUNT
+        // SELECT COUNT(right.B) FROM right WHERE B >= 50 AND B <= 60
+
+        inBuffer = malloc(bufSize);
+        outBuffer = malloc(bufSize);
+
+        std::string tableName = "right";
+        createAndPopulateTable(tableName, {"B", "C"}, 3000);
+
+        // Create an IndexScan that does not read the table
+        PeterDB::IndexScan is(rm, tableName, "B", nullptr, true);
+        ASSERT_EQ(is.getAttributes(attrs), success) << "IndexScan.getAttributes() should succeed.";
+        ASSERT_EQ(attrs.size(), 1) << "Only the indexed attribute should be returned.";
+        ASSERT_EQ(attrs[0].name, "right.B");
+
+        int lowKey = 50, highKey = 60;
+        is.setIterator(&lowKey, &highKey, true, true);
+        ASSERT_NE(is.getNextTuple(outBuffer), QE_EOF) << "IndexScan.getNextTuple() should succeed.";
+        ASSERT_EQ(*(unsigned char *) outBuffer, 0) << "Indexed values should not be null.";
+        ASSERT_EQ(*(int *) ((char *) outBuffer + 1), lowKey);
+        is.setIterator(&lowKey, &highKey, true, true);
+
+        // Create Aggregate
+        PeterDB::Aggregate agg(&is, {"right.B", PeterDB::TypeInt, 4}, PeterDB::COUNT);
+        ASSERT_EQ(agg.getAttributes(attrs), success) << "Aggregate.getAttributes() should succeed.";
+        ASSERT_NE(agg.getNextTuple(outBuffer), QE_EOF) << "Aggregate.getNextTuple() should succeed.";
+        std::stringstream stream;
+        ASSERT_EQ(rm.printTuple(attrs, outBuffer, stream), success)
+                                    << "RelationManager.printTuple() should succeed.";
+        // B = i % 251 + 20, and every remainder from 30 to 40 occurs 12 times below 3000
+        checkPrintRecord("COUNT(right.B): 132", stream.str());
+        ASSERT_EQ(agg.getNextTuple(outBuffer), QE_EOF) << "Only 1 tuple should be returned for COUNT.";
+
+    }
+
     TEST_F(QE_Test, scan_with_update_and_delete) {
         // Function Tested
         // Insert 25 records into table
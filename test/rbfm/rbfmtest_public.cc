@@ -401,6 +401,580 @@ namespace PeterDBTesting {
                                     << "Read a deleted record should not success.";
     }
 
+    TEST_F(RBFM_Test, pax_layout_records) {
+        // Functions tested
+        // 1. Create Record-Based File with PAX layout
+        // 2. Insert Records
+        // 3. Read Records and Attributes
+        // 4. Update and Delete Records
+        // 5. Scan with condition and projection
+        std::string paxFileName = "rbfm_pax_test_file";
+        PeterDB::FileHandle paxFileHandle;
+        ASSERT_EQ(rbfm.createFile(paxFileName, PeterDB::LayoutPax), success) << "Creating a PAX file should succeed.";
+        ASSERT_EQ(rbfm.openFile(paxFileName, paxFileHandle), success) << "Opening the file should succeed.";
+        ASSERT_EQ(paxFileHandle.pageLayout, PeterDB::LayoutPax) << "The layout should be kept in the file.";
+
+        std::vector<PeterDB::Attribute> recordDescriptor;
+        createRecordDescriptor(recordDescriptor);
+        inBuffer = malloc(100);
+        outBuffer = malloc(100);
+        nullsIndicator = initializeNullFieldsIndicator(recordDescriptor);
+
+        unsigned numRecords = 500;
+        std::vector<PeterDB::RID> rids(numRecords);
+        size_t recordSize;
+        for (unsigned i = 0; i < numRecords; ++i) {
+            // every seventh record has a null age
+            nullsIndicator[0] = i % 7 == 0 ? 64 : 0;
+            std::string name = "Emp" + std::to_string(i);
+            prepareRecord((int) recordDescriptor.size(), nullsIndicator, (int) name.length(), name, (int) i, 1.5f * i,
+                          (int) i * 10, inBuffer, recordSize);
+            ASSERT_EQ(rbfm.insertRecord(paxFileHandle, recordDescriptor, inBuffer, rids[i]), success)
+                                        << "Inserting a record should succeed.";
+        }
+        ASSERT_GT(paxFileHandle.getNumberOfPages(), 1) << "Records should span multiple pages.";
+
+        for (unsigned i = 0; i < numRecords; ++i) {
+            nullsIndicator[0] = i % 7 == 0 ? 64 : 0;
+            std::string name = "Emp" + std::to_string(i);
+            prepareRecord((int) recordDescriptor.size(), nullsIndicator, (int) name.length(), name, (int) i, 1.5f * i,
+                          (int) i * 10, inBuffer, recordSize);
+            memset(outBuffer, 0, 100);
+            ASSERT_EQ(rbfm.readRecord(paxFileHandle, recordDescriptor, rids[i], outBuffer), success)
+                                        << "Reading a record should succeed.";
+            ASSERT_EQ(memcmp(inBuffer, outBuffer, recordSize), 0) << "Returned data should be the same.";
+        }
+
+        // read a single attribute
+        int salary = 0;
+        ASSERT_EQ(rbfm.readAttribute(paxFileHandle, recordDescriptor, rids[42], "Salary", outBuffer), success);
+        memcpy(&salary, (char *) outBuffer + 1, sizeof(int));
+        ASSERT_EQ(salary, 420);
+
+        // an update keeps the rid, a longer varchar than declared is rejected
+        nullsIndicator[0] = 0;
+        std::string newName = "RenamedEmployee";
+        prepareRecord((int) recordDescriptor.size(), nullsIndicator, (int) newName.length(), newName, 3, 2.5, 30,
+                      inBuffer, recordSize);
+        ASSERT_EQ(rbfm.updateRecord(paxFileHandle, recordDescriptor, inBuffer, rids[3]), success);
+        ASSERT_EQ(rbfm.readRecord(paxFileHandle, recordDescriptor, rids[3], outBuffer), success);
+        ASSERT_EQ(memcmp(inBuffer, outBuffer, recordSize), 0) << "Returned data should be the updated record.";
+        std::string tooLong(40, 'x');
+        prepareRecord((int) recordDescriptor.size(), nullsIndicator, (int) tooLong.length(), tooLong, 1, 1, 1,
+                      inBuffer, recordSize);
+        ASSERT_NE(rbfm.updateRecord(paxFileHandle, recordDescriptor, inBuffer, rids[4]), success);
+
+        // delete every even record, the freed slots are reused by the next insert
+        unsigned pageCount = paxFileHandle.getNumberOfPages();
+        for (unsigned i = 0; i < numRecords; i += 2)
+            ASSERT_EQ(rbfm.deleteRecord(paxFileHandle, recordDescriptor, rids[i]), success);
+        ASSERT_NE(rbfm.readRecord(paxFileHandle, recordDescriptor, rids[0], outBuffer), success)
+                                    << "Reading a deleted record should fail.";
+        PeterDB::RID reusedRid;
+        prepareRecord((int) recordDescriptor.size(), nullsIndicator, (int) newName.length(), newName, 1, 1, 1,
+                      inBuffer, recordSize);
+        ASSERT_EQ(rbfm.insertRecord(paxFileHandle, recordDescriptor, inBuffer, reusedRid), success);
+        auto reusedPos = std::find(rids.begin(), rids.end(), reusedRid) - rids.begin();
+        ASSERT_TRUE(reusedPos < numRecords && reusedPos % 2 == 0) << "A freed slot should be reused.";
+        ASSERT_EQ(paxFileHandle.getNumberOfPages(), pageCount) << "No page should be appended.";
+        ASSERT_EQ(rbfm.deleteRecord(paxFileHandle, recordDescriptor, reusedRid), success);
+
+        // scan odd records with age > 250, projecting salary then name
+        int ageLimit = 250;
+        std::vector<std::string> projected{"Salary", "EmpName"};
+        PeterDB::RBFM_ScanIterator scanIterator;
+        ASSERT_EQ(rbfm.scan(paxFileHandle, recordDescriptor, "Age", PeterDB::GT_OP, &ageLimit, projected, scanIterator),
+                  success);
+        PeterDB::RID rid;
+        unsigned count = 0;
+        while (scanIterator.getNextRecord(rid, outBuffer) != RBFM_EOF) {
+            memcpy(&salary, (char *) outBuffer + 1, sizeof(int));
+            unsigned i = salary / 10;
+            ASSERT_TRUE(i > 250 && i % 2 == 1 && i % 7 != 0) << "Scanned record should satisfy the condition.";
+            ASSERT_EQ(rid, rids[i]);
+            ++count;
+        }
+        unsigned expected = 0;
+        for (unsigned i = 251; i < numRecords; i += 2) if (i % 7 != 0) ++expected;
+        ASSERT_EQ(count, expected) << "Scan should return every matching record.";
+
+        ASSERT_EQ(rbfm.closeFile(paxFileHandle), success);
+        ASSERT_EQ(rbfm.destroyFile(paxFileName), success);
+    }
+
+    TEST_F(RBFM_Test, zone_map_scan_skips_pages) {
+        // Functions tested
+        // 1. Create Record-Based File with zone maps
+        // 2. Insert records in age order
+        // 3. Range scan reads only the pages that can match
+        // 4. Update and Delete keep the zone maps correct
+        std::string zoneFileName = "rbfm_zone_test_file";
+        PeterDB::FileHandle zoneFileHandle;
+        ASSERT_EQ(rbfm.createFile(zoneFileName, PeterDB::LayoutSlotted, true), success)
+                                    << "Creating a file with zone maps should succeed.";
+        ASSERT_EQ(rbfm.openFile(zoneFileName, zoneFileHandle), success) << "Opening the file should succeed.";
+
+        std::vector<PeterDB::Attribute> recordDescriptor;
+        createRecordDescriptor(recordDescriptor);
+        inBuffer = malloc(100);
+        outBuffer = malloc(100);
+        nullsIndicator = initializeNullFieldsIndicator(recordDescriptor);
+
+        unsigned numRecords = 3000;
+        std::vector<PeterDB::RID> rids(numRecords);
+        size_t recordSize;
+        for (unsigned i = 0; i < numRecords; ++i) {
+            std::string name = "Emp" + std::to_string(i);
+            prepareRecord((int) recordDescriptor.size(), nullsIndicator, (int) name.length(), name, (int) i, 1.5f * i,
+                          (int) i * 10, inBuffer, recordSize);
+            ASSERT_EQ(rbfm.insertRecord(zoneFileHandle, recordDescriptor, inBuffer, rids[i]), success)
+                                        << "Inserting a record should succeed.";
+        }
+        ASSERT_GT(zoneFileHandle.getNumberOfPages(), 20) << "Records should span many pages.";
+        unsigned zoneReads, zoneWrites, zoneAppends;
+        ASSERT_NE(zoneFileHandle.zoneMap, nullptr);
+        zoneFileHandle.zoneMap->collectCounterValues(zoneReads, zoneWrites, zoneAppends);
+        ASSERT_LT(zoneReads + zoneWrites, 10) << "Zone map pages should be written back, not rewritten per record.";
+
+        auto scanAges = [&](PeterDB::CompOp op, int value, unsigned &pagesRead) {
+            std::vector<std::string> projected{"Age"};
+            PeterDB::RBFM_ScanIterator scanIterator;
+            unsigned readBefore, readAfter, writeCount, appendCount;
+            zoneFileHandle.collectCounterValues(readBefore, writeCount, appendCount);
+            EXPECT_EQ(rbfm.scan(zoneFileHandle, recordDescriptor, "Age", op, &value, projected, scanIterator), success);
+            PeterDB::RID rid;
+            std::set<int> ages;
+            while (scanIterator.getNextRecord(rid, outBuffer) != RBFM_EOF)
+                ages.insert(*(int *) ((char *) outBuffer + 1));
+            zoneFileHandle.collectCounterValues(readAfter, writeCount, appendCount);
+            pagesRead = readAfter - readBefore;
+            return ages;
+        };
+
+        unsigned pagesRead, fullScanRead;
+        std::set<int> ages = scanAges(PeterDB::GE_OP, 0, fullScanRead);
+        ASSERT_EQ(ages.size(), numRecords) << "Scan should return every record.";
+
+        // only the last pages hold ages above the limit
+        ages = scanAges(PeterDB::GT_OP, 2900, pagesRead);
+        ASSERT_EQ(ages.size(), 99) << "Scan should return every matching record.";
+        ASSERT_EQ(*ages.begin(), 2901);
+        ASSERT_LT(pagesRead, fullScanRead / 4) << "Pages that cannot match should not be read.";
+
+        ages = scanAges(PeterDB::EQ_OP, 1500, pagesRead);
+        ASSERT_EQ(ages.size(), 1);
+        ASSERT_LT(pagesRead, fullScanRead / 10) << "Only the page holding the value should be read.";
+        ages = scanAges(PeterDB::LT_OP, 0, pagesRead);
+        ASSERT_TRUE(ages.empty());
+        ASSERT_EQ(pagesRead, 0);
+
+        // an update widens the range of its page, a delete removes the value again
+        std::string name = "Emp0";
+        prepareRecord((int) recordDescriptor.size(), nullsIndicator, (int) name.length(), name, 5000, 0, 0,
+                      inBuffer, recordSize);
+        ASSERT_EQ(rbfm.updateRecord(zoneFileHandle, recordDescriptor, inBuffer, rids[0]), success);
+        ages = scanAges(PeterDB::GE_OP, 5000, pagesRead);
+        ASSERT_EQ(ages.size(), 1) << "The updated record should be found.";
+        ASSERT_EQ(rbfm.deleteRecord(zoneFileHandle, recordDescriptor, rids[0]), success);
+        ages = scanAges(PeterDB::GE_OP, 5000, pagesRead);
+        ASSERT_TRUE(ages.empty()) << "The deleted record should not be found.";
+
+        // pages left without records are skipped by every condition
+        for (unsigned i = 1; i < 1000; ++i)
+            ASSERT_EQ(rbfm.deleteRecord(zoneFileHandle, recordDescriptor, rids[i]), success);
+        ages = scanAges(PeterDB::LT_OP, 900, pagesRead);
+        ASSERT_TRUE(ages.empty());
+        ASSERT_EQ(pagesRead, 0) << "Empty pages should not be read.";
+        ages = scanAges(PeterDB::NE_OP, -1, pagesRead);
+        ASSERT_EQ(ages.size(), numRecords - 1000);
+
+        ASSERT_EQ(rbfm.closeFile(zoneFileHandle), success);
+        ASSERT_EQ(rbfm.destroyFile(zoneFileName), success);
+        ASSERT_FALSE(fileExists(zoneFileName + ".zone")) << "The zone map should be destroyed with the file.";
+    }
+
+    TEST_F(RBFM_Test, vacuum_collapses_tombstone_chains) {
+        // Functions tested
+        // 1. Update records until they are forwarded more than once
+        // 2. Report forwarding chain statistics
+        // 3. Vacuum collapses chains and removes dead tombstones
+        std::vector<PeterDB::Attribute> recordDescriptor;
+        createRecordDescriptor(recordDescriptor);
+        recordDescriptor[0].length = (PeterDB::AttrLength) 1000;
+        inBuffer = malloc(2000);
+        outBuffer = malloc(2000);
+        nullsIndicator = initializeNullFieldsIndicator(recordDescriptor);
+        size_t recordSize;
+
+        auto writeRecord = [&](const std::string &name, PeterDB::RID &rid, bool update) {
+            prepareRecord((int) recordDescriptor.size(), nullsIndicator, (int) name.length(), name, 1, 2, 3, inBuffer,
+                          recordSize);
+            if (update) return rbfm.updateRecord(fileHandle, recordDescriptor, inBuffer, rid);
+            return rbfm.insertRecord(fileHandle, recordDescriptor, inBuffer, rid);
+        };
+        // small records fill every page, so the next growing update has to forward its record again
+        auto fillPages = [&]() {
+            unsigned pages = fileHandle.getNumberOfPages();
+            PeterDB::RID rid;
+            while (fileHandle.getNumberOfPages() == pages)
+                ASSERT_EQ(writeRecord("filler", rid, false), success);
+        };
+
+        PeterDB::RID movedRid, deadRid;
+        ASSERT_EQ(writeRecord("moved", movedRid, false), success);
+        ASSERT_EQ(writeRecord("dead", deadRid, false), success);
+        fillPages();
+        for (int length : {200, 400, 800}) {
+            ASSERT_EQ(writeRecord(std::string(length, 'm'), movedRid, true), success);
+            fillPages();
+        }
+        ASSERT_EQ(writeRecord(std::string(800, 'd'), deadRid, true), success);
+
+        // deleting a forwarded record where it is stored leaves its tombstone pointing at nothing
+        PeterDB::RBFM_ScanIterator scanIterator;
+        std::vector<std::string> projected{"EmpName"};
+        ASSERT_EQ(rbfm.scan(fileHandle, recordDescriptor, "", PeterDB::NO_OP, nullptr, projected, scanIterator), success);
+        PeterDB::RID rid, storedDeadRid{0, 0};
+        while (scanIterator.getNextRecord(rid, outBuffer) != RBFM_EOF)
+            if (*((char *) outBuffer + 1 + sizeof(int)) == 'd' && *(int *) ((char *) outBuffer + 1) == 800) storedDeadRid = rid;
+        ASSERT_NE(storedDeadRid.slotNum, 0) << "The forwarded record should be scanned.";
+        ASSERT_EQ(rbfm.deleteRecord(fileHandle, recordDescriptor, storedDeadRid), success);
+
+        PeterDB::ChainStats stats;
+        ASSERT_EQ(rbfm.vacuum(fileHandle, stats, true), success);
+        ASSERT_EQ(stats.chains, 2);
+        ASSERT_GE(stats.maxChainLength, 2) << "Repeated growth should chain tombstones.";
+        ASSERT_EQ(stats.reclaimed, 0) << "A report should not change the file.";
+        unsigned chainLength = stats.maxChainLength;
+
+        auto readsOfMovedRecord = [&]() {
+            unsigned readBefore, readAfter, writeCount, appendCount;
+            fileHandle.collectCounterValues(readBefore, writeCount, appendCount);
+            EXPECT_EQ(rbfm.readRecord(fileHandle, recordDescriptor, movedRid, outBuffer), success);
+            fileHandle.collectCounterValues(readAfter, writeCount, appendCount);
+            EXPECT_EQ(*(int *) ((char *) outBuffer + 1), 800);
+            return readAfter - readBefore;
+        };
+        ASSERT_EQ(readsOfMovedRecord(), chainLength + 1);
+
+        ASSERT_EQ(rbfm.vacuum(fileHandle, stats), success);
+        ASSERT_EQ(stats.collapsed, 1);
+        // the moved record's skipped tombstones plus the dead one
+        ASSERT_EQ(stats.reclaimed, chainLength) << "Skipped and dead tombstones should be removed.";
+        ASSERT_EQ(readsOfMovedRecord(), 2) << "A vacuumed record should be one hop away.";
+        ASSERT_NE(rbfm.readRecord(fileHandle, recordDescriptor, deadRid, outBuffer), success);
+
+        ASSERT_EQ(rbfm.vacuum(fileHandle, stats, true), success);
+        ASSERT_EQ(stats.tombstones, 1);
+        ASSERT_EQ(stats.maxChainLength, 1);
+        ASSERT_EQ(stats.chainLengths[1], 1);
+    }
+
+    TEST_F(RBFM_Test, update_single_attribute) {
+        // Functions tested
+        // 1. Overwrite a fixed-width attribute in place
+        // 2. Grow, shrink and null a varchar attribute
+        // 3. Grow an attribute past the page's free space
+        std::vector<PeterDB::Attribute> recordDescriptor;
+        createRecordDescriptor(recordDescriptor);
+        recordDescriptor[0].length = (PeterDB::AttrLength) 1000;
+        inBuffer = malloc(2000);
+        outBuffer = malloc(2000);
+        nullsIndicator = initializeNullFieldsIndicator(recordDescriptor);
+        size_t recordSize;
+        char value[1100];
+
+        PeterDB::RID rid, nextRid;
+        prepareRecord((int) recordDescriptor.size(), nullsIndicator, 5, "Peter", 24, 170.1, 5000, inBuffer, recordSize);
+        ASSERT_EQ(rbfm.insertRecord(fileHandle, recordDescriptor, inBuffer, rid), success);
+        prepareRecord((int) recordDescriptor.size(), nullsIndicator, 4, "Next", 30, 180.2, 6000, inBuffer, recordSize);
+        ASSERT_EQ(rbfm.insertRecord(fileHandle, recordDescriptor, inBuffer, nextRid), success);
+
+        // "data" follows the readAttribute() format
+        auto setValue = [&](const std::string &attributeName, const void *val, int length, bool isNull) {
+            value[0] = isNull ? (char) 128 : 0;
+            memcpy(value + 1, val, length);
+            return rbfm.updateAttribute(fileHandle, recordDescriptor, rid, attributeName, value);
+        };
+        auto expectRecord = [&](const PeterDB::RID &recordRid, const std::string &name, int age, float height, int salary,
+                                unsigned char nulls) {
+            unsigned char nullsBits[1] = {nulls};
+            prepareRecord((int) recordDescriptor.size(), nullsBits, (int) name.length(), name, age, height, salary,
+                          inBuffer, recordSize);
+            ASSERT_EQ(rbfm.readRecord(fileHandle, recordDescriptor, recordRid, outBuffer), success);
+            ASSERT_EQ(memcmp(inBuffer, outBuffer, recordSize), 0) << "The record should hold the updated attribute.";
+        };
+
+        int age = 25;
+        ASSERT_EQ(setValue("Age", &age, sizeof(int), false), success);
+        expectRecord(rid, "Peter", 25, 170.1, 5000, 0);
+
+        for (const std::string &name : {std::string{"Peter Anteater"}, std::string{"P"}}) {
+            int nameLength = (int) name.length();
+            memcpy(value + 1 + sizeof(int), name.c_str(), nameLength);
+            ASSERT_EQ(setValue("EmpName", &nameLength, sizeof(int), false), success);
+            expectRecord(rid, name, 25, 170.1, 5000, 0);
+            expectRecord(nextRid, "Next", 30, 180.2, 6000, 0);
+        }
+
+        ASSERT_EQ(setValue("Height", &age, 0, true), success);
+        expectRecord(rid, "P", 25, 0, 5000, 32);
+        ASSERT_NE(setValue("Bonus", &age, sizeof(int), false), success) << "An unknown attribute should fail.";
+
+        // fill the page, then grow the name past its free space
+        PeterDB::RID fillerRid;
+        prepareRecord((int) recordDescriptor.size(), nullsIndicator, 6, "filler", 1, 2, 3, inBuffer, recordSize);
+        while (fileHandle.getNumberOfPages() == 1)
+            ASSERT_EQ(rbfm.insertRecord(fileHandle, recordDescriptor, inBuffer, fillerRid), success);
+        std::string longName(800, 'n');
+        int nameLength = (int) longName.length();
+        memcpy(value + 1 + sizeof(int), longName.c_str(), nameLength);
+        ASSERT_EQ(setValue("EmpName", &nameLength, sizeof(int), false), success);
+        expectRecord(rid, longName, 25, 0, 5000, 32);
+        expectRecord(nextRid, "Next", 30, 180.2, 6000, 0);
+    }
+
+    TEST_F(RBFM_Test, read_records_batch) {
+        // Functions tested
+        // 1. Insert records over several pages, forward one of them
+        // 2. Read them back in one batch, in an order unrelated to their pages
+        // 3. Each page is read once
+        std::vector<PeterDB::Attribute> recordDescriptor;
+        createRecordDescriptor(recordDescriptor);
+        recordDescriptor[0].length = (PeterDB::AttrLength) 1000;
+        inBuffer = malloc(2000);
+        outBuffer = malloc(2000);
+        nullsIndicator = initializeNullFieldsIndicator(recordDescriptor);
+        size_t recordSize;
+
+        int numRecords = 40;
+        std::vector<PeterDB::RID> rids(numRecords);
+        for (int i = 0; i < numRecords; i++) {
+            prepareRecord((int) recordDescriptor.size(), nullsIndicator, 300, std::string(300, 'a' + i % 26), i, 1, i * 10,
+                          inBuffer, recordSize);
+            ASSERT_EQ(rbfm.insertRecord(fileHandle, recordDescriptor, inBuffer, rids[i]), success);
+        }
+        prepareRecord((int) recordDescriptor.size(), nullsIndicator, 900, std::string(900, 'z'), 0, 1, 0, inBuffer, recordSize);
+        ASSERT_EQ(rbfm.updateRecord(fileHandle, recordDescriptor, inBuffer, rids[0]), success);
+
+        // alternate between the ends of the file
+        std::vector<PeterDB::RID> batch;
+        for (int i = 0; i < numRecords / 2; i++) {
+            batch.push_back(rids[i]);
+            batch.push_back(rids[numRecords - 1 - i]);
+        }
+        std::vector<char> data(batch.size() * PAGE_SIZE);
+        std::vector<unsigned> offsets;
+        std::vector<PeterDB::SizeType> versions;
+        unsigned readBefore, readAfter, writeCount, appendCount;
+        fileHandle.collectCounterValues(readBefore, writeCount, appendCount);
+        ASSERT_EQ(rbfm.readRecords(fileHandle, recordDescriptor, batch, data.data(), offsets, &versions), success);
+        fileHandle.collectCounterValues(readAfter, writeCount, appendCount);
+        ASSERT_EQ(readAfter - readBefore, fileHandle.getNumberOfPages() + 1)
+                                    << "Each page should be read once, plus one hop for the forwarded record.";
+
+        ASSERT_EQ(offsets.size(), batch.size());
+        for (unsigned i = 0; i < batch.size(); i++) {
+            ASSERT_EQ(rbfm.readRecord(fileHandle, recordDescriptor, batch[i], outBuffer), success);
+            ASSERT_EQ(memcmp(data.data() + offsets[i], outBuffer, rbfm.recordLength(recordDescriptor, outBuffer)), 0)
+                                        << "Record " << i << " of the batch should match readRecord().";
+            ASSERT_EQ(versions[i], 1);
+        }
+    }
+
+    TEST_F(RBFM_Test, read_several_attributes) {
+        // Functions tested
+        // 1. Insert a record with a null field
+        // 2. Read several of its attributes at once, out of descriptor order
+        std::vector<PeterDB::Attribute> recordDescriptor;
+        createRecordDescriptor(recordDescriptor);
+        inBuffer = malloc(200);
+        outBuffer = malloc(200);
+        nullsIndicator = initializeNullFieldsIndicator(recordDescriptor);
+        nullsIndicator[0] = 32;  // Height is null
+        size_t recordSize;
+
+        PeterDB::RID rid;
+        prepareRecord((int) recordDescriptor.size(), nullsIndicator, 8, "Anteater", 25, 177.8, 6200, inBuffer, recordSize);
+        ASSERT_EQ(rbfm.insertRecord(fileHandle, recordDescriptor, inBuffer, rid), success);
+
+        // Salary, Height, EmpName
+        ASSERT_EQ(rbfm.readAttributes(fileHandle, recordDescriptor, rid, {3, 2, 0}, outBuffer), success);
+        char *out = (char *) outBuffer;
+        ASSERT_EQ(*(unsigned char *) out, 64) << "Only the second projected attribute should be null.";
+        ASSERT_EQ(*(int *) (out + 1), 6200);
+        ASSERT_EQ(*(int *) (out + 1 + sizeof(int)), 8);
+        ASSERT_EQ(memcmp(out + 1 + 2 * sizeof(int), "Anteater", 8), 0);
+
+        ASSERT_NE(rbfm.readAttributes(fileHandle, recordDescriptor, rid, {4}, outBuffer), success)
+                                    << "An attribute outside the descriptor should fail.";
+    }
+
+    TEST_F(RBFM_Test, fixed_width_prefix_records) {
+        // Functions tested
+        // 1. Insert records of an all fixed-width descriptor and of one with a fixed-width prefix, alternately,
+        //    through the layout of each descriptor and through none
+        // 2. Include records with nulls inside and after the prefix
+        // 3. Read them all back
+        std::vector<PeterDB::Attribute> fixedDescriptor{{"a", PeterDB::TypeInt, 4}, {"b", PeterDB::TypeReal, 4},
+                                                        {"c", PeterDB::TypeInt, 4}};
+        std::vector<PeterDB::Attribute> mixedDescriptor{{"a", PeterDB::TypeInt, 4}, {"b", PeterDB::TypeReal, 4},
+                                                        {"c", PeterDB::TypeVarChar, 20}, {"d", PeterDB::TypeInt, 4}};
+        inBuffer = malloc(100);
+        outBuffer = malloc(100);
+
+        // a record holds its null byte, then the non-null values
+        auto makeRecord = [](const std::vector<PeterDB::Attribute> &descriptor, unsigned char nulls, int i, char *record) {
+            char *pos = record + 1;
+            record[0] = (char) nulls;
+            for (int field = 0; field < (int) descriptor.size(); field++) {
+                if (nulls & (128 >> field)) continue;
+                if (descriptor[field].type == PeterDB::TypeVarChar) {
+                    int length = i % 7;
+                    memcpy(pos, &length, sizeof(int));
+                    memset(pos + sizeof(int), 'a' + field, length);
+                    pos += sizeof(int) + length;
+                } else {
+                    int value = i * 10 + field;
+                    memcpy(pos, &value, sizeof(int));
+                    pos += sizeof(int);
+                }
+            }
+            return (size_t) (pos - record);
+        };
+
+        PeterDB::RecordLayout layouts[2];
+        rbfm.getRecordLayout(fixedDescriptor, layouts[0]);
+        rbfm.getRecordLayout(mixedDescriptor, layouts[1]);
+        ASSERT_EQ(layouts[0].fixedPrefix, 3u);
+        ASSERT_EQ(layouts[1].fixedPrefix, 2u);
+
+        std::vector<PeterDB::RID> rids;
+        std::vector<std::vector<char>> records;
+        std::vector<int> descriptors;
+        for (int i = 0; i < 60; i++) {
+            const std::vector<PeterDB::Attribute> &descriptor = i % 2 ? mixedDescriptor : fixedDescriptor;
+            unsigned char nulls = i % 3 == 0 ? 0 : i % 3 == 1 ? 64 : 16;
+            size_t recordSize = makeRecord(descriptor, nulls, i, (char *) inBuffer);
+            ASSERT_EQ(rbfm.recordLength(descriptor, inBuffer), recordSize);
+            ASSERT_EQ(rbfm.recordLength(descriptor, inBuffer, &layouts[i % 2]), recordSize);
+            fileHandle.recordLayout = i % 4 < 2 ? &layouts[i % 2] : nullptr;
+            PeterDB::RID rid;
+            ASSERT_EQ(rbfm.insertRecord(fileHandle, descriptor, inBuffer, rid), success);
+            rids.push_back(rid);
+            records.emplace_back((char *) inBuffer, (char *) inBuffer + recordSize);
+            descriptors.push_back(i % 2);
+        }
+
+        for (int i = 0; i < 60; i++) {
+            const std::vector<PeterDB::Attribute> &descriptor = descriptors[i] ? mixedDescriptor : fixedDescriptor;
+            ASSERT_EQ(rbfm.readRecord(fileHandle, descriptor, rids[i], outBuffer), success);
+            ASSERT_EQ(memcmp(outBuffer, records[i].data(), records[i].size()), 0) << "Record " << i << " should read back.";
+            ASSERT_EQ(rbfm.readAttribute(fileHandle, descriptor, rids[i], "a", outBuffer), success);
+            ASSERT_EQ(*(int *) ((char *) outBuffer + 1), i * 10);
+        }
+    }
+
+    TEST_F(RBFM_Test, sample_records) {
+        // Functions tested
+        // 1. Insert records over many pages
+        // 2. Sample some pages, reading only those
+        // 3. The same seed draws the same sample, a sample larger than the file draws every record
+        std::vector<PeterDB::Attribute> recordDescriptor;
+        createRecordDescriptor(recordDescriptor);
+        inBuffer = malloc(200);
+        outBuffer = malloc(200);
+        nullsIndicator = initializeNullFieldsIndicator(recordDescriptor);
+        size_t recordSize;
+
+        int numRecords = 500;
+        for (int i = 0; i < numRecords; i++) {
+            PeterDB::RID rid;
+            prepareRecord((int) recordDescriptor.size(), nullsIndicator, 80, std::string(80, 's'), i, 1, i, inBuffer,
+                          recordSize);
+            ASSERT_EQ(rbfm.insertRecord(fileHandle, recordDescriptor, inBuffer, rid), success);
+        }
+        ASSERT_GT(fileHandle.getNumberOfPages(), 8);
+
+        std::vector<PeterDB::RID> sample, again;
+        PeterDB::SampleStats stats;
+        auto distinct = [](const std::vector<PeterDB::RID> &rids) {
+            std::set<std::pair<unsigned, unsigned>> seen;
+            for (const PeterDB::RID &rid : rids) seen.emplace(rid.pageNum, rid.slotNum);
+            return seen.size();
+        };
+        unsigned readBefore, readAfter, writeCount, appendCount;
+        fileHandle.collectCounterValues(readBefore, writeCount, appendCount);
+        ASSERT_EQ(rbfm.sampleRecords(fileHandle, 4, 20, 42, sample, stats), success);
+        fileHandle.collectCounterValues(readAfter, writeCount, appendCount);
+        ASSERT_EQ(readAfter - readBefore, 4) << "Only the sampled pages should be read.";
+        ASSERT_EQ(stats.pagesSampled, 4);
+        ASSERT_EQ(stats.pagesInFile, fileHandle.getNumberOfPages());
+        ASSERT_GE(stats.recordsSeen, 20);
+        ASSERT_EQ(sample.size(), 20);
+        ASSERT_EQ(distinct(sample), 20) << "Sampled records should be distinct.";
+        for (const PeterDB::RID &rid : sample)
+            ASSERT_EQ(rbfm.readRecord(fileHandle, recordDescriptor, rid, outBuffer), success);
+
+        ASSERT_EQ(rbfm.sampleRecords(fileHandle, 4, 20, 42, again, stats), success);
+        ASSERT_EQ(sample.size(), again.size());
+        for (unsigned i = 0; i < sample.size(); i++) {
+            ASSERT_EQ(sample[i].pageNum, again[i].pageNum) << "The same seed should draw the same sample.";
+            ASSERT_EQ(sample[i].slotNum, again[i].slotNum) << "The same seed should draw the same sample.";
+        }
+
+        ASSERT_EQ(rbfm.sampleRecords(fileHandle, 1000, 1000, 7, sample, stats), success);
+        ASSERT_EQ(stats.recordsSeen, numRecords);
+        ASSERT_EQ(distinct(sample), numRecords);
+    }
+
+    TEST_F(RBFM_Test, analyze_file) {
+        // Functions tested
+        // 1. Insert records of two schema versions, delete some and forward one
+        // 2. Analyze the file in one pass
+        std::vector<PeterDB::Attribute> recordDescriptor;
+        createRecordDescriptor(recordDescriptor);
+        recordDescriptor[0].length = (PeterDB::AttrLength) 1000;
+        inBuffer = malloc(2000);
+        outBuffer = malloc(2000);
+        nullsIndicator = initializeNullFieldsIndicator(recordDescriptor);
+        size_t recordSize;
+
+        int numRecords = 200;
+        std::vector<PeterDB::RID> rids(numRecords);
+        for (int i = 0; i < numRecords; i++) {
+            prepareRecord((int) recordDescriptor.size(), nullsIndicator, 50, std::string(50, 'a'), i, 1, i, inBuffer,
+                          recordSize);
+            ASSERT_EQ(rbfm.insertRecord(fileHandle, recordDescriptor, inBuffer, rids[i], i < 150 ? 1 : 2), success);
+        }
+        for (int i = 0; i < 10; i++)
+            ASSERT_EQ(rbfm.deleteRecord(fileHandle, recordDescriptor, rids[2 * i + 1]), success);
+        // the first page is full, so growing a record there forwards it
+        prepareRecord((int) recordDescriptor.size(), nullsIndicator, 1500, std::string(1500, 'b'), 0, 1, 0, inBuffer,
+                      recordSize);
+        ASSERT_EQ(rbfm.updateRecord(fileHandle, recordDescriptor, inBuffer, rids[0]), success);
+
+        PeterDB::HeapStats stats;
+        unsigned readBefore, readAfter, writeCount, appendCount;
+        fileHandle.collectCounterValues(readBefore, writeCount, appendCount);
+        ASSERT_EQ(rbfm.analyze(fileHandle, stats), success);
+        fileHandle.collectCounterValues(readAfter, writeCount, appendCount);
+        ASSERT_EQ(readAfter - readBefore, fileHandle.getNumberOfPages()) << "Every page should be read once.";
+
+        ASSERT_EQ(stats.pages, fileHandle.getNumberOfPages());
+        ASSERT_EQ(stats.fillHistogram.size(), HEAP_FILL_BUCKETS);
+        ASSERT_EQ(std::accumulate(stats.fillHistogram.begin(), stats.fillHistogram.end(), 0u), stats.pages);
+        ASSERT_EQ(stats.records, numRecords - 10);
+        ASSERT_EQ(stats.emptySlots, 10);
+        ASSERT_EQ(stats.chains.tombstones, 1);
+        ASSERT_EQ(stats.chains.chainLengths[1], 1);
+        ASSERT_GT(stats.reclaimableBytes, 10 * 4) << "Empty slots and the tombstone should be reclaimable.";
+        ASSERT_GT(stats.freeBytes, stats.fragmentedBytes);
+        ASSERT_EQ(stats.versions.size(), 3);
+        ASSERT_EQ(stats.versions[1], 140);
+        ASSERT_EQ(stats.versions[2], 50);
+    }
+
     TEST_F(RBFM_Test_2, varchar_compact_size) {
         // Checks whether VarChar is implemented correctly or not.
         //
@@ -363,6 +363,186 @@ namespace PeterDBTesting {
         }
     }
 
+    TEST_F(RM_Scan_Test, columnar_table_scan_and_batch) {
+        // Functions Tested
+        // 1. Create a table with columnar storage
+        // 2. Insert, read, update and delete tuples
+        // 3. Conditional scan fetched in batches
+
+        std::string columnarTable = "rm_test_columnar_table";
+        std::vector<PeterDB::Attribute> table_attrs = parseDDL(
+                "CREATE TABLE " + columnarTable + " (emp_name VARCHAR(50), age INT, height REAL, salary REAL)");
+        ASSERT_EQ(rm.createTable(columnarTable, table_attrs, PeterDB::LayoutColumnar), success)
+                                    << "Create table " << columnarTable << " should succeed.";
+
+        int numTuples = 2500;
+        size_t tupleSize = 0;
+        inBuffer = malloc(200);
+        outBuffer = malloc(200);
+        ASSERT_EQ(rm.getAttributes(columnarTable, attrs), success) << "RelationManager::getAttributes() should succeed.";
+        nullsIndicator = initializeNullFieldsIndicator(attrs);
+
+        std::vector<PeterDB::RID> rids(numTuples);
+        for (int i = 0; i < numTuples; i++) {
+            prepareTuple((int) attrs.size(), nullsIndicator, 6, "Tester", i, (float) i, (float) i * 2, inBuffer, tupleSize);
+            ASSERT_EQ(rm.insertTuple(columnarTable, inBuffer, rids[i]), success)
+                                        << "RelationManager::insertTuple() should succeed.";
+        }
+
+        // read back a tuple from each row group
+        for (int i = 0; i < numTuples; i += 1001) {
+            prepareTuple((int) attrs.size(), nullsIndicator, 6, "Tester", i, (float) i, (float) i * 2, inBuffer, tupleSize);
+            memset(outBuffer, 0, 200);
+            ASSERT_EQ(rm.readTuple(columnarTable, rids[i], outBuffer), success);
+            ASSERT_EQ(memcmp(inBuffer, outBuffer, tupleSize), 0) << "Returned tuple should match the inserted one.";
+        }
+
+        // a batch goes to the row group the last insert went to, writing each of its chunk pages once
+        PeterDB::RecordBasedFileManager &rbfm = PeterDB::RecordBasedFileManager::instance();
+        PeterDB::FileHandle fileHandle;
+        unsigned readsBefore, writesBefore, appendsBefore, readsAfter, writesAfter, appendsAfter;
+        ASSERT_EQ(rbfm.openFile(columnarTable, fileHandle), success);
+        prepareTuple((int) attrs.size(), nullsIndicator, 6, "Batch", 0, 0, 0, inBuffer, tupleSize);
+        std::vector<const void *> batch(100, inBuffer);
+        std::vector<PeterDB::RID> batchInserted;
+        ASSERT_EQ(fileHandle.collectCounterValues(readsBefore, writesBefore, appendsBefore), success);
+        ASSERT_EQ(rbfm.insertRecords(fileHandle, attrs, batch, batchInserted), success);
+        ASSERT_EQ(fileHandle.collectCounterValues(readsAfter, writesAfter, appendsAfter), success);
+        ASSERT_EQ(batchInserted.size(), batch.size());
+        ASSERT_EQ(batchInserted.back().pageNum, rids[numTuples - 1].pageNum) << "The batch should fill the last row group.";
+        EXPECT_LT(writesAfter - writesBefore, 10) << "Each chunk page should be written once for the batch.";
+        EXPECT_LT(readsAfter - readsBefore, 10) << "The open row group should be found without walking the file.";
+        ASSERT_EQ(rbfm.closeFile(fileHandle), success);
+        ASSERT_EQ(rm.readTuple(columnarTable, batchInserted[50], outBuffer), success);
+        ASSERT_EQ(memcmp(inBuffer, outBuffer, tupleSize), 0) << "Returned tuple should match the inserted one.";
+
+        // update and delete keep the remaining tuples in place
+        prepareTuple((int) attrs.size(), nullsIndicator, 7, "Updated", 1, 1, 2, inBuffer, tupleSize);
+        ASSERT_EQ(rm.updateTuple(columnarTable, inBuffer, rids[1]), success);
+        ASSERT_EQ(rm.readAttribute(columnarTable, rids[1], "emp_name", outBuffer), success);
+        ASSERT_EQ(memcmp((char *) outBuffer + 1 + sizeof(int), "Updated", 7), 0);
+        ASSERT_EQ(rm.deleteTuple(columnarTable, rids[2100]), success);
+        ASSERT_NE(rm.readTuple(columnarTable, rids[2100], outBuffer), success) << "A deleted tuple should not be read.";
+
+        // scan age >= 2000 in batches
+        int ageLimit = 2000;
+        std::vector<std::string> attributes{"salary", "age"};
+        ASSERT_NE(rm.scan(columnarTable, "age", PeterDB::GE_OP, &ageLimit, {"salary", "weight"}, rmsi), success)
+                                    << "Projecting an attribute the table does not have should fail.";
+        ASSERT_EQ(rm.scan(columnarTable, "age", PeterDB::GE_OP, &ageLimit, attributes, rmsi), success)
+                                    << "RelationManager::scan() should succeed.";
+        unsigned batchSize = 64;
+        void *batchBuffer = malloc(batchSize * 9);
+        std::vector<PeterDB::RID> batchRids;
+        std::vector<unsigned> offsets;
+        std::set<int> ages;
+        while (rmsi.getNextBatch(batchRids, batchBuffer, offsets, batchSize) != RM_EOF) {
+            ASSERT_LE(batchRids.size(), batchSize);
+            ASSERT_EQ(batchRids.size(), offsets.size());
+            for (unsigned i = 0; i < offsets.size(); ++i) {
+                char *tuple = (char *) batchBuffer + offsets[i];
+                int age = *(int *) (tuple + 1 + sizeof(float));
+                ASSERT_EQ(*(float *) (tuple + 1), (float) age * 2) << "Projected values should belong to one tuple.";
+                ASSERT_EQ(batchRids[i].pageNum, rids[age].pageNum);
+                ASSERT_EQ(batchRids[i].slotNum, rids[age].slotNum);
+                ages.insert(age);
+            }
+        }
+        free(batchBuffer);
+        ASSERT_EQ(ages.size(), numTuples - ageLimit - 1) << "Every matching tuple should be scanned once.";
+        ASSERT_EQ(ages.count(2100), 0) << "A deleted tuple should not be scanned.";
+
+        ASSERT_EQ(rmsi.close(), success);
+        ASSERT_EQ(rm.deleteTable(columnarTable), success);
+    }
+
+    TEST_F(RM_Scan_Test, dictionary_encoded_scan) {
+        // Functions Tested
+        // 1. Create a table with a dictionary-encoded attribute
+        // 2. Insert, read and update tuples
+        // 3. Equality scans on the encoded attribute
+
+        std::string dictTable = "rm_test_dict_table";
+        std::vector<PeterDB::Attribute> table_attrs = parseDDL(
+                "CREATE TABLE " + dictTable + " (emp_name VARCHAR(50), age INT, height REAL, salary REAL)");
+        ASSERT_NE(rm.createTable(dictTable, table_attrs, PeterDB::LayoutSlotted, {"age"}), success)
+                                    << "Only varchar attributes can be dictionary-encoded.";
+        ASSERT_EQ(rm.createTable(dictTable, table_attrs, PeterDB::LayoutSlotted, {"emp_name"}), success)
+                                    << "Create table " << dictTable << " should succeed.";
+
+        int numTuples = 300;
+        size_t tupleSize = 0;
+        inBuffer = malloc(200);
+        outBuffer = malloc(200);
+        ASSERT_EQ(rm.getAttributes(dictTable, attrs), success) << "RelationManager::getAttributes() should succeed.";
+        ASSERT_EQ(attrs[0].type, PeterDB::TypeVarChar) << "Encoded attributes should still be reported as varchar.";
+        nullsIndicator = initializeNullFieldsIndicator(attrs);
+
+        std::vector<std::string> names{"Alice", "Bob", "Carol"};
+        std::vector<PeterDB::RID> rids(numTuples);
+        for (int i = 0; i < numTuples; i++) {
+            const std::string &name = names[i % names.size()];
+            prepareTuple((int) attrs.size(), nullsIndicator, name.size(), name, i, (float) i, (float) i * 2, inBuffer,
+                         tupleSize);
+            ASSERT_EQ(rm.insertTuple(dictTable, inBuffer, rids[i]), success)
+                                        << "RelationManager::insertTuple() should succeed.";
+        }
+
+        prepareTuple((int) attrs.size(), nullsIndicator, 3, "Bob", 4, 4, 8, inBuffer, tupleSize);
+        memset(outBuffer, 0, 200);
+        ASSERT_EQ(rm.readTuple(dictTable, rids[4], outBuffer), success);
+        ASSERT_EQ(memcmp(inBuffer, outBuffer, tupleSize), 0) << "Returned tuple should be decoded.";
+
+        prepareTuple((int) attrs.size(), nullsIndicator, 4, "Dave", 5, 5, 10, inBuffer, tupleSize);
+        ASSERT_EQ(rm.updateTuple(dictTable, inBuffer, rids[5]), success);
+        ASSERT_EQ(rm.readAttribute(dictTable, rids[5], "emp_name", outBuffer), success);
+        ASSERT_EQ(*(unsigned *) ((char *) outBuffer + 1), 4);
+        ASSERT_EQ(memcmp((char *) outBuffer + 1 + sizeof(int), "Dave", 4), 0);
+
+        // emp_name = "Carol"
+        char value[20];
+        *(unsigned *) value = 5;
+        memcpy(value + sizeof(unsigned), "Carol", 5);
+        std::vector<std::string> attributes{"age", "emp_name"};
+        ASSERT_EQ(rm.scan(dictTable, "emp_name", PeterDB::EQ_OP, value, attributes, rmsi), success)
+                                    << "RelationManager::scan() should succeed.";
+        PeterDB::RID rid;
+        int count = 0;
+        while (rmsi.getNextTuple(rid, outBuffer) != RM_EOF) {
+            int age = *(int *) ((char *) outBuffer + 1);
+            ASSERT_EQ(age % 3, 2);
+            ASSERT_EQ(*(unsigned *) ((char *) outBuffer + 1 + sizeof(int)), 5);
+            ASSERT_EQ(memcmp((char *) outBuffer + 1 + 2 * sizeof(int), "Carol", 5), 0);
+            count++;
+        }
+        ASSERT_EQ(count, numTuples / 3 - 1) << "The updated tuple should no longer match.";
+        ASSERT_EQ(rmsi.close(), success);
+
+        // a value missing from the dictionary matches nothing with EQ and everything with NE
+        *(unsigned *) value = 3;
+        memcpy(value + sizeof(unsigned), "Eve", 3);
+        ASSERT_EQ(rm.scan(dictTable, "emp_name", PeterDB::NE_OP, value, {"age"}, rmsi), success);
+        count = 0;
+        while (rmsi.getNextTuple(rid, outBuffer) != RM_EOF) count++;
+        ASSERT_EQ(count, numTuples);
+        ASSERT_EQ(rmsi.close(), success);
+
+        ASSERT_NE(rm.scan(dictTable, "emp_name", PeterDB::LT_OP, value, {"age"}, rmsi), success)
+                                    << "Range scans on encoded attributes should fail.";
+
+        ASSERT_EQ(rm.deleteTable(dictTable), success);
+        ASSERT_FALSE(fileExists(dictTable + "_emp_name.dict")) << "The dictionary should be removed with the table.";
+
+        // a table created again under the same name starts from an empty dictionary
+        ASSERT_EQ(rm.createTable(dictTable, table_attrs, PeterDB::LayoutSlotted, {"emp_name"}), success);
+        prepareTuple((int) attrs.size(), nullsIndicator, 3, "Zed", 1, 1, 2, inBuffer, tupleSize);
+        ASSERT_EQ(rm.insertTuple(dictTable, inBuffer, rid), success);
+        memset(outBuffer, 0, 200);
+        ASSERT_EQ(rm.readTuple(dictTable, rid, outBuffer), success);
+        ASSERT_EQ(memcmp(inBuffer, outBuffer, tupleSize), 0) << "Returned tuple should be decoded.";
+        ASSERT_EQ(rm.deleteTable(dictTable), success);
+    }
+
     TEST_F(RM_Scan_Test, simple_scan_after_table_deletion) {
         // Functions Tested
         // 1. Simple scan
@@ -1729,5 +1909,641 @@ namespace PeterDBTesting {
                          stream.str());
     }
 
+    TEST_F(RM_Version_Test, scan_after_add_attribute) {
+        // Functions Tested:
+        // 1. Insert tuples before and after Add Attribute
+        // 2. Scan projecting the added attribute over both versions
+
+        size_t tupleSize = 0;
+        inBuffer = malloc(200);
+        outBuffer = malloc(200);
+        ASSERT_EQ(rm.getAttributes(tableName, attrs), success) << "RelationManager::getAttributes() should succeed.";
+        nullsIndicator = initializeNullFieldsIndicator(attrs);
+
+        // old and new versions interleave on the same pages
+        int numTuples = 100;
+        for (int i = 0; i < numTuples; i++) {
+            prepareTuple((int) attrs.size(), nullsIndicator, 6, "Tester", i, (float) i, (float) i, inBuffer, tupleSize);
+            ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rid), success)
+                                        << "RelationManager::insertTuple() should succeed.";
+        }
+        PeterDB::Attribute attr{"ssn", PeterDB::TypeInt, 4};
+        ASSERT_EQ(rm.addAttribute(tableName, attr), success) << "RelationManager::addAttribute() should succeed.";
+        for (int i = numTuples; i < 2 * numTuples; i++) {
+            prepareTupleAfterAdd((int) attrs.size() + 1, nullsIndicator, 6, "Tester", i, (float) i, (float) i, i * 10,
+                                 inBuffer, tupleSize);
+            ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rid), success)
+                                        << "RelationManager::insertTuple() should succeed.";
+        }
+
+        // records of the old version return null for ssn, later records of the current version do not
+        int ageLimit = numTuples / 2;
+        std::vector<std::string> attributes{"ssn", "age"};
+        PeterDB::RM_ScanIterator rmsi;
+        ASSERT_EQ(rm.scan(tableName, "age", PeterDB::GE_OP, &ageLimit, attributes, rmsi), success)
+                                    << "RelationManager::scan() should succeed.";
+        int count = 0;
+        while (rmsi.getNextTuple(rid, outBuffer) != RM_EOF) {
+            unsigned char nullBits = *(unsigned char *) outBuffer;
+            if (nullBits & 128) {
+                int age = *(int *) ((char *) outBuffer + 1);
+                ASSERT_LT(age, numTuples) << "Only old records should lack the added attribute.";
+            } else {
+                int ssn = *(int *) ((char *) outBuffer + 1);
+                int age = *(int *) ((char *) outBuffer + 1 + sizeof(int));
+                ASSERT_EQ(ssn, age * 10);
+            }
+            count++;
+        }
+        ASSERT_EQ(count, 2 * numTuples - ageLimit);
+        ASSERT_EQ(rmsi.close(), success);
+    }
+
+
+    TEST_F(RM_Version_Test, migrate_old_version_records) {
+        // Functions Tested:
+        // 1. Insert tuples, then Add Attribute
+        // 2. Migrate the table in steps
+        // 3. Read tuples after the migration
+
+        size_t tupleSize = 0;
+        inBuffer = malloc(200);
+        outBuffer = malloc(200);
+        ASSERT_EQ(rm.getAttributes(tableName, attrs), success) << "RelationManager::getAttributes() should succeed.";
+        nullsIndicator = initializeNullFieldsIndicator(attrs);
+
+        int numTuples = 300;
+        std::vector<PeterDB::RID> rids(numTuples);
+        for (int i = 0; i < numTuples; i++) {
+            prepareTuple((int) attrs.size(), nullsIndicator, 6, "Tester", i, (float) i, (float) i, inBuffer, tupleSize);
+            ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rids[i]), success)
+                                        << "RelationManager::insertTuple() should succeed.";
+        }
+        PeterDB::Attribute attr{"ssn", PeterDB::TypeInt, 4};
+        ASSERT_EQ(rm.addAttribute(tableName, attr), success) << "RelationManager::addAttribute() should succeed.";
+
+        // every step rewrites at most the requested number of records
+        unsigned step = 64, migrated, total = 0;
+        bool done = false;
+        while (!done) {
+            ASSERT_EQ(rm.migrateTable(tableName, step, migrated, done), success)
+                                        << "RelationManager::migrateTable() should succeed.";
+            ASSERT_LE(migrated, step);
+            total += migrated;
+        }
+        ASSERT_EQ(total, numTuples) << "Every old record should be migrated once.";
+        ASSERT_EQ(rm.migrateTable(tableName, step, migrated, done), success);
+        ASSERT_EQ(migrated, 0);
+        ASSERT_TRUE(done);
+
+        // the records now carry the current version and read the same as before
+        PeterDB::RecordBasedFileManager &rbfm = PeterDB::RecordBasedFileManager::instance();
+        ASSERT_EQ(rbfm.openFile(tableName, fileHandle), success);
+        for (int i = 0; i < numTuples; i += 7) {
+            PeterDB::SizeType version = 0;
+            ASSERT_EQ(rbfm.readRecord(fileHandle, attrs, rids[i], outBuffer, &version), success);
+            ASSERT_EQ(version, 2) << "Migrated records should have the current schema version.";
+            ASSERT_EQ(rm.readAttribute(tableName, rids[i], "age", outBuffer), success);
+            ASSERT_EQ(*(int *) ((char *) outBuffer + 1), i);
+            ASSERT_EQ(rm.readAttribute(tableName, rids[i], "ssn", outBuffer), success);
+            ASSERT_EQ(*(unsigned char *) outBuffer, 128) << "The added attribute should be null.";
+        }
+        ASSERT_EQ(rbfm.closeFile(fileHandle), success);
+
+        // a later schema change starts the migration over
+        ASSERT_EQ(rm.dropAttribute(tableName, "height"), success) << "RelationManager::dropAttribute() should succeed.";
+        ASSERT_EQ(rm.migrateTable(tableName, numTuples, migrated, done), success);
+        ASSERT_EQ(migrated, numTuples);
+        ASSERT_TRUE(done);
+        ASSERT_EQ(rm.readAttribute(tableName, rids[10], "salary", outBuffer), success);
+        ASSERT_EQ(*(float *) ((char *) outBuffer + 1), 10.0f);
+    }
+
+    TEST_F(RM_Version_Test, fill_factor_keeps_updates_in_place) {
+        // Functions Tested:
+        // 1. Create a table with a fill factor
+        // 2. Insert tuples into it and into a table that packs its pages
+        // 3. Grow every tuple and check for forwarded records
+
+        size_t tupleSize = 0;
+        inBuffer = malloc(200);
+        outBuffer = malloc(200);
+        ASSERT_EQ(rm.getAttributes(tableName, attrs), success) << "RelationManager::getAttributes() should succeed.";
+        nullsIndicator = initializeNullFieldsIndicator(attrs);
+
+        std::string fillTableName = "rm_fill_factor_table";
+        remove(fillTableName.c_str());
+        ASSERT_NE(rm.createTable(fillTableName, attrs, PeterDB::LayoutSlotted, {}, 0), success)
+                                    << "A fill factor of zero should be rejected.";
+        ASSERT_EQ(rm.createTable(fillTableName, attrs, PeterDB::LayoutSlotted, {}, 80), success)
+                                    << "RelationManager::createTable() should succeed.";
+
+        int numTuples = 400;
+        std::vector<PeterDB::RID> rids(numTuples), fillRids(numTuples);
+        for (int i = 0; i < numTuples; i++) {
+            prepareTuple((int) attrs.size(), nullsIndicator, 1, "a", i, (float) i, (float) i, inBuffer, tupleSize);
+            ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rids[i]), success)
+                                        << "RelationManager::insertTuple() should succeed.";
+            ASSERT_EQ(rm.insertTuple(fillTableName, inBuffer, fillRids[i]), success)
+                                        << "RelationManager::insertTuple() should succeed.";
+        }
+        ASSERT_GT(fillRids.back().pageNum, rids.back().pageNum) << "The fill factor should leave room on every page.";
+
+        for (int i = 0; i < numTuples; i++) {
+            prepareTuple((int) attrs.size(), nullsIndicator, 9, "aaaaaaaaa", i, (float) i, (float) i, inBuffer, tupleSize);
+            ASSERT_EQ(rm.updateTuple(tableName, inBuffer, rids[i]), success)
+                                        << "RelationManager::updateTuple() should succeed.";
+            ASSERT_EQ(rm.updateTuple(fillTableName, inBuffer, fillRids[i]), success)
+                                        << "RelationManager::updateTuple() should succeed.";
+        }
+
+        // packed pages forward the grown records, pages with headroom keep them in place
+        PeterDB::ChainStats stats;
+        ASSERT_EQ(rm.vacuumTable(tableName, stats, true), success) << "RelationManager::vacuumTable() should succeed.";
+        ASSERT_GT(stats.tombstones, 0);
+        ASSERT_EQ(rm.vacuumTable(fillTableName, stats, true), success) << "RelationManager::vacuumTable() should succeed.";
+        ASSERT_EQ(stats.tombstones, 0) << "Updates should grow records in place.";
+
+        ASSERT_EQ(rm.readTuple(fillTableName, fillRids[numTuples - 1], outBuffer), success);
+        ASSERT_EQ(memcmp(inBuffer, outBuffer, tupleSize), 0) << "The updated tuple should be read back.";
+        ASSERT_EQ(rm.deleteTable(fillTableName), success) << "RelationManager::deleteTable() should succeed.";
+    }
+
+    TEST_F(RM_Catalog_Test, catalog_without_fill_factor_is_upgraded) {
+        // Functions Tested
+        // 1. Open a catalog written before Tables had a fill-factor column
+        // 2. Create a table, insert and read a tuple
+        // 3. Scan Tables for the fill factor of every table
+        rm.deleteCatalog();
+        PeterDB::RecordBasedFileManager &rbfm = PeterDB::RecordBasedFileManager::instance();
+        for (const std::string &catalogFile : {"Tables", "Columns", "Schemas", "Indices"})
+            ASSERT_EQ(rbfm.createFile(catalogFile), success);
+
+        std::vector<PeterDB::Attribute> oldTablesAttrs{{"table-id", PeterDB::TypeInt, 4},
+                                                       {"table-name", PeterDB::TypeVarChar, 50},
+                                                       {"file-name", PeterDB::TypeVarChar, 50},
+                                                       {"is-system-table", PeterDB::TypeInt, 4}};
+        std::vector<PeterDB::Attribute> columnsAttrs{{"table-id", PeterDB::TypeInt, 4},
+                                                     {"column-name", PeterDB::TypeVarChar, 50},
+                                                     {"column-type", PeterDB::TypeInt, 4},
+                                                     {"column-length", PeterDB::TypeInt, 4},
+                                                     {"column-position", PeterDB::TypeInt, 4}};
+        auto appendInt = [](std::string &record, int value) { record.append((char *) &value, sizeof(int)); };
+        auto appendString = [&](std::string &record, const std::string &value) {
+            appendInt(record, (int) value.size());
+            record += value;
+        };
+
+        PeterDB::FileHandle fileHandle;
+        PeterDB::RID rid;
+        ASSERT_EQ(rbfm.openFile("Tables", fileHandle), success);
+        std::vector<std::pair<int, std::string>> oldTables{{1, "Tables"}, {2, "Columns"}, {3, "Schemas"},
+                                                           {4, "Indices"}, {7, "rm_old_catalog_leftover"}};
+        for (const auto &table : oldTables) {
+            std::string record(1, '\0');
+            appendInt(record, table.first);
+            appendString(record, table.second);
+            appendString(record, table.second);
+            appendInt(record, table.first < 5 ? 1 : 0);
+            ASSERT_EQ(rbfm.insertRecord(fileHandle, oldTablesAttrs, record.data(), rid), success);
+        }
+        ASSERT_EQ(rbfm.closeFile(fileHandle), success);
+        ASSERT_EQ(rbfm.openFile("Columns", fileHandle), success);
+        for (const PeterDB::Attribute &attr : oldTablesAttrs) {
+            std::string record(1, '\0');
+            appendInt(record, 1);
+            appendString(record, attr.name);
+            appendInt(record, attr.type);
+            appendInt(record, (int) attr.length);
+            appendInt(record, (int) (&attr - &oldTablesAttrs[0]) + 1);
+            ASSERT_EQ(rbfm.insertRecord(fileHandle, columnsAttrs, record.data(), rid), success);
+        }
+        ASSERT_EQ(rbfm.closeFile(fileHandle), success);
+
+        std::string tableName = "rm_old_catalog_table";
+        remove(tableName.c_str());
+        std::vector<PeterDB::Attribute> table_attrs = parseDDL(
+                "CREATE TABLE " + tableName + " (emp_name VARCHAR(50), age INT, height REAL, salary REAL)");
+        ASSERT_EQ(rm.createTable(tableName, table_attrs, PeterDB::LayoutSlotted, {}, 80), success)
+                                    << "Creating a table in an old catalog should succeed.";
+
+        char inBuffer[100], outBuffer[100];
+        size_t tupleSize;
+        unsigned char *nullsIndicator = initializeNullFieldsIndicator(table_attrs);
+        prepareTuple((int) table_attrs.size(), nullsIndicator, 5, "Peter", 24, 170.1f, 5000, inBuffer, tupleSize);
+        ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rid), success);
+        ASSERT_EQ(rm.readTuple(tableName, rid, outBuffer), success);
+        ASSERT_EQ(memcmp(inBuffer, outBuffer, tupleSize), 0) << "Returned tuple should match the inserted one.";
+        free(nullsIndicator);
+
+        // old entries fill whole pages, and table ids continue after the largest one in use
+        PeterDB::RM_ScanIterator rmsi;
+        ASSERT_EQ(rm.scan("Tables", "", PeterDB::NO_OP, nullptr, {"table-id", "fill-factor"}, rmsi), success);
+        std::set<int> tableIDs;
+        while (rmsi.getNextTuple(rid, outBuffer) != RM_EOF) {
+            int tableID = *(int *) (outBuffer + 1), fillFactor = *(int *) (outBuffer + 1 + sizeof(int));
+            ASSERT_TRUE(tableIDs.insert(tableID).second) << "Table ids should not repeat.";
+            ASSERT_EQ(fillFactor, tableID == 8 ? 80 : 100);
+        }
+        ASSERT_EQ(rmsi.close(), success);
+        ASSERT_EQ(tableIDs.size(), oldTables.size() + 1);
+        ASSERT_EQ(*tableIDs.rbegin(), 8);
+
+        ASSERT_EQ(rm.deleteTable(tableName), success);
+        ASSERT_EQ(rm.deleteCatalog(), success);
+    }
+
+    TEST_F(RM_Version_Test, update_single_attribute) {
+        // Functions Tested:
+        // 1. Create an index, insert tuples
+        // 2. Update one attribute of some tuples
+        // 3. Read tuples and scan the index after the updates
+
+        size_t tupleSize = 0;
+        inBuffer = malloc(200);
+        outBuffer = malloc(200);
+        ASSERT_EQ(rm.getAttributes(tableName, attrs), success) << "RelationManager::getAttributes() should succeed.";
+        nullsIndicator = initializeNullFieldsIndicator(attrs);
+        ASSERT_EQ(rm.createIndex(tableName, "age"), success) << "RelationManager::createIndex() should succeed.";
+
+        int numTuples = 100;
+        std::vector<PeterDB::RID> rids(numTuples);
+        for (int i = 0; i < numTuples; i++) {
+            prepareTuple((int) attrs.size(), nullsIndicator, 6, "Tester", i, (float) i, (float) i, inBuffer, tupleSize);
+            ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rids[i]), success)
+                                        << "RelationManager::insertTuple() should succeed.";
+        }
+
+        // move every even age above the inserted ones, and rename the odd tuples
+        char value[50];
+        value[0] = 0;
+        for (int i = 0; i < numTuples; i++) {
+            if (i % 2 == 0) {
+                int age = i + numTuples;
+                memcpy(value + 1, &age, sizeof(int));
+                ASSERT_EQ(rm.updateAttribute(tableName, rids[i], "age", value), success)
+                                            << "RelationManager::updateAttribute() should succeed.";
+            } else {
+                int nameLength = 14;
+                memcpy(value + 1, &nameLength, sizeof(int));
+                memcpy(value + 1 + sizeof(int), "Peter Anteater", nameLength);
+                ASSERT_EQ(rm.updateAttribute(tableName, rids[i], "emp_name", value), success)
+                                            << "RelationManager::updateAttribute() should succeed.";
+            }
+        }
+        ASSERT_NE(rm.updateAttribute(tableName, rids[0], "ssn", value), success) << "An unknown attribute should fail.";
+
+        for (int i = 0; i < numTuples; i++) {
+            if (i % 2 == 0)
+                prepareTuple((int) attrs.size(), nullsIndicator, 6, "Tester", i + numTuples, (float) i, (float) i, inBuffer, tupleSize);
+            else
+                prepareTuple((int) attrs.size(), nullsIndicator, 14, "Peter Anteater", i, (float) i, (float) i, inBuffer, tupleSize);
+            ASSERT_EQ(rm.readTuple(tableName, rids[i], outBuffer), success) << "RelationManager::readTuple() should succeed.";
+            ASSERT_EQ(memcmp(inBuffer, outBuffer, tupleSize), 0) << "The tuple should hold the updated attribute.";
+        }
+
+        // the index holds the new ages in place of the old ones
+        PeterDB::RM_IndexScanIterator rmisi;
+        int lowAge = 0, key;
+        ASSERT_EQ(rm.indexScan(tableName, "age", &lowAge, nullptr, true, true, rmisi), success);
+        PeterDB::RID rid;
+        int count = 0;
+        while (rmisi.getNextEntry(rid, &key) != RM_EOF) {
+            ASSERT_TRUE(key % 2 == 1 ? key < numTuples : key >= numTuples) << "Old ages should leave the index.";
+            count++;
+        }
+        ASSERT_EQ(count, numTuples);
+        ASSERT_EQ(rmisi.close(), success);
+
+        // tuples of an older schema version are rewritten whole
+        PeterDB::Attribute attr{"ssn", PeterDB::TypeInt, 4};
+        ASSERT_EQ(rm.addAttribute(tableName, attr), success) << "RelationManager::addAttribute() should succeed.";
+        int ssn = 123;
+        memcpy(value + 1, &ssn, sizeof(int));
+        ASSERT_EQ(rm.updateAttribute(tableName, rids[1], "ssn", value), success);
+        ASSERT_EQ(rm.readAttribute(tableName, rids[1], "ssn", outBuffer), success);
+        ASSERT_EQ(*(int *) ((char *) outBuffer + 1), ssn);
+        ASSERT_EQ(rm.readAttribute(tableName, rids[1], "age", outBuffer), success);
+        ASSERT_EQ(*(int *) ((char *) outBuffer + 1), 1);
+    }
+
+    TEST_F(RM_Version_Test, read_tuples_batch) {
+        // Functions Tested:
+        // 1. Insert tuples, Add Attribute, insert more tuples
+        // 2. Read old and new tuples in one batch
+
+        size_t tupleSize = 0;
+        inBuffer = malloc(200);
+        outBuffer = malloc(200);
+        ASSERT_EQ(rm.getAttributes(tableName, attrs), success) << "RelationManager::getAttributes() should succeed.";
+        nullsIndicator = initializeNullFieldsIndicator(attrs);
+
+        int numTuples = 50;
+        std::vector<PeterDB::RID> rids(2 * numTuples);
+        for (int i = 0; i < numTuples; i++) {
+            prepareTuple((int) attrs.size(), nullsIndicator, 6, "Tester", i, (float) i, (float) i, inBuffer, tupleSize);
+            ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rids[i]), success)
+                                        << "RelationManager::insertTuple() should succeed.";
+        }
+        PeterDB::Attribute attr{"ssn", PeterDB::TypeInt, 4};
+        ASSERT_EQ(rm.addAttribute(tableName, attr), success) << "RelationManager::addAttribute() should succeed.";
+        ASSERT_EQ(rm.getAttributes(tableName, attrs), success) << "RelationManager::getAttributes() should succeed.";
+        free(nullsIndicator);
+        nullsIndicator = initializeNullFieldsIndicator(attrs);
+        for (int i = numTuples; i < 2 * numTuples; i++) {
+            prepareTupleAfterAdd((int) attrs.size(), nullsIndicator, 6, "Tester", i, (float) i, (float) i, i * 10, inBuffer, tupleSize);
+            ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rids[i]), success)
+                                        << "RelationManager::insertTuple() should succeed.";
+        }
+
+        // newest tuples first, so the batch is not in page order
+        std::vector<PeterDB::RID> batch(rids.rbegin(), rids.rend());
+        std::vector<char> data(batch.size() * PAGE_SIZE);
+        std::vector<unsigned> offsets;
+        ASSERT_EQ(rm.readTuples(tableName, batch, data.data(), offsets), success)
+                                    << "RelationManager::readTuples() should succeed.";
+        ASSERT_EQ(offsets.size(), batch.size());
+        for (unsigned i = 0; i < batch.size(); i++) {
+            ASSERT_EQ(rm.readTuple(tableName, batch[i], outBuffer), success);
+            size_t length = PeterDB::RecordBasedFileManager::instance().recordLength(attrs, outBuffer);
+            ASSERT_EQ(memcmp(data.data() + offsets[i], outBuffer, length), 0)
+                                        << "Tuple " << i << " of the batch should match readTuple().";
+        }
+    }
+
+    TEST_F(RM_Version_Test, read_several_attributes) {
+        // Functions Tested:
+        // 1. Insert a tuple, Add Attribute, insert another tuple
+        // 2. Read several attributes of both at once
+
+        size_t tupleSize = 0;
+        inBuffer = malloc(200);
+        outBuffer = malloc(200);
+        ASSERT_EQ(rm.getAttributes(tableName, attrs), success) << "RelationManager::getAttributes() should succeed.";
+        nullsIndicator = initializeNullFieldsIndicator(attrs);
+
+        PeterDB::RID oldRid, newRid;
+        prepareTuple((int) attrs.size(), nullsIndicator, 6, "Tester", 30, 170.5, 5000.5, inBuffer, tupleSize);
+        ASSERT_EQ(rm.insertTuple(tableName, inBuffer, oldRid), success) << "RelationManager::insertTuple() should succeed.";
+        PeterDB::Attribute attr{"ssn", PeterDB::TypeInt, 4};
+        ASSERT_EQ(rm.addAttribute(tableName, attr), success) << "RelationManager::addAttribute() should succeed.";
+        ASSERT_EQ(rm.getAttributes(tableName, attrs), success) << "RelationManager::getAttributes() should succeed.";
+        free(nullsIndicator);
+        nullsIndicator = initializeNullFieldsIndicator(attrs);
+        prepareTupleAfterAdd((int) attrs.size(), nullsIndicator, 5, "Newer", 40, 180.5, 6000.5, 777, inBuffer, tupleSize);
+        ASSERT_EQ(rm.insertTuple(tableName, inBuffer, newRid), success) << "RelationManager::insertTuple() should succeed.";
+
+        std::vector<std::string> names{"ssn", "age", "emp_name"};
+        ASSERT_EQ(rm.readAttributes(tableName, newRid, names, outBuffer), success)
+                                    << "RelationManager::readAttributes() should succeed.";
+        char *out = (char *) outBuffer;
+        ASSERT_EQ(*(unsigned char *) out, 0);
+        ASSERT_EQ(*(int *) (out + 1), 777);
+        ASSERT_EQ(*(int *) (out + 1 + sizeof(int)), 40);
+        ASSERT_EQ(*(int *) (out + 1 + 2 * sizeof(int)), 5);
+        ASSERT_EQ(memcmp(out + 1 + 3 * sizeof(int), "Newer", 5), 0);
+
+        // the older tuple lacks the added attribute
+        ASSERT_EQ(rm.readAttributes(tableName, oldRid, names, outBuffer), success)
+                                    << "RelationManager::readAttributes() should succeed.";
+        ASSERT_EQ(*(unsigned char *) out, 128);
+        ASSERT_EQ(*(int *) (out + 1), 30);
+        ASSERT_EQ(*(int *) (out + 1 + sizeof(int)), 6);
+
+        names.emplace_back("bonus");
+        ASSERT_NE(rm.readAttributes(tableName, newRid, names, outBuffer), success) << "An unknown attribute should fail.";
+    }
+
+    TEST_F(RM_Version_Test, sample_table) {
+        // Functions Tested:
+        // 1. Insert tuples
+        // 2. Sample the table and check the sampled tuples
+
+        size_t tupleSize = 0;
+        inBuffer = malloc(200);
+        outBuffer = malloc(200);
+        ASSERT_EQ(rm.getAttributes(tableName, attrs), success) << "RelationManager::getAttributes() should succeed.";
+        nullsIndicator = initializeNullFieldsIndicator(attrs);
+
+        int numTuples = 1000;
+        for (int i = 0; i < numTuples; i++) {
+            PeterDB::RID rid;
+            prepareTuple((int) attrs.size(), nullsIndicator, 6, "Tester", i, (float) i, (float) i, inBuffer, tupleSize);
+            ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rid), success)
+                                        << "RelationManager::insertTuple() should succeed.";
+        }
+
+        unsigned sampleSize = 30;
+        std::vector<PeterDB::RID> rids;
+        std::vector<char> data(sampleSize * PAGE_SIZE);
+        std::vector<unsigned> offsets;
+        PeterDB::SampleStats stats;
+        ASSERT_EQ(rm.sampleTable(tableName, 3, sampleSize, 1, rids, data.data(), offsets, stats), success)
+                                    << "RelationManager::sampleTable() should succeed.";
+        ASSERT_EQ(rids.size(), sampleSize);
+        ASSERT_EQ(stats.pagesSampled, 3);
+        // scaling the records seen up to the whole table estimates its size
+        double estimate = (double) stats.recordsSeen * stats.pagesInFile / stats.pagesSampled;
+        ASSERT_NEAR(estimate, numTuples, numTuples / 5);
+
+        for (unsigned i = 0; i < rids.size(); i++) {
+            ASSERT_EQ(rm.readTuple(tableName, rids[i], outBuffer), success);
+            ASSERT_EQ(memcmp(data.data() + offsets[i], outBuffer, tupleSize), 0) << "Sampled tuples should be read whole.";
+        }
+        ASSERT_NE(rm.sampleTable("Tables", 3, sampleSize, 1, rids, data.data(), offsets, stats), success)
+                                    << "The catalog should not be sampled.";
+    }
+
+    TEST_F(RM_Version_Test, rebuild_table) {
+        // Functions Tested:
+        // 1. Create an index, insert tuples and delete most of them
+        // 2. Add an attribute, so the remaining tuples are of an older version
+        // 3. Rebuild the table, then scan it and its index
+
+        size_t tupleSize = 0;
+        inBuffer = malloc(200);
+        outBuffer = malloc(200);
+        ASSERT_EQ(rm.getAttributes(tableName, attrs), success) << "RelationManager::getAttributes() should succeed.";
+        nullsIndicator = initializeNullFieldsIndicator(attrs);
+        ASSERT_EQ(rm.createIndex(tableName, "age"), success) << "RelationManager::createIndex() should succeed.";
+
+        int numTuples = 1000;
+        std::vector<PeterDB::RID> rids(numTuples);
+        for (int i = 0; i < numTuples; i++) {
+            prepareTuple((int) attrs.size(), nullsIndicator, 6, "Tester", i, (float) i, (float) i, inBuffer, tupleSize);
+            ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rids[i]), success)
+                                        << "RelationManager::insertTuple() should succeed.";
+        }
+        for (int i = 0; i < numTuples; i++) {
+            if (i % 4 != 0)
+                ASSERT_EQ(rm.deleteTuple(tableName, rids[i]), success) << "RelationManager::deleteTuple() should succeed.";
+        }
+        PeterDB::Attribute attr{"ssn", PeterDB::TypeInt, 4};
+        ASSERT_EQ(rm.addAttribute(tableName, attr), success) << "RelationManager::addAttribute() should succeed.";
+
+        PeterDB::HeapStats before, after;
+        ASSERT_EQ(rm.analyzeTable(tableName, before), success) << "RelationManager::analyzeTable() should succeed.";
+        ASSERT_EQ(rm.rebuildTable(tableName), success) << "RelationManager::rebuildTable() should succeed.";
+        ASSERT_EQ(rm.analyzeTable(tableName, after), success) << "RelationManager::analyzeTable() should succeed.";
+        ASSERT_EQ(after.records, numTuples / 4);
+        ASSERT_LE(after.pages * 3, before.pages) << "A quarter of the tuples should need far fewer pages.";
+        ASSERT_EQ(after.emptySlots, 0);
+        ASSERT_EQ(after.chains.tombstones, 0);
+        ASSERT_EQ(after.versions.back(), numTuples / 4) << "Every tuple should be of the current version.";
+        ASSERT_FALSE(fileExists(tableName + ".rebuild")) << "The rebuilt file should replace the table file.";
+
+        // the tuples are read in the current schema and the index points at their new RIDs
+        std::vector<std::string> attrNames{"age", "ssn"};
+        PeterDB::RM_ScanIterator rmsi;
+        ASSERT_EQ(rm.scan(tableName, "", PeterDB::NO_OP, nullptr, attrNames, rmsi), success);
+        PeterDB::RID rid;
+        int count = 0;
+        while (rmsi.getNextTuple(rid, outBuffer) != RM_EOF) {
+            ASSERT_EQ(*(int *) ((char *) outBuffer + 1) % 4, 0);
+            ASSERT_EQ(*(unsigned char *) outBuffer, 64) << "The added attribute should be null.";
+            count++;
+        }
+        ASSERT_EQ(count, numTuples / 4);
+        ASSERT_EQ(rmsi.close(), success);
+
+        PeterDB::RM_IndexScanIterator rmisi;
+        int key;
+        ASSERT_EQ(rm.indexScan(tableName, "age", nullptr, nullptr, true, true, rmisi), success);
+        count = 0;
+        while (rmisi.getNextEntry(rid, &key) != RM_EOF) {
+            ASSERT_EQ(rm.readAttribute(tableName, rid, "age", outBuffer), success);
+            ASSERT_EQ(*(int *) ((char *) outBuffer + 1), key) << "Index entries should point at the rebuilt tuples.";
+            count++;
+        }
+        ASSERT_EQ(count, numTuples / 4);
+        ASSERT_EQ(rmisi.close(), success);
+    }
+
+    TEST_F(RM_Version_Test, rebuild_swap_is_finished) {
+        // Functions Tested:
+        // 1. Leave a rebuilt table file and the manifest committing it, as a rebuild cut short after committing would
+        // 2. Insert more tuples into the old table file
+        // 3. Rebuild the table, which first swaps the committed file in
+
+        size_t tupleSize = 0;
+        inBuffer = malloc(200);
+        outBuffer = malloc(200);
+        ASSERT_EQ(rm.getAttributes(tableName, attrs), success) << "RelationManager::getAttributes() should succeed.";
+        nullsIndicator = initializeNullFieldsIndicator(attrs);
+
+        PeterDB::RID rid;
+        int numTuples = 20;
+        for (int i = 0; i < numTuples; i++) {
+            if (i == numTuples / 2) {
+                std::ifstream table(tableName, std::ios::binary);
+                std::ofstream rebuilt(tableName + ".rebuild", std::ios::binary);
+                rebuilt << table.rdbuf();
+            }
+            prepareTuple((int) attrs.size(), nullsIndicator, 6, "Tester", i, (float) i, (float) i, inBuffer, tupleSize);
+            ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rid), success) << "RelationManager::insertTuple() should succeed.";
+        }
+        std::ofstream manifest(tableName + ".swap");
+        manifest << tableName << '\n';
+        manifest.close();
+
+        ASSERT_EQ(rm.rebuildTable(tableName), success) << "RelationManager::rebuildTable() should succeed.";
+        ASSERT_FALSE(fileExists(tableName + ".swap")) << "The manifest should be removed once the swap is done.";
+        ASSERT_FALSE(fileExists(tableName + ".rebuild")) << "The rebuilt file should replace the table file.";
+
+        std::vector<std::string> attrNames{"age"};
+        PeterDB::RM_ScanIterator rmsi;
+        ASSERT_EQ(rm.scan(tableName, "", PeterDB::NO_OP, nullptr, attrNames, rmsi), success);
+        int count = 0;
+        while (rmsi.getNextTuple(rid, outBuffer) != RM_EOF) {
+            ASSERT_LT(*(int *) ((char *) outBuffer + 1), numTuples / 2) << "Only the tuples of the committed file should remain.";
+            count++;
+        }
+        ASSERT_EQ(count, numTuples / 2);
+        ASSERT_EQ(rmsi.close(), success);
+    }
+
+    TEST_F(RM_Version_Test, composite_index_prefix_scan) {
+        // Functions Tested:
+        // 1. Create an index on (emp_name, age) over inserted tuples
+        // 2. Scan the entries of one name, which come in age order
+        // 3. Update and delete tuples, then scan one name and one (name, age) pair
+
+        size_t tupleSize = 0;
+        inBuffer = malloc(200);
+        outBuffer = malloc(200);
+        ASSERT_EQ(rm.getAttributes(tableName, attrs), success) << "RelationManager::getAttributes() should succeed.";
+        nullsIndicator = initializeNullFieldsIndicator(attrs);
+
+        int numTuples = 300;
+        std::vector<PeterDB::RID> rids(numTuples);
+        for (int i = 0; i < numTuples; i++) {
+            std::string name = "Tester" + std::to_string(i % 3);
+            prepareTuple((int) attrs.size(), nullsIndicator, name.size(), name, 150 - i, (float) i, (float) i, inBuffer,
+                         tupleSize);
+            ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rids[i]), success)
+                                        << "RelationManager::insertTuple() should succeed.";
+        }
+        std::vector<std::string> keyNames{"emp_name", "age"};
+        ASSERT_EQ(rm.createIndex(tableName, keyNames), success) << "RelationManager::createIndex() should succeed.";
+
+        // the scanned names and (name, age) pairs are tuples in the insertTuple() format
+        int nameLength = 7;
+        char prefix[20];
+        prefix[0] = 0;
+        memcpy(prefix + 1, &nameLength, sizeof(int));
+        memcpy(prefix + 1 + sizeof(int), "Tester1", nameLength);
+        char *prefixAge = prefix + 1 + sizeof(int) + nameLength;
+
+        PeterDB::RM_IndexScanIterator rmisi;
+        PeterDB::RID rid;
+        char key[20];
+        int count = 0, age, lastAge = INT32_MIN;
+        ASSERT_EQ(rm.indexScan(tableName, keyNames, prefix, 1, rmisi), success);
+        while (rmisi.getNextKeyTuple(rid, key) != RM_EOF) {
+            ASSERT_EQ(memcmp(key, prefix, prefixAge - prefix), 0) << "Only entries of the scanned name should be returned.";
+            memcpy(&age, key + (prefixAge - prefix), sizeof(int));
+            ASSERT_GT(age, lastAge) << "Entries of one name should come in age order.";
+            ASSERT_EQ(rm.readAttribute(tableName, rid, "age", outBuffer), success);
+            ASSERT_EQ(*(int *) ((char *) outBuffer + 1), age) << "Index entries should point at their tuples.";
+            lastAge = age;
+            count++;
+        }
+        ASSERT_EQ(count, numTuples / 3);
+        ASSERT_EQ(lastAge, 149);
+        ASSERT_EQ(rmisi.close(), success);
+
+        // rids[1], rids[4] and rids[7] hold Tester1: one changes age, one is renamed and one is deleted
+        char value[50];
+        value[0] = 0;
+        age = -1000;
+        memcpy(value + 1, &age, sizeof(int));
+        ASSERT_EQ(rm.updateAttribute(tableName, rids[1], "age", value), success)
+                                    << "RelationManager::updateAttribute() should succeed.";
+        memcpy(value + 1, &nameLength, sizeof(int));
+        memcpy(value + 1 + sizeof(int), "Tester2", nameLength);
+        ASSERT_EQ(rm.updateAttribute(tableName, rids[4], "emp_name", value), success)
+                                    << "RelationManager::updateAttribute() should succeed.";
+        ASSERT_EQ(rm.deleteTuple(tableName, rids[7]), success) << "RelationManager::deleteTuple() should succeed.";
+
+        ASSERT_EQ(rm.indexScan(tableName, keyNames, prefix, 1, rmisi), success);
+        count = 0;
+        while (rmisi.getNextKeyTuple(rid, key) != RM_EOF) {
+            if (count == 0) ASSERT_TRUE(rid == rids[1]) << "The lowest age should come first.";
+            ASSERT_FALSE(rid == rids[4]) << "A renamed tuple should leave the range.";
+            ASSERT_FALSE(rid == rids[7]) << "A deleted tuple should leave the index.";
+            count++;
+        }
+        ASSERT_EQ(count, numTuples / 3 - 2);
+        ASSERT_EQ(rmisi.close(), success);
+
+        memcpy(prefixAge, &age, sizeof(int));
+        ASSERT_EQ(rm.indexScan(tableName, keyNames, prefix, 2, rmisi), success);
+        ASSERT_EQ(rmisi.getNextKeyTuple(rid, key), success);
+        ASSERT_TRUE(rid == rids[1]);
+        ASSERT_EQ(memcmp(key, prefix, prefixAge + sizeof(int) - prefix), 0);
+        ASSERT_EQ(rmisi.getNextKeyTuple(rid, key), RM_EOF);
+        ASSERT_EQ(rmisi.close(), success);
+        ASSERT_EQ(rm.destroyIndex(tableName, keyNames), success) << "RelationManager::destroyIndex() should succeed.";
+    }
 
 } // namespace PeterDBTesting